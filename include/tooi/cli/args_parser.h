@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
+#include "tooi/core/interpreter_options.h"
+
 /**
  * @namespace tooi
  * @brief The main namespace for the Tooi project.
@@ -58,6 +60,12 @@ public:
      */
     bool is_verbose() const;
 
+    /**
+     * @brief Gets the interpreter settings selected on the command line.
+     * @return The options (verbose, --no-opt, ...) to pass to the interpreter.
+     */
+    const core::InterpreterOptions &get_options() const;
+
     /**
      * @brief Displays a standard help message to the console.
      * @param program_name The name of the executable (argv[0]), used in the help message.
@@ -73,7 +81,7 @@ private:
     RunMode mode_ = RunMode::REPL;  ///< @brief The determined run mode. Defaults to REPL.
     std::string filename_;          ///< @brief Stores the filename if provided.
     std::string error_message_;     ///< @brief Stores any error message encountered during parsing.
-    bool verbose_ = false;          ///< @brief Flag for verbose output.
+    core::InterpreterOptions options_;  ///< @brief Interpreter settings (includes verbose).
 };
 
 }  // namespace cli
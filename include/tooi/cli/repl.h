@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+
+#include "tooi/core/interpreter_options.h"
 // #include <csignal> // Definitely remove now
 
 /**
@@ -22,9 +24,9 @@ class Repl {
 public:
     /**
      * @brief Constructs a Repl instance.
-     * @param verbose Enable verbose output during execution.
+     * @param options Interpreter settings (verbosity, optimization).
      */
-    explicit Repl(bool verbose = false);
+    explicit Repl(core::InterpreterOptions options = {});
 
     /**
      * @brief Starts the REPL, processing user input until termination.
@@ -32,7 +34,7 @@ public:
     void run();
 
 private:
-    bool verbose_ = false; // Flag for verbose output
+    core::InterpreterOptions options_; // Settings passed to the interpreter
     // No signal-related members needed
 };
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "tooi/vm/aot.h"
+
+namespace tooi {
+namespace cli {
+
+/**
+ * @brief Runs a script compiled ahead of time: the `main` of the C++ that --emit-cpp writes.
+ *
+ * Compiles the embedded script with the options it was emitted with and
+ * runs it, its chunks in their generated functions where those still match.
+ * The only command-line option is --vm-stats.
+ *
+ * @param program The script and its generated code.
+ * @return The process exit code: 0 if the script ran without errors.
+ */
+int run_compiled(const vm::AotProgram& program, int argc, char* argv[]);
+
+} // namespace cli
+} // namespace tooi
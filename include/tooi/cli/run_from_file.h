@@ -2,6 +2,8 @@
 
 #include <string> // Needed for filename
 
+#include "tooi/core/interpreter_options.h"
+
 namespace tooi {
 namespace cli {
 
@@ -12,12 +14,12 @@ namespace cli {
  * using the file's content as input.
  *
  * @param filename The path to the script file.
- * @param verbose Enable verbose output during interpretation.
+ * @param options Interpreter settings (verbosity, optimization).
  * @return True if the file was opened and the script executed without fatal
  *         interpreter errors, false otherwise (e.g., file not found, fatal
  *         interpreter error).
  */
-bool run_from_file(const std::string& filename, bool verbose);
+bool run_from_file(const std::string& filename, const core::InterpreterOptions& options);
 
 } // namespace cli
 } // namespace tooi 
\ No newline at end of file
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "tooi/core/source_location.h"
+#include "tooi/core/token.h"
+#include "tooi/core/types.h"
+
+namespace tooi {
+namespace core {
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+/**
+ * @brief The different kinds of expression nodes.
+ *
+ * Passes dispatch on the kind and static_cast to the concrete node type.
+ */
+enum class ExprKind {
+    Literal,     ///< 42, 3.14, "text", true, nil
+    Identifier,  ///< name
+    Self,        ///< self
+    Unary,       ///< -a, not a
+    Binary,      ///< a + b, a < b, a == b, ...
+    Logical,     ///< a and b, a or b (short-circuit)
+    Cast,        ///< a as int (also implicit conversions inserted by the type checker)
+    Array,       ///< [1, 2, 3]
+    Tuple,       ///< (1, 2)
+    Assoc,       ///< ["key" -> value, ...]
+    Index,       ///< a[i]
+    Property,    ///< a.name
+    Invoke,      ///< @name(args), a.@name(args)
+    New,         ///< new a
+    Object       ///< => { mode } @ { act }
+};
+
+/**
+ * @brief Value of a literal. Integers are signed unless the literal is unsigned
+ *        or does not fit in int64.
+ */
+using LiteralValue = std::variant<std::monostate, bool, int64_t, uint64_t, double, std::string>;
+
+/**
+ * @brief Base class of all expression nodes.
+ */
+struct Expr {
+    Expr(ExprKind kind, SourceLocation loc) : kind(kind), loc(loc) {}
+    virtual ~Expr() = default;
+
+    ExprKind kind;
+    SourceLocation loc;
+    TypeRef type;  ///< Static type, attached by the TypeChecker (null before checking)
+};
+
+using ExprPtr = std::unique_ptr<Expr>;
+
+/**
+ * @brief How a name was resolved by the type checker.
+ */
+enum class BindingKind {
+    Unresolved,  ///< Not yet resolved
+    Local,       ///< Local variable or param of the enclosing act (slot = local index)
+    Upvalue,     ///< Local of an enclosing act, captured by value (slot = upvalue index)
+    Property,    ///< Property of the enclosing act's object (`self`)
+    Global,      ///< Top-level binding (slot = global index)
+    Dynamic      ///< Unknown at compile time: looked up on `self`, then globals, at runtime
+};
+
+/**
+ * @brief Result of name resolution, attached to identifiers and bindings.
+ */
+struct Resolution {
+    BindingKind kind = BindingKind::Unresolved;
+    int slot = -1;          ///< Local, upvalue or global index, -1 otherwise
+    bool is_set = false;    ///< True if the binding is immutable (`set`)
+};
+
+struct LiteralExpr : Expr {
+    LiteralExpr(LiteralValue value, SourceLocation loc)
+        : Expr(ExprKind::Literal, loc), value(std::move(value)) {}
+    LiteralValue value;
+    TypeRef suffix_type;  ///< Type forced by a numeric suffix (e.g. `42u64`), null if none
+};
+
+struct IdentifierExpr : Expr {
+    IdentifierExpr(std::string name, SourceLocation loc)
+        : Expr(ExprKind::Identifier, loc), name(std::move(name)) {}
+    std::string name;
+    Resolution resolution;
+};
+
+struct SelfExpr : Expr {
+    explicit SelfExpr(SourceLocation loc) : Expr(ExprKind::Self, loc) {}
+};
+
+struct UnaryExpr : Expr {
+    UnaryExpr(TokenType op, ExprPtr operand, SourceLocation loc)
+        : Expr(ExprKind::Unary, loc), op(op), operand(std::move(operand)) {}
+    TokenType op;  ///< MINUS or NOT
+    ExprPtr operand;
+};
+
+struct BinaryExpr : Expr {
+    BinaryExpr(TokenType op, ExprPtr left, ExprPtr right, SourceLocation loc)
+        : Expr(ExprKind::Binary, loc), op(op), left(std::move(left)), right(std::move(right)) {}
+    TokenType op;  ///< PLUS, MINUS, ASTERISK, SLASH, PERCENT or a comparison
+    ExprPtr left;
+    ExprPtr right;
+};
+
+struct LogicalExpr : Expr {
+    LogicalExpr(TokenType op, ExprPtr left, ExprPtr right, SourceLocation loc)
+        : Expr(ExprKind::Logical, loc), op(op), left(std::move(left)), right(std::move(right)) {}
+    TokenType op;  ///< AND or OR
+    ExprPtr left;
+    ExprPtr right;
+};
+
+/**
+ * @brief The flavour of a conversion.
+ */
+enum class CastKind {
+    Explicit,  ///< `a as T`: converting (e.g. "42" as int parses the string)
+    Widen,     ///< Implicit lossless numeric conversion inserted by the type checker
+    Check      ///< Implicit proto -> T conversion, checked at runtime
+};
+
+struct CastExpr : Expr {
+    CastExpr(ExprPtr operand, TypeRef target, CastKind cast_kind, SourceLocation loc)
+        : Expr(ExprKind::Cast, loc), operand(std::move(operand)), target(std::move(target)),
+          cast_kind(cast_kind) {}
+    ExprPtr operand;
+    TypeRef target;
+    CastKind cast_kind;
+};
+
+struct ArrayExpr : Expr {
+    explicit ArrayExpr(SourceLocation loc) : Expr(ExprKind::Array, loc) {}
+    std::vector<ExprPtr> elements;
+};
+
+struct TupleExpr : Expr {
+    explicit TupleExpr(SourceLocation loc) : Expr(ExprKind::Tuple, loc) {}
+    std::vector<ExprPtr> elements;
+};
+
+struct AssocExpr : Expr {
+    explicit AssocExpr(SourceLocation loc) : Expr(ExprKind::Assoc, loc) {}
+    std::vector<ExprPtr> keys;
+    std::vector<ExprPtr> values;
+};
+
+struct IndexExpr : Expr {
+    IndexExpr(ExprPtr object, ExprPtr index, SourceLocation loc)
+        : Expr(ExprKind::Index, loc), object(std::move(object)), index(std::move(index)) {}
+    ExprPtr object;
+    ExprPtr index;
+};
+
+struct PropertyExpr : Expr {
+    PropertyExpr(ExprPtr object, std::string name, SourceLocation loc)
+        : Expr(ExprKind::Property, loc), object(std::move(object)), name(std::move(name)) {}
+    ExprPtr object;
+    std::string name;
+};
+
+/**
+ * @brief Invocation of an act: `@name(args)` (receiver is null) or `receiver.@name(args)`.
+ */
+struct InvokeExpr : Expr {
+    InvokeExpr(ExprPtr receiver, std::string name, SourceLocation loc)
+        : Expr(ExprKind::Invoke, loc), receiver(std::move(receiver)), name(std::move(name)) {}
+    ExprPtr receiver;
+    std::string name;
+    Resolution resolution;  ///< Resolution of `name` when there is no receiver
+    std::vector<ExprPtr> args;
+};
+
+struct NewExpr : Expr {
+    NewExpr(ExprPtr operand, SourceLocation loc)
+        : Expr(ExprKind::New, loc), operand(std::move(operand)) {}
+    ExprPtr operand;
+};
+
+struct Stmt;
+using StmtPtr = std::unique_ptr<Stmt>;
+
+/**
+ * @brief A local variable slot of an act, recorded by the type checker.
+ */
+struct LocalInfo {
+    std::string name;
+    TypeRef type;
+    bool is_set = false;
+};
+
+/**
+ * @brief Describes where a captured variable comes from in the enclosing act.
+ */
+struct UpvalueInfo {
+    std::string name;
+    TypeRef type;
+    bool from_local = true;  ///< True: enclosing act's local slot; false: its upvalue
+    int index = -1;          ///< Slot in the enclosing act
+};
+
+/**
+ * @brief The body of an act that the parser only skipped over, to be parsed
+ * and checked on the act's first invocation (see Parser).
+ */
+struct DeferredBody {
+    std::vector<Token> tokens;  ///< Between the braces, followed by END_OF_FILE
+    bool rejected = false;      ///< Parsing or checking it reported errors
+
+    // --- Filled in by the TypeChecker, to check the body as if it were checked in place ---
+    std::shared_ptr<ObjectInfo> self;  ///< The object as defined so far
+    TypeRef self_type;
+    size_t visible_declarations = 0;  ///< GlobalTable::declarations() at the act
+};
+
+/**
+ * @brief The executable part of an object (`@ { ... }`).
+ */
+struct ActDecl {
+    std::vector<StmtPtr> body;
+    SourceLocation loc;
+    std::string name;  ///< Name of the binding the act belongs to, for diagnostics
+    std::unique_ptr<DeferredBody> deferred;  ///< Set while the body is not parsed yet
+
+    // --- Filled in by the TypeChecker ---
+    std::vector<LocalInfo> locals;      ///< Params first, then locals in declaration order
+    std::vector<UpvalueInfo> upvalues;  ///< Captured variables of enclosing acts
+    int param_count = 0;
+};
+
+/**
+ * @brief One entry of a mode block: a property or a parameter declaration.
+ */
+struct ModeEntry {
+    enum class Kind { Property, Param };
+    Kind kind = Kind::Property;
+    std::string name;
+    bool is_set = false;
+    bool is_private = false;
+    TypeRef declared_type;  ///< Explicit annotation, null if none
+    TypeRef type;           ///< Checked type: the annotation or the initializer's type
+    ExprPtr value;          ///< Initializer, null if none
+    SourceLocation loc;
+};
+
+/**
+ * @brief An object literal: a mode block and/or an act block.
+ *
+ * Appears as the value of `let x => {...} @ {...}`, `let x >> {...}` and
+ * `let x @ {...}` bindings, and as nested object properties.
+ */
+struct ObjectExpr : Expr {
+    explicit ObjectExpr(SourceLocation loc) : Expr(ExprKind::Object, loc) {}
+    std::vector<ModeEntry> mode;
+    std::unique_ptr<ActDecl> act;  ///< Null if the object has no act
+    bool is_pure = false;
+    bool is_runnable = false;
+};
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+enum class StmtKind {
+    Add,         ///< add io;
+    Bind,        ///< let/set ...;
+    Expression,  ///< expr;
+    If,
+    While,
+    For,
+    Block,
+    Done,  ///< done; (leave the innermost loop)
+    Skip,  ///< skip; (continue with the next iteration)
+    Be     ///< be expr; (finish the act with a result)
+};
+
+struct Stmt {
+    Stmt(StmtKind kind, SourceLocation loc) : kind(kind), loc(loc) {}
+    virtual ~Stmt() = default;
+
+    StmtKind kind;
+    SourceLocation loc;
+};
+
+struct AddStmt : Stmt {
+    AddStmt(std::string module, SourceLocation loc)
+        : Stmt(StmtKind::Add, loc), module(std::move(module)) {}
+    std::string module;
+    Resolution resolution;
+};
+
+/**
+ * @brief The operator of a binding statement.
+ */
+enum class BindOp {
+    Declare,   ///< let x : T;          (no value)
+    Assign,    ///< let x -> value;
+    Compound,  ///< let x + value;      (also -, *, /, %)
+    Define,    ///< let x => { mode } [@ { act }];
+    Append,    ///< let x >> { mode };
+    Act        ///< let x @ { act };
+};
+
+/**
+ * @brief Modifiers and type given after `:` in a binding or mode entry.
+ */
+struct TypeAnnotation {
+    TypeRef type;  ///< Null if only modifiers were given
+    bool is_public = false;
+    bool is_private = false;
+    bool is_pure = false;
+    bool is_runnable = false;
+};
+
+struct BindStmt : Stmt {
+    BindStmt(bool is_set, ExprPtr target, SourceLocation loc)
+        : Stmt(StmtKind::Bind, loc), is_set(is_set), target(std::move(target)) {}
+    bool is_set;     ///< `set` instead of `let`
+    ExprPtr target;  ///< IdentifierExpr, PropertyExpr or IndexExpr
+    std::optional<TypeAnnotation> annotation;
+    BindOp op = BindOp::Declare;
+    TokenType compound_op = TokenType::PLUS;  ///< Operator of a Compound binding
+    ExprPtr value;  ///< Assign/Compound: the value; Define/Append/Act: an ObjectExpr
+
+    // --- Filled in by the TypeChecker ---
+    bool declares = false;  ///< True if this statement introduces a new binding
+    TypeRef binding_type;   ///< Type of the bound name after the statement
+};
+
+struct ExpressionStmt : Stmt {
+    ExpressionStmt(ExprPtr expr, SourceLocation loc)
+        : Stmt(StmtKind::Expression, loc), expr(std::move(expr)) {}
+    ExprPtr expr;
+};
+
+struct BlockStmt : Stmt {
+    explicit BlockStmt(SourceLocation loc) : Stmt(StmtKind::Block, loc) {}
+    std::vector<StmtPtr> statements;
+};
+
+struct IfStmt : Stmt {
+    IfStmt(ExprPtr condition, StmtPtr then_branch, StmtPtr else_branch, SourceLocation loc)
+        : Stmt(StmtKind::If, loc), condition(std::move(condition)),
+          then_branch(std::move(then_branch)), else_branch(std::move(else_branch)) {}
+    ExprPtr condition;
+    StmtPtr then_branch;  ///< BlockStmt
+    StmtPtr else_branch;  ///< BlockStmt, IfStmt or null
+};
+
+struct WhileStmt : Stmt {
+    WhileStmt(ExprPtr condition, StmtPtr body, SourceLocation loc)
+        : Stmt(StmtKind::While, loc), condition(std::move(condition)), body(std::move(body)) {}
+    ExprPtr condition;
+    StmtPtr body;  ///< BlockStmt
+};
+
+struct ForStmt : Stmt {
+    ForStmt(std::string variable, ExprPtr iterable, StmtPtr body, SourceLocation loc)
+        : Stmt(StmtKind::For, loc), variable(std::move(variable)),
+          iterable(std::move(iterable)), body(std::move(body)) {}
+    std::string variable;
+    ExprPtr iterable;
+    StmtPtr body;  ///< BlockStmt
+    Resolution resolution;  ///< Where the loop variable lives
+    TypeRef variable_type;  ///< Static type of the loop variable
+};
+
+struct DoneStmt : Stmt {
+    explicit DoneStmt(SourceLocation loc) : Stmt(StmtKind::Done, loc) {}
+};
+
+struct SkipStmt : Stmt {
+    explicit SkipStmt(SourceLocation loc) : Stmt(StmtKind::Skip, loc) {}
+};
+
+struct BeStmt : Stmt {
+    BeStmt(ExprPtr value, SourceLocation loc) : Stmt(StmtKind::Be, loc), value(std::move(value)) {}
+    ExprPtr value;  ///< Null for a plain `be;`
+};
+
+/**
+ * @brief A parsed translation unit (a script file or one REPL submission).
+ */
+struct Program {
+    std::vector<StmtPtr> statements;
+};
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/type_checker.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @brief Counters reported by the AstOptimizer (printed with --verbose).
+ */
+struct AstOptimizerStats {
+    int folded_expressions = 0;     ///< Operators and casts replaced by literals
+    int propagated_constants = 0;   ///< Uses of constant `set` bindings replaced by literals
+    int removed_branches = 0;       ///< if/while branches removed because of constant conditions
+    int removed_statements = 0;     ///< Statements removed after `be`, `done` or `skip`
+};
+
+/**
+ * @class AstOptimizer
+ * @brief Constant folding and dead branch elimination on the checked AST.
+ *
+ * Runs after the TypeChecker, so every expression has a static type and
+ * folding can follow the typed semantics exactly: integer operations are
+ * only folded when the result fits the operand type (overflow and division
+ * by zero are left to the runtime, which reports them), float32 results are
+ * rounded to float precision, and conversions use the same routines as the
+ * runtime (see conversions.h).
+ *
+ * `set` bindings initialized with a constant are propagated into later uses
+ * when the binding is made unconditionally, i.e. at the top level of the
+ * script or of an act body. Constant globals are remembered in the
+ * GlobalTable so later REPL submissions can use them too.
+ */
+class AstOptimizer {
+public:
+    explicit AstOptimizer(GlobalTable& globals);
+
+    /**
+     * @brief Optimizes a checked program in place.
+     */
+    void optimize(Program& program);
+
+    /**
+     * @brief Optimizes a checked act body in place (used for deferred bodies).
+     */
+    void optimize_act(ActDecl& act);
+
+    const AstOptimizerStats& stats() const { return stats_; }
+
+private:
+    GlobalTable& globals_;
+    AstOptimizerStats stats_;
+    // Constant `set` locals of the act currently being optimized, by slot.
+    std::unordered_map<int, LiteralValue>* locals_ = nullptr;
+
+    // --- Statements ---
+    void optimize_block(std::vector<StmtPtr>& statements, bool straight_line);
+    StmtPtr optimize_statement(StmtPtr stmt, bool straight_line);
+    void optimize_bind(BindStmt& stmt, bool straight_line);
+    void optimize_object(ObjectExpr& object);
+
+    // --- Expressions ---
+    void optimize_expr(ExprPtr& expr);
+    void fold_unary(ExprPtr& expr);
+    void fold_binary(ExprPtr& expr);
+    void fold_logical(ExprPtr& expr);
+    void fold_cast(ExprPtr& expr);
+    void propagate(ExprPtr& expr);
+    void replace_with_literal(ExprPtr& expr, LiteralValue value, const TypeRef& type);
+};
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/token.h"
+#include "tooi/core/types.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @file constant_folding.h
+ * @brief Operations on typed literal values, shared by every compile-time evaluator.
+ *
+ * The AstOptimizer and the IR's compile-time evaluation of pure acts both
+ * compute values the runtime would otherwise compute, so they share these
+ * routines. Each returns std::nullopt where the runtime would raise an error
+ * (integer overflow, division by zero, out-of-range conversions) or where the
+ * result is decided by runtime rules (mixed types), leaving the operation to
+ * the runtime.
+ */
+
+// Integer literals hold int64_t for signed and uint64_t for unsigned types, but
+// these accept both representations to stay robust against untyped literals.
+int64_t as_signed(const LiteralValue& value);
+uint64_t as_unsigned(const LiteralValue& value);
+double as_double(const LiteralValue& value);
+
+/// Text produced by string concatenation and `as string`.
+std::string display_string(const LiteralValue& value, const TypeRef& type);
+
+/**
+ * @brief Converts a numeric value of type `from` to the numeric type `to`.
+ * @return std::nullopt if the value does not fit (the runtime reports that).
+ */
+std::optional<LiteralValue> convert_numeric(const LiteralValue& value, const TypeRef& from,
+                                            const TypeRef& to);
+
+/**
+ * @brief `text as <to>` for a numeric type `to`.
+ * @return std::nullopt if the text is not a number or does not fit.
+ */
+std::optional<LiteralValue> parse_number(std::string_view text, const TypeRef& to);
+
+/**
+ * @brief Explicit `as` conversion between primitive types.
+ */
+std::optional<LiteralValue> convert_literal(const LiteralValue& value, const TypeRef& from,
+                                            const TypeRef& to);
+
+/**
+ * @brief `+ - * / %` on two numeric values of the same type.
+ */
+std::optional<LiteralValue> fold_arithmetic(TokenType op, const LiteralValue& a,
+                                            const LiteralValue& b, const TypeRef& type);
+
+/**
+ * @brief Unary minus on a numeric value.
+ */
+std::optional<LiteralValue> fold_negate(const LiteralValue& value, const TypeRef& type);
+
+/**
+ * @brief Equality and ordered comparisons of two values of the same type.
+ *
+ * Ordered comparisons involving NaN are false and NaN is not equal to anything.
+ */
+std::optional<bool> fold_comparison(TokenType op, const LiteralValue& a, const LiteralValue& b,
+                                    const TypeRef& type);
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "tooi/core/types.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @file conversions.h
+ * @brief Value <-> text conversions shared by the optimizer and the runtime.
+ *
+ * Constant folding must produce exactly what the runtime would, so `as`
+ * conversions and string concatenation both go through these functions.
+ *
+ * They are built on std::to_chars and std::from_chars: no locale, no
+ * streams, and no exceptions for malformed text. Floats are formatted as the
+ * shortest text that reads back as the same value (of float32 precision for
+ * a float32), in fixed or scientific notation, whichever is shorter.
+ */
+
+/// Formats a signed integer in decimal.
+std::string format_int(int64_t value);
+
+/// Formats an unsigned integer in decimal.
+std::string format_uint(uint64_t value);
+
+/**
+ * @brief Formats a floating point number.
+ * @param is_float32 Format with float32 precision (the value is a rounded float).
+ */
+std::string format_float(double value, bool is_float32);
+
+/// format_int(), appended to `out` in place.
+void append_int(int64_t value, std::string& out);
+/// format_uint(), appended to `out` in place.
+void append_uint(uint64_t value, std::string& out);
+/// format_float(), appended to `out` in place.
+void append_float(double value, bool is_float32, std::string& out);
+
+/**
+ * @brief Parses a signed integer that must fit in the given integer type.
+ *
+ * Like the other parsers, accepts leading whitespace and a `+` sign, and
+ * nothing after the number.
+ * @return The value, or std::nullopt if the text is malformed or out of range.
+ */
+std::optional<int64_t> parse_int(std::string_view text, const TypeRef& type);
+
+/**
+ * @brief Parses an unsigned integer that must fit in the given integer type.
+ * @return The value, or std::nullopt if the text is malformed or out of range.
+ */
+std::optional<uint64_t> parse_uint(std::string_view text, const TypeRef& type);
+
+/**
+ * @brief Parses a floating point number (also `inf` and `nan`).
+ * @return The value, or std::nullopt if the text is malformed or out of range.
+ */
+std::optional<double> parse_float(std::string_view text);
+
+}  // namespace core
+}  // namespace tooi
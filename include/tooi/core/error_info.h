@@ -43,17 +43,65 @@ enum class ErrorCode {
     Scanner_InvalidSuffixForFloat,        // ADDED: e.g., 1.23i32
 
     // --- Parser Errors ---
-    // TODO: Add parser error codes
-
     Parser_UnexpectedToken,
     Parser_ExpectedExpression,
-    // ... other parser errors
+    Parser_ExpectedToken,           // e.g., missing ';' or ')'
+    Parser_ExpectedIdentifier,
+    Parser_ExpectedType,
+    Parser_InvalidBindingTarget,    // e.g., "let a.b : int -> 1"
+    Parser_InvalidModeEntry,        // mode blocks only contain let/set/param entries
 
     // --- Semantic Errors ---
-    // TODO: Add semantic error codes
+    Semantic_UndefinedName,
+    Semantic_TypeMismatch,
+    Semantic_InvalidOperands,
+    Semantic_InvalidUnaryOperand,
+    Semantic_ExpectedBool,
+    Semantic_InvalidCast,
+    Semantic_AssignToImmutable,
+    Semantic_NotIndexable,
+    Semantic_InvalidIndex,
+    Semantic_TupleIndexOutOfRange,
+    Semantic_UnknownMember,
+    Semantic_PrivateAccess,
+    Semantic_NotInvocable,
+    Semantic_TooManyArguments,
+    Semantic_SelfOutsideAct,
+    Semantic_LoopControlOutsideLoop,
+    Semantic_BeOutsideAct,
+    Semantic_UnknownModule,
+    Semantic_AddNotTopLevel,
+    Semantic_IntegerLiteralOutOfRange,
+    Semantic_NotAnObject,           // e.g., ">>" applied to an int
+    Semantic_ComplexCompoundTarget, // e.g., "let arr[@next()] + 1"
+    Semantic_PureMutation,          // Pure act modifies state it does not own
+    Semantic_PureIO,                // Pure act uses a module (I/O)
+    Semantic_PureCall,              // Pure act invokes an act that is not pure
 
     // --- Runtime Errors ---
-    // TODO: Add runtime error codes
+    Runtime_TypeMismatch,           // proto value does not have the expected type
+    Runtime_InvalidConversion,      // `as` conversion failed (e.g., "abc" as int)
+    Runtime_InvalidOperands,
+    Runtime_InvalidUnaryOperand,
+    Runtime_IntegerOverflow,
+    Runtime_DivisionByZero,
+    Runtime_IndexOutOfRange,
+    Runtime_InvalidIndex,           // Index of the wrong type (e.g., a string for an array)
+    Runtime_MissingKey,
+    Runtime_NotIndexable,
+    Runtime_ElementNotAssignable,   // e.g., assigning to a tuple element
+    Runtime_NotIterable,
+    Runtime_UnknownProperty,
+    Runtime_NotAnObject,
+    Runtime_AssignToImmutable,
+    Runtime_NotInvocable,
+    Runtime_TooManyArguments,
+    Runtime_MissingArgument,        // Builtin method invoked without a required argument
+    Runtime_UnknownMethod,
+    Runtime_UndefinedName,
+    Runtime_EmptyArray,
+    Runtime_StackOverflow,
+    Runtime_ActHasErrors,           // Deferred act body failed to parse or check when invoked
 
     // --- General/Internal Errors ---
     Registry_UnknownErrorCode,  // Fallback if an unknown code is requested
@@ -61,6 +109,12 @@ enum class ErrorCode {
     // --- Interpreter Errors ---
     Interpreter_StreamReadError,  // Error reading from input stream
     Interpreter_HaltingLexical,   // Fatal: Halting due to previous lexical errors
+    Interpreter_HaltingSyntax,    // Fatal: Halting due to previous syntax errors
+    Interpreter_HaltingSemantic,  // Fatal: Halting due to previous semantic errors
+    Interpreter_ProfileUnavailable,  // --opcode-profile in a build without TOOI_VM_PROFILE
+    Interpreter_ProfileWriteError,   // The opcode profile file cannot be written
+    Interpreter_JitUnavailable,      // --jit on a platform without a JIT backend
+    Interpreter_EmitWriteError,      // The --emit-cpp output file cannot be written
 };
 
 /**
@@ -2,6 +2,7 @@
 
 #include "tooi/core/error_info.h" // Includes ErrorCode and ErrorInfo
 #include <unordered_map>
+#include <memory> // For std::unique_ptr
 #include <mutex> // For thread-safe singleton initialization
 
 namespace tooi {
@@ -3,6 +3,9 @@
 #include <istream> // Include for std::istream
 #include <string>
 #include "tooi/core/error_reporter.h" // Include ErrorReporter header
+#include "tooi/core/interpreter_options.h"
+#include "tooi/core/type_checker.h"
+#include "tooi/vm/vm.h"
 // #include <vector> // Example placeholder for state
 // #include <unordered_map> // Example placeholder for state
 
@@ -29,9 +32,9 @@ class Interpreter {
    public:
     /**
      * @brief Constructs an Interpreter instance.
-     * @param verbose Enable verbose output during execution.
+     * @param options Settings controlling verbosity and optimization.
      */
-    explicit Interpreter(bool verbose = false);
+    explicit Interpreter(InterpreterOptions options = {});
 
     /**
      * @brief Executes Tooi code read from the given input stream.
@@ -51,13 +54,22 @@ class Interpreter {
     // Add getter for error status
     bool had_error() const;
 
+    /**
+     * @brief Runs the chunks of the next script in the functions generated for them.
+     * @param program C++ generated by --emit-cpp for that script; must outlive the interpreter.
+     */
+    void use_aot(const vm::AotProgram& program) { vm_.use_aot(program); }
+
    private:
     // Placeholder for interpreter state:
     // std::unordered_map<std::string, Value> variables_;
     // ExecutionEnvironment environment_;
     int execution_count_ = 0; // Simple example of state
     bool verbose_ = false; // Flag for verbose output
+    InterpreterOptions options_;
     ErrorReporter error_reporter_; // Owns the error reporter
+    GlobalTable globals_; // Top-level bindings, persisted across runs
+    vm::VM vm_; // Runtime state (heap, global values), persisted across runs
 };
 
 }  // namespace core
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace tooi {
+namespace core {
+
+/**
+ * @brief Settings that control how the Interpreter processes code.
+ *
+ * Filled in from the command line by ArgsParser and passed down through the
+ * REPL / file runner to the Interpreter.
+ */
+struct InterpreterOptions {
+    bool verbose = false;   ///< Print tokens and pipeline statistics
+    bool optimize = true;   ///< Run the optimization passes (disabled by --no-opt)
+    bool dump_ir = false;     ///< Print the optimized IR (--dump-ir)
+    bool dump_bytecode = false;  ///< Print the compiled bytecode (--dump-bytecode)
+    bool pass_stats = false;  ///< Print per-pass change counts and timings (--pass-stats)
+    bool vm_stats = false;    ///< Print instruction counts and run time (--vm-stats)
+    bool ic_stats = false;    ///< Print the hit rate of every inline cache (--ic-stats)
+    bool jit = false;         ///< Compile hot acts to machine code (--jit)
+    bool trace = true;        ///< With jit, also trace hot loops (disabled by --no-trace)
+    bool lazy = true;         ///< Parse and compile acts when first invoked (disabled by --eager)
+    std::vector<std::string> disabled_passes;  ///< IR passes turned off with --disable-pass
+    std::string opcode_profile;  ///< File to write executed opcode sequences to (--opcode-profile)
+    std::string emit_cpp;  ///< Write the script as C++ here ("-": stdout) instead of running it
+};
+
+}  // namespace core
+}  // namespace tooi
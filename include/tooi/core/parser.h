@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/error_reporter.h"
+#include "tooi/core/token.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @class Parser
+ * @brief Recursive descent parser turning the token stream into an AST.
+ *
+ * Syntax errors are reported through the ErrorReporter; the parser then
+ * resynchronizes at the next statement boundary so that several errors can
+ * be reported in one run.
+ *
+ * With deferred acts, the body of an act outside of other act bodies is only
+ * matched brace by brace and kept as tokens (ActDecl::deferred), to be parsed
+ * when the act is first invoked. Bodies that change other objects' types
+ * while being checked (`>>` and `@` on existing objects) and bodies of pure
+ * acts, which may be evaluated at compile time, are parsed right away.
+ */
+class Parser {
+public:
+    /**
+     * @brief Constructs a Parser instance.
+     * @param tokens The tokens produced by the Scanner (must end with END_OF_FILE).
+     * @param source The source code the tokens were scanned from (for diagnostics).
+     * @param error_reporter Reference to the error reporter to use.
+     * @param defer_acts Leave act bodies unparsed where possible (see above).
+     */
+    Parser(std::vector<Token> tokens, const std::string& source, ErrorReporter& error_reporter,
+           bool defer_acts = false);
+
+    /**
+     * @brief Parses the whole token stream.
+     * @return The parsed program. If errors were reported, the program only
+     *         contains the statements that could be parsed.
+     */
+    Program parse();
+
+    /**
+     * @brief Parses the body of an act whose parsing was deferred, into act.body.
+     *
+     * The tokens are consumed; act.deferred stays set for the TypeChecker.
+     * @return True if no syntax errors were found.
+     */
+    static bool parse_deferred(ActDecl& act, const std::string& source,
+                               ErrorReporter& error_reporter);
+
+private:
+    std::vector<Token> tokens_;
+    const std::string& source_;
+    ErrorReporter& error_reporter_;
+    size_t current_ = 0;
+    bool defer_acts_;
+    int act_depth_ = 0;  ///< Act bodies being parsed around the current token
+    bool had_error_ = false;
+
+    // --- Statements ---
+    StmtPtr statement();
+    StmtPtr bind_statement(bool is_set);
+    StmtPtr add_statement();
+    StmtPtr if_statement();
+    StmtPtr while_statement();
+    StmtPtr for_statement();
+    std::unique_ptr<BlockStmt> block();
+    std::vector<StmtPtr> statement_list();
+    ExprPtr binding_target();
+    TypeAnnotation annotation();
+    TypeRef type();
+    bool is_type_start() const;
+    std::unique_ptr<ObjectExpr> mode_block(SourceLocation loc);
+    ModeEntry mode_entry();
+    std::unique_ptr<ActDecl> act_block(const std::string& name, bool is_pure);
+    size_t deferrable_body_end() const;
+
+    // --- Expressions (lowest to highest precedence) ---
+    ExprPtr expression();
+    ExprPtr logic_or();
+    ExprPtr logic_and();
+    ExprPtr equality();
+    ExprPtr comparison();
+    ExprPtr term();
+    ExprPtr factor();
+    ExprPtr cast();
+    ExprPtr unary();
+    ExprPtr postfix();
+    ExprPtr primary();
+    ExprPtr number_literal(const Token& token);
+    void arguments(std::vector<ExprPtr>& args);
+
+    // --- Token helpers ---
+    bool is_at_end() const;
+    const Token& peek() const;
+    const Token& peek_next() const;
+    const Token& previous() const;
+    const Token& advance();
+    bool check(TokenType type) const;
+    bool match(TokenType type);
+    const Token& consume(TokenType type, const char* expected);
+    std::string consume_identifier(const char* context);
+    void synchronize();
+
+    static SourceLocation location_of(const Token& token);
+
+    /// Reports an error at the given token and throws to unwind to the statement level.
+    template <typename... Args>
+    [[noreturn]] void error_at(const Token& token, ErrorCode code, Args&&... args);
+};
+
+}  // namespace core
+}  // namespace tooi
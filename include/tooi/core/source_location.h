@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+namespace tooi {
+namespace core {
+
+/**
+ * @brief A position in the source code, used to attach diagnostics to AST nodes.
+ */
+struct SourceLocation {
+    int line = 0;    ///< Line number (1-based), 0 if unknown
+    int column = 0;  ///< Column number (1-based), 0 if unknown
+    int length = 1;  ///< Number of characters covered (for carets)
+};
+
+/**
+ * @brief Extracts the text of a given line from the source code.
+ * @param source The full source code.
+ * @param line The line number (1-based).
+ * @return The line without its trailing newline, or an empty string if out of range.
+ */
+inline std::string source_line(const std::string& source, int line) {
+    size_t start = 0;
+    for (int current = 1; current < line; ++current) {
+        start = source.find('\n', start);
+        if (start == std::string::npos) return "";
+        ++start;
+    }
+    size_t end = source.find('\n', start);
+    if (end == std::string::npos) end = source.length();
+    return source.substr(start, end - start);
+}
+
+}  // namespace core
+}  // namespace tooi
@@ -66,6 +66,7 @@ struct Token {
     std::string lexeme;  ///< The actual character sequence from the source
     TokenLiteral literal;///< The literal value, if any
     int line;           ///< Line number for error reporting
+    int column;         ///< Column number (1-based) for error reporting, 0 if unknown
 
     /**
      * @brief Constructs a new Token
@@ -73,9 +74,11 @@ struct Token {
      * @param lexeme The lexeme string
      * @param literal The literal value
      * @param line The line number
+     * @param column The column number (1-based), 0 if unknown
      */
-    Token(TokenType type, std::string lexeme, TokenLiteral literal, int line)
-        : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line) {}
+    Token(TokenType type, std::string lexeme, TokenLiteral literal, int line, int column = 0)
+        : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line),
+          column(column) {}
 
     /**
      * @brief Creates an EOF token
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/error_reporter.h"
+#include "tooi/core/types.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @brief Static information about a top-level binding.
+ */
+struct GlobalInfo {
+    std::string name;
+    TypeRef type;
+    bool is_set = false;
+    std::optional<LiteralValue> constant;  ///< Value of a constant `set` binding (optimizer)
+    size_t declaration = 0;                 ///< GlobalTable::declarations() before this one
+};
+
+/**
+ * @class GlobalTable
+ * @brief Maps top-level names to stable global indices.
+ *
+ * The table persists across Interpreter::run() calls so that REPL
+ * submissions can refer to bindings made by earlier ones. Indices never
+ * change once assigned, which allows the runtime to store globals in a
+ * plain vector.
+ */
+class GlobalTable {
+public:
+    /**
+     * @brief Declares (or redeclares) a global binding.
+     * @return The global index of the binding.
+     */
+    int declare(const std::string& name, TypeRef type, bool is_set);
+
+    /**
+     * @brief Looks up a global by name.
+     * @return The global index, or -1 if the name is not bound.
+     */
+    int find(const std::string& name) const;
+
+    GlobalInfo& at(int index) { return globals_[index]; }
+    const GlobalInfo& at(int index) const { return globals_[index]; }
+    size_t size() const { return globals_.size(); }
+
+    /// Number of declarations and redeclarations made so far.
+    size_t declarations() const { return declarations_; }
+
+private:
+    std::vector<GlobalInfo> globals_;
+    size_t declarations_ = 0;
+    std::unordered_map<std::string, int> index_;
+};
+
+/**
+ * @class TypeChecker
+ * @brief Resolves names and infers and checks static types.
+ *
+ * The checker annotates the AST in place:
+ * - every expression gets its static type (Expr::type),
+ * - names get a Resolution (local slot, upvalue, self property, global or dynamic),
+ * - acts get their local and upvalue layout,
+ * - implicit conversions become explicit CastExpr nodes (CastKind::Widen or
+ *   CastKind::Check), so both operands of an arithmetic operator always have
+ *   the same type afterwards,
+ * - compound bindings (`let x + 1;`) are rewritten to plain assignments,
+ * - acts of `pure` objects are verified to have no side effects: no I/O, no
+ *   invocation of acts that are not pure, and no mutation of globals,
+ *   properties or anything else the act did not create itself.
+ *
+ * Code generation can then use unboxed, typed operations wherever a type is
+ * statically known and fall back to dynamic `proto` values elsewhere.
+ */
+class TypeChecker {
+public:
+    /**
+     * @brief Constructs a TypeChecker instance.
+     * @param globals The global table; new top-level bindings are added to it.
+     * @param source The source code being checked (for diagnostics).
+     * @param error_reporter Reference to the error reporter to use.
+     */
+    TypeChecker(GlobalTable& globals, const std::string& source, ErrorReporter& error_reporter);
+
+    /**
+     * @brief Checks a program, annotating its AST.
+     * @return True if no semantic errors were found.
+     */
+    bool check(Program& program);
+
+    /**
+     * @brief Checks the body of an act whose parsing was deferred.
+     *
+     * The body must have been parsed into act.body. It is checked as it would
+     * have been in place: against the object as it was defined so far and the
+     * globals declared before it. Later globals resolve dynamically.
+     * @return True if no semantic errors were found.
+     */
+    bool check_deferred(ActDecl& act);
+
+private:
+    // Per-act (or top-level script) checking state.
+    struct FunctionContext {
+        ActDecl* act = nullptr;  // Null for top-level code
+        FunctionContext* enclosing = nullptr;
+        std::shared_ptr<ObjectInfo> self;
+        TypeRef self_type;
+        std::unordered_map<std::string, int> locals;
+        std::unordered_map<std::string, int> upvalues;
+        int loop_depth = 0;
+        // Purity checking (acts of `pure` objects only).
+        bool pure = false;
+        std::unordered_map<int, bool> owned_locals;  // Slot -> only ever bound to new values
+        std::vector<std::pair<int, SourceLocation>> local_mutations;  // Slot, location
+    };
+
+    // A name lookup result.
+    struct Binding {
+        Resolution resolution;
+        TypeRef type;
+    };
+
+    GlobalTable& globals_;
+    const std::string& source_;
+    ErrorReporter& error_reporter_;
+    FunctionContext* function_ = nullptr;
+    bool had_error_ = false;
+    size_t visible_declarations_ = SIZE_MAX;  // Globals declared later resolve dynamically
+
+    // --- Statements ---
+    void check_statement(Stmt& stmt);
+    void check_block(std::vector<StmtPtr>& statements);
+    void check_add(AddStmt& stmt);
+    void check_bind(BindStmt& stmt);
+    void check_name_bind(BindStmt& stmt);
+    void check_member_bind(BindStmt& stmt);
+    void check_object_update(BindStmt& stmt, const TypeRef& target_type, const std::string& name);
+    void desugar_compound(BindStmt& stmt);
+    void check_condition(ExprPtr& condition, const char* context);
+    void check_for(ForStmt& stmt);
+
+    // --- Objects ---
+    TypeRef check_object(ObjectExpr& object, const std::string& name);
+    void check_mode_entries(ObjectExpr& object, ObjectInfo& info);
+    void check_act(ActDecl& act, const std::shared_ptr<ObjectInfo>& self, const TypeRef& self_type);
+    void check_act_body(ActDecl& act, const std::shared_ptr<ObjectInfo>& self,
+                        const TypeRef& self_type);
+
+    // --- Expressions ---
+    TypeRef check_expr(ExprPtr& expr);
+    TypeRef check_literal(LiteralExpr& expr);
+    TypeRef check_identifier(IdentifierExpr& expr);
+    TypeRef check_unary(UnaryExpr& expr);
+    TypeRef check_binary(BinaryExpr& expr);
+    TypeRef check_logical(LogicalExpr& expr);
+    TypeRef check_cast(CastExpr& expr);
+    TypeRef check_array(ArrayExpr& expr);
+    TypeRef check_tuple(TupleExpr& expr);
+    TypeRef check_assoc(AssocExpr& expr);
+    TypeRef check_index(IndexExpr& expr);
+    TypeRef check_property(PropertyExpr& expr);
+    TypeRef check_invoke(InvokeExpr& expr);
+    TypeRef check_builtin_invoke(InvokeExpr& expr, const TypeRef& receiver);
+    TypeRef check_new(NewExpr& expr);
+
+    // --- Helpers ---
+    std::optional<Binding> lookup(const std::string& name);
+    int resolve_upvalue(FunctionContext& context, const std::string& name, TypeRef& type);
+    Binding declare(const std::string& name, TypeRef type, bool is_set);
+    bool coerce(ExprPtr& expr, const TypeRef& target, const std::string& what);
+    void widen(ExprPtr& expr, const TypeRef& target);
+    void check_pure_mutation(const Expr& container, const SourceLocation& loc);
+    void note_local_binding(const Resolution& resolution, bool is_new_value);
+    void check_pure_locals();
+    std::string pure_act_name() const;
+    static TypeRef binding_type_of(const TypeRef& value_type);
+    static bool is_self_access(const Expr& expr);
+
+    template <typename... Args>
+    void error(const SourceLocation& loc, ErrorCode code, Args&&... args);
+};
+
+}  // namespace core
+}  // namespace tooi
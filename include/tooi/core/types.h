@@ -0,0 +1,159 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tooi/core/token.h"
+
+namespace tooi {
+namespace core {
+
+/**
+ * @brief The different kinds of static types known to the type checker.
+ *
+ * `Proto` is the dynamic type: a value whose concrete type is only known at
+ * runtime. Every other kind is a statically known type, which allows later
+ * stages to use unboxed representations and specialized operations.
+ */
+enum class TypeKind {
+    Proto,    ///< Dynamically typed value (`proto`, or anything not statically known)
+    Nil,      ///< The type of the `nil` literal
+    Bool,     ///< `bool`
+    Byte,     ///< `byte` (unsigned 8-bit)
+    Int32,    ///< `int`, `int32`
+    Int64,    ///< `int64`
+    UInt32,   ///< `uint`, `uint32`
+    UInt64,   ///< `uint64`
+    Float32,  ///< `float`, `float32`
+    Float64,  ///< `float64`
+    String,   ///< `string`
+    Array,    ///< `[T]`
+    Tuple,    ///< `(T1, T2, ...)`
+    Assoc,    ///< `[K -> V]`
+    Object,   ///< Objects created from mode/act blocks
+    Module    ///< Builtin modules imported with `add`
+};
+
+struct Type;
+struct ObjectInfo;
+
+/// Types are immutable and shared between AST nodes.
+using TypeRef = std::shared_ptr<const Type>;
+
+/**
+ * @brief Static information about a single property of an object type.
+ */
+struct PropertyInfo {
+    TypeRef type;             ///< Declared (or inferred) type of the property
+    bool is_set = false;      ///< True if the property was declared with `set`
+    bool is_private = false;  ///< True if the property was declared `private`
+};
+
+/**
+ * @brief Static information about an object, collected from its mode block.
+ *
+ * Shared (and extended in place) by every type that refers to the same object
+ * definition, so that `>>` appends are visible through all aliases.
+ */
+struct ObjectInfo {
+    std::string name;                                ///< Binding name, for diagnostics
+    std::map<std::string, PropertyInfo> properties;  ///< Properties from mode blocks
+    std::vector<std::pair<std::string, TypeRef>> params;  ///< `param` declarations, in order
+    bool has_act = false;   ///< True if an act (`@ { ... }`) is attached
+    bool is_pure = false;   ///< True if declared with the `pure` modifier
+};
+
+/**
+ * @brief A static type.
+ *
+ * Primitive types are singletons obtained through the static factory
+ * functions; composite types are created on demand and compared structurally
+ * with types_equal().
+ */
+struct Type {
+    TypeKind kind;
+    std::vector<TypeRef> elements;  ///< Array: {elem}; Tuple: elements; Assoc: {key, value}
+    std::shared_ptr<ObjectInfo> object;  ///< Object: property table (may be null)
+    std::string name;               ///< Module name
+
+    explicit Type(TypeKind kind) : kind(kind) {}
+
+    // --- Factories ---
+    static TypeRef proto();
+    static TypeRef nil();
+    static TypeRef boolean();
+    static TypeRef byte();
+    static TypeRef int32();
+    static TypeRef int64();
+    static TypeRef uint32();
+    static TypeRef uint64();
+    static TypeRef float32();
+    static TypeRef float64();
+    static TypeRef string();
+    static TypeRef array_of(TypeRef element);
+    static TypeRef tuple_of(std::vector<TypeRef> elements);
+    static TypeRef assoc_of(TypeRef key, TypeRef value);
+    static TypeRef object_of(std::shared_ptr<ObjectInfo> info);
+    static TypeRef module(std::string name);
+
+    /**
+     * @brief Maps a type keyword token (e.g. `int`, `float64`) to its type.
+     * @return The corresponding type, or nullptr if the token is not a type keyword.
+     */
+    static TypeRef from_keyword(TokenType keyword);
+
+    // --- Classification ---
+    bool is_proto() const { return kind == TypeKind::Proto; }
+    bool is_integer() const;
+    bool is_float() const { return kind == TypeKind::Float32 || kind == TypeKind::Float64; }
+    bool is_numeric() const { return is_integer() || is_float(); }
+    bool is_signed() const { return kind == TypeKind::Int32 || kind == TypeKind::Int64; }
+    /// True for types whose values can never be nil and can be kept unboxed.
+    bool is_primitive() const { return is_numeric() || kind == TypeKind::Bool; }
+    /// Width in bits of integer and float types, 0 for other types.
+    int bit_width() const;
+
+    const TypeRef& element() const { return elements[0]; }
+    const TypeRef& key() const { return elements[0]; }
+    const TypeRef& value() const { return elements[1]; }
+
+    /**
+     * @brief Returns the type in Tooi source syntax (e.g. `[int]`, `(int, string)`).
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @brief Structural type equality.
+ *
+ * Object types compare equal to each other regardless of their property
+ * tables; objects are only distinguished at runtime.
+ */
+bool types_equal(const TypeRef& a, const TypeRef& b);
+
+/**
+ * @brief Checks whether a value of type @p source may be stored in a binding of type @p target.
+ *
+ * Allows identical types, lossless numeric widening, `nil` for reference
+ * types and anything to or from `proto` (the latter checked at runtime).
+ */
+bool is_assignable(const TypeRef& target, const TypeRef& source);
+
+/**
+ * @brief Returns the common type of two numeric operands (the usual arithmetic conversions).
+ *
+ * Both operands must be numeric. Floats win over integers, and the wider
+ * (or, at equal width, the unsigned) integer type wins.
+ */
+TypeRef promote_numeric(const TypeRef& a, const TypeRef& b);
+
+/**
+ * @brief Checks whether an integer constant fits in the given numeric type.
+ * @param negative True if the magnitude represents a negative value.
+ */
+bool integer_fits(const TypeRef& type, uint64_t magnitude, bool negative = false);
+
+}  // namespace core
+}  // namespace tooi
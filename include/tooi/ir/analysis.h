@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tooi/ir/ir.h"
+
+namespace tooi {
+namespace ir {
+
+/**
+ * @class DominatorTree
+ * @brief Dominators of the reachable blocks of a function.
+ *
+ * Computed with the iterative algorithm of Cooper, Harvey and Kennedy ("A
+ * Simple, Fast Dominance Algorithm"). The tree is a snapshot: it must be
+ * recomputed after a pass changes the control flow graph.
+ */
+class DominatorTree {
+public:
+    explicit DominatorTree(const Function& function);
+
+    /// Immediate dominator, or null for the entry block and unreachable blocks.
+    BasicBlock* idom(const BasicBlock* block) const;
+    /// True if `a` dominates `b` (every block dominates itself).
+    bool dominates(const BasicBlock* a, const BasicBlock* b) const;
+    bool is_reachable(const BasicBlock* block) const;
+    /// Reachable blocks in reverse postorder (definitions before uses, except for phis).
+    const std::vector<BasicBlock*>& reverse_postorder() const { return rpo_; }
+    /// Blocks immediately dominated by `block`.
+    const std::vector<BasicBlock*>& children(const BasicBlock* block) const;
+
+private:
+    std::vector<BasicBlock*> rpo_;
+    std::unordered_map<const BasicBlock*, int> order_;  ///< Position in rpo_
+    std::vector<int> idom_;                             ///< Indexed by rpo position
+    std::vector<std::vector<BasicBlock*>> children_;
+};
+
+/**
+ * @brief A natural loop: a header and the blocks that reach a back edge to it.
+ */
+struct Loop {
+    BasicBlock* header = nullptr;
+    std::vector<BasicBlock*> blocks;  ///< In reverse postorder, header first
+    std::unordered_set<const BasicBlock*> members;
+    /// Unique block outside the loop that jumps only to the header, null if absent.
+    BasicBlock* preheader = nullptr;
+    Loop* parent = nullptr;
+    int depth = 1;  ///< 1 for outermost loops
+
+    bool contains(const BasicBlock* block) const { return members.count(block) != 0; }
+};
+
+/**
+ * @brief Finds the natural loops of a function.
+ * @return The loops, innermost loops before the loops that contain them.
+ */
+std::vector<std::unique_ptr<Loop>> find_loops(const DominatorTree& dominators);
+
+}  // namespace ir
+}  // namespace tooi
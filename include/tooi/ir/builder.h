@@ -0,0 +1,154 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/type_checker.h"
+#include "tooi/ir/ir.h"
+
+namespace tooi {
+namespace ir {
+
+/**
+ * @class Builder
+ * @brief Lowers a checked AST to SSA form.
+ *
+ * SSA is constructed directly from the AST with the algorithm of Braun et al.
+ * ("Simple and Efficient Construction of Static Single Assignment Form"):
+ * locals become SSA values, phis are placed on demand and trivial phis are
+ * removed as soon as they are complete.
+ *
+ * Globals are promoted to SSA values as well, since all bindings of a script
+ * are globals and hot loops at the top level would otherwise go through
+ * memory for every access. Stores are written through (StoreGlobal) so that
+ * acts and later REPL runs always see the current value, and because an act
+ * may change any global, every global the function uses is reloaded after
+ * an invocation that can run user code.
+ *
+ * Every act becomes its own Function; the top-level code becomes
+ * Module::script(). Acts whose parsing was deferred (core::ActDecl::deferred)
+ * get a Function without blocks, which build_deferred() completes later.
+ */
+class Builder {
+public:
+    explicit Builder(const core::GlobalTable& globals);
+
+    std::unique_ptr<Module> build(const core::Program& program);
+
+    /**
+     * @brief Builds the body of an act whose parsing was deferred.
+     *
+     * build() leaves such functions without blocks. Once the body has been
+     * parsed and checked, this fills in @p function, adding the acts nested
+     * in the body to @p module.
+     */
+    void build_deferred(Module& module, Function& function);
+
+private:
+    // A variable tracked by the SSA construction.
+    struct VarKey {
+        enum class Kind { Local, Global, Temp };
+        Kind kind;
+        int index;
+        bool operator<(const VarKey& other) const {
+            return kind != other.kind ? kind < other.kind : index < other.index;
+        }
+    };
+
+    struct LoopTargets {
+        BasicBlock* break_target;
+        BasicBlock* continue_target;
+    };
+
+    // Construction state of the function being built (acts nest).
+    struct FunctionState {
+        Function* function = nullptr;
+        const core::ActDecl* act = nullptr;
+        BasicBlock* current = nullptr;
+        std::map<VarKey, std::unordered_map<const BasicBlock*, Instruction*>> current_def;
+        std::unordered_set<const BasicBlock*> sealed;
+        std::unordered_map<const BasicBlock*, std::vector<std::pair<VarKey, Instruction*>>>
+            incomplete_phis;
+        std::unordered_set<const Instruction*> pending_phis;  ///< Phis waiting for operands
+        std::unordered_map<const Instruction*, VarKey> phi_vars;
+        std::unordered_map<const BasicBlock*, Instruction*> last_call;
+        std::unordered_map<const Instruction*, Instruction*> replaced_phis;
+        std::vector<std::unique_ptr<Instruction>> removed_phis;
+        std::set<int> globals_used;             ///< Globals referenced by the function body
+        std::map<VarKey, core::TypeRef> types;  ///< Common static type of each variable
+        std::vector<LoopTargets> loops;
+        int next_temp = 0;
+    };
+
+    const core::GlobalTable& globals_;
+    Module* module_ = nullptr;
+    FunctionState* state_ = nullptr;
+    // Stands for "reload from memory after the block's last call" in current_def.
+    Instruction reload_marker_{Opcode::LoadGlobal, nullptr, {}};
+
+    // --- Functions ---
+    Function* build_act(const core::ObjectExpr& object, const std::string& name);
+    void build_body(Function& function, const core::ObjectInfo* info);
+    void finish_function();
+    void scan_block(const std::vector<core::StmtPtr>& statements);
+    void scan_statement(const core::Stmt& stmt);
+    void scan_expr(const core::Expr& expr);
+    void scan_binding(const core::Resolution& resolution, const core::TypeRef& type);
+
+    // --- Statements ---
+    void lower_block(const std::vector<core::StmtPtr>& statements);
+    void lower_statement(const core::Stmt& stmt);
+    void lower_bind(const core::BindStmt& stmt);
+    void lower_if(const core::IfStmt& stmt);
+    void lower_while(const core::WhileStmt& stmt);
+    void lower_for(const core::ForStmt& stmt);
+    void lower_jump_statement(BasicBlock* target);
+
+    // --- Objects ---
+    Instruction* lower_object(const core::ObjectExpr& object, const std::string& name);
+    void lower_mode_entries(Instruction* object, const core::ObjectExpr& expr);
+    Instruction* make_act(const core::ObjectExpr& object, const std::string& name);
+
+    // --- Expressions ---
+    Instruction* lower_expr(const core::Expr& expr);
+    Instruction* lower_condition(const core::Expr& expr);
+    Instruction* lower_logical(const core::LogicalExpr& expr);
+    Instruction* lower_invoke(const core::InvokeExpr& expr);
+    Instruction* read_binding(const core::Resolution& resolution, const std::string& name,
+                              const core::TypeRef& expected, core::SourceLocation loc);
+    void assign(const core::Resolution& resolution, const std::string& name, Instruction* value,
+                core::SourceLocation loc);
+    void after_call(Instruction* call);
+
+    // --- Emission helpers ---
+    Instruction* emit(Opcode op, core::TypeRef type, core::SourceLocation loc,
+                      const std::vector<Instruction*>& operands = {});
+    Instruction* constant(core::LiteralValue value, core::TypeRef type, core::SourceLocation loc);
+    Instruction* default_value(const core::TypeRef& type, core::SourceLocation loc);
+    Instruction* coerce(BasicBlock* block, Instruction* value, const core::TypeRef& type);
+    void jump(BasicBlock* target);
+    void branch(Instruction* condition, BasicBlock* if_true, BasicBlock* if_false);
+    BasicBlock* new_block();
+
+    // --- SSA construction ---
+    void write_variable(VarKey key, const BasicBlock* block, Instruction* value);
+    Instruction* read_variable(VarKey key, BasicBlock* block);
+    Instruction* read_variable_recursive(VarKey key, BasicBlock* block);
+    Instruction* add_phi_operands(VarKey key, Instruction* phi);
+    Instruction* try_remove_trivial_phi(Instruction* phi);
+    Instruction* resolve(Instruction* value) const;
+    Instruction* new_phi(VarKey key, BasicBlock* block);
+    Instruction* undefined_value(VarKey key, BasicBlock* block);
+    core::TypeRef variable_type(VarKey key) const;
+    void seal_block(BasicBlock* block);
+    Instruction* read(VarKey key, const core::TypeRef& expected);
+};
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tooi/core/ast.h"
+#include "tooi/core/source_location.h"
+#include "tooi/core/types.h"
+
+namespace tooi {
+/**
+ * @namespace tooi::ir
+ * @brief Mid-level SSA intermediate representation and its optimization passes.
+ */
+namespace ir {
+
+/**
+ * @brief The IR instruction set.
+ *
+ * Every instruction produces at most one SSA value. Arithmetic and comparison
+ * instructions are typed: both operands have the instruction's operand type
+ * (the TypeChecker inserted explicit conversions), so `add` on two `int`
+ * values is a 32-bit checked integer addition and `add` on `proto` values is
+ * a dynamically dispatched one.
+ */
+#define TOOI_IR_OPCODES(X)                                                          \
+    /* --- Values --- */                                                            \
+    X(Const)      /* literal constant (constant)                                 */ \
+    X(Param)      /* act parameter (index)                                       */ \
+    X(Self)       /* object whose act is running                                 */ \
+    X(Upvalue)    /* captured value of the running act (index)                   */ \
+    X(Phi)        /* SSA merge (operands parallel to incoming)                   */ \
+    /* --- Names --- */                                                             \
+    X(LoadGlobal)  /* read global slot (index)                                   */ \
+    X(StoreGlobal) /* write global slot (index, name) <- operand 0               */ \
+    X(LoadName)    /* dynamic lookup of name on self, then globals               */ \
+    X(AddModule)   /* builtin module (name)                                      */ \
+    /* --- Arithmetic, comparison, conversion --- */                                \
+    X(Add)                                                                          \
+    X(Sub)                                                                          \
+    X(Mul)                                                                          \
+    X(Div)                                                                          \
+    X(Mod)                                                                          \
+    X(Neg)                                                                          \
+    X(Not)                                                                          \
+    X(Eq)                                                                           \
+    X(Ne)                                                                           \
+    X(Lt)                                                                           \
+    X(Le)                                                                           \
+    X(Gt)                                                                           \
+    X(Ge)                                                                           \
+    X(Truthy)  /* proto -> bool (nil and false are false)                        */ \
+    X(Concat)  /* string concatenation, operands converted to text               */ \
+    X(Convert) /* conversion to type (cast_kind)                                 */ \
+    /* --- Objects --- */                                                           \
+    X(NewObject)   /* empty object (name for diagnostics)                        */ \
+    X(CloneObject) /* `new x`: shallow copy                                      */ \
+    X(GetProp)     /* operand 0 . name                                           */ \
+    X(SetProp)     /* operand 0 . name <- operand 1                              */ \
+    X(DefineProp)  /* mode entry: operand 0 . name <- operand 1 (is_set, is_private) */ \
+    X(MakeAct)     /* act closure of function (index): upvalues, then param defaults */ \
+    X(SetAct)      /* operand 0 gets act operand 1                               */ \
+    X(ActIs)       /* operand 0 has act operand 1, or an act of function (index) */ \
+    X(Invoke)      /* run the act of operand 0 with arguments operands 1..n      */ \
+    X(CallMethod)  /* operand 0 .@ name (operands 1..n), builtin or object act   */ \
+    /* --- Collections --- */                                                       \
+    X(NewArray)                                                                     \
+    X(NewTuple)                                                                     \
+    X(NewAssoc)   /* key, value, key, value, ...                                 */ \
+    X(Index)      /* operand 0 [operand 1] (bounds_check)                        */ \
+    X(SetIndex)   /* operand 0 [operand 1] <- operand 2 (bounds_check)           */ \
+    X(Length)     /* length of an array, tuple, string or assoc                  */ \
+    X(IterSource) /* indexable sequence for `for`: assoc -> keys, else itself    */ \
+    /* --- Control flow --- */                                                      \
+    X(Jump)   /* targets[0]                                                      */ \
+    X(Branch) /* operand 0 ? targets[0] : targets[1]                             */ \
+    X(Return) /* operand 0                                                       */
+
+enum class Opcode {
+#define TOOI_IR_OPCODE_ENUM(name) name,
+    TOOI_IR_OPCODES(TOOI_IR_OPCODE_ENUM)
+#undef TOOI_IR_OPCODE_ENUM
+};
+
+/// Name of an opcode as spelled in TOOI_IR_OPCODES (e.g. "LoadGlobal").
+const char* opcode_name(Opcode op);
+
+struct BasicBlock;
+struct Function;
+struct Module;
+
+/**
+ * @brief An IR instruction, which is also the SSA value it defines.
+ *
+ * Instructions keep use lists in both directions (operands and users), so
+ * passes can replace a value everywhere in constant time per use.
+ */
+struct Instruction {
+    Instruction(Opcode op, core::TypeRef type, core::SourceLocation loc)
+        : op(op), type(std::move(type)), loc(loc) {}
+    Instruction(const Instruction&) = delete;
+    Instruction& operator=(const Instruction&) = delete;
+
+    Opcode op;
+    core::TypeRef type;  ///< Static type of the value (nil for instructions without a value)
+    core::SourceLocation loc;
+    BasicBlock* block = nullptr;
+    int id = -1;  ///< Unique within the function, used for printing
+
+    std::vector<Instruction*> operands;
+    std::vector<Instruction*> users;  ///< One entry per use
+    std::vector<BasicBlock*> incoming;  ///< Phi: predecessor for each operand
+    std::vector<BasicBlock*> targets;   ///< Jump: 1 target, Branch: true and false target
+
+    // --- Payload (meaning depends on the opcode) ---
+    core::LiteralValue constant;  ///< Const
+    int index = -1;               ///< Param/Upvalue index, global slot, function index
+    std::string name;             ///< Property, method, module or object name
+    core::CastKind cast_kind = core::CastKind::Explicit;  ///< Convert
+    bool bounds_check = true;     ///< Index/SetIndex: false once proven in range
+    bool is_set = false;          ///< DefineProp
+    bool is_private = false;      ///< DefineProp
+    core::TypeRef property_type;  ///< DefineProp: type later writes must have, null for proto
+
+    void add_operand(Instruction* value);
+    void set_operand(size_t i, Instruction* value);
+    void remove_operand(size_t i);
+    /// Drops all operands (and the corresponding uses).
+    void drop_operands();
+    /// Makes every user of this value use `value` instead.
+    void replace_all_uses_with(Instruction* value);
+
+    bool is_terminator() const;
+    /// True if the instruction writes memory, calls user code or transfers control.
+    bool has_side_effects() const;
+    /// True if the instruction can raise a runtime error.
+    bool may_trap() const;
+    /// True if the instruction only depends on its operands (no memory reads).
+    bool is_pure() const;
+};
+
+/**
+ * @brief A straight-line sequence of instructions ending in a terminator.
+ */
+struct BasicBlock {
+    int id = -1;
+    Function* function = nullptr;
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    std::vector<BasicBlock*> predecessors;
+
+    Instruction* terminator() const;
+    std::vector<BasicBlock*> successors() const;
+
+    /// Appends an instruction at the end of the block.
+    Instruction* append(std::unique_ptr<Instruction> instruction);
+    /// Inserts an instruction at the given position.
+    Instruction* insert(size_t position, std::unique_ptr<Instruction> instruction);
+    /// Inserts an instruction before the terminator (or at the end if there is none).
+    Instruction* insert_before_terminator(std::unique_ptr<Instruction> instruction);
+    /// Position of an instruction within the block.
+    size_t position_of(const Instruction* instruction) const;
+    /// Unlinks an instruction from the block and returns it.
+    std::unique_ptr<Instruction> remove(Instruction* instruction);
+    /// Removes an instruction that has no users, dropping its operands.
+    void erase(Instruction* instruction);
+    /// Index of a predecessor (for phi operands), -1 if not a predecessor.
+    int predecessor_index(const BasicBlock* block) const;
+};
+
+/**
+ * @brief The IR of one act, or of the top-level code of a script.
+ */
+struct Function {
+    std::string name;
+    int index = 0;  ///< Position in Module::functions
+    bool is_script = false;
+    int param_count = 0;
+    int upvalue_count = 0;
+    bool is_pure = false;
+    std::vector<std::unique_ptr<BasicBlock>> blocks;  ///< blocks[0] is the entry block
+    const core::ActDecl* decl = nullptr;  ///< Source act, null for the script
+    Module* module = nullptr;             ///< Module that owns the function
+
+    BasicBlock* entry() const { return blocks.front().get(); }
+    BasicBlock* create_block();
+    /// Removes a block; it must no longer be referenced by other blocks.
+    void remove_block(BasicBlock* block);
+    std::unique_ptr<Instruction> create(Opcode op, core::TypeRef type,
+                                        core::SourceLocation loc = {});
+    size_t instruction_count() const;
+    /// Upper bound (exclusive) of the instruction ids of the function.
+    int id_limit() const { return next_value_id_; }
+
+private:
+    int next_block_id_ = 0;
+    int next_value_id_ = 0;
+};
+
+/**
+ * @brief A compiled program: the script function followed by all acts.
+ */
+struct Module {
+    std::vector<std::unique_ptr<Function>> functions;
+
+    Function* script() const { return functions.front().get(); }
+    Function* create_function(std::string name);
+    size_t instruction_count() const;
+};
+
+/// Adds an edge from `from` to `to` in the predecessor lists.
+void link(BasicBlock* from, BasicBlock* to);
+/// Removes one edge from `from` to `to`, including the matching phi operands.
+void unlink(BasicBlock* from, BasicBlock* to);
+
+void print_function(const Function& function, std::ostream& out);
+void print_module(const Module& module, std::ostream& out);
+
+}  // namespace ir
+}  // namespace tooi
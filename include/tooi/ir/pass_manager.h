@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tooi/ir/ir.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+/**
+ * @brief What one pass did over a whole module.
+ */
+struct PassStats {
+    std::string name;
+    bool enabled = true;
+    int changes = 0;            ///< Sum of the pass's change counts over all functions
+    double milliseconds = 0.0;  ///< Time spent in the pass
+};
+
+/**
+ * @class PassManager
+ * @brief Runs the mid-level optimization pipeline over a module.
+ *
+ * The pipeline is fixed (ctfe, inline, cse, licm, bce, dce); each pass can be disabled by
+ * name (`--disable-pass=licm`) to measure or bisect its effect, and every
+ * run records how many changes each pass made and how long it took
+ * (`--pass-stats`).
+ *
+ * Each pass runs over all functions before the next one starts. Only ctfe
+ * and inline read the IR of other functions, and they come first, so the
+ * remaining passes of an act can wait until it is compiled (see
+ * run(Module&, bool) and finish()). Acts whose parsing was deferred have no
+ * IR yet and are skipped; start() runs their share of run() later.
+ */
+class PassManager {
+public:
+    using Pass = std::function<int(Function&)>;
+
+    PassManager();
+    PassManager(const PassManager&) = delete;  // Passes refer to the manager's statistics
+    PassManager& operator=(const PassManager&) = delete;
+
+    /// Names of the passes in pipeline order.
+    static const std::vector<std::string>& pass_names();
+
+    /**
+     * @brief Disables a pass.
+     * @return False if there is no pass with that name.
+     */
+    bool disable(const std::string& name);
+
+    /**
+     * @brief Runs the pipeline over a module.
+     * @param defer_acts Run only ctfe and inline over the acts, leaving their
+     *        remaining passes to finish().
+     */
+    void run(Module& module, bool defer_acts = false);
+
+    /**
+     * @brief Runs ctfe and inline on an act built after run(), whose parsing
+     * was deferred (see Builder::build_deferred()); finish() does the rest.
+     */
+    void start(Function& function);
+
+    /// Runs the passes run(module, true) left out on one of its acts.
+    void finish(Function& function);
+
+    const std::vector<PassStats>& stats() const { return stats_; }
+    const InlineStats& inline_stats() const { return inline_stats_; }
+    void print_stats(std::ostream& out) const;
+
+private:
+    /// ctfe and inline, the passes that read other functions' IR.
+    static constexpr size_t kInterproceduralPasses = 2;
+
+    std::vector<Pass> passes_;
+    std::vector<PassStats> stats_;  ///< Parallel to passes_
+    InlineStats inline_stats_;
+
+    void run_pass(size_t pass, Function& function);
+};
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "tooi/ir/ir.h"
+
+namespace tooi {
+namespace ir {
+
+/// Instructions the compile-time evaluation of one invocation may execute.
+const int kEvaluationStepBudget = 100000;
+
+/**
+ * @brief Evaluates invocations of pure acts with constant arguments at compile time.
+ *
+ * The callee must be known: an object created since the last call that
+ * could have rebound or modified it (directly, or through the global it was
+ * stored to), whose act is the one it was defined with. The act's IR is
+ * interpreted under a budget of kEvaluationStepBudget instructions, with
+ * nested invocations of other known pure acts; if it returns a primitive
+ * value or a string, the invocation is replaced by that constant. Runtime
+ * errors, values the evaluator does not know and exhausting the budget
+ * leave the invocation to the runtime.
+ *
+ * @return The number of invocations replaced.
+ */
+int evaluate_pure_calls(Function& function);
+
+/// Largest act, in IR instructions, inlined at a call site outside of loops.
+/// Each enclosing loop raises the limit by the same amount again (up to three loops).
+const int kInlineSizeLimit = 24;
+
+/// Instructions the inliner may add to one function.
+const int kInlineGrowthLimit = 400;
+
+/**
+ * @brief What the inliner did, summed over the functions it ran on.
+ */
+struct InlineStats {
+    int call_sites = 0;    ///< Invocations replaced by a copy of the callee's body
+    int guarded = 0;       ///< Of those, the ones that keep the invocation as a fallback
+    int instructions = 0;  ///< Instructions copied into callers
+};
+
+/**
+ * @brief Splices the bodies of small acts into the functions that invoke them.
+ *
+ * The callee is predicted from the object being invoked: an object defined
+ * in the caller, a global every store of which holds an object defined with
+ * the same act, or a mode entry of such an object. `@` replaces the act of
+ * an object through any binding that refers to it, so `set` bindings and
+ * `set` properties cannot rule it out; the copy runs unguarded only when
+ * the object was defined on the straight-line path to the invocation with
+ * no call in between. Otherwise an `ActIs` check on the object selects the
+ * copy and keeps the invocation for any other act. Visibility is checked
+ * statically, so the copy may still read the callee's private properties.
+ *
+ * Without a runtime profile, loop nesting estimates how hot a call site
+ * is: calls in loops are considered first and may inline larger acts (see
+ * kInlineSizeLimit). Acts that look names up dynamically (including those
+ * that invoke themselves through their own name) are not inlined, since
+ * the lookup depends on the running act.
+ *
+ * @param stats If not null, receives what was inlined.
+ * @return The number of call sites inlined.
+ */
+int inline_small_acts(Function& function, InlineStats* stats = nullptr);
+
+/**
+ * @brief Global value numbering over the dominator tree.
+ *
+ * Pure instructions (arithmetic, comparisons, conversions, constants) are
+ * replaced by an identical instruction that dominates them. Memory reads
+ * (LoadGlobal, GetProp, LoadName, Index, Length) are only merged within a
+ * block, up to the next instruction that may write the memory they read.
+ *
+ * @return The number of instructions removed.
+ */
+int eliminate_common_subexpressions(Function& function);
+
+/**
+ * @brief Loop-invariant code motion.
+ *
+ * Moves instructions whose operands are defined outside a loop into the
+ * loop's preheader, innermost loops first. Instructions that may trap are
+ * only hoisted from the start of the loop header, where they would have run
+ * first anyway; `length` and global reads are hoisted from loops that
+ * contain no calls or stores that could change them.
+ *
+ * @return The number of instructions hoisted.
+ */
+int hoist_loop_invariants(Function& function);
+
+/**
+ * @brief Removes bounds checks that are proven redundant.
+ *
+ * An element access `a[i]` needs no check when `i` is known to be
+ * non-negative and the access is dominated by the true edge of a branch on
+ * `i < a.length` with no call in between that could change the length of
+ * `a`. This covers `for` loops and the usual counted `while` loops.
+ *
+ * @return The number of checks removed.
+ */
+int eliminate_bounds_checks(Function& function);
+
+/**
+ * @brief Folds constant branches and removes unreachable blocks and unused values.
+ *
+ * Instructions are only removed when they have no side effects and cannot
+ * trap, so runtime errors are preserved.
+ *
+ * @return The number of instructions removed or simplified.
+ */
+int eliminate_dead_code(Function& function);
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "tooi/core/interpreter_options.h"
+#include "tooi/vm/bytecode.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @file aot.h
+ * @brief Ahead-of-time compilation: a script's bytecode translated to C++ (--emit-cpp).
+ *
+ * `tooi --emit-cpp script.tooi` compiles the script as usual and writes a
+ * C++ program holding one function per chunk, in the shape of the Jit's
+ * native code (AotFunction): every instruction is a label the function can
+ * be entered at. Moves, globals, branches, truthiness, typed arithmetic and
+ * comparisons (generic ones on int and float64 operands), conversions to
+ * the type a value already has and property reads answered by their inline
+ * cache run inline; any other instruction, or one whose operands have other
+ * kinds, overflow or miss the cache, returns its position so that the
+ * interpreter executes it. The system
+ * compiler builds the program against the runtime library (the front end
+ * and the VM) into a native executable.
+ *
+ * The executable embeds the script and compiles it to bytecode again at
+ * startup; a chunk runs its generated function only if the fingerprint of
+ * its bytecode still matches the one the function was generated from, and
+ * is interpreted otherwise. The VM keeps executing everything the generated
+ * code leaves to it, so semantics and diagnostics are the VM's own.
+ */
+
+/// What a program generated by emit_cpp() hands to the runtime library.
+struct AotProgram {
+    const char* source;           ///< The script, compiled again at startup
+    bool optimize;                ///< The script was compiled with the optimization passes
+    const char* disabled_passes;  ///< Comma-separated, as given to --disable-pass
+    const AotFunction* functions;  ///< By CompiledModule::functions index
+    const uint64_t* fingerprints;  ///< fingerprint() of the chunk each function was made from
+    size_t count;
+};
+
+/// Hash of a chunk's instructions, with superinstructions counted as their first part.
+uint64_t fingerprint(const Chunk& chunk);
+
+/**
+ * @brief Gives a compiled chunk the function generated for it.
+ * @return False if its bytecode has changed since, so that it is interpreted.
+ */
+bool attach(const AotProgram& program, Chunk& chunk);
+
+/**
+ * @brief Writes the C++ program for a compiled script.
+ * @param source The script's text, embedded in the program.
+ * @param options The options it was compiled with, which the program compiles it with again.
+ */
+void emit_cpp(const CompiledModule& module, const std::string& source,
+              const core::InterpreterOptions& options, std::ostream& out);
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tooi {
+namespace vm {
+namespace x64 {
+
+/**
+ * @file assembler.h
+ * @brief The x86-64 instructions the JIT tiers generate.
+ *
+ * Just what the templates and traces use, with 32-bit displacements and
+ * jump offsets throughout so that every template has a fixed shape.
+ */
+
+enum Reg : uint8_t { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15 };
+
+/// Condition codes, as in the low nibble of Jcc and SETcc.
+enum Cond : uint8_t {
+    kOverflow = 0x0,
+    kBelow = 0x2,
+    kAboveEqual = 0x3,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kBelowEqual = 0x6,
+    kAbove = 0x7,
+    kParity = 0xA,
+    kNoParity = 0xB,
+    kLess = 0xC,
+    kGreaterEqual = 0xD,
+    kLessEqual = 0xE,
+    kGreater = 0xF,
+};
+
+/// Opcodes of the two-operand ALU instructions in their `op r/m, reg` form.
+enum Alu : uint8_t { kAdd = 0x01, kOr = 0x09, kAnd = 0x21, kSub = 0x29, kXor = 0x31, kCmp = 0x39,
+                     kTest = 0x85 };
+
+/// Scalar double operations (F2 0F xx).
+enum Sse : uint8_t { kAddsd = 0x58, kMulsd = 0x59, kSubsd = 0x5C, kDivsd = 0x5E };
+
+struct Label {
+    static constexpr size_t kUnbound = SIZE_MAX;
+    size_t offset = kUnbound;
+    std::vector<size_t> fixups;  ///< rel32 fields waiting for the label to be bound
+};
+
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    size_t size() const { return code.size(); }
+
+    void push(Reg r) {
+        if (r >= r8) byte(0x41);
+        byte(0x50 + (r & 7));
+    }
+    void pop(Reg r) {
+        if (r >= r8) byte(0x41);
+        byte(0x58 + (r & 7));
+    }
+    void ret() { byte(0xC3); }
+    void call(Reg target) {
+        rex(false, 0, target);
+        byte(0xFF);
+        direct(2, target);
+    }
+
+    void mov(Reg dst, Reg src) { alu64(0x89, dst, src); }
+    void mov(Reg dst, uint64_t imm) {
+        rex(true, 0, dst);
+        byte(0xB8 + (dst & 7));
+        for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(imm >> (8 * i)));
+    }
+    void mov32(Reg dst, uint32_t imm) {
+        rex(false, 0, dst);
+        byte(0xB8 + (dst & 7));
+        u32(imm);
+    }
+    void load(Reg dst, Reg base, int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8B);
+        memory(dst, base, disp);
+    }
+    /// Loads 32 bits, sign-extended to 64.
+    void load_int32(Reg dst, Reg base, int32_t disp) {
+        rex(true, dst, base);
+        byte(0x63);
+        memory(dst, base, disp);
+    }
+    void store(Reg base, int32_t disp, Reg src) {
+        rex(true, src, base);
+        byte(0x89);
+        memory(src, base, disp);
+    }
+    void lea(Reg dst, Reg base, int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8D);
+        memory(dst, base, disp);
+    }
+    void store_byte(Reg base, int32_t disp, uint8_t imm) {
+        rex(false, 0, base);
+        byte(0xC6);
+        memory(0, base, disp);
+        byte(imm);
+    }
+    /// Compares the byte at [base] with zero.
+    void cmp_byte_zero(Reg base) {
+        rex(false, 0, base);
+        byte(0x80);
+        memory(7, base, 0);
+        byte(0);
+    }
+
+    void alu64(uint8_t op, Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(op);
+        direct(src, dst);
+    }
+    void alu32(uint8_t op, Reg dst, Reg src) {
+        rex(false, src, dst);
+        byte(op);
+        direct(src, dst);
+    }
+    void add64(Reg r, int8_t imm) { group1(true, 0, r, imm); }
+    void cmp64(Reg r, int8_t imm) { group1(true, 7, r, imm); }
+    void xor32(Reg r, int8_t imm) { group1(false, 6, r, imm); }
+    void cmp32(Reg r, uint32_t imm) { group1_imm32(false, 7, r, imm); }
+    void add_rsp(uint32_t imm) { group1_imm32(true, 0, rsp, imm); }
+    void sub_rsp(uint32_t imm) { group1_imm32(true, 5, rsp, imm); }
+    void shl64(Reg r, uint8_t count) { shift(4, r, count); }
+    void shr64(Reg r, uint8_t count) { shift(5, r, count); }
+    void imul32(Reg dst, Reg src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        direct(dst, src);
+    }
+    void cdq() { byte(0x99); }
+    void idiv32(Reg divisor) {
+        rex(false, 0, divisor);
+        byte(0xF7);
+        direct(7, divisor);
+    }
+    void movsxd(Reg dst, Reg src) {
+        rex(true, dst, src);
+        byte(0x63);
+        direct(dst, src);
+    }
+    /// SETcc into the low byte of rax, rcx, rdx or rbx, zero-extended to the full register.
+    void set(Cond cond, Reg r) {
+        byte(0x0F);
+        byte(0x90 | cond);
+        direct(0, r);
+        byte(0x0F);  // movzx r32, r8
+        byte(0xB6);
+        direct(r, r);
+    }
+
+    void movq_to_xmm(int xmm, Reg src) {
+        byte(0x66);
+        rex(true, xmm, src);
+        byte(0x0F);
+        byte(0x6E);
+        direct(xmm, src);
+    }
+    void movq_from_xmm(Reg dst, int xmm) {
+        byte(0x66);
+        rex(true, xmm, dst);
+        byte(0x0F);
+        byte(0x7E);
+        direct(xmm, dst);
+    }
+    void sse(Sse op, int dst, int src) {
+        byte(0xF2);
+        byte(0x0F);
+        byte(op);
+        direct(dst, src);
+    }
+    /// Converts the signed 64-bit integer in `src` to a double.
+    void cvtsi2sd(int xmm, Reg src) {
+        byte(0xF2);
+        rex(true, xmm, src);
+        byte(0x0F);
+        byte(0x2A);
+        direct(xmm, src);
+    }
+    void ucomisd(int x, int y) {
+        byte(0x66);
+        byte(0x0F);
+        byte(0x2E);
+        direct(x, y);
+    }
+
+    void jmp(Reg target) {
+        rex(false, 0, target);
+        byte(0xFF);
+        direct(4, target);
+    }
+    void jmp(Label& label) {
+        byte(0xE9);
+        rel32(label);
+    }
+    void jump_if(Cond cond, Label& label) {
+        byte(0x0F);
+        byte(0x80 | cond);
+        rel32(label);
+    }
+    void bind(Label& label) {
+        label.offset = size();
+        for (size_t fixup : label.fixups) patch(fixup, label.offset);
+        label.fixups.clear();
+    }
+
+private:
+    void byte(uint8_t value) { code.push_back(value); }
+    void u32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void rex(bool wide, int reg, int rm) {
+        uint8_t prefix = 0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+        if (prefix != 0x40) byte(prefix);
+    }
+    void direct(int reg, int rm) { byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+    void memory(int reg, Reg base, int32_t disp) {
+        byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == rsp) byte(0x24);  // rsp and r12 need a SIB byte
+        u32(static_cast<uint32_t>(disp));
+    }
+    void group1(bool wide, int extension, Reg r, int8_t imm) {
+        rex(wide, 0, r);
+        byte(0x83);
+        direct(extension, r);
+        byte(static_cast<uint8_t>(imm));
+    }
+    void group1_imm32(bool wide, int extension, Reg r, uint32_t imm) {
+        rex(wide, 0, r);
+        byte(0x81);
+        direct(extension, r);
+        u32(imm);
+    }
+    void shift(int extension, Reg r, uint8_t count) {
+        rex(true, 0, r);
+        byte(0xC1);
+        direct(extension, r);
+        byte(count);
+    }
+    void rel32(Label& label) {
+        size_t field = size();
+        u32(0);
+        if (label.offset == Label::kUnbound) {
+            label.fixups.push_back(field);
+        } else {
+            patch(field, label.offset);
+        }
+    }
+    void patch(size_t field, size_t target) {
+        auto offset = static_cast<uint32_t>(static_cast<int64_t>(target) -
+                                            static_cast<int64_t>(field + 4));
+        for (int i = 0; i < 4; ++i) code[field + i] = static_cast<uint8_t>(offset >> (8 * i));
+    }
+};
+
+}  // namespace x64
+}  // namespace vm
+}  // namespace tooi
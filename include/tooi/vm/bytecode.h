@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tooi/core/source_location.h"
+#include "tooi/core/types.h"
+#include "tooi/vm/value.h"
+
+namespace tooi {
+namespace ir {
+struct Function;
+struct Module;
+}  // namespace ir
+
+namespace vm {
+
+/**
+ * @brief What an instruction operand refers to.
+ */
+enum class OperandKind {
+    Register,  ///< Frame slot written (or, for windows, the first of a range)
+    Source,    ///< Frame slot, or a constant if kConstantFlag is set
+    Upvalue,   ///< Index into the closure's captured values
+    Global,    ///< Global slot (core::GlobalTable index)
+    Name,      ///< Index into Chunk::names
+    Type,      ///< Index into Chunk::types
+    Count,     ///< Number of values in a window
+    Function,  ///< Index into CompiledModule::functions
+    Target,    ///< Code offset of a jump target
+    Flags,     ///< DefineProp flags
+    Cache      ///< Index into Chunk::caches
+};
+
+/**
+ * @brief Arithmetic and comparisons specialized to one operand type.
+ *
+ * The compiler emits them when both operands are statically of one type
+ * among `int`, `int64`, `uint`, `uint64` and `float64`, and the VM quickens
+ * generic instructions into them once their operand kinds are stable. They
+ * compute on the unboxed payloads, integers with overflow checks. An operand
+ * of another kind de-quickens the instruction back to its generic form;
+ * overflow, division by zero and int64/uint64 results too wide for the
+ * payload run the generic operation without de-quickening.
+ */
+#define TOOI_VM_TYPED_OPCODES(X, type)     \
+    X(Add##type, Register, Source, Source) \
+    X(Sub##type, Register, Source, Source) \
+    X(Mul##type, Register, Source, Source) \
+    X(Div##type, Register, Source, Source) \
+    X(Mod##type, Register, Source, Source) \
+    X(Eq##type, Register, Source, Source)  \
+    X(Ne##type, Register, Source, Source)  \
+    X(Lt##type, Register, Source, Source)  \
+    X(Le##type, Register, Source, Source)  \
+    X(Gt##type, Register, Source, Source)  \
+    X(Ge##type, Register, Source, Source)
+
+/**
+ * @brief The VM instruction set.
+ *
+ * The VM is a register machine in the style of Lua 5: instructions name the
+ * frame slots they read and write, so `a + b` is a single `Add`. Operands
+ * that only read a value (Source) may also name a constant.
+ *
+ * Instructions that take a variable number of values (invocations, literals
+ * and closures) read them from a window of consecutive slots at the top of
+ * the frame. For invocations the callee sits in the window's first slot and
+ * the arguments above it become the first slots of the new frame.
+ */
+#define TOOI_VM_OPCODES(X)                                                         \
+    /* --- Values and names --- */                                                 \
+    X(Move, Register, Source)                                                      \
+    X(LoadSelf, Register)                                                          \
+    X(LoadUpvalue, Register, Upvalue)                                              \
+    X(LoadGlobal, Register, Global)                                                \
+    X(StoreGlobal, Global, Source)                                                 \
+    X(LoadName, Register, Name)   /* self property, then global, by name        */ \
+    X(AddModule, Register, Name)                                                   \
+    /* --- Arithmetic, comparison, conversion --- */                               \
+    X(Add, Register, Source, Source)                                               \
+    X(Sub, Register, Source, Source)                                               \
+    X(Mul, Register, Source, Source)                                               \
+    X(Div, Register, Source, Source)                                               \
+    X(Mod, Register, Source, Source)                                               \
+    X(Neg, Register, Source)                                                       \
+    X(Not, Register, Source)                                                       \
+    X(Eq, Register, Source, Source)                                                \
+    X(Ne, Register, Source, Source)                                                \
+    X(Lt, Register, Source, Source)                                                \
+    X(Le, Register, Source, Source)                                                \
+    X(Gt, Register, Source, Source)                                                \
+    X(Ge, Register, Source, Source)                                                \
+    X(Truthy, Register, Source)                                                    \
+    X(Concat, Register, Source, Source)                                            \
+    X(Cast, Register, Source, Type)   /* explicit `as` conversion               */ \
+    X(Coerce, Register, Source, Type) /* implicit: widen or check a proto value */ \
+    /* --- Typed and quickened forms --- */                                        \
+    TOOI_VM_TYPED_OPCODES(X, I32)                                                  \
+    TOOI_VM_TYPED_OPCODES(X, I64)                                                  \
+    TOOI_VM_TYPED_OPCODES(X, U32)                                                  \
+    TOOI_VM_TYPED_OPCODES(X, U64)                                                  \
+    TOOI_VM_TYPED_OPCODES(X, F64)                                                  \
+    X(ConcatStr, Register, Source, Source)   /* Concat of two strings           */ \
+    X(GetPropObject, Register, Source, Name, Cache) /* GetProp on an object     */ \
+    /* --- Objects --- */                                                          \
+    X(NewObject, Register, Name)                                                   \
+    X(CloneObject, Register, Source)                                               \
+    X(GetProp, Register, Source, Name, Cache)                                      \
+    X(SetProp, Source, Name, Source, Cache)                                        \
+    X(DefineProp, Source, Name, Source, Flags, Type) /* declared property type  */ \
+    X(MakeAct, Register, Function, Register) /* upvalues, param defaults        */ \
+    X(SetAct, Source, Source)                                                      \
+    X(ActIs, Register, Source, Source)                                             \
+    X(ActIsFunction, Register, Source, Function)                                   \
+    X(Invoke, Register, Register, Count)     /* result, window, argument count  */ \
+    X(CallMethod, Register, Register, Name, Count, Cache)                          \
+    X(TailInvoke, Register, Count)           /* window, count; reuses the frame */ \
+    /* --- Collections --- */                                                      \
+    X(NewArray, Register, Register, Count)                                         \
+    X(NewTuple, Register, Register, Count)                                         \
+    X(NewAssoc, Register, Register, Count)   /* key, value, key, value, ...     */ \
+    X(Index, Register, Source, Source)                                             \
+    X(SetIndex, Source, Source, Source)      /* container, index, value         */ \
+    X(Length, Register, Source)                                                    \
+    X(IterSource, Register, Source)                                                \
+    /* --- Builtin methods of arrays and assocs, run inline --- */                 \
+    X(ArrayPush, Register, Source, Source)   /* result, array, element          */ \
+    X(ArrayPop, Register, Source)                                                  \
+    X(ArrayInsert, Register, Source, Source, Source) /* array, element, index   */ \
+    X(ArrayRemove, Register, Source, Source) /* result, array, index            */ \
+    X(AssocHas, Register, Source, Source)    /* result, assoc, key              */ \
+    X(AssocRemove, Register, Source, Source)                                       \
+    /* --- Control flow --- */                                                     \
+    X(Jump, Target)                                                                \
+    X(JumpIfFalse, Target, Source)                                                 \
+    X(JumpIfTrue, Target, Source)                                                  \
+    X(Return, Source)
+
+/**
+ * @brief Superinstructions: sequences of two or three instructions run by one handler.
+ *
+ * Generated at build time by tools/gen_superinstructions.py from the opcode
+ * sequences most frequent in benchmarks/opcode_profile.txt, as entries
+ * `X(name, first, second[, third])`. A superinstruction only replaces the
+ * opcode byte of its first instruction, whose operands it takes: the
+ * following instructions stay in place, so jumps into them still work, and
+ * the fused handler executes them one after the other without dispatching
+ * in between.
+ */
+#include "tooi/vm/superinstructions.inc"
+
+enum class Opcode : uint8_t {
+#define TOOI_VM_OPCODE_ENUM(name, ...) name,
+    TOOI_VM_OPCODES(TOOI_VM_OPCODE_ENUM)
+    TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_OPCODE_ENUM)
+#undef TOOI_VM_OPCODE_ENUM
+};
+
+const char* opcode_name(Opcode op);
+const std::vector<OperandKind>& operand_kinds(Opcode op);
+
+/// The form of a generic Add..Mod or Eq..Ge specialized to operands of the kind, or `op`.
+Opcode typed_opcode(Opcode op, ValueKind kind);
+
+/// The generic instruction a typed or quickened one falls back to, or `op` if it is generic.
+Opcode generic_opcode(Opcode op);
+
+/// The opcodes a superinstruction executes in order, or just `op` for an ordinary one.
+const std::vector<Opcode>& superinstruction_parts(Opcode op);
+
+/**
+ * @brief Rewrites the instruction at `position` into the longest superinstruction
+ *        whose parts start there; leaves it alone if there is none.
+ */
+void fuse_superinstruction(std::vector<uint32_t>& code, size_t position);
+
+/**
+ * @brief Splits the superinstructions that run the instruction at `position`
+ *        as a later part, then fuses what remains of them again.
+ *
+ * Called when that instruction changes form (see VM::dequicken), since a
+ * fused handler would keep running its old form.
+ */
+void unfuse_superinstructions(std::vector<uint32_t>& code, size_t position);
+
+/// Number of code words of an instruction (one per operand).
+inline size_t instruction_length(Opcode op) { return operand_kinds(op).size(); }
+
+/// Largest value of an operand.
+constexpr uint32_t kMaxOperand = (1u << 24) - 1;
+
+/// Marks a Source operand that indexes Chunk::constants instead of a slot.
+constexpr uint32_t kConstantFlag = 1u << 23;
+
+/**
+ * An instruction is one 32-bit word holding the opcode in the low byte and
+ * the first operand above it, followed by one word per further operand.
+ */
+inline uint32_t encode(Opcode op, uint32_t operand = 0) {
+    return static_cast<uint32_t>(op) | (operand << 8);
+}
+inline Opcode decode_op(uint32_t word) { return static_cast<Opcode>(word & 0xff); }
+inline uint32_t decode_operand(uint32_t word) { return word >> 8; }
+
+/// Flags operand of DefineProp.
+constexpr uint32_t kPropertyIsSet = 1;
+constexpr uint32_t kPropertyIsPrivate = 2;
+
+struct CompiledModule;
+struct JitContext;
+struct NativeCode;
+struct Shape;
+
+/**
+ * @brief A chunk translated to C++ ahead of time by --emit-cpp (see aot.h).
+ *
+ * Called like the Jit's native code: runs the chunk from the instruction at
+ * `position` and returns the position of the one the interpreter executes next.
+ */
+using AotFunction = uint32_t (*)(Value* slots, const Value* constants, JitContext* context,
+                                 uint32_t position);
+
+/**
+ * @brief What the VM observed about one generic instruction, for quickening.
+ *
+ * Kept for the first word of every instruction. The VM counts consecutive
+ * executions whose operands allow the same specialized form and rewrites
+ * the instruction once the count reaches VM::kQuickenThreshold.
+ */
+struct Feedback {
+    static constexpr uint8_t kBlocked = 0xff;  ///< De-quickened; never quickened again
+
+    Opcode candidate{};  ///< Specialized form the last execution allowed
+    uint8_t count = 0;
+};
+
+/**
+ * @brief The inline cache of a property access or method call site.
+ *
+ * Caches the slot of the property for up to kEntries object shapes: a site
+ * with one is monomorphic, with more polymorphic. A site that sees yet
+ * another shape goes megamorphic and from then on also consults the VM's
+ * shared megamorphic cache. SetProp sites only cache writable properties,
+ * along with the declared type that values written to them must have.
+ */
+struct InlineCache {
+    static constexpr int kEntries = 4;
+
+    struct Entry {
+        const Shape* shape = nullptr;
+        uint32_t slot = 0;
+        const core::TypeRef* type = nullptr;  ///< SetProp: Property::type, if the property has one
+    };
+
+    Entry entries[kEntries];
+    uint8_t count = 0;
+    bool megamorphic = false;
+    uint64_t hits = 0;  ///< Lookups answered by a cache, for --ic-stats
+    uint64_t misses = 0;
+};
+
+/**
+ * @brief The bytecode of one act, or of the top-level code of a script.
+ *
+ * An act compiled lazily (Compiler::compile_lazily) has its name and counts
+ * of params and upvalues from the start, and no code until it is first
+ * invoked.
+ */
+struct Chunk {
+    std::string name;
+    int index = 0;  ///< Position in CompiledModule::functions
+    int param_count = 0;
+    int upvalue_count = 0;
+    int slot_count = 0;  ///< Frame slots: params, values, then the window
+    mutable std::vector<uint32_t> code;  ///< Quickened in place by the VM
+    std::vector<core::SourceLocation> locations;  ///< Parallel to code (one per word)
+    mutable std::vector<Feedback> feedback;       ///< Parallel to code; sized by the VM
+    mutable std::vector<InlineCache> caches;      ///< Indexed by Cache operands
+    mutable NativeCode* native = nullptr;  ///< Machine code from the Jit, once compiled
+    mutable uint32_t hotness = 0;          ///< Entries counted towards compiling it
+    AotFunction aot = nullptr;  ///< Its code in a program built from --emit-cpp output
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    std::vector<core::TypeRef> types;
+    const CompiledModule* module = nullptr;
+};
+
+/**
+ * @brief The compiled form of an ir::Module: the script followed by all acts.
+ *
+ * Modules stay alive as long as the VM, since closures created by a REPL
+ * submission outlive it.
+ */
+struct CompiledModule {
+    /// Grows when the body of a deferred act is built (Compiler::compile_act).
+    mutable std::vector<std::unique_ptr<Chunk>> functions;
+    std::string source;  ///< For runtime diagnostics
+    /// The IR of the acts not compiled yet, and what runs on an act's IR before it is.
+    std::shared_ptr<ir::Module> ir;
+    std::function<void(ir::Function&)> prepare;
+
+    Chunk* script() const { return functions.front().get(); }
+};
+
+void print_chunk(const Chunk& chunk, std::ostream& out);
+void print_compiled_module(const CompiledModule& module, std::ostream& out);
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace tooi {
+namespace vm {
+
+/// Machine code of one chunk or loop trace, as installed in the CodeCache.
+struct NativeCode {
+    static constexpr uint32_t kNoEntry = UINT32_MAX;
+
+    NativeCode** owner;     ///< Where the chunk or loop points at its code; cleared on eviction
+    uint32_t* hotness;      ///< Its hotness counter; reset on eviction
+    const uint8_t* code;    ///< Start of the executable mapping
+    size_t mapped;          ///< Bytes mapped (whole pages)
+    size_t size;            ///< Bytes of machine code
+    std::vector<uint32_t> entries;  ///< Code offset per bytecode word; kNoEntry for operands
+    uint64_t last_used = 0;  ///< CodeCache tick of the latest entry, for eviction
+};
+
+/**
+ * @class CodeCache
+ * @brief Executable memory for JIT-compiled chunks and traces, evicted least recently used first.
+ *
+ * Memory is never writable and executable at once (W^X): each chunk's
+ * code is copied into fresh pages mapped read-write with `mmap`, which
+ * `mprotect` then turns read-execute before the code can run. Code is
+ * never patched in place; a chunk whose code changes is evicted and
+ * compiled again. When installing would exceed the capacity, the code
+ * entered least recently is evicted, and its owner goes back to the
+ * interpreter until it gets hot again.
+ */
+class CodeCache {
+public:
+    static constexpr size_t kDefaultCapacity = size_t{4} << 20;  ///< Bytes of mapped code
+
+    explicit CodeCache(size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+    CodeCache(const CodeCache&) = delete;
+    CodeCache& operator=(const CodeCache&) = delete;
+    ~CodeCache();
+
+    /**
+     * @brief Copies code into executable memory and points `owner` at it.
+     * @param hotness The owner's hotness counter, reset when the code is evicted.
+     * @return The installed code, or nullptr if the memory cannot be mapped.
+     */
+    NativeCode* install(NativeCode*& owner, uint32_t& hotness, const std::vector<uint8_t>& code,
+                        std::vector<uint32_t> entries);
+
+    /// Unmaps the code `owner` points at, if any; the owner then runs in the interpreter again.
+    void evict(NativeCode*& owner);
+
+    /// Marks the code as just entered.
+    void touch(NativeCode& native) { native.last_used = ++tick_; }
+
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_; }
+    size_t evictions() const { return evictions_; }
+
+private:
+    size_t capacity_;
+    size_t used_ = 0;
+    size_t evictions_ = 0;
+    uint64_t tick_ = 0;
+    std::list<NativeCode> blocks_;  ///< Stable addresses; owners point into it
+
+    void release(std::list<NativeCode>::iterator block);
+};
+
+}  // namespace vm
+}  // namespace tooi
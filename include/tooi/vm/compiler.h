@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "tooi/ir/ir.h"
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/heap.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @class Compiler
+ * @brief Translates optimized SSA IR into register bytecode.
+ *
+ * Blocks are laid out in reverse postorder so that most jumps fall through.
+ * Every SSA value that is used gets a frame slot of its own after the params
+ * (which live where the caller put them); constants are used in place as
+ * Source operands. Two kinds of values are written straight to where they
+ * are needed instead:
+ * - a value whose only use is an operand of a phi on the edge leaving its
+ *   block shares the phi's slot, if the phi is not read after it there,
+ * - a value whose only use is a window operand of a later instruction in
+ *   the same block, with no other window use in between, is computed into
+ *   its window slot.
+ *
+ * The remaining phi operands are copied on the incoming edges as a parallel
+ * assignment, using a scratch slot to break cycles. Branches to a block
+ * with phis get a short stub that performs the copies for that edge.
+ */
+class Compiler {
+public:
+    /// String constants are allocated on the VM's heap.
+    explicit Compiler(Heap& heap);
+
+    std::unique_ptr<CompiledModule> compile(const ir::Module& module, std::string source);
+
+    /**
+     * @brief Compiles the script of a module now, and each act on its first invocation.
+     *
+     * Large scripts define many acts that a given run never invokes; their
+     * chunks only get the counts MakeAct and invocations check until the VM
+     * calls compile_act().
+     * @param prepare Runs on an act's IR right before it is compiled, if set
+     *        (the passes PassManager::run(module, true) left out, and building
+     *        the bodies of deferred acts). It may throw RuntimeError.
+     */
+    std::unique_ptr<CompiledModule> compile_lazily(std::shared_ptr<ir::Module> module,
+                                                   std::string source,
+                                                   std::function<void(ir::Function&)> prepare);
+
+    /// Compiles an act compile_lazily() left without code.
+    void compile_act(Chunk& chunk);
+
+private:
+    Heap& heap_;
+};
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "tooi/vm/code_cache.h"
+
+namespace tooi {
+namespace vm {
+
+struct Object;
+
+/**
+ * @file deopt.h
+ * @brief Deoptimization: why speculative code hands a frame back, and what it depends on.
+ *
+ * Quickened instructions, inlined acts, inline caches and JIT code all
+ * speculate, and all fall back the same way: every tier keeps a frame in
+ * the interpreter's layout (a trace writes its values back, boxed, before
+ * it leaves), so handing a frame back to the baseline bytecode is resuming
+ * the interpreter at the instruction whose assumption failed. Most
+ * assumptions are checked where they are used. The objects whose shapes a
+ * trace read once before its loop are watched instead (Dependencies), and
+ * the traces relying on them are dropped as soon as one changes.
+ */
+
+/// The assumption a deoptimization found broken.
+enum class DeoptReason : uint8_t {
+    Kind,      ///< An operand had another kind than the code was specialized for
+    Shape,     ///< An object had another shape
+    Act,       ///< An inlined act was replaced, as by `let obj @ {...}`
+    Overflow,  ///< int32 arithmetic overflowed or divided by zero
+    Range,     ///< An index was out of range
+};
+
+constexpr size_t kDeoptReasons = 5;
+/// JitContext::deopt when native code left without deoptimizing.
+constexpr uint8_t kNoDeopt = 0xff;
+
+const char* deopt_reason_name(DeoptReason reason);
+
+/// Deoptimizations by reason, printed with --vm-stats.
+struct DeoptStats {
+    uint64_t counts[kDeoptReasons] = {};
+
+    void count(DeoptReason reason) { counts[static_cast<size_t>(reason)]++; }
+    uint64_t operator[](DeoptReason reason) const { return counts[static_cast<size_t>(reason)]; }
+};
+
+/**
+ * @class Dependencies
+ * @brief Native code that assumed objects keep their shapes.
+ *
+ * A watched object has Object::watched set, so that the VM only looks
+ * here when one of those changes shape. Objects are never dereferenced
+ * through the table, so one that is collected meanwhile leaves a stale
+ * entry at worst.
+ */
+class Dependencies {
+public:
+    /// Makes the code `owner` points at depend on the shape of `object`.
+    void add(Object& object, NativeCode*& owner);
+
+    /**
+     * @brief Evicts the code depending on an object that changed shape.
+     * @return How many pieces of code were evicted.
+     */
+    size_t invalidate(Object& object, CodeCache& cache);
+
+private:
+    struct Dependent {
+        NativeCode** owner;
+        const NativeCode* code;  ///< What `owner` pointed at; it may have been replaced since
+    };
+    std::unordered_map<const Object*, std::vector<Dependent>> dependents_;
+};
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/object.h"
+#include "tooi/vm/value.h"
+
+/**
+ * @file fast_paths.h
+ * @brief The typed fast paths: arithmetic and comparisons on unboxed payloads.
+ *
+ * The typed opcodes compute on unboxed payloads. Their fast paths return
+ * false, leaving the result alone, whenever the generic operation has to run
+ * instead: an operand of another kind (Operand<T>::is fails, and the VM
+ * de-quickens), integer overflow, division by zero, or an int64/uint64
+ * result too wide for the payload. Shared by the interpreter's handlers and
+ * the C++ that --emit-cpp generates (see aot.h), which also reads properties
+ * through inline caches here.
+ */
+
+namespace tooi {
+namespace vm {
+
+// The fast paths must be inlined into their handlers; with dozens of
+// instantiations in one function, the inliner otherwise gives up on them.
+#if defined(__GNUC__) || defined(__clang__)
+#define TOOI_VM_INLINE [[gnu::always_inline]] inline
+#else
+#define TOOI_VM_INLINE inline
+#endif
+
+template <typename T>
+struct Operand;
+
+template <>
+struct Operand<int32_t> {
+    static bool is(const Value& value) { return value.is_int32(); }
+    static int32_t get(const Value& value) { return static_cast<int32_t>(value.as_int()); }
+    static bool make(int32_t number, Value& result) {
+        result = Value::int32(number);
+        return true;
+    }
+};
+
+template <>
+struct Operand<uint32_t> {
+    static bool is(const Value& value) { return value.is_uint32(); }
+    static uint32_t get(const Value& value) { return static_cast<uint32_t>(value.as_uint()); }
+    static bool make(uint32_t number, Value& result) {
+        result = Value::uint32(number);
+        return true;
+    }
+};
+
+template <>
+struct Operand<int64_t> {
+    static bool is(const Value& value) { return value.is_small_int64(); }
+    static int64_t get(const Value& value) { return value.as_int(); }
+    static bool make(int64_t number, Value& result) {
+        if (!Value::fits_payload(number)) return false;
+        result = Value::small_int64(number);
+        return true;
+    }
+};
+
+template <>
+struct Operand<uint64_t> {
+    static bool is(const Value& value) { return value.is_small_uint64(); }
+    static uint64_t get(const Value& value) { return value.as_uint(); }
+    static bool make(uint64_t number, Value& result) {
+        if (!Value::fits_payload(number)) return false;
+        result = Value::small_uint64(number);
+        return true;
+    }
+};
+
+template <>
+struct Operand<double> {
+    static bool is(const Value& value) { return value.is_float64(); }
+    static double get(const Value& value) { return value.as_double(); }
+    static bool make(double number, Value& result) {
+        result = Value::number(ValueKind::Float64, number);
+        return true;
+    }
+};
+
+template <Opcode op, typename T>
+TOOI_VM_INLINE bool typed_arithmetic(const Value& x, const Value& y, Value& result) {
+    if (!Operand<T>::is(x) || !Operand<T>::is(y)) return false;
+    T a = Operand<T>::get(x);
+    T b = Operand<T>::get(y);
+    T number;
+    if constexpr (std::is_floating_point_v<T>) {
+        if constexpr (op == Opcode::Add) {
+            number = a + b;
+        } else if constexpr (op == Opcode::Sub) {
+            number = a - b;
+        } else if constexpr (op == Opcode::Mul) {
+            number = a * b;
+        } else if constexpr (op == Opcode::Div) {
+            number = a / b;
+        } else {
+            number = std::fmod(a, b);
+        }
+    } else if constexpr (op == Opcode::Add) {
+        if (__builtin_add_overflow(a, b, &number)) return false;
+    } else if constexpr (op == Opcode::Sub) {
+        if (__builtin_sub_overflow(a, b, &number)) return false;
+    } else if constexpr (op == Opcode::Mul) {
+        if (__builtin_mul_overflow(a, b, &number)) return false;
+    } else {
+        if (b == 0) return false;
+        if constexpr (std::is_signed_v<T>) {
+            if (a == std::numeric_limits<T>::min() && b == -1) return false;
+        }
+        number = op == Opcode::Div ? a / b : a % b;
+    }
+    return Operand<T>::make(number, result);
+}
+
+template <Opcode op, typename T>
+TOOI_VM_INLINE bool typed_compare(const Value& x, const Value& y, Value& result) {
+    if (!Operand<T>::is(x) || !Operand<T>::is(y)) return false;
+    T a = Operand<T>::get(x);
+    T b = Operand<T>::get(y);
+    bool holds;
+    if constexpr (op == Opcode::Eq) {
+        holds = a == b;
+    } else if constexpr (op == Opcode::Ne) {
+        holds = a != b;
+    } else if constexpr (op == Opcode::Lt) {
+        holds = a < b;
+    } else if constexpr (op == Opcode::Le) {
+        holds = a <= b;
+    } else if constexpr (op == Opcode::Gt) {
+        holds = a > b;
+    } else {
+        holds = a >= b;
+    }
+    result = Value::boolean(holds);
+    return true;
+}
+
+/// A property read answered by the site's inline cache; false on a miss, left to the VM.
+TOOI_VM_INLINE bool cached_property(const Value& object, InlineCache& cache, Value& result) {
+    if (!object.is(ValueKind::Object)) return false;
+    const Object* instance = as_object(object);
+    for (uint8_t i = 0; i < cache.count; ++i) {
+        if (cache.entries[i].shape == instance->shape) {
+            cache.hits++;
+            result = instance->slots()[cache.entries[i].slot];
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tooi/vm/object.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @class Heap
+ * @brief Owns every runtime object and reclaims them with mark and sweep.
+ *
+ * Collection only happens when the VM asks for it at a safe point (an
+ * invocation or a loop back edge), where every live value is reachable from
+ * the VM's roots. Allocation itself never collects, so native code can hold
+ * fresh objects in C++ locals while it builds a result.
+ */
+class Heap {
+public:
+    /// Collections are not considered before this many objects exist.
+    static constexpr size_t kMinThreshold = 1 << 16;
+
+    Heap() = default;
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+    ~Heap();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new T(std::forward<Args>(args)...);
+        object->next = objects_;
+        objects_ = object;
+        count_++;
+        return object;
+    }
+
+    Value string(std::string text) {
+        return Value::heap(make<StringObject>(std::move(text)));
+    }
+    Value array(ValueKind kind, std::vector<Value> elements) {
+        return Value::heap(make<ArrayObject>(kind, std::move(elements)));
+    }
+    /// A new object without properties.
+    Object* object(std::string name) { return make<Object>(std::move(name), &empty_shape_); }
+    /// The copy `new` makes of an object, with its own arrays and assoc arrays (see Object).
+    Object* copy(Object& original);
+
+    /// The root of the shape tree: the shape of objects without properties.
+    Shape* empty_shape() { return &empty_shape_; }
+
+    /// True once enough objects were allocated since the last collection.
+    bool should_collect() const { return count_ >= threshold_; }
+    /// The counters should_collect() compares, for native code that polls them.
+    const size_t* count_address() const { return &count_; }
+    const size_t* threshold_address() const { return &threshold_; }
+
+    /**
+     * @brief Collects garbage.
+     * @param mark_roots Marks the roots (through mark()); called once.
+     */
+    void collect(const std::function<void(Heap&)>& mark_roots);
+
+    void mark(const Value& value) {
+        if (value.is_pointer()) mark(value.ref());
+    }
+    void mark(HeapObject* object);
+
+    size_t object_count() const { return count_; }
+    size_t collections() const { return collections_; }
+
+private:
+    HeapObject* objects_ = nullptr;
+    size_t count_ = 0;
+    size_t threshold_ = kMinThreshold;
+    size_t collections_ = 0;
+    std::vector<HeapObject*> gray_;  ///< Marked objects whose references are not yet marked
+    Shape empty_shape_;
+
+    void trace(HeapObject* object);
+};
+
+}  // namespace vm
+}  // namespace tooi
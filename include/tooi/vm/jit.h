@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/code_cache.h"
+#include "tooi/vm/deopt.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define TOOI_JIT_AVAILABLE 1
+#else
+#define TOOI_JIT_AVAILABLE 0
+#endif
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @brief What generated code reads besides the frame's slots and constants.
+ *
+ * Filled in by the VM before every entry into native code; the templates
+ * address the fields by offset.
+ */
+struct JitContext {
+    Value* globals = nullptr;
+    Value self;
+    const size_t* heap_count = nullptr;      ///< Heap::should_collect() compares these two
+    const size_t* heap_threshold = nullptr;
+    uint8_t deopt = kNoDeopt;  ///< DeoptReason a trace left for, if it deoptimized
+    InlineCache* caches = nullptr;  ///< The chunk's, for the code --emit-cpp generates
+};
+
+/// JIT counters, printed with --vm-stats.
+struct JitStats {
+    uint64_t compiled = 0;           ///< Chunks compiled to machine code
+    uint64_t invalidated = 0;        ///< Compiled chunks whose bytecode was rewritten afterwards
+    uint64_t entries = 0;            ///< Transfers from the interpreter into native code
+    uint64_t osr_entries = 0;        ///< Of which at a loop back edge, into a running frame
+    uint64_t traces = 0;             ///< Loop traces recorded and compiled
+    uint64_t trace_aborts = 0;       ///< Recordings stopped by an instruction a trace cannot hold
+    uint64_t trace_invalidated = 0;  ///< Traces dropped once what they assumed stopped holding
+    uint64_t blacklisted = 0;        ///< Loops no longer traced
+    uint64_t trace_entries = 0;      ///< Runs of a loop trace
+    DeoptStats deopts;               ///< Trace exits whose assumption failed
+};
+
+/**
+ * @class Jit
+ * @brief Baseline JIT: translates hot chunks to x86-64 machine code, one template per opcode.
+ *
+ * A chunk is compiled once it has been entered (invoked, returned to, or
+ * looped back into) kHotness times. Every instruction becomes a fixed
+ * sequence of machine code working on the frame's slots in place, so the
+ * interpreter and native code can hand a frame back and forth at any
+ * instruction boundary. Moves, globals, branches, truthiness and the int
+ * and float64 typed instructions have templates; any other instruction,
+ * and a typed one whose operands have the wrong kind or overflow, leaves
+ * native code, and the interpreter executes it. The interpreter enters
+ * native code again at the next invocation, return or loop back edge.
+ *
+ * Native code never calls back into the VM and never allocates, so it
+ * needs no safe points of its own: a loop back edge exits to the
+ * interpreter when the heap wants a collection. Quickening or
+ * de-quickening an instruction invalidates the code of its chunk.
+ *
+ * Above the templates sits a tracing tier for loops (see trace.h). Every
+ * loop back edge counts towards the hotness of its loop; a hot loop has
+ * one iteration recorded as a trace, which is compiled with its values
+ * unboxed and runs iteration after iteration until a guard fails. A loop
+ * whose recording aborts kMaxAborts times, or whose trace keeps leaving
+ * within its first iterations, is blacklisted and left to the templates,
+ * whose back edges only return to the interpreter, and so to the trace,
+ * while their loop is not blacklisted.
+ *
+ * Both tiers take over a frame mid-execution (on-stack replacement): a
+ * long loop in a chunk that is only invoked once moves into native code
+ * at one of its back edges. The way back is the same: a failed guard or
+ * an instruction without a template writes the frame back and resumes the
+ * interpreter at that instruction. A trace that keeps failing before it
+ * completes an iteration, because the kinds or shapes it was recorded with
+ * no longer hold, is dropped and recorded again.
+ *
+ * Only available on x86-64 Linux (kAvailable).
+ */
+class Jit {
+public:
+    static constexpr bool kAvailable = TOOI_JIT_AVAILABLE;
+    /// Entries into a chunk before it is compiled.
+    static constexpr uint32_t kHotness = 100;
+    /// Back edges of a loop before it is traced.
+    static constexpr uint32_t kLoopHotness = 50;
+    /// Aborted recordings, or traces dropped for failing in their first iteration, before a
+    /// loop is blacklisted.
+    static constexpr uint32_t kMaxAborts = 3;
+    /// A trace that averages fewer than kMinIterations per run over its first
+    /// kProbation runs is dropped, and its loop blacklisted.
+    static constexpr uint32_t kProbation = 100;
+    static constexpr uint32_t kMinIterations = 4;
+
+    explicit Jit(size_t capacity = CodeCache::kDefaultCapacity, bool tracing = true)
+        : tracing_(tracing), cache_(capacity) {}
+
+    /**
+     * @brief Where the native code of a chunk resumes at an instruction.
+     *
+     * Counts the entry towards the chunk's hotness and compiles it when it
+     * gets hot. Every instruction is an entry, so at a loop back edge the
+     * frame the interpreter is running moves into native code as it is: a
+     * chunk that is called once but loops long gets compiled all the same.
+     * @param back_edge The entry is at a loop back edge.
+     * @return nullptr if the chunk runs in the interpreter.
+     */
+    const uint8_t* entry(const Chunk& chunk, size_t position, bool back_edge = false) {
+        if (!chunk.native && (++chunk.hotness < kHotness || !compile(chunk))) return nullptr;
+        cache_.touch(*chunk.native);
+        stats_.entries++;
+        if (back_edge) stats_.osr_entries++;
+        return chunk.native->code + chunk.native->entries[position];
+    }
+
+    /**
+     * @brief Runs native code from an entry until it leaves to the interpreter.
+     * @return The position of the instruction the interpreter executes next.
+     */
+    uint32_t run(const Chunk& chunk, const uint8_t* entry, Value* slots, const Value* constants,
+                 JitContext& context);
+
+    /// Drops the machine code of a chunk whose bytecode was rewritten.
+    void invalidate(const Chunk& chunk) {
+        if (!chunk.native) return;
+        cache_.evict(chunk.native);
+        stats_.invalidated++;
+    }
+
+    /// True if hot loops are traced.
+    bool tracing() const { return tracing_; }
+
+    /**
+     * @brief Takes a loop back edge to the header at `header`.
+     *
+     * Runs the loop's trace if it has one, and otherwise counts the back
+     * edge and records a trace once the loop is hot. Traces do not depend
+     * on how the chunk's instructions are quickened, so invalidating the
+     * chunk keeps them.
+     * @return The position the interpreter continues at: the header if
+     * nothing ran, or where the trace or the recording stopped.
+     */
+    uint32_t loop(const Chunk& chunk, uint32_t header, Value* slots, JitContext& context);
+
+    /// Drops the traces that read a property of `object` once, before their loop.
+    void shape_changed(Object& object) {
+        stats_.trace_invalidated += dependencies_.invalidate(object, cache_);
+    }
+
+    /// Nonzero once the loop at `header` is blacklisted; read by the templates' back edges.
+    const uint8_t* blacklisted(const Chunk& chunk, uint32_t header) {
+        return &loops_[&chunk.code[header]].blacklisted;
+    }
+
+    const JitStats& stats() const { return stats_; }
+    const CodeCache& cache() const { return cache_; }
+
+private:
+    struct Loop {
+        uint32_t hotness = 0;  ///< Back edges counted towards tracing it
+        uint32_t aborts = 0;
+        uint32_t misses = 0;   ///< Consecutive runs of the trace that completed no iteration
+        uint32_t runs = 0;     ///< Runs of the trace, and the iterations they completed
+        uint64_t iterations = 0;
+        uint8_t blacklisted = 0;
+        NativeCode* trace = nullptr;
+    };
+
+    bool tracing_;
+    JitStats stats_;
+    std::unordered_map<const uint32_t*, Loop> loops_;  ///< By the loop's header instruction
+    Dependencies dependencies_;
+    // Declared last, so destroyed first: releasing a trace clears fields of its Loop.
+    CodeCache cache_;
+
+    /// Compiles and installs a chunk; false if it cannot run natively.
+    bool compile(const Chunk& chunk);
+    /// Counts a failed recording or trace; blacklists the loop after kMaxAborts.
+    void abort(Loop& loop);
+};
+
+}  // namespace vm
+}  // namespace tooi
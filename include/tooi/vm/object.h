@@ -0,0 +1,276 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tooi/vm/value.h"
+
+namespace tooi {
+namespace vm {
+
+struct Chunk;
+
+/// An int64 or uint64 too wide for the payload of a Value.
+struct IntegerObject : HeapObject {
+    IntegerObject(ValueKind kind, uint64_t bits) : HeapObject(kind), bits(bits) {}
+    uint64_t bits;  ///< The value; an int64 in two's complement
+};
+
+struct StringObject : HeapObject {
+    explicit StringObject(std::string text) : HeapObject(ValueKind::String), text(std::move(text)) {}
+    std::string text;
+};
+
+/**
+ * @brief Contents that copies of a container can share until one of them
+ * modifies them.
+ *
+ * The contents stay inline until the first copy shares them; they then move
+ * to a block counting its sharers, and whichever sharer modifies them first
+ * takes its own copy (the last one takes the block's contents back).
+ */
+template <typename T>
+class SharedContents {
+public:
+    SharedContents() = default;
+    explicit SharedContents(T contents) : own_(std::move(contents)) {}
+    ~SharedContents() { release(); }
+    SharedContents(const SharedContents&) = delete;
+    SharedContents& operator=(const SharedContents&) = delete;
+
+    const T& get() const { return shared_ ? shared_->contents : own_; }
+    /// The contents, copied first if another container still shares them.
+    T& writable() {
+        if (shared_) unshare();
+        return own_;
+    }
+    /// Starts sharing the contents of `original`.
+    void share(SharedContents& original) {
+        release();
+        if (!original.shared_) original.shared_ = new Block{std::move(original.own_), 1};
+        shared_ = original.shared_;
+        shared_->owners++;
+    }
+
+private:
+    struct Block {
+        T contents;
+        uint32_t owners;
+    };
+    T own_;                    ///< Unused while shared_ is set
+    Block* shared_ = nullptr;
+
+    void unshare() {
+        if (shared_->owners == 1) {
+            own_ = std::move(shared_->contents);
+        } else {
+            own_ = shared_->contents;
+        }
+        release();
+    }
+    void release() {
+        if (shared_ && --shared_->owners == 0) delete shared_;
+        shared_ = nullptr;
+    }
+};
+
+/**
+ * @brief Arrays and tuples; tuples are never modified after creation.
+ *
+ * The copies `new` makes of an array share its elements until either side
+ * modifies them (see Object).
+ */
+struct ArrayObject : HeapObject {
+    ArrayObject(ValueKind kind, std::vector<Value> elements)
+        : HeapObject(kind), elements_(std::move(elements)) {}
+
+    const std::vector<Value>& elements() const { return elements_.get(); }
+    /// The elements, copied first if another array still shares them.
+    std::vector<Value>& writable_elements() { return elements_.writable(); }
+    /// Starts sharing the elements of `original`, as its copy.
+    void share_elements(ArrayObject& original) { elements_.share(original.elements_); }
+
+private:
+    SharedContents<std::vector<Value>> elements_;
+};
+
+/**
+ * @brief An assoc array. Entries keep their insertion order, which is the
+ * order of `keys()` and of `for` loops. Like the elements of an array, the
+ * entries are shared with copies until either side modifies them.
+ */
+struct AssocObject : HeapObject {
+    AssocObject() : HeapObject(ValueKind::Assoc) {}
+
+    /// The value stored for a key, or nullptr.
+    const Value* find(const Value& key) const;
+    /// Inserts or replaces an entry.
+    void set(const Value& key, const Value& value);
+    /// Removes an entry; returns false if the key is not present.
+    bool remove(const Value& key, Value* removed = nullptr);
+
+    const std::vector<std::pair<Value, Value>>& entries() const { return table_.get().entries; }
+    /// Starts sharing the entries of `original`, as its copy.
+    void share_entries(AssocObject& original) { table_.share(original.table_); }
+
+private:
+    struct Table {
+        std::vector<std::pair<Value, Value>> entries;
+        std::unordered_map<Value, size_t, ValueHash, ValueEqual> index;  ///< Key -> entry position
+    };
+    SharedContents<Table> table_;
+};
+
+/// Where an object keeps one property, and how it was declared.
+struct Property {
+    uint32_t slot = 0;  ///< Index into Object::slots()
+    bool is_set = false;
+    bool is_private = false;
+    core::TypeRef type;  ///< Declared type that writes are checked against, null for proto
+};
+
+/**
+ * @brief The layout shared by objects whose properties were defined alike.
+ *
+ * A shape maps property names to slots. Defining a property follows a
+ * transition from the object's current shape, created on first use and
+ * cached on that shape, so objects built by the same mode block (and
+ * extended by the same `>>` blocks) end up sharing one shape. Shapes form a
+ * tree rooted at Heap::empty_shape() and live as long as the heap.
+ */
+struct Shape {
+    /// The property with the given name, or nullptr.
+    const Property* find(const std::string& name) const {
+        auto it = properties.find(name);
+        return it == properties.end() ? nullptr : &it->second;
+    }
+
+    /// The shape after defining a property: adding it, or redeclaring it with other flags.
+    Shape* transition(const std::string& name, bool is_set, bool is_private,
+                      const core::TypeRef& type = nullptr);
+
+    struct Transition {
+        std::string name;
+        bool is_set;
+        bool is_private;
+        core::TypeRef type;
+        std::unique_ptr<Shape> target;
+    };
+
+    uint32_t slot_count = 0;
+    std::unordered_map<std::string, Property> properties;
+    std::vector<Transition> transitions;  ///< Usually one or two; searched linearly
+};
+
+/// A closure: the code of an act and the values it captured.
+struct Closure : HeapObject {
+    explicit Closure(const Chunk* function) : HeapObject(ValueKind::Closure), function(function) {}
+    const Chunk* function;
+    std::vector<Value> captured;  ///< Upvalues, then param defaults
+};
+
+/// The property values of objects, shared by an object and its `new` copies.
+struct SlotStorage {
+    std::vector<Value> values;  ///< Laid out by the owners' shape
+    uint32_t owners = 1;
+};
+
+/**
+ * @brief An object created from a mode/act block (or by `new`).
+ *
+ * `new` makes a copy that shares the original's slot storage instead of
+ * copying it; whichever of them writes a property first (an assignment or a
+ * `>>` definition) takes its own copy of the slots. Reads never copy.
+ * Arrays and assoc arrays held in properties are the exception: the copy
+ * gets its own slots with new containers that share the originals' contents
+ * until either side modifies them (see Heap::copy). Containers nested inside
+ * those are shared, as in a shallow copy.
+ */
+struct Object : HeapObject {
+    Object(std::string name, Shape* shape)
+        : HeapObject(ValueKind::Object), name(std::move(name)), shape(shape) {}
+    ~Object() { release_slots(); }
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
+    /// The value of the property with the given name, or nullptr.
+    const Value* find(const std::string& property) const {
+        const Property* info = shape->find(property);
+        return info ? &storage_->values[info->slot] : nullptr;
+    }
+
+    /// Adds a property, or replaces its value and flags, moving to the next shape.
+    void define(const std::string& property, const Value& value, bool is_set, bool is_private,
+                const core::TypeRef& type = nullptr);
+
+    /// The property values, for reading.
+    std::span<const Value> slots() const {
+        return storage_ ? std::span<const Value>(storage_->values) : std::span<const Value>();
+    }
+    /// The property values, copied first if another object still shares them.
+    std::vector<Value>& writable_slots() {
+        if (!storage_ || storage_->owners > 1) unshare_slots();
+        return storage_->values;
+    }
+    /// Starts sharing the slots of `original`, as its copy made by `new`.
+    void share_slots(Object& original) {
+        release_slots();
+        storage_ = original.storage_;
+        if (storage_) storage_->owners++;
+    }
+
+    std::string name;  ///< Binding name, for diagnostics
+    Shape* shape;
+    Closure* act = nullptr;
+    bool watched = false;  ///< JIT code depends on its shape (see Dependencies)
+
+private:
+    SlotStorage* storage_ = nullptr;  ///< Null until the first property is defined
+
+    void unshare_slots();
+    void release_slots() {
+        if (storage_ && --storage_->owners == 0) delete storage_;
+        storage_ = nullptr;
+    }
+};
+
+/// A builtin module imported with `add`.
+struct ModuleObject : HeapObject {
+    explicit ModuleObject(std::string name) : HeapObject(ValueKind::Module), name(std::move(name)) {}
+    std::string name;
+};
+
+// Unboxing of heap values; the kind is checked in TOOI_VALIDATE_VALUES builds.
+
+inline StringObject* as_string(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::String), "as_string of a non-string value");
+    return static_cast<StringObject*>(value.ref());
+}
+inline ArrayObject* as_array(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::Array) || value.is(ValueKind::Tuple),
+                     "as_array of a non-array value");
+    return static_cast<ArrayObject*>(value.ref());
+}
+inline AssocObject* as_assoc(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::Assoc), "as_assoc of a non-assoc value");
+    return static_cast<AssocObject*>(value.ref());
+}
+inline Object* as_object(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::Object), "as_object of a non-object value");
+    return static_cast<Object*>(value.ref());
+}
+inline Closure* as_closure(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::Closure), "as_closure of a non-act value");
+    return static_cast<Closure*>(value.ref());
+}
+inline ModuleObject* as_module(const Value& value) {
+    TOOI_VALUE_CHECK(value.is(ValueKind::Module), "as_module of a non-module value");
+    return static_cast<ModuleObject*>(value.ref());
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "tooi/vm/bytecode.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @class OpcodeProfile
+ * @brief Counts the opcode pairs and triples the VM executes in sequence.
+ *
+ * Only builds configured with TOOI_VM_PROFILE=ON record anything; their VM
+ * reports every dispatched instruction. A sequence only continues through
+ * instructions that follow each other in the code (fall-through), since
+ * those are the only ones a superinstruction can combine. The profile
+ * written by --opcode-profile is what tools/opcode_profile.py merges over
+ * the benchmarks into benchmarks/opcode_profile.txt.
+ */
+class OpcodeProfile {
+public:
+    /// Counts the instruction `op` starting at `start`.
+    void record(Opcode op, const uint32_t* start) {
+        if (start != next_) run_ = 0;
+        if (run_ >= 1) pairs_[key(previous_, op)]++;
+        if (run_ >= 2) triples_[key(key(before_previous_, previous_), op)]++;
+        before_previous_ = previous_;
+        previous_ = op;
+        run_ = run_ < 2 ? run_ + 1 : 2;
+        next_ = start + instruction_length(op);
+    }
+
+    /**
+     * @brief Writes one line per sequence, most frequent first:
+     *        `pair <count> <op> <op>` and `triple <count> <op> <op> <op>`.
+     */
+    void write(std::ostream& out) const;
+
+private:
+    std::unordered_map<uint32_t, uint64_t> pairs_;
+    std::unordered_map<uint32_t, uint64_t> triples_;
+    Opcode before_previous_{};
+    Opcode previous_{};
+    int run_ = 0;  ///< Instructions of the current fall-through sequence, up to 2
+    const uint32_t* next_ = nullptr;  ///< Where the previous instruction ends
+
+    static uint32_t key(uint32_t prefix, Opcode op) {
+        return (prefix << 8) | static_cast<uint32_t>(op);
+    }
+    static uint32_t key(Opcode first, Opcode second) {
+        return key(static_cast<uint32_t>(first), second);
+    }
+};
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "tooi/core/error_info.h"
+#include "tooi/core/types.h"
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/heap.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @file operations.h
+ * @brief The dynamic semantics of Tooi's operators and conversions.
+ *
+ * Operands may be of any kind: typed code passes operands of the same kind,
+ * `proto` code passes whatever it has, and the operations follow the rules
+ * the TypeChecker applies statically (the usual arithmetic conversions via
+ * core::promote_numeric, `+` with a string operand concatenates). Integer
+ * arithmetic is checked. Every failure throws RuntimeError.
+ */
+
+/**
+ * @brief A runtime error raised by an operation.
+ *
+ * The VM catches it in its dispatch loop, where the failing instruction and
+ * therefore the source location are known, and reports it through the
+ * ErrorReporter. The message arguments are formatted when the error is
+ * raised.
+ */
+class RuntimeError : public std::runtime_error {
+public:
+    template <typename... Args>
+    explicit RuntimeError(core::ErrorCode code, const Args&... args)
+        : std::runtime_error("runtime error"), code(code), args{fmt::format("{}", args)...} {}
+
+    core::ErrorCode code;
+    std::vector<std::string> args;
+};
+
+/// Text for a value in a diagnostic: strings are quoted.
+std::string describe(const Value& value);
+
+/// `+ - * / %` (op is Add, Sub, Mul, Div or Mod).
+Value arithmetic(Opcode op, const Value& a, const Value& b, Heap& heap);
+
+/// Unary minus.
+Value negate(const Value& value, Heap& heap);
+
+/// `== != < <= > >=` (op is Eq, Ne, Lt, Le, Gt or Ge).
+bool compare(Opcode op, const Value& a, const Value& b);
+
+/// String concatenation of the display text of both operands.
+Value concat(const Value& a, const Value& b, Heap& heap);
+
+/// Explicit `as` conversion.
+Value cast(const Value& value, const core::TypeRef& target, Heap& heap);
+
+/**
+ * @brief Implicit conversion to a static type: lossless numeric widening, or
+ * a check that a `proto` value has the type (collections are checked element
+ * by element).
+ */
+Value coerce(const Value& value, const core::TypeRef& target, Heap& heap);
+
+/// True if the value is a valid value of the static type, without conversion.
+bool has_type(const Value& value, const core::TypeRef& type);
+
+/// The zero value a binding of the given type starts with.
+Value zero_value(const core::TypeRef& type, Heap& heap);
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/deopt.h"
+#include "tooi/vm/jit.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @file trace.h
+ * @brief The tracing tier of the JIT: recording, optimizing and compiling loop traces.
+ *
+ * A trace is the linear path one iteration of a hot loop took, from the
+ * loop header back to it, in SSA form. Branches become guards; values are
+ * kept unboxed in the representation of the kind they had while recording,
+ * and the kinds that every iteration relies on are checked once, before
+ * the first one. Property reads of objects the loop does not change are
+ * hoisted there as well; the trace then depends on those objects' shapes
+ * (see Dependencies).
+ */
+
+/// How a trace value is held in machine code.
+enum class TraceRep : uint8_t {
+    Int32,    ///< Sign-extended to 64 bits
+    Float64,  ///< The bits of the double
+    Bool,     ///< 0 or 1
+    Any,      ///< The bits of the boxed Value
+};
+
+enum class TraceOp : uint8_t {
+    // Values the loop reads before writing them, loaded before the first iteration.
+    Slot,    ///< Frame slot `x`
+    Global,  ///< Global slot `x`
+    Self,    ///< The frame's self
+    Const,   ///< `constant`, unboxed to the value's rep
+
+    AddI32, SubI32, MulI32, DivI32, ModI32,  ///< Exit on overflow and division by zero
+    AddF64, SubF64, MulF64, DivF64,
+    CompareI32,  ///< x `cond` y
+    CompareF64,
+    Not,
+    Truthy,
+    Int32ToFloat64,
+    Unbox,     ///< Exits unless the Any value x has `kind`
+    Index,     ///< Element y of the array or tuple x; exits when out of range
+    Length,    ///< Of the array or tuple x
+    Property,  ///< Slot y of the object x; exits unless x is an object with `shape`
+    Guard,     ///< Exits unless the truthiness of x is `cond`
+};
+
+/// A location the trace writes: a frame slot or a global.
+struct TraceWrite {
+    bool global;
+    uint32_t index;
+    uint32_t value;  ///< Trace instruction holding the value written
+};
+
+/// A side exit: the writes of the iteration so far, and where the interpreter resumes.
+struct TraceExit {
+    uint32_t position;
+    std::vector<TraceWrite> writes;
+    std::optional<DeoptReason> reason;  ///< What failed, unless the exit takes another branch
+};
+
+struct TraceInstruction {
+    TraceInstruction(TraceOp op, TraceRep rep, std::optional<ValueKind> kind = std::nullopt,
+                     uint32_t x = 0, uint32_t y = 0)
+        : op(op), rep(rep), kind(kind), x(x), y(y) {}
+
+    TraceOp op;
+    TraceRep rep;
+    std::optional<ValueKind> kind;  ///< Known kind of the value, if any
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint8_t cond = 0;        ///< x64::Cond of a compare; expected truthiness of a Guard
+    uint32_t exit = 0;       ///< TraceExit of the instructions that can leave
+    Value constant;
+    const Shape* shape = nullptr;
+    bool live = true;        ///< Cleared by dead code elimination
+    bool invariant = false;  ///< Computed once, before the first iteration
+};
+
+/**
+ * @brief A value carried into the next iteration: the loop-entry value
+ * `entry` takes the value `value` had at the end of the iteration.
+ */
+struct TraceCarry {
+    uint32_t entry;
+    uint32_t value;
+    bool check;  ///< `value` is an Any whose kind must match the entry's
+};
+
+struct Trace {
+    uint32_t header = 0;  ///< Position of the loop header
+    std::vector<TraceInstruction> instructions;
+    std::vector<TraceExit> exits;
+    std::vector<TraceWrite> writes;  ///< Every location the iteration wrote, with its final value
+    std::vector<TraceCarry> carries;
+    std::vector<Object*> watched;  ///< Objects read by invariant Property instructions
+};
+
+/// Most bytecode instructions one trace may record.
+constexpr size_t kMaxTraceLength = 512;
+
+/**
+ * @brief Records one iteration of the loop at `header` while executing it.
+ *
+ * The recorder executes every instruction it records itself, with the
+ * interpreter's semantics, and stops at the first one it cannot record:
+ * the frame, the globals and the position are then exactly as the
+ * interpreter would have left them before that instruction.
+ * @param resume Set to the position the interpreter continues at.
+ * @return true if the iteration got back to the header and the trace is complete.
+ */
+bool record_trace(const Chunk& chunk, uint32_t header, Value* slots, JitContext& context,
+                  Trace& trace, uint32_t& resume);
+
+/// Removes instructions whose values neither a guard, an exit nor the next iteration use.
+void eliminate_dead_code(Trace& trace);
+
+/**
+ * @brief Compiles a trace to machine code, called as
+ * `uint64_t (Value* slots, JitContext*)`. It returns the position the
+ * interpreter resumes at in the low 32 bits, and the number of iterations
+ * it completed in the high 32 bits.
+ */
+std::vector<uint8_t> compile_trace(const Trace& trace);
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tooi/core/types.h"
+
+namespace tooi {
+/**
+ * @namespace tooi::vm
+ * @brief The bytecode compiler and the virtual machine that executes it.
+ */
+namespace vm {
+
+/**
+ * @brief The runtime type of a value.
+ *
+ * Unlike core::TypeKind there is no `proto`: every value has a concrete
+ * kind at runtime. Integers and floats keep the exact kind they were
+ * computed with, so a `proto` holding an `int64` is still an `int64`.
+ */
+enum class ValueKind : uint8_t {
+    Nil,
+    Bool,
+    Byte,
+    Int32,
+    Int64,
+    UInt32,
+    UInt64,
+    Float32,
+    Float64,
+    String,   ///< StringObject
+    Array,    ///< ArrayObject
+    Tuple,    ///< ArrayObject (immutable)
+    Assoc,    ///< AssocObject
+    Object,   ///< Object
+    Closure,  ///< Closure (the act of an object, never bound by user code)
+    Module    ///< ModuleObject
+};
+
+inline bool is_signed_kind(ValueKind kind) {
+    return kind == ValueKind::Int32 || kind == ValueKind::Int64;
+}
+inline bool is_unsigned_kind(ValueKind kind) {
+    return kind == ValueKind::Byte || kind == ValueKind::UInt32 || kind == ValueKind::UInt64;
+}
+inline bool is_integer_kind(ValueKind kind) {
+    return is_signed_kind(kind) || is_unsigned_kind(kind);
+}
+inline bool is_float_kind(ValueKind kind) {
+    return kind == ValueKind::Float32 || kind == ValueKind::Float64;
+}
+inline bool is_numeric_kind(ValueKind kind) {
+    return is_integer_kind(kind) || is_float_kind(kind);
+}
+inline bool is_heap_kind(ValueKind kind) { return kind >= ValueKind::String; }
+
+/**
+ * @brief Header shared by every garbage-collected object.
+ *
+ * Objects are linked into the Heap's list of all allocations, which the
+ * sweep phase walks. The header lives here rather than in object.h because
+ * Value reads the kind of the object it points to.
+ */
+struct HeapObject {
+    explicit HeapObject(ValueKind kind) : kind(kind) {}
+    HeapObject(const HeapObject&) = delete;
+    HeapObject& operator=(const HeapObject&) = delete;
+    virtual ~HeapObject() = default;
+
+    ValueKind kind;
+    bool marked = false;
+    HeapObject* next = nullptr;  ///< Next allocation in the Heap
+};
+
+class Heap;
+
+// ============================================================================
+// Box validation
+// ============================================================================
+
+#ifdef TOOI_VALIDATE_VALUES
+/// Checks a box or unbox when built with -DTOOI_VALIDATE_VALUES=ON; aborts on failure.
+#define TOOI_VALUE_CHECK(condition, message) \
+    ((condition) ? void() : ::tooi::vm::invalid_value(message, __FILE__, __LINE__))
+#else
+#define TOOI_VALUE_CHECK(condition, message) static_cast<void>(0)
+#endif
+
+/// Reports a value that failed TOOI_VALUE_CHECK and aborts.
+[[noreturn]] void invalid_value(const char* message, const char* file, int line);
+
+// ============================================================================
+// Value
+// ============================================================================
+
+/**
+ * @brief A runtime value, NaN-boxed into 64 bits.
+ *
+ * A float64 is stored as its own bits, with every NaN canonicalized to the
+ * positive quiet NaN. All other values are boxed in the NaN space that no
+ * canonical double uses: the top 13 bits are set, bits 48-50 hold a tag and
+ * the low 48 bits the payload:
+ *
+ * | tag | payload                                            |
+ * |-----|----------------------------------------------------|
+ * | 0   | nil (0), false (1) or true (2)                     |
+ * | 1   | int32, sign-extended to 48 bits                    |
+ * | 2   | uint32                                             |
+ * | 3   | byte                                               |
+ * | 4   | float32, as its float bits                         |
+ * | 5   | int64 that fits in 48 bits (signed)                |
+ * | 6   | uint64 that fits in 48 bits                        |
+ * | 7   | HeapObject pointer; the kind comes from the object |
+ *
+ * An int64 or uint64 outside the 48-bit payload is boxed in an
+ * IntegerObject, so creating one may allocate; the factories for those
+ * kinds take the Heap. Every integer has exactly one representation, which
+ * keeps comparisons of same-kind values simple.
+ */
+class Value {
+public:
+    Value() : bits_(kNil) {}
+
+    static Value nil() { return Value(); }
+    static Value boolean(bool value) { return Value(value ? kTrue : kFalse); }
+    static Value int32(int64_t value) {
+        TOOI_VALUE_CHECK(value >= INT32_MIN && value <= INT32_MAX, "int32 out of range");
+        return immediate(kInt32Tag, static_cast<uint64_t>(value));
+    }
+    static Value uint32(uint64_t value) {
+        TOOI_VALUE_CHECK(value <= UINT32_MAX, "uint32 out of range");
+        return immediate(kUInt32Tag, value);
+    }
+    /// True if an int64 or uint64 value fits in the payload, without boxing.
+    static bool fits_payload(int64_t value) {
+        return value >= -kPayloadLimit && value < kPayloadLimit;
+    }
+    static bool fits_payload(uint64_t value) {
+        return value < static_cast<uint64_t>(kPayloadLimit);
+    }
+    static Value small_int64(int64_t value) {
+        TOOI_VALUE_CHECK(fits_payload(value), "int64 too wide for the payload");
+        return immediate(kInt64Tag, static_cast<uint64_t>(value));
+    }
+    static Value small_uint64(uint64_t value) {
+        TOOI_VALUE_CHECK(fits_payload(value), "uint64 too wide for the payload");
+        return immediate(kUInt64Tag, value);
+    }
+    /// A signed integer of the given kind; a wide int64 is allocated on the heap.
+    static Value signed_int(ValueKind kind, int64_t value, Heap& heap) {
+        if (kind == ValueKind::Int32) return int32(value);
+        TOOI_VALUE_CHECK(kind == ValueKind::Int64, "signed_int of an unsigned kind");
+        if (fits_payload(value)) return small_int64(value);
+        return box_integer(kind, static_cast<uint64_t>(value), heap);
+    }
+    /// An unsigned integer of the given kind; a wide uint64 is allocated on the heap.
+    static Value unsigned_int(ValueKind kind, uint64_t value, Heap& heap) {
+        switch (kind) {
+            case ValueKind::Byte:
+                TOOI_VALUE_CHECK(value <= UINT8_MAX, "byte out of range");
+                return immediate(kByteTag, value);
+            case ValueKind::UInt32:
+                return uint32(value);
+            default:
+                TOOI_VALUE_CHECK(kind == ValueKind::UInt64, "unsigned_int of a signed kind");
+                if (fits_payload(value)) return small_uint64(value);
+                return box_integer(kind, value, heap);
+        }
+    }
+    static Value number(ValueKind kind, double value) {
+        if (kind == ValueKind::Float32) {
+            return immediate(kFloat32Tag, std::bit_cast<uint32_t>(static_cast<float>(value)));
+        }
+        TOOI_VALUE_CHECK(kind == ValueKind::Float64, "number of a non-float kind");
+        return value == value ? Value(std::bit_cast<uint64_t>(value)) : Value(kCanonicalNaN);
+    }
+    static Value heap(HeapObject* object) {
+        auto address = reinterpret_cast<uintptr_t>(object);
+        TOOI_VALUE_CHECK(object != nullptr, "null heap reference");
+        TOOI_VALUE_CHECK(address < (uint64_t{1} << 48), "heap pointer wider than 48 bits");
+        TOOI_VALUE_CHECK(is_heap_kind(object->kind) || object->kind == ValueKind::Int64 ||
+                             object->kind == ValueKind::UInt64,
+                         "heap object of an immediate kind");
+        return immediate(kPointerTag, address);
+    }
+
+    // ------------------------------------------------------------------------
+    // Type checks
+    // ------------------------------------------------------------------------
+
+    ValueKind kind() const {
+        if (!is_boxed()) return ValueKind::Float64;
+        switch (tag()) {
+            case kSpecialTag:
+                return bits_ == kNil ? ValueKind::Nil : ValueKind::Bool;
+            case kInt32Tag:
+                return ValueKind::Int32;
+            case kUInt32Tag:
+                return ValueKind::UInt32;
+            case kByteTag:
+                return ValueKind::Byte;
+            case kFloat32Tag:
+                return ValueKind::Float32;
+            case kInt64Tag:
+                return ValueKind::Int64;
+            case kUInt64Tag:
+                return ValueKind::UInt64;
+            default:
+                return pointer()->kind;
+        }
+    }
+    bool is(ValueKind kind) const { return this->kind() == kind; }
+
+    bool is_nil() const { return bits_ == kNil; }
+    bool is_bool() const { return bits_ == kFalse || bits_ == kTrue; }
+    bool is_int32() const { return has_tag(kInt32Tag); }
+    bool is_uint32() const { return has_tag(kUInt32Tag); }
+    /// An int64 held in the payload (a boxed one is a pointer).
+    bool is_small_int64() const { return has_tag(kInt64Tag); }
+    /// A uint64 held in the payload (a boxed one is a pointer).
+    bool is_small_uint64() const { return has_tag(kUInt64Tag); }
+    bool is_float64() const { return !is_boxed(); }
+    /// True for every value that references a HeapObject, including wide integers.
+    bool is_pointer() const { return has_tag(kPointerTag); }
+    /// True for strings, collections, objects, closures and modules.
+    bool is_heap() const { return is_pointer() && is_heap_kind(pointer()->kind); }
+    /// nil and false are false, everything else is true.
+    bool truthy() const { return bits_ != kNil && bits_ != kFalse; }
+
+    // ------------------------------------------------------------------------
+    // Payloads
+    // ------------------------------------------------------------------------
+
+    bool as_bool() const {
+        TOOI_VALUE_CHECK(is_bool(), "as_bool of a non-bool value");
+        return bits_ == kTrue;
+    }
+    /// The value of an int32 or int64.
+    int64_t as_int() const {
+        if (has_tag(kInt32Tag)) return static_cast<int32_t>(static_cast<uint32_t>(bits_));
+        if (has_tag(kInt64Tag)) return static_cast<int64_t>(bits_ << 16) >> 16;
+        TOOI_VALUE_CHECK(is(ValueKind::Int64), "as_int of a non-signed value");
+        return static_cast<int64_t>(boxed_integer());
+    }
+    /// The value of a byte, uint32 or uint64.
+    uint64_t as_uint() const {
+        if (has_tag(kUInt32Tag) || has_tag(kByteTag) || has_tag(kUInt64Tag)) {
+            return bits_ & kPayloadMask;
+        }
+        TOOI_VALUE_CHECK(is(ValueKind::UInt64), "as_uint of a non-unsigned value");
+        return boxed_integer();
+    }
+    /// The value of a float32 or float64.
+    double as_double() const {
+        if (has_tag(kFloat32Tag)) return std::bit_cast<float>(static_cast<uint32_t>(bits_));
+        TOOI_VALUE_CHECK(is_float64(), "as_double of a non-float value");
+        return std::bit_cast<double>(bits_);
+    }
+    HeapObject* ref() const {
+        TOOI_VALUE_CHECK(is_pointer(), "ref of an immediate value");
+        return pointer();
+    }
+
+    /// The raw 64 bits, for hashing and for identical-bits comparisons.
+    uint64_t bits() const { return bits_; }
+
+private:
+    static constexpr uint64_t kBoxed = 0xFFF8'0000'0000'0000;
+    static constexpr uint64_t kPayloadMask = 0x0000'FFFF'FFFF'FFFF;
+    static constexpr int64_t kPayloadLimit = int64_t{1} << 47;
+    static constexpr uint64_t kCanonicalNaN = 0x7FF8'0000'0000'0000;
+
+    static constexpr unsigned kSpecialTag = 0;
+    static constexpr unsigned kInt32Tag = 1;
+    static constexpr unsigned kUInt32Tag = 2;
+    static constexpr unsigned kByteTag = 3;
+    static constexpr unsigned kFloat32Tag = 4;
+    static constexpr unsigned kInt64Tag = 5;
+    static constexpr unsigned kUInt64Tag = 6;
+    static constexpr unsigned kPointerTag = 7;
+
+    static constexpr uint64_t kNil = kBoxed;
+    static constexpr uint64_t kFalse = kBoxed | 1;
+    static constexpr uint64_t kTrue = kBoxed | 2;
+
+    uint64_t bits_;
+
+    explicit Value(uint64_t bits) : bits_(bits) {}
+
+    static Value immediate(unsigned tag, uint64_t payload) {
+        return Value(kBoxed | uint64_t{tag} << 48 | (payload & kPayloadMask));
+    }
+    /// Allocates an IntegerObject for an integer that does not fit in the payload.
+    static Value box_integer(ValueKind kind, uint64_t value, Heap& heap);
+
+    bool is_boxed() const { return (bits_ & kBoxed) == kBoxed; }
+    unsigned tag() const { return static_cast<unsigned>(bits_ >> 48) & 7; }
+    bool has_tag(unsigned tag) const { return bits_ >> 48 == (kBoxed >> 48 | tag); }
+    HeapObject* pointer() const { return reinterpret_cast<HeapObject*>(bits_ & kPayloadMask); }
+    uint64_t boxed_integer() const;
+};
+
+static_assert(sizeof(Value) == 8, "Value must fit in one machine word");
+
+/// Name of a runtime type as used in diagnostics (`int`, `string`, `array`, ...).
+const char* kind_name(ValueKind kind);
+
+/// The static type corresponding to a primitive kind (nullptr for heap kinds).
+core::TypeRef primitive_type(ValueKind kind);
+
+/// The kind of the values of a primitive static type.
+ValueKind kind_of(const core::TypeRef& type);
+
+/**
+ * @brief Text of a value, as produced by `as string`, concatenation and io.@print.
+ *
+ * Strings inside collections are quoted; cyclic collections print `...` for
+ * a collection that is already being printed.
+ */
+std::string display_string(const Value& value);
+
+/**
+ * @brief `==` on runtime values.
+ *
+ * Numbers compare by mathematical value across kinds, strings by content and
+ * everything else on the heap by identity.
+ */
+bool values_equal(const Value& a, const Value& b);
+
+/// Hash consistent with values_equal, for assoc array keys.
+size_t hash_value(const Value& value);
+
+struct ValueHash {
+    size_t operator()(const Value& value) const { return hash_value(value); }
+};
+struct ValueEqual {
+    bool operator()(const Value& a, const Value& b) const { return values_equal(a, b); }
+};
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tooi/core/error_reporter.h"
+#include "tooi/core/type_checker.h"
+#include "tooi/vm/aot.h"
+#include "tooi/vm/bytecode.h"
+#include "tooi/vm/heap.h"
+#include "tooi/vm/jit.h"
+#include "tooi/vm/opcode_profile.h"
+#include "tooi/vm/operations.h"
+
+namespace tooi {
+namespace vm {
+
+/**
+ * @brief Execution counters, printed with --vm-stats.
+ */
+struct VMStats {
+    uint64_t instructions = 0;  ///< Instructions dispatched
+    uint64_t invocations = 0;   ///< Act frames entered
+    uint64_t tail_calls = 0;    ///< Of which in place of the invoking frame
+    uint64_t quickened = 0;     ///< Instructions rewritten to a specialized form
+    uint64_t dequickened = 0;   ///< Specialized instructions whose guard failed
+    DeoptStats deopts;          ///< De-quickenings and inlined acts found replaced
+    uint64_t aot_chunks = 0;    ///< Chunks given functions generated by --emit-cpp
+    uint64_t aot_stale = 0;     ///< Chunks whose generated function no longer matched
+    uint64_t aot_entries = 0;   ///< Transfers from the interpreter into generated functions
+    double milliseconds = 0;    ///< Wall time spent in run() and invoke_global()
+};
+
+/**
+ * @class VM
+ * @brief Executes compiled bytecode.
+ *
+ * All frames share one contiguous value stack. An invocation finds the
+ * callee and its arguments in the window at the top of the caller's slots;
+ * the arguments become the first slots of the new frame (missing ones are
+ * filled in from the act's param defaults) and the result is written to the
+ * caller's result slot when the act returns. The script itself runs as a
+ * frame of the same shape. Entering and leaving a frame allocates nothing:
+ * the frame records live in a vector reserved for kMaxFrames, and an act's
+ * upvalues were copied into its closure when it was created. An act
+ * invoked in tail position (TailInvoke) reuses the frame of its caller, so
+ * recursion through tail calls runs in constant stack space.
+ *
+ * The stack starts at kInitialStackSize values and doubles when a frame
+ * does not fit, up to kMaxStackSize. Growing moves it, so frames hold
+ * pointers into it only while the VM can rebase them (see grow_stack()).
+ *
+ * The VM persists across REPL submissions: globals live in a vector indexed
+ * by core::GlobalTable slot, and compiled modules are kept since closures
+ * may still refer to their code.
+ */
+class VM {
+public:
+    static constexpr size_t kInitialStackSize = 1 << 10;  ///< Values, for all frames together
+    static constexpr size_t kMaxStackSize = 1 << 18;
+    static constexpr size_t kMaxFrames = 10000;
+    /// Executions with the same operand kinds before a generic instruction is quickened.
+    static constexpr uint8_t kQuickenThreshold = 8;
+    /// Entries of the shared cache of megamorphic property access sites.
+    static constexpr size_t kMegamorphicEntries = 1024;
+    /// Whether profile() records anything (builds configured with TOOI_VM_PROFILE=ON).
+#ifdef TOOI_VM_PROFILE
+    static constexpr bool kProfiling = true;
+#else
+    static constexpr bool kProfiling = false;
+#endif
+
+    explicit VM(core::ErrorReporter& error_reporter, std::ostream& out = std::cout,
+                std::istream& in = std::cin);
+    VM(const VM&) = delete;
+    VM& operator=(const VM&) = delete;
+
+    Heap& heap() { return heap_; }
+
+    /**
+     * @brief Compiles hot chunks to machine code from now on (--jit).
+     * @param capacity Bytes of code the cache keeps before evicting.
+     * @param tracing Also trace hot loops (off with --no-trace).
+     * Only call it where Jit::kAvailable.
+     */
+    void enable_jit(size_t capacity = CodeCache::kDefaultCapacity, bool tracing = true);
+    /// The JIT, or nullptr while it is not enabled.
+    const Jit* jit() const { return jit_.get(); }
+
+    /**
+     * @brief Runs the chunks of the modules run from now on in C++ generated for them.
+     *
+     * A generated function is entered where the JIT's code would be; see
+     * aot.h. `program` must outlive the VM.
+     */
+    void use_aot(const AotProgram& program);
+
+    /**
+     * @brief Runs the script of a compiled module.
+     * @param globals The global table the module was compiled against.
+     * @return False if a runtime error was reported.
+     */
+    bool run(std::unique_ptr<CompiledModule> module, const core::GlobalTable& globals);
+
+    /// True if the global holds an object with an act.
+    bool is_invocable(int global) const;
+
+    /**
+     * @brief Invokes the act of the object held by a global, without arguments.
+     * @return False if a runtime error was reported.
+     */
+    bool invoke_global(int global);
+
+    const Value& global(int index) const { return globals_[index]; }
+
+    const VMStats& stats() const { return stats_; }
+    void print_stats(std::ostream& out) const;
+    /// Prints the state and hit rate of every inline cache that was used (--ic-stats).
+    void print_ic_stats(std::ostream& out) const;
+
+    /// Opcode sequences executed so far; empty unless kProfiling.
+    const OpcodeProfile& profile() const { return profile_; }
+
+private:
+    struct Frame {
+        const Chunk* chunk;
+        const uint32_t* pc;  ///< Where execution continues (saved while a callee runs)
+        Value* slots;        ///< The callee sits right below the first slot
+        Value self;
+        Closure* closure;
+        Value* result;  ///< Caller slot that receives the returned value
+    };
+
+    struct MegamorphicEntry {
+        const Shape* shape = nullptr;
+        const std::string* name = nullptr;  ///< Chunk::names entry of the site
+        uint32_t slot = 0;
+        bool writable = false;
+        const core::TypeRef* type = nullptr;  ///< As in InlineCache::Entry
+    };
+
+    core::ErrorReporter& error_reporter_;
+    std::ostream& out_;
+    std::istream& in_;
+    Heap heap_;
+    std::unique_ptr<Value[]> stack_;
+    size_t stack_size_ = kInitialStackSize;
+    Value* sp_;  ///< End of the innermost frame's slots (updated at safe points)
+    std::vector<Frame> frames_;
+    std::vector<Value> globals_;
+    const core::GlobalTable* global_table_ = nullptr;
+    std::vector<std::unique_ptr<CompiledModule>> modules_;
+    std::unordered_map<std::string, Value> builtin_modules_;
+    VMStats stats_;
+    OpcodeProfile profile_;
+    std::vector<MegamorphicEntry> megamorphic_;
+    std::unique_ptr<Jit> jit_;
+    JitContext jit_context_;
+    const AotProgram* aot_ = nullptr;
+
+    /**
+     * @brief Runs from the current frame until the frame at depth `entry_depth` returns.
+     * @return False after reporting a runtime error (the frames are unwound).
+     */
+    bool execute(size_t entry_depth);
+
+    /**
+     * @brief Pushes the frame for invoking `callee[0]` with the `argc` values above it.
+     * @param replace Take the place of the innermost frame instead (a tail call).
+     */
+    void enter(Value* callee, int argc, Value* result, bool replace = false);
+    /**
+     * @brief Makes room for a frame of `count` slots at `slots`.
+     * @param replace The frame replaces the innermost one, so the depth does not grow.
+     * @return Where `slots` is once the stack has grown (and moved) to hold them.
+     * @throws RuntimeError with Runtime_StackOverflow past kMaxStackSize or kMaxFrames.
+     */
+    Value* reserve_frame(Value* slots, size_t count, bool replace = false);
+    /// Moves the stack to a larger allocation, rebasing sp_ and the frames' pointers.
+    void grow_stack(size_t size);
+    /// Compiles an act that Compiler::compile_lazily() left for its first invocation.
+    void compile_act(const Chunk& chunk);
+    /// Gives a compiled chunk its function from use_aot()'s program, if it still matches.
+    void attach_aot(Chunk& chunk);
+    /// Feeds the specialized form an execution of a generic instruction allows.
+    void observe(const Chunk& chunk, ptrdiff_t position, Opcode candidate);
+    /// Rewrites a specialized instruction whose guard failed back to its generic form.
+    void dequicken(const Chunk& chunk, ptrdiff_t position);
+    /**
+     * @brief The slot of a property, looked up through a site's inline cache.
+     * @param written_type For a write: only find properties that can be assigned, and
+     *        receive the declared type of the property (nullptr if it has none).
+     * @return -1 if the object has no such (writable) property.
+     */
+    int cached_slot(InlineCache& cache, const Object* object, const std::string& name,
+                    const core::TypeRef** written_type = nullptr);
+    Value call_builtin(const std::string& name, const Value& receiver, const Value* args,
+                       int argc);
+    Value get_property(const Value& object, const std::string& name);
+    void set_property(const Value& object, const std::string& name, const Value& value);
+    /// Object::define, which drops the traces that relied on the object's shape.
+    void define_property(Object& object, const std::string& name, const Value& value,
+                         bool is_set, bool is_private, const core::TypeRef& type = nullptr);
+    Value index(const Value& container, const Value& position);
+    void set_index(const Value& container, const Value& position, const Value& value);
+    Value length(const Value& sequence);
+    Value load_name(const Frame& frame, const std::string& name);
+    Value builtin_module(const std::string& name);
+
+    void collect_garbage();
+    void report(const RuntimeError& error, const Frame& frame, const uint32_t* pc);
+};
+
+}  // namespace vm
+}  // namespace tooi
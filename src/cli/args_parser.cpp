@@ -3,10 +3,13 @@
  * @brief Implementation of the ArgsParser class for command-line argument parsing.
  */
 #include "tooi/cli/args_parser.h"
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector> // For processing arguments
 #include "tooi/cli/colors.h" // Use central color definitions
+#include "tooi/ir/pass_manager.h"
 
 namespace tooi {
 namespace cli {
@@ -28,8 +31,45 @@ void ArgsParser::parse(int argc, char* argv[]) {
             mode_ = RunMode::VERSION;
             return; // Version overrides everything else
         } else if (arg == "--verbose" || arg == "-V") {
-            verbose_ = true;
+            options_.verbose = true;
             // Continue parsing other args
+        } else if (arg == "--no-opt") {
+            options_.optimize = false;
+        } else if (arg == "--dump-ir") {
+            options_.dump_ir = true;
+        } else if (arg == "--dump-bytecode") {
+            options_.dump_bytecode = true;
+        } else if (arg == "--vm-stats") {
+            options_.vm_stats = true;
+        } else if (arg == "--ic-stats") {
+            options_.ic_stats = true;
+        } else if (arg == "--jit") {
+            options_.jit = true;
+        } else if (arg == "--no-trace") {
+            options_.trace = false;
+        } else if (arg == "--eager") {
+            options_.lazy = false;
+        } else if (arg == "--pass-stats") {
+            options_.pass_stats = true;
+        } else if (arg == "--emit-cpp") {
+            options_.emit_cpp = "-";
+        } else if (arg.rfind("--emit-cpp=", 0) == 0) {
+            options_.emit_cpp = arg.substr(std::string("--emit-cpp=").size());
+        } else if (arg.rfind("--opcode-profile=", 0) == 0) {
+            options_.opcode_profile = arg.substr(std::string("--opcode-profile=").size());
+        } else if (arg.rfind("--disable-pass=", 0) == 0) {
+            // Comma-separated list of pass names, e.g. --disable-pass=licm,bce
+            std::stringstream names(arg.substr(std::string("--disable-pass=").size()));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                const auto& known = ir::PassManager::pass_names();
+                if (std::find(known.begin(), known.end(), name) == known.end()) {
+                    mode_ = RunMode::ERROR;
+                    error_message_ = "Unknown pass: " + name;
+                    return;
+                }
+                options_.disabled_passes.push_back(name);
+            }
         } else if (arg.rfind("-", 0) == 0) {
              // Unknown option
              mode_ = RunMode::ERROR;
@@ -48,7 +88,10 @@ void ArgsParser::parse(int argc, char* argv[]) {
 
     // Post-processing logic
     if (mode_ != RunMode::HELP && mode_ != RunMode::VERSION && mode_ != RunMode::ERROR) {
-        if (!potential_filename.empty()) {
+        if (!options_.emit_cpp.empty() && potential_filename.empty()) {
+             mode_ = RunMode::ERROR;
+             error_message_ = "--emit-cpp needs a script file.";
+        } else if (!potential_filename.empty()) {
              mode_ = RunMode::FILE;
              filename_ = potential_filename;
         } else {
@@ -79,7 +122,14 @@ const std::string& ArgsParser::get_filename() const {
  * Checks if verbose mode was requested.
  */
 bool ArgsParser::is_verbose() const {
-    return verbose_;
+    return options_.verbose;
+}
+
+/**
+ * Returns the interpreter settings collected from the command line.
+ */
+const core::InterpreterOptions& ArgsParser::get_options() const {
+    return options_;
 }
 
 /**
@@ -92,6 +142,22 @@ void ArgsParser::show_help(const char* program_name) const {
     std::cerr << "  " << YELLOW << "-h, --help" << RESET << "     Show this help message and exit\n";
     std::cerr << "  " << YELLOW << "-v, --version" << RESET << "  Show version information and exit\n";
     std::cerr << "  " << YELLOW << "-V, --verbose" << RESET << "  Enable verbose output during execution\n";
+    std::cerr << "  " << YELLOW << "--no-opt" << RESET << "       Disable constant folding and other optimizations\n";
+    std::cerr << "  " << YELLOW << "--disable-pass=<names>" << RESET << "\n"
+              << "                 Disable IR passes (comma-separated: ctfe, inline, cse, licm, bce, dce)\n";
+    std::cerr << "  " << YELLOW << "--pass-stats" << RESET << "   Print changes and time per IR pass\n";
+    std::cerr << "  " << YELLOW << "--dump-ir" << RESET << "      Print the optimized IR\n";
+    std::cerr << "  " << YELLOW << "--eager" << RESET << "        Parse and compile every act up front, not on its first invocation\n";
+    std::cerr << "  " << YELLOW << "--jit" << RESET << "          Compile hot acts to x86-64 machine code\n";
+    std::cerr << "  " << YELLOW << "--no-trace" << RESET << "     With --jit, compile acts only and leave loops untraced\n";
+    std::cerr << "  " << YELLOW << "--vm-stats" << RESET << "     Print executed instructions and run time\n";
+    std::cerr << "  " << YELLOW << "--ic-stats" << RESET << "     Print the hit rate of each property and method cache\n";
+    std::cerr << "  " << YELLOW << "--dump-bytecode" << RESET << "\n"
+              << "                 Print the compiled bytecode\n";
+    std::cerr << "  " << YELLOW << "--emit-cpp[=<file>]" << RESET << "\n"
+              << "                 Write the script as C++ to build a native executable from\n";
+    std::cerr << "  " << YELLOW << "--opcode-profile=<file>" << RESET << "\n"
+              << "                 Write executed opcode pairs and triples (TOOI_VM_PROFILE builds)\n";
     std::cerr << BOLD_CYAN << "\nArguments:\n" << RESET;
     std::cerr << "  " << YELLOW << "file" << RESET << "           Execute the script from the specified file\n";
     std::cerr << "\nIf no file is provided, tooi starts in REPL mode.\n";
@@ -20,7 +20,7 @@ namespace tooi {
 namespace cli {
 
 // Constructor implementation
-Repl::Repl(bool verbose) : verbose_(verbose) {}
+Repl::Repl(core::InterpreterOptions options) : options_(options) {}
 
 /**
  * @brief Runs the Read-Eval-Print Loop (REPL) using the linenoise library.
@@ -36,7 +36,7 @@ Repl::Repl(bool verbose) : verbose_(verbose) {}
  */
 void Repl::run() {
     using namespace tooi::cli::colors; // Using declaration
-    core::Interpreter interpreter(verbose_);  // Create the interpreter instance
+    core::Interpreter interpreter(options_);  // Create the interpreter instance
     std::string current_block;                // Buffer to accumulate multi-line input
     bool need_more_input = false;  // Flag to determine which prompt to show ('>' or '...')
     char *line_c_str = nullptr;    // Raw C-string buffer returned by linenoise
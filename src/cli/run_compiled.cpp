@@ -0,0 +1,42 @@
+/**
+ * @file run_compiled.cpp
+ * @brief Implementation of the run_compiled function.
+ */
+#include "tooi/cli/run_compiled.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "tooi/core/interpreter.h"
+
+namespace tooi {
+namespace cli {
+
+int run_compiled(const vm::AotProgram& program, int argc, char* argv[]) {
+    core::InterpreterOptions options;
+    options.optimize = program.optimize;
+    // Chunks are matched to generated functions by index, which acts nested in
+    // deferred bodies would only get once built; compile everything as --emit-cpp did.
+    options.lazy = false;
+    std::stringstream names(program.disabled_passes);
+    for (std::string name; std::getline(names, name, ',');) {
+        options.disabled_passes.push_back(name);
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) != "--vm-stats") {
+            std::cerr << "Usage: " << argv[0] << " [--vm-stats]" << std::endl;
+            return 1;
+        }
+        options.vm_stats = true;
+    }
+
+    core::Interpreter interpreter(options);
+    interpreter.use_aot(program);
+    std::istringstream source(program.source);
+    bool success = interpreter.run(source);
+    return success && !interpreter.had_error() ? 0 : 1;
+}
+
+} // namespace cli
+} // namespace tooi
@@ -20,11 +20,11 @@ namespace cli {
  * and runs the interpreter using the file's content as input.
  *
  * @param filename The path to the script file.
- * @param verbose Flag indicating whether to print verbose output.
+ * @param options Interpreter settings (verbosity, optimization).
  * @return True if the file was valid and the script executed without fatal
  *         interpreter errors, false otherwise.
  */
-bool run_from_file(const std::string& filename, bool verbose) {
+bool run_from_file(const std::string& filename, const core::InterpreterOptions& options) {
     // 1. Check file validity using <filesystem>
     std::error_code ec;
     auto status = std::filesystem::status(filename, ec);
@@ -55,7 +55,7 @@ bool run_from_file(const std::string& filename, bool verbose) {
     }
 
     // 3. Run the interpreter
-    core::Interpreter interpreter(verbose);
+    core::Interpreter interpreter(options);
     bool success = interpreter.run(file);
 
     // file stream is automatically closed when it goes out of scope (RAII)
@@ -0,0 +1,340 @@
+/**
+ * @file ast_optimizer.cpp
+ * @brief Implementation of constant folding and dead branch elimination.
+ */
+#include "tooi/core/ast_optimizer.h"
+
+#include <utility>
+
+#include "tooi/core/constant_folding.h"
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+bool is_literal(const Expr& expr) {
+    return expr.kind == ExprKind::Literal;
+}
+
+const LiteralValue& value_of(const Expr& expr) {
+    return static_cast<const LiteralExpr&>(expr).value;
+}
+
+bool is_bool_literal(const Expr& expr, bool expected) {
+    if (!is_literal(expr)) return false;
+    const bool* value = std::get_if<bool>(&value_of(expr));
+    return value && *value == expected;
+}
+
+}  // anonymous namespace
+
+AstOptimizer::AstOptimizer(GlobalTable& globals) : globals_(globals) {}
+
+void AstOptimizer::optimize(Program& program) {
+    locals_ = nullptr;
+    optimize_block(program.statements, true);
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+void AstOptimizer::optimize_block(std::vector<StmtPtr>& statements, bool straight_line) {
+    std::vector<StmtPtr> result;
+    result.reserve(statements.size());
+    for (size_t i = 0; i < statements.size(); ++i) {
+        StmtPtr stmt = optimize_statement(std::move(statements[i]), straight_line);
+        if (!stmt) continue;
+        StmtKind kind = stmt->kind;
+        result.push_back(std::move(stmt));
+        if (kind == StmtKind::Be || kind == StmtKind::Done || kind == StmtKind::Skip) {
+            // Nothing after an unconditional jump can run.
+            stats_.removed_statements += static_cast<int>(statements.size() - i - 1);
+            break;
+        }
+    }
+    statements = std::move(result);
+}
+
+StmtPtr AstOptimizer::optimize_statement(StmtPtr stmt, bool straight_line) {
+    switch (stmt->kind) {
+        case StmtKind::Add:
+        case StmtKind::Done:
+        case StmtKind::Skip:
+            break;
+        case StmtKind::Bind:
+            optimize_bind(static_cast<BindStmt&>(*stmt), straight_line);
+            break;
+        case StmtKind::Expression:
+            optimize_expr(static_cast<ExpressionStmt&>(*stmt).expr);
+            break;
+        case StmtKind::Be: {
+            auto& be = static_cast<BeStmt&>(*stmt);
+            if (be.value) optimize_expr(be.value);
+            break;
+        }
+        case StmtKind::Block:
+            optimize_block(static_cast<BlockStmt&>(*stmt).statements, straight_line);
+            break;
+        case StmtKind::If: {
+            auto& if_stmt = static_cast<IfStmt&>(*stmt);
+            optimize_expr(if_stmt.condition);
+            if (is_literal(*if_stmt.condition) && if_stmt.condition->type &&
+                if_stmt.condition->type->kind == TypeKind::Bool) {
+                // The surviving branch now runs unconditionally.
+                stats_.removed_branches++;
+                bool taken = std::get<bool>(value_of(*if_stmt.condition));
+                StmtPtr branch =
+                    taken ? std::move(if_stmt.then_branch) : std::move(if_stmt.else_branch);
+                if (!branch) return nullptr;
+                return optimize_statement(std::move(branch), straight_line);
+            }
+            if_stmt.then_branch = optimize_statement(std::move(if_stmt.then_branch), false);
+            if (!if_stmt.then_branch) if_stmt.then_branch = std::make_unique<BlockStmt>(stmt->loc);
+            if (if_stmt.else_branch) {
+                if_stmt.else_branch = optimize_statement(std::move(if_stmt.else_branch), false);
+            }
+            break;
+        }
+        case StmtKind::While: {
+            auto& while_stmt = static_cast<WhileStmt&>(*stmt);
+            optimize_expr(while_stmt.condition);
+            if (is_bool_literal(*while_stmt.condition, false)) {
+                stats_.removed_branches++;
+                return nullptr;
+            }
+            while_stmt.body = optimize_statement(std::move(while_stmt.body), false);
+            if (!while_stmt.body) while_stmt.body = std::make_unique<BlockStmt>(stmt->loc);
+            break;
+        }
+        case StmtKind::For: {
+            auto& for_stmt = static_cast<ForStmt&>(*stmt);
+            optimize_expr(for_stmt.iterable);
+            for_stmt.body = optimize_statement(std::move(for_stmt.body), false);
+            if (!for_stmt.body) for_stmt.body = std::make_unique<BlockStmt>(stmt->loc);
+            break;
+        }
+    }
+    return stmt;
+}
+
+void AstOptimizer::optimize_bind(BindStmt& stmt, bool straight_line) {
+    if (stmt.target->kind == ExprKind::Property) {
+        optimize_expr(static_cast<PropertyExpr&>(*stmt.target).object);
+    } else if (stmt.target->kind == ExprKind::Index) {
+        auto& index = static_cast<IndexExpr&>(*stmt.target);
+        optimize_expr(index.object);
+        optimize_expr(index.index);
+    }
+
+    switch (stmt.op) {
+        case BindOp::Declare:
+        case BindOp::Compound:
+            break;
+        case BindOp::Assign:
+            optimize_expr(stmt.value);
+            break;
+        case BindOp::Define:
+        case BindOp::Append:
+        case BindOp::Act:
+            optimize_object(static_cast<ObjectExpr&>(*stmt.value));
+            break;
+    }
+
+    // Remember `set name -> <constant>;` for propagation into later uses.
+    if (!straight_line || !stmt.is_set || !stmt.declares || stmt.op != BindOp::Assign ||
+        stmt.target->kind != ExprKind::Identifier || !is_literal(*stmt.value) ||
+        !types_equal(stmt.value->type, stmt.binding_type)) {
+        return;
+    }
+    const Resolution& resolution = static_cast<IdentifierExpr&>(*stmt.target).resolution;
+    if (resolution.kind == BindingKind::Global) {
+        globals_.at(resolution.slot).constant = value_of(*stmt.value);
+    } else if (resolution.kind == BindingKind::Local && locals_) {
+        (*locals_)[resolution.slot] = value_of(*stmt.value);
+    }
+}
+
+void AstOptimizer::optimize_object(ObjectExpr& object) {
+    for (auto& entry : object.mode) {
+        if (entry.value) optimize_expr(entry.value);
+    }
+    if (object.act) optimize_act(*object.act);
+}
+
+void AstOptimizer::optimize_act(ActDecl& act) {
+    std::unordered_map<int, LiteralValue> locals;
+    auto* enclosing = locals_;
+    locals_ = &locals;
+    optimize_block(act.body, true);
+    locals_ = enclosing;
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+void AstOptimizer::optimize_expr(ExprPtr& expr) {
+    switch (expr->kind) {
+        case ExprKind::Literal:
+        case ExprKind::Self:
+            break;
+        case ExprKind::Identifier:
+            propagate(expr);
+            break;
+        case ExprKind::Unary:
+            optimize_expr(static_cast<UnaryExpr&>(*expr).operand);
+            fold_unary(expr);
+            break;
+        case ExprKind::Binary: {
+            auto& binary = static_cast<BinaryExpr&>(*expr);
+            optimize_expr(binary.left);
+            optimize_expr(binary.right);
+            fold_binary(expr);
+            break;
+        }
+        case ExprKind::Logical: {
+            auto& logical = static_cast<LogicalExpr&>(*expr);
+            optimize_expr(logical.left);
+            optimize_expr(logical.right);
+            fold_logical(expr);
+            break;
+        }
+        case ExprKind::Cast:
+            optimize_expr(static_cast<CastExpr&>(*expr).operand);
+            fold_cast(expr);
+            break;
+        case ExprKind::Array:
+            for (auto& element : static_cast<ArrayExpr&>(*expr).elements) optimize_expr(element);
+            break;
+        case ExprKind::Tuple:
+            for (auto& element : static_cast<TupleExpr&>(*expr).elements) optimize_expr(element);
+            break;
+        case ExprKind::Assoc: {
+            auto& assoc = static_cast<AssocExpr&>(*expr);
+            for (auto& key : assoc.keys) optimize_expr(key);
+            for (auto& value : assoc.values) optimize_expr(value);
+            break;
+        }
+        case ExprKind::Index: {
+            auto& index = static_cast<IndexExpr&>(*expr);
+            optimize_expr(index.object);
+            optimize_expr(index.index);
+            break;
+        }
+        case ExprKind::Property:
+            optimize_expr(static_cast<PropertyExpr&>(*expr).object);
+            break;
+        case ExprKind::Invoke: {
+            auto& invoke = static_cast<InvokeExpr&>(*expr);
+            if (invoke.receiver) optimize_expr(invoke.receiver);
+            for (auto& arg : invoke.args) optimize_expr(arg);
+            break;
+        }
+        case ExprKind::New:
+            optimize_expr(static_cast<NewExpr&>(*expr).operand);
+            break;
+        case ExprKind::Object:
+            optimize_object(static_cast<ObjectExpr&>(*expr));
+            break;
+    }
+}
+
+void AstOptimizer::propagate(ExprPtr& expr) {
+    const auto& identifier = static_cast<const IdentifierExpr&>(*expr);
+    const Resolution& resolution = identifier.resolution;
+    const LiteralValue* constant = nullptr;
+    if (resolution.kind == BindingKind::Global) {
+        const auto& info = globals_.at(resolution.slot);
+        if (info.constant) constant = &*info.constant;
+    } else if (resolution.kind == BindingKind::Local && locals_) {
+        auto it = locals_->find(resolution.slot);
+        if (it != locals_->end()) constant = &it->second;
+    }
+    if (!constant) return;
+    stats_.propagated_constants++;
+    stats_.folded_expressions--;  // replace_with_literal counts this as a fold
+    replace_with_literal(expr, *constant, expr->type);
+}
+
+void AstOptimizer::fold_unary(ExprPtr& expr) {
+    auto& unary = static_cast<UnaryExpr&>(*expr);
+    if (!is_literal(*unary.operand)) return;
+    const LiteralValue& value = value_of(*unary.operand);
+    const TypeRef& type = unary.operand->type;
+
+    if (unary.op == TokenType::NOT) {
+        if (const bool* v = std::get_if<bool>(&value)) replace_with_literal(expr, !*v, expr->type);
+        return;
+    }
+    if (auto result = fold_negate(value, type)) replace_with_literal(expr, *result, type);
+}
+
+void AstOptimizer::fold_binary(ExprPtr& expr) {
+    auto& binary = static_cast<BinaryExpr&>(*expr);
+    if (!is_literal(*binary.left) || !is_literal(*binary.right)) return;
+    const LiteralValue& a = value_of(*binary.left);
+    const LiteralValue& b = value_of(*binary.right);
+    const TypeRef& left_type = binary.left->type;
+    const TypeRef& right_type = binary.right->type;
+    TokenType op = binary.op;
+
+    if (expr->type->kind == TypeKind::String) {
+        // String concatenation: `+` with a string on either side.
+        replace_with_literal(
+            expr, display_string(a, left_type) + display_string(b, right_type), expr->type);
+        return;
+    }
+
+    if (!types_equal(left_type, right_type)) return;  // Mixed types are decided at runtime
+
+    if (expr->type->kind == TypeKind::Bool) {
+        // Equality and ordered comparisons.
+        if (auto result = fold_comparison(op, a, b, left_type)) {
+            replace_with_literal(expr, *result, expr->type);
+        }
+        return;
+    }
+
+    const TypeRef& type = expr->type;
+    if (!types_equal(type, left_type)) return;
+    if (auto result = fold_arithmetic(op, a, b, type)) {
+        replace_with_literal(expr, std::move(*result), type);
+    }
+}
+
+void AstOptimizer::fold_logical(ExprPtr& expr) {
+    auto& logical = static_cast<LogicalExpr&>(*expr);
+    bool is_and = logical.op == TokenType::AND;
+    // `false and x` / `true or x` short-circuit without evaluating x.
+    if (is_bool_literal(*logical.left, !is_and)) {
+        replace_with_literal(expr, !is_and, expr->type);
+        return;
+    }
+    // `true and x` / `false or x` are just x, provided x already is a bool.
+    if (is_bool_literal(*logical.left, is_and) && logical.right->type &&
+        logical.right->type->kind == TypeKind::Bool) {
+        stats_.folded_expressions++;
+        ExprPtr right = std::move(logical.right);
+        expr = std::move(right);
+    }
+}
+
+void AstOptimizer::fold_cast(ExprPtr& expr) {
+    auto& cast = static_cast<CastExpr&>(*expr);
+    if (!is_literal(*cast.operand) || cast.cast_kind == CastKind::Check) return;
+    if (auto result = convert_literal(value_of(*cast.operand), cast.operand->type, cast.target)) {
+        replace_with_literal(expr, std::move(*result), cast.target);
+    }
+}
+
+void AstOptimizer::replace_with_literal(ExprPtr& expr, LiteralValue value, const TypeRef& type) {
+    auto literal = std::make_unique<LiteralExpr>(std::move(value), expr->loc);
+    literal->type = type;
+    expr = std::move(literal);
+    stats_.folded_expressions++;
+}
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,275 @@
+/**
+ * @file constant_folding.cpp
+ * @brief Implementation of operations on typed literal values.
+ */
+#include "tooi/core/constant_folding.h"
+
+#include <cmath>
+#include <limits>
+
+#include "tooi/core/conversions.h"
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+bool fits_signed(const TypeRef& type, int64_t value) {
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    return integer_fits(type, magnitude, value < 0);
+}
+
+double round_to(const TypeRef& type, double value) {
+    return type->kind == TypeKind::Float32 ? static_cast<double>(static_cast<float>(value))
+                                           : value;
+}
+
+std::optional<LiteralValue> fold_signed(TokenType op, int64_t a, int64_t b, const TypeRef& type) {
+    int64_t result = 0;
+    switch (op) {
+        case TokenType::PLUS:
+            if (__builtin_add_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::MINUS:
+            if (__builtin_sub_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::ASTERISK:
+            if (__builtin_mul_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::SLASH:
+        case TokenType::PERCENT:
+            if (b == 0 || (a == std::numeric_limits<int64_t>::min() && b == -1)) {
+                return std::nullopt;
+            }
+            result = op == TokenType::SLASH ? a / b : a % b;
+            break;
+        default:
+            return std::nullopt;
+    }
+    if (!fits_signed(type, result)) return std::nullopt;
+    return LiteralValue(result);
+}
+
+std::optional<LiteralValue> fold_unsigned(TokenType op, uint64_t a, uint64_t b,
+                                          const TypeRef& type) {
+    uint64_t result = 0;
+    switch (op) {
+        case TokenType::PLUS:
+            if (__builtin_add_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::MINUS:
+            if (__builtin_sub_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::ASTERISK:
+            if (__builtin_mul_overflow(a, b, &result)) return std::nullopt;
+            break;
+        case TokenType::SLASH:
+        case TokenType::PERCENT:
+            if (b == 0) return std::nullopt;
+            result = op == TokenType::SLASH ? a / b : a % b;
+            break;
+        default:
+            return std::nullopt;
+    }
+    if (!integer_fits(type, result, false)) return std::nullopt;
+    return LiteralValue(result);
+}
+
+std::optional<LiteralValue> fold_float(TokenType op, double a, double b, const TypeRef& type) {
+    double result = 0;
+    switch (op) {
+        case TokenType::PLUS:
+            result = a + b;
+            break;
+        case TokenType::MINUS:
+            result = a - b;
+            break;
+        case TokenType::ASTERISK:
+            result = a * b;
+            break;
+        case TokenType::SLASH:
+            result = a / b;
+            break;
+        case TokenType::PERCENT:
+            result = std::fmod(a, b);
+            break;
+        default:
+            return std::nullopt;
+    }
+    return LiteralValue(round_to(type, result));
+}
+
+// Three-way comparison of two literals of the same type.
+template <typename T>
+int compare(const T& a, const T& b) {
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+std::optional<int> compare_literals(const LiteralValue& a, const LiteralValue& b,
+                                    const TypeRef& type) {
+    switch (type->kind) {
+        case TypeKind::String:
+            return compare(std::get<std::string>(a), std::get<std::string>(b));
+        case TypeKind::Bool:
+            return compare(std::get<bool>(a), std::get<bool>(b));
+        case TypeKind::Nil:
+            return 0;
+        default:
+            break;
+    }
+    if (type->is_float()) {
+        double x = as_double(a);
+        double y = as_double(b);
+        if (std::isnan(x) || std::isnan(y)) return std::nullopt;  // Unordered
+        return compare(x, y);
+    }
+    if (type->is_integer()) {
+        return type->is_signed() ? compare(as_signed(a), as_signed(b))
+                                 : compare(as_unsigned(a), as_unsigned(b));
+    }
+    return std::nullopt;
+}
+
+}  // anonymous namespace
+
+int64_t as_signed(const LiteralValue& value) {
+    if (const int64_t* v = std::get_if<int64_t>(&value)) return *v;
+    return static_cast<int64_t>(std::get<uint64_t>(value));
+}
+
+uint64_t as_unsigned(const LiteralValue& value) {
+    if (const uint64_t* v = std::get_if<uint64_t>(&value)) return *v;
+    return static_cast<uint64_t>(std::get<int64_t>(value));
+}
+
+double as_double(const LiteralValue& value) {
+    if (const double* v = std::get_if<double>(&value)) return *v;
+    if (const int64_t* v = std::get_if<int64_t>(&value)) return static_cast<double>(*v);
+    return static_cast<double>(std::get<uint64_t>(value));
+}
+
+std::string display_string(const LiteralValue& value, const TypeRef& type) {
+    if (const std::string* v = std::get_if<std::string>(&value)) return *v;
+    if (const bool* v = std::get_if<bool>(&value)) return *v ? "true" : "false";
+    if (std::holds_alternative<std::monostate>(value)) return "nil";
+    if (type->is_float()) return format_float(as_double(value), type->kind == TypeKind::Float32);
+    if (type->is_signed()) return format_int(as_signed(value));
+    return format_uint(as_unsigned(value));
+}
+
+std::optional<LiteralValue> convert_numeric(const LiteralValue& value, const TypeRef& from,
+                                            const TypeRef& to) {
+    if (to->is_float()) return LiteralValue(round_to(to, as_double(value)));
+
+    if (from->is_float()) {
+        double truncated = std::trunc(as_double(value));
+        if (!std::isfinite(truncated)) return std::nullopt;
+        // 2^63 and 2^64 are exactly representable, so these bounds are exact.
+        if (to->is_signed()) {
+            if (truncated < -9223372036854775808.0 || truncated >= 9223372036854775808.0) {
+                return std::nullopt;
+            }
+            int64_t result = static_cast<int64_t>(truncated);
+            if (!fits_signed(to, result)) return std::nullopt;
+            return LiteralValue(result);
+        }
+        if (truncated < 0 || truncated >= 18446744073709551616.0) return std::nullopt;
+        uint64_t result = static_cast<uint64_t>(truncated);
+        if (!integer_fits(to, result, false)) return std::nullopt;
+        return LiteralValue(result);
+    }
+
+    // Integer -> integer
+    bool negative = from->is_signed() && as_signed(value) < 0;
+    uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(as_signed(value))
+                                  : as_unsigned(value);
+    if (!integer_fits(to, magnitude, negative)) return std::nullopt;
+    if (to->is_signed()) return LiteralValue(as_signed(value));
+    return LiteralValue(as_unsigned(value));
+}
+
+std::optional<LiteralValue> parse_number(std::string_view text, const TypeRef& to) {
+    if (to->is_float()) {
+        if (auto parsed = parse_float(text)) return LiteralValue(round_to(to, *parsed));
+    } else if (to->is_signed()) {
+        if (auto parsed = parse_int(text, to)) return LiteralValue(*parsed);
+    } else if (auto parsed = parse_uint(text, to)) {
+        return LiteralValue(*parsed);
+    }
+    return std::nullopt;
+}
+
+std::optional<LiteralValue> convert_literal(const LiteralValue& value, const TypeRef& from,
+                                            const TypeRef& to) {
+    if (types_equal(from, to)) return value;
+    if (to->kind == TypeKind::String) return LiteralValue(display_string(value, from));
+    if (to->kind == TypeKind::Bool) {
+        if (from->is_numeric()) return LiteralValue(as_double(value) != 0);
+        if (const std::string* text = std::get_if<std::string>(&value)) {
+            if (*text == "true" || *text == "false") return LiteralValue(*text == "true");
+        }
+        return std::nullopt;
+    }
+    if (!to->is_numeric()) return std::nullopt;
+
+    if (from->is_numeric()) return convert_numeric(value, from, to);
+    if (const bool* flag = std::get_if<bool>(&value)) {
+        return convert_numeric(LiteralValue(int64_t{*flag ? 1 : 0}), Type::int32(), to);
+    }
+    if (const std::string* text = std::get_if<std::string>(&value)) return parse_number(*text, to);
+    return std::nullopt;
+}
+
+std::optional<LiteralValue> fold_arithmetic(TokenType op, const LiteralValue& a,
+                                            const LiteralValue& b, const TypeRef& type) {
+    if (!type->is_numeric()) return std::nullopt;
+    if (type->is_float()) return fold_float(op, as_double(a), as_double(b), type);
+    if (type->is_signed()) return fold_signed(op, as_signed(a), as_signed(b), type);
+    return fold_unsigned(op, as_unsigned(a), as_unsigned(b), type);
+}
+
+std::optional<LiteralValue> fold_negate(const LiteralValue& value, const TypeRef& type) {
+    if (type->is_float()) return LiteralValue(-as_double(value));
+    if (!type->is_integer() || !type->is_signed()) return std::nullopt;
+    int64_t operand = as_signed(value);
+    if (operand == std::numeric_limits<int64_t>::min() || !fits_signed(type, -operand)) {
+        return std::nullopt;
+    }
+    return LiteralValue(-operand);
+}
+
+std::optional<bool> fold_comparison(TokenType op, const LiteralValue& a, const LiteralValue& b,
+                                    const TypeRef& type) {
+    std::optional<int> order = compare_literals(a, b, type);
+    if (op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL) {
+        bool equal;
+        if (order) {
+            equal = *order == 0;
+        } else if (type->is_float()) {
+            equal = false;  // NaN is not equal to anything
+        } else {
+            return std::nullopt;
+        }
+        return op == TokenType::EQUAL_EQUAL ? equal : !equal;
+    }
+    if (!order) {
+        // Ordered comparisons involving NaN are false.
+        if (type->is_float()) return false;
+        return std::nullopt;
+    }
+    switch (op) {
+        case TokenType::LESS:
+            return *order < 0;
+        case TokenType::LESS_EQUAL:
+            return *order <= 0;
+        case TokenType::GREATER:
+            return *order > 0;
+        case TokenType::GREATER_EQUAL:
+            return *order >= 0;
+        default:
+            return std::nullopt;
+    }
+}
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,104 @@
+/**
+ * @file conversions.cpp
+ * @brief Implementation of value <-> text conversions.
+ */
+#include "tooi/core/conversions.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+// Enough for any int64, uint64 or shortest float64 ("-2.2250738585072014e-308").
+constexpr size_t kMaxNumberLength = 32;
+
+// Writes `value` with std::to_chars straight into the end of `out`.
+template <typename T>
+void append_chars(T value, std::string& out) {
+    size_t size = out.size();
+    out.resize(size + kMaxNumberLength);
+    char* end = std::to_chars(out.data() + size, out.data() + out.size(), value).ptr;
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+// The number in `text`, without the leading whitespace and `+` strtol accepts.
+std::string_view number_part(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\n\v\f\r");
+    if (start == std::string_view::npos) return {};
+    text.remove_prefix(start);
+    if (text.size() > 1 && text[0] == '+' && text[1] != '-') text.remove_prefix(1);
+    return text;
+}
+
+// Parses all of `text` as a T; false if anything is left over or out of range.
+template <typename T>
+bool parse_chars(std::string_view text, T& value) {
+    text = number_part(text);
+    const char* end = text.data() + text.size();
+    auto [ptr, error] = std::from_chars(text.data(), end, value);
+    return error == std::errc() && ptr == end;
+}
+
+}  // anonymous namespace
+
+void append_int(int64_t value, std::string& out) {
+    append_chars(value, out);
+}
+
+void append_uint(uint64_t value, std::string& out) {
+    append_chars(value, out);
+}
+
+void append_float(double value, bool is_float32, std::string& out) {
+    if (std::isnan(value)) {
+        out += "nan";
+    } else if (is_float32) {
+        append_chars(static_cast<float>(value), out);
+    } else {
+        append_chars(value, out);
+    }
+}
+
+std::string format_int(int64_t value) {
+    std::string text;
+    append_int(value, text);
+    return text;
+}
+
+std::string format_uint(uint64_t value) {
+    std::string text;
+    append_uint(value, text);
+    return text;
+}
+
+std::string format_float(double value, bool is_float32) {
+    std::string text;
+    append_float(value, is_float32, text);
+    return text;
+}
+
+std::optional<int64_t> parse_int(std::string_view text, const TypeRef& type) {
+    int64_t value = 0;
+    if (!parse_chars(text, value)) return std::nullopt;
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    if (!integer_fits(type, magnitude, value < 0)) return std::nullopt;
+    return value;
+}
+
+std::optional<uint64_t> parse_uint(std::string_view text, const TypeRef& type) {
+    uint64_t value = 0;
+    if (!parse_chars(text, value) || !integer_fits(type, value, false)) return std::nullopt;
+    return value;
+}
+
+std::optional<double> parse_float(std::string_view text) {
+    double value = 0;
+    if (!parse_chars(text, value)) return std::nullopt;
+    return value;
+}
+
+}  // namespace core
+}  // namespace tooi
@@ -123,6 +123,288 @@ void ErrorRegistry::initialize_registry() {
         "A character that is not valid in a numeric literal was encountered."
     };
 
+    // --- Parser Errors ---
+    registry_map_[ErrorCode::Parser_UnexpectedToken] = {
+        ErrorCode::Parser_UnexpectedToken, ErrorSeverity::Error, "E_PARSER_UNEXPECTED_TOKEN",
+        "Unexpected token '{}'.",
+        "The parser found a token that cannot start or continue a statement at this position."
+    };
+    registry_map_[ErrorCode::Parser_ExpectedExpression] = {
+        ErrorCode::Parser_ExpectedExpression, ErrorSeverity::Error, "E_PARSER_EXPECTED_EXPR",
+        "Expected an expression, found '{}'.",
+        "An expression (literal, name, invocation, array, tuple, ...) was required at this position."
+    };
+    registry_map_[ErrorCode::Parser_ExpectedToken] = {
+        ErrorCode::Parser_ExpectedToken, ErrorSeverity::Error, "E_PARSER_EXPECTED_TOKEN",
+        "Expected {}, found '{}'.",
+        "A specific token (such as ';', ')' or '}') was required at this position."
+    };
+    registry_map_[ErrorCode::Parser_ExpectedIdentifier] = {
+        ErrorCode::Parser_ExpectedIdentifier, ErrorSeverity::Error, "E_PARSER_EXPECTED_IDENT",
+        "Expected {}, found '{}'.",
+        "A name was required at this position. Keywords cannot be used as names."
+    };
+    registry_map_[ErrorCode::Parser_ExpectedType] = {
+        ErrorCode::Parser_ExpectedType, ErrorSeverity::Error, "E_PARSER_EXPECTED_TYPE",
+        "Expected a type, found '{}'.",
+        "Type annotations after ':' must name a type such as int, string, [int], (int, int) or [string -> proto]."
+    };
+    registry_map_[ErrorCode::Parser_InvalidBindingTarget] = {
+        ErrorCode::Parser_InvalidBindingTarget, ErrorSeverity::Error, "E_PARSER_INVALID_TARGET",
+        "Invalid binding target.",
+        "Only plain names can carry a type annotation, and 'self' must be followed by a property or index."
+    };
+    registry_map_[ErrorCode::Parser_InvalidModeEntry] = {
+        ErrorCode::Parser_InvalidModeEntry, ErrorSeverity::Error, "E_PARSER_INVALID_MODE_ENTRY",
+        "Invalid entry in mode block: '{}'.",
+        "Mode blocks may only contain 'let', 'set' and 'param' declarations, or \"key\" -> value entries."
+    };
+
+    // --- Semantic Errors ---
+    registry_map_[ErrorCode::Semantic_UndefinedName] = {
+        ErrorCode::Semantic_UndefinedName, ErrorSeverity::Error, "E_SEMANTIC_UNDEFINED_NAME",
+        "Undefined name '{}'.",
+        "The name is not bound at this point. Bind it with 'let' or 'set' before using it."
+    };
+    registry_map_[ErrorCode::Semantic_TypeMismatch] = {
+        ErrorCode::Semantic_TypeMismatch, ErrorSeverity::Error, "E_SEMANTIC_TYPE_MISMATCH",
+        "Cannot bind a value of type '{}' to '{}' of type '{}'.",
+        "The value's static type is not assignable to the declared type. Use 'as' for explicit conversions."
+    };
+    registry_map_[ErrorCode::Semantic_InvalidOperands] = {
+        ErrorCode::Semantic_InvalidOperands, ErrorSeverity::Error, "E_SEMANTIC_INVALID_OPERANDS",
+        "Operator '{}' cannot be applied to '{}' and '{}'.",
+        "The operand types are not supported by this operator."
+    };
+    registry_map_[ErrorCode::Semantic_InvalidUnaryOperand] = {
+        ErrorCode::Semantic_InvalidUnaryOperand, ErrorSeverity::Error, "E_SEMANTIC_INVALID_UNARY",
+        "Operator '{}' cannot be applied to '{}'.",
+        "The operand type is not supported by this unary operator."
+    };
+    registry_map_[ErrorCode::Semantic_ExpectedBool] = {
+        ErrorCode::Semantic_ExpectedBool, ErrorSeverity::Error, "E_SEMANTIC_EXPECTED_BOOL",
+        "Expected 'bool' {}, found '{}'.",
+        "Conditions and logical operands must be of type bool (or proto, checked at runtime)."
+    };
+    registry_map_[ErrorCode::Semantic_InvalidCast] = {
+        ErrorCode::Semantic_InvalidCast, ErrorSeverity::Error, "E_SEMANTIC_INVALID_CAST",
+        "Cannot convert '{}' to '{}'.",
+        "'as' converts between numbers, strings and booleans; other conversions are only possible from proto values."
+    };
+    registry_map_[ErrorCode::Semantic_AssignToImmutable] = {
+        ErrorCode::Semantic_AssignToImmutable, ErrorSeverity::Error, "E_SEMANTIC_IMMUTABLE",
+        "Cannot modify immutable binding '{}'.",
+        "Bindings and properties declared with 'set' cannot be rebound, and objects bound with 'set' cannot be redefined."
+    };
+    registry_map_[ErrorCode::Semantic_NotIndexable] = {
+        ErrorCode::Semantic_NotIndexable, ErrorSeverity::Error, "E_SEMANTIC_NOT_INDEXABLE",
+        "Values of type '{}' cannot be indexed.",
+        "Only arrays, tuples, assoc arrays and strings support the [] operator."
+    };
+    registry_map_[ErrorCode::Semantic_InvalidIndex] = {
+        ErrorCode::Semantic_InvalidIndex, ErrorSeverity::Error, "E_SEMANTIC_INVALID_INDEX",
+        "Invalid index of type '{}' for '{}'.",
+        "Arrays, tuples and strings are indexed by integers; assoc arrays by their key type."
+    };
+    registry_map_[ErrorCode::Semantic_TupleIndexOutOfRange] = {
+        ErrorCode::Semantic_TupleIndexOutOfRange, ErrorSeverity::Error, "E_SEMANTIC_TUPLE_INDEX",
+        "Tuple index {} is out of range for '{}'.",
+        "Constant tuple indices must be smaller than the number of tuple elements."
+    };
+    registry_map_[ErrorCode::Semantic_UnknownMember] = {
+        ErrorCode::Semantic_UnknownMember, ErrorSeverity::Error, "E_SEMANTIC_UNKNOWN_MEMBER",
+        "'{}' has no member '{}'.",
+        "The property or act does not exist on this type."
+    };
+    registry_map_[ErrorCode::Semantic_PrivateAccess] = {
+        ErrorCode::Semantic_PrivateAccess, ErrorSeverity::Error, "E_SEMANTIC_PRIVATE_ACCESS",
+        "Property '{}' is private.",
+        "Private properties can only be accessed from the act of the object that declares them."
+    };
+    registry_map_[ErrorCode::Semantic_NotInvocable] = {
+        ErrorCode::Semantic_NotInvocable, ErrorSeverity::Error, "E_SEMANTIC_NOT_INVOCABLE",
+        "'{}' of type '{}' cannot be invoked.",
+        "Only objects with an act can be invoked with '@'."
+    };
+    registry_map_[ErrorCode::Semantic_TooManyArguments] = {
+        ErrorCode::Semantic_TooManyArguments, ErrorSeverity::Error, "E_SEMANTIC_TOO_MANY_ARGS",
+        "'{}' takes {} argument(s) but {} were given.",
+        "Arguments are bound to the 'param' declarations of the invoked object, in order."
+    };
+    registry_map_[ErrorCode::Semantic_SelfOutsideAct] = {
+        ErrorCode::Semantic_SelfOutsideAct, ErrorSeverity::Error, "E_SEMANTIC_SELF_OUTSIDE_ACT",
+        "'self' can only be used inside an act.",
+        "'self' refers to the object whose act is executing."
+    };
+    registry_map_[ErrorCode::Semantic_LoopControlOutsideLoop] = {
+        ErrorCode::Semantic_LoopControlOutsideLoop, ErrorSeverity::Error, "E_SEMANTIC_LOOP_CONTROL",
+        "'{}' can only be used inside a loop.",
+        "'done' leaves and 'skip' continues the innermost while or for loop."
+    };
+    registry_map_[ErrorCode::Semantic_BeOutsideAct] = {
+        ErrorCode::Semantic_BeOutsideAct, ErrorSeverity::Error, "E_SEMANTIC_BE_OUTSIDE_ACT",
+        "'be' can only be used inside an act.",
+        "'be' finishes the executing act and makes its value the result of the invocation."
+    };
+    registry_map_[ErrorCode::Semantic_UnknownModule] = {
+        ErrorCode::Semantic_UnknownModule, ErrorSeverity::Error, "E_SEMANTIC_UNKNOWN_MODULE",
+        "Unknown module '{}'.",
+        "The module named in 'add' does not exist."
+    };
+    registry_map_[ErrorCode::Semantic_AddNotTopLevel] = {
+        ErrorCode::Semantic_AddNotTopLevel, ErrorSeverity::Error, "E_SEMANTIC_ADD_NOT_TOP_LEVEL",
+        "'add' is only allowed at the top level.",
+        "Modules are imported once for the whole program."
+    };
+    registry_map_[ErrorCode::Semantic_IntegerLiteralOutOfRange] = {
+        ErrorCode::Semantic_IntegerLiteralOutOfRange, ErrorSeverity::Error, "E_SEMANTIC_LITERAL_RANGE",
+        "Integer literal {} does not fit in '{}'.",
+        "The literal's value is outside the range of the target integer type."
+    };
+    registry_map_[ErrorCode::Semantic_NotAnObject] = {
+        ErrorCode::Semantic_NotAnObject, ErrorSeverity::Error, "E_SEMANTIC_NOT_AN_OBJECT",
+        "'{}' cannot be applied to '{}' of type '{}'.",
+        "Mode appends ('>>') and act overrides ('@') require an object."
+    };
+    registry_map_[ErrorCode::Semantic_ComplexCompoundTarget] = {
+        ErrorCode::Semantic_ComplexCompoundTarget, ErrorSeverity::Error, "E_SEMANTIC_COMPOUND_TARGET",
+        "The target of a compound binding must not contain invocations.",
+        "'let target + value;' reads and writes the target; bind the result of the invocation to a name first."
+    };
+    registry_map_[ErrorCode::Semantic_PureMutation] = {
+        ErrorCode::Semantic_PureMutation, ErrorSeverity::Error, "E_SEMANTIC_PURE_MUTATION",
+        "Pure act '{}' cannot modify '{}'.",
+        "Pure acts may not rebind globals or properties, and may only modify arrays, assoc arrays and objects held in locals that they created themselves."
+    };
+    registry_map_[ErrorCode::Semantic_PureIO] = {
+        ErrorCode::Semantic_PureIO, ErrorSeverity::Error, "E_SEMANTIC_PURE_IO",
+        "Pure act '{}' cannot call '{}.{}'.",
+        "Pure acts may not perform I/O."
+    };
+    registry_map_[ErrorCode::Semantic_PureCall] = {
+        ErrorCode::Semantic_PureCall, ErrorSeverity::Error, "E_SEMANTIC_PURE_CALL",
+        "Pure act '{}' cannot invoke '{}', which is not known to be pure.",
+        "Only acts of objects declared 'pure' (and the pure act itself) can be invoked from a pure act."
+    };
+
+    // --- Runtime Errors ---
+    registry_map_[ErrorCode::Runtime_TypeMismatch] = {
+        ErrorCode::Runtime_TypeMismatch, ErrorSeverity::Error, "E_RUNTIME_TYPE_MISMATCH",
+        "Expected a value of type '{}' but found '{}'.",
+        "A proto value was used where a statically typed value is required, and its runtime type does not match."
+    };
+    registry_map_[ErrorCode::Runtime_InvalidConversion] = {
+        ErrorCode::Runtime_InvalidConversion, ErrorSeverity::Error, "E_RUNTIME_INVALID_CONVERSION",
+        "Cannot convert {} of type '{}' to '{}'.",
+        "The value cannot be represented in the target type, or the text is not a valid number or boolean."
+    };
+    registry_map_[ErrorCode::Runtime_InvalidOperands] = {
+        ErrorCode::Runtime_InvalidOperands, ErrorSeverity::Error, "E_RUNTIME_INVALID_OPERANDS",
+        "Operator '{}' cannot be applied to '{}' and '{}'.",
+        "The runtime types of the operands do not support this operator."
+    };
+    registry_map_[ErrorCode::Runtime_InvalidUnaryOperand] = {
+        ErrorCode::Runtime_InvalidUnaryOperand, ErrorSeverity::Error, "E_RUNTIME_INVALID_UNARY_OPERAND",
+        "Operator '{}' cannot be applied to '{}'.",
+        "The runtime type of the operand does not support this operator."
+    };
+    registry_map_[ErrorCode::Runtime_IntegerOverflow] = {
+        ErrorCode::Runtime_IntegerOverflow, ErrorSeverity::Error, "E_RUNTIME_INTEGER_OVERFLOW",
+        "Integer overflow: the result of '{}' does not fit in '{}'.",
+        "Integer arithmetic is checked; use a wider type or convert to a float first."
+    };
+    registry_map_[ErrorCode::Runtime_DivisionByZero] = {
+        ErrorCode::Runtime_DivisionByZero, ErrorSeverity::Error, "E_RUNTIME_DIVISION_BY_ZERO",
+        "Integer division by zero.",
+        "Integer division and remainder by zero are errors; float division produces an infinity or NaN instead."
+    };
+    registry_map_[ErrorCode::Runtime_IndexOutOfRange] = {
+        ErrorCode::Runtime_IndexOutOfRange, ErrorSeverity::Error, "E_RUNTIME_INDEX_OUT_OF_RANGE",
+        "Index {} is out of range ({} of length {}).",
+        "Valid indices run from 0 to the length minus one."
+    };
+    registry_map_[ErrorCode::Runtime_InvalidIndex] = {
+        ErrorCode::Runtime_InvalidIndex, ErrorSeverity::Error, "E_RUNTIME_INVALID_INDEX",
+        "Cannot index a {} with a value of type '{}'.",
+        "Arrays, tuples and strings are indexed with integers."
+    };
+    registry_map_[ErrorCode::Runtime_MissingKey] = {
+        ErrorCode::Runtime_MissingKey, ErrorSeverity::Error, "E_RUNTIME_MISSING_KEY",
+        "Key {} is not in the assoc array.",
+        "Use '.@has(key)' to check for a key before reading it."
+    };
+    registry_map_[ErrorCode::Runtime_NotIndexable] = {
+        ErrorCode::Runtime_NotIndexable, ErrorSeverity::Error, "E_RUNTIME_NOT_INDEXABLE",
+        "Values of type '{}' cannot be indexed.",
+        "Only arrays, tuples, strings and assoc arrays support '[ ]'."
+    };
+    registry_map_[ErrorCode::Runtime_ElementNotAssignable] = {
+        ErrorCode::Runtime_ElementNotAssignable, ErrorSeverity::Error, "E_RUNTIME_ELEMENT_NOT_ASSIGNABLE",
+        "Cannot assign to an element of a value of type '{}'.",
+        "Only elements of arrays and assoc arrays can be rebound."
+    };
+    registry_map_[ErrorCode::Runtime_NotIterable] = {
+        ErrorCode::Runtime_NotIterable, ErrorSeverity::Error, "E_RUNTIME_NOT_ITERABLE",
+        "Cannot iterate over a value of type '{}'.",
+        "'for' iterates over arrays, tuples, strings and the keys of assoc arrays."
+    };
+    registry_map_[ErrorCode::Runtime_UnknownProperty] = {
+        ErrorCode::Runtime_UnknownProperty, ErrorSeverity::Error, "E_RUNTIME_UNKNOWN_PROPERTY",
+        "Object '{}' has no property '{}'.",
+        "The property was never defined in a mode block or bound on the object."
+    };
+    registry_map_[ErrorCode::Runtime_NotAnObject] = {
+        ErrorCode::Runtime_NotAnObject, ErrorSeverity::Error, "E_RUNTIME_NOT_AN_OBJECT",
+        "Cannot use property '{}' of a value of type '{}'.",
+        "Properties and acts belong to objects."
+    };
+    registry_map_[ErrorCode::Runtime_AssignToImmutable] = {
+        ErrorCode::Runtime_AssignToImmutable, ErrorSeverity::Error, "E_RUNTIME_ASSIGN_TO_IMMUTABLE",
+        "Cannot rebind property '{}', which was declared with 'set'.",
+        "Properties declared with 'set' cannot be rebound."
+    };
+    registry_map_[ErrorCode::Runtime_NotInvocable] = {
+        ErrorCode::Runtime_NotInvocable, ErrorSeverity::Error, "E_RUNTIME_NOT_INVOCABLE",
+        "'{}' is not an object with an act.",
+        "Only objects with an act ('@ { ... }') can be invoked."
+    };
+    registry_map_[ErrorCode::Runtime_TooManyArguments] = {
+        ErrorCode::Runtime_TooManyArguments, ErrorSeverity::Error, "E_RUNTIME_TOO_MANY_ARGS",
+        "'{}' takes {} argument(s) but {} were given.",
+        "Arguments are bound to the 'param' declarations of the invoked object, in order."
+    };
+    registry_map_[ErrorCode::Runtime_MissingArgument] = {
+        ErrorCode::Runtime_MissingArgument, ErrorSeverity::Error, "E_RUNTIME_MISSING_ARGUMENT",
+        "'{}' requires {} argument(s) but {} were given.",
+        "Builtin methods have no default arguments."
+    };
+    registry_map_[ErrorCode::Runtime_UnknownMethod] = {
+        ErrorCode::Runtime_UnknownMethod, ErrorSeverity::Error, "E_RUNTIME_UNKNOWN_METHOD",
+        "Values of type '{}' have no method '{}'.",
+        "Builtin methods exist on arrays (push, pop, insert, remove), assoc arrays (remove, has, keys) and modules."
+    };
+    registry_map_[ErrorCode::Runtime_UndefinedName] = {
+        ErrorCode::Runtime_UndefinedName, ErrorSeverity::Error, "E_RUNTIME_UNDEFINED_NAME",
+        "Name '{}' is not defined.",
+        "The name was neither a property of 'self' nor a global when the code ran."
+    };
+    registry_map_[ErrorCode::Runtime_EmptyArray] = {
+        ErrorCode::Runtime_EmptyArray, ErrorSeverity::Error, "E_RUNTIME_EMPTY_ARRAY",
+        "Cannot pop from an empty array.",
+        "Check '.length' before removing elements."
+    };
+    registry_map_[ErrorCode::Runtime_StackOverflow] = {
+        ErrorCode::Runtime_StackOverflow, ErrorSeverity::Error, "E_RUNTIME_STACK_OVERFLOW",
+        "Stack overflow: acts nested more than {} deep.",
+        "This usually means an act invokes itself without a terminating condition."
+    };
+    registry_map_[ErrorCode::Runtime_ActHasErrors] = {
+        ErrorCode::Runtime_ActHasErrors, ErrorSeverity::Error, "E_RUNTIME_ACT_HAS_ERRORS",
+        "Act '{}' has errors and cannot run.",
+        "Its body is only checked when it is first invoked; fix the errors reported above, "
+        "or run with --eager to check all acts up front."
+    };
+
     // --- Interpreter Errors ---
     registry_map_[ErrorCode::Interpreter_StreamReadError] = {
         ErrorCode::Interpreter_StreamReadError, ErrorSeverity::Error, "E_INTERPRETER_STREAM_READ",
@@ -134,6 +416,36 @@ void ErrorRegistry::initialize_registry() {
         "Halting due to lexical errors.",
         "The interpreter process is stopping because one or more lexical errors were detected by the scanner earlier."
     };
+    registry_map_[ErrorCode::Interpreter_HaltingSyntax] = {
+        ErrorCode::Interpreter_HaltingSyntax, ErrorSeverity::Fatal, "F_INTERPRETER_HALTING_SYNTAX",
+        "Halting due to syntax errors.",
+        "The interpreter process is stopping because one or more syntax errors were detected by the parser earlier."
+    };
+    registry_map_[ErrorCode::Interpreter_HaltingSemantic] = {
+        ErrorCode::Interpreter_HaltingSemantic, ErrorSeverity::Fatal, "F_INTERPRETER_HALTING_SEMANTIC",
+        "Halting due to semantic errors.",
+        "The interpreter process is stopping because one or more type or name errors were detected by the type checker earlier."
+    };
+    registry_map_[ErrorCode::Interpreter_ProfileUnavailable] = {
+        ErrorCode::Interpreter_ProfileUnavailable, ErrorSeverity::Warning, "W_INTERPRETER_PROFILE_UNAVAILABLE",
+        "Opcode profiling is not compiled in; no profile is written.",
+        "--opcode-profile needs a build configured with -DTOOI_VM_PROFILE=ON."
+    };
+    registry_map_[ErrorCode::Interpreter_ProfileWriteError] = {
+        ErrorCode::Interpreter_ProfileWriteError, ErrorSeverity::Error, "E_INTERPRETER_PROFILE_WRITE",
+        "Cannot write the opcode profile to '{}'.",
+        "The file given to --opcode-profile could not be opened for writing."
+    };
+    registry_map_[ErrorCode::Interpreter_JitUnavailable] = {
+        ErrorCode::Interpreter_JitUnavailable, ErrorSeverity::Warning, "W_INTERPRETER_JIT_UNAVAILABLE",
+        "The JIT is not available on this platform; running in the interpreter.",
+        "--jit generates x86-64 code and needs an x86-64 Linux build."
+    };
+    registry_map_[ErrorCode::Interpreter_EmitWriteError] = {
+        ErrorCode::Interpreter_EmitWriteError, ErrorSeverity::Error, "E_INTERPRETER_EMIT_WRITE",
+        "Cannot write the generated C++ to '{}'.",
+        "The file given to --emit-cpp could not be opened for writing."
+    };
 
     // --- General/Internal Errors ---
     registry_map_[ErrorCode::Registry_UnknownErrorCode] = {
@@ -141,8 +453,6 @@ void ErrorRegistry::initialize_registry() {
         "Unknown internal error code encountered: {}.",
         "An internal error occurred where an undefined error code was requested from the error registry."
     };
-
-    // TODO: Add definitions for Parser, Semantic, Runtime errors here later
 }
 
 
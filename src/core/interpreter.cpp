@@ -4,26 +4,68 @@
  */
 #include "tooi/core/interpreter.h"
 
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <istream>
+#include <memory>
 #include <sstream> // Needed to read stream into string
 #include <string>
 #include <vector>
 
+#include "tooi/core/ast_optimizer.h"
+#include "tooi/core/parser.h"
 #include "tooi/core/scanner.h" // Include the Scanner header
 #include "tooi/core/token.h"   // Include the Token header
 #include "tooi/core/error_reporter.h"
 #include "tooi/cli/colors.h" // Include colors
 #include "tooi/core/error_info.h"
+#include "tooi/core/type_checker.h"
+#include "tooi/ir/builder.h"
+#include "tooi/ir/pass_manager.h"
+#include "tooi/vm/aot.h"
+#include "tooi/vm/compiler.h"
+#include "tooi/vm/operations.h"
 
 namespace tooi {
 namespace core {
 
+namespace {
+
+// Parses, checks and builds the body of an act whose parsing was deferred
+// (ActDecl::deferred), before its first invocation is compiled. Errors are
+// reported as if they had been found up front, and the invocation fails.
+void build_deferred_act(ir::Function& act, const std::string& source, GlobalTable& globals,
+                        ErrorReporter& error_reporter, ir::PassManager* passes) {
+    // The IR only sees the AST as const; run() hands it over to the module's lazy acts.
+    auto& decl = const_cast<ActDecl&>(*act.decl);
+    DeferredBody& deferred = *decl.deferred;
+    if (!deferred.rejected) {
+        deferred.rejected = !Parser::parse_deferred(decl, source, error_reporter) ||
+                            !TypeChecker(globals, source, error_reporter).check_deferred(decl);
+    }
+    if (deferred.rejected) throw vm::RuntimeError(ErrorCode::Runtime_ActHasErrors, act.name);
+    if (passes) AstOptimizer(globals).optimize_act(decl);
+
+    ir::Module& module = *act.module;
+    size_t first_nested = module.functions.size();
+    ir::Builder(globals).build_deferred(module, act);
+    decl.deferred.reset();
+    if (!passes) return;
+    passes->start(act);
+    for (size_t i = first_nested; i < module.functions.size(); ++i) {
+        passes->start(*module.functions[i]);
+    }
+}
+
+}  // anonymous namespace
+
 /**
  * @brief Executes Tooi code read from the given input stream.
  *
  * Reads the entire stream content, tokenizes it using the Scanner,
- * and currently just prints the resulting tokens.
+ * parses it and type checks the result against the globals defined by
+ * earlier runs.
  * Modifies the interpreter's state (e.g., increments execution count).
  *
  * @param input_stream The input stream providing the Tooi code.
@@ -56,8 +98,7 @@ bool Interpreter::run(std::istream& input_stream) {
     }
 
     // 2. Scan the source string into tokens
-    Scanner scanner(std::move(source), error_reporter_);
-    // source has been moved, do not use it again
+    Scanner scanner(source, error_reporter_);
     std::vector<Token> tokens = scanner.scan_tokens();
 
     // 3. Print the tokens only if verbose mode is enabled
@@ -74,20 +115,132 @@ bool Interpreter::run(std::istream& input_stream) {
         return true;
     }
 
-    // TODO: Placeholder for actual processing (Parsing, Evaluation):
-    // Parser parser(tokens, error_reporter_);
-    // auto statements = parser.parse();
-    // if (!parser.has_errors()) {
-    //    evaluate(statements);
-    // }
+    // 4. Parse the tokens into an AST. Unless all of the module is printed or
+    //    translated, acts are compiled on their first invocation, and most act
+    //    bodies are only parsed and checked then as well (see Parser).
+    bool lazy = options_.lazy && !options_.dump_ir && !options_.dump_bytecode &&
+                !options_.pass_stats && options_.emit_cpp.empty();
+    Parser parser(std::move(tokens), source, error_reporter_, lazy);
+    auto program = std::make_shared<Program>(parser.parse());
+    if (error_reporter_.had_error()) {
+        error_reporter_.report_general(ErrorCode::Interpreter_HaltingSyntax);
+        return true;
+    }
+
+    // 5. Resolve names and check types. The checker works on a copy of the
+    //    global table so that a rejected REPL submission leaves no bindings behind.
+    GlobalTable globals = globals_;
+    TypeChecker checker(globals, source, error_reporter_);
+    if (!checker.check(*program)) {
+        error_reporter_.report_general(ErrorCode::Interpreter_HaltingSemantic);
+        return true;
+    }
+
+    // 6. Fold constants and drop dead branches (skipped with --no-opt)
+    if (options_.optimize) {
+        AstOptimizer optimizer(globals);
+        optimizer.optimize(*program);
+        if (verbose_) {
+            const AstOptimizerStats& stats = optimizer.stats();
+            std::cout << "  Optimizer: folded " << stats.folded_expressions
+                      << " expression(s), propagated " << stats.propagated_constants
+                      << " constant(s), removed " << stats.removed_branches << " branch(es) and "
+                      << stats.removed_statements << " unreachable statement(s)" << std::endl;
+        }
+    }
+    globals_ = std::move(globals);
+
+    // 7. Lower to SSA form and run the IR passes (also skipped with --no-opt).
+    //    When compiling lazily, acts only get the passes that look across
+    //    functions now, and the rest when they are compiled.
+    ir::Builder builder(globals_);
+    std::unique_ptr<ir::Module> module = builder.build(*program);
+    auto passes = std::make_shared<ir::PassManager>();
+    if (options_.optimize) {
+        for (const std::string& name : options_.disabled_passes) passes->disable(name);
+        passes->run(*module, lazy);
+        if (verbose_) {
+            const ir::InlineStats& stats = passes->inline_stats();
+            std::cout << "  Inliner: inlined " << stats.call_sites << " call site(s) ("
+                      << stats.guarded << " guarded by an act check), copying "
+                      << stats.instructions << " instruction(s)" << std::endl;
+        }
+        if (options_.pass_stats) passes->print_stats(std::cout);
+    }
+    if (options_.dump_ir) ir::print_module(*module, std::cout);
+
+    // 8. Compile to bytecode and run it. A script that binds `main` to an
+    //    object with an act has it invoked as the program's entry point.
+    int main = -1;
+    int main_global = globals_.find("main");
+    for (const auto& block : module->functions.front()->blocks) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == ir::Opcode::StoreGlobal && instruction->index == main_global) {
+                main = main_global;
+            }
+        }
+    }
+    vm::Compiler compiler(vm_.heap());
+    std::unique_ptr<vm::CompiledModule> compiled;
+    if (lazy) {
+        // The closure keeps the AST of deferred act bodies and the passes alive.
+        ir::PassManager* pipeline = options_.optimize ? passes.get() : nullptr;
+        auto prepare = [this, program, passes, pipeline,
+                        shared_source = std::make_shared<const std::string>(source)](
+                           ir::Function& act) {
+            if (act.blocks.empty()) {
+                build_deferred_act(act, *shared_source, globals_, error_reporter_, pipeline);
+            }
+            if (pipeline) pipeline->finish(act);
+        };
+        compiled = compiler.compile_lazily(std::move(module), source, std::move(prepare));
+    } else {
+        compiled = compiler.compile(*module, source);
+    }
+    if (options_.dump_bytecode) vm::print_compiled_module(*compiled, std::cout);
+    if (!options_.emit_cpp.empty()) {
+        // --emit-cpp: write the script out as C++ instead of running it
+        if (options_.emit_cpp == "-") {
+            vm::emit_cpp(*compiled, source, options_, std::cout);
+        } else if (std::ofstream out(options_.emit_cpp); out) {
+            vm::emit_cpp(*compiled, source, options_, out);
+        } else {
+            error_reporter_.report_general(ErrorCode::Interpreter_EmitWriteError,
+                                           options_.emit_cpp);
+        }
+        return true;
+    }
+    if (vm_.run(std::move(compiled), globals_) && main >= 0 && vm_.is_invocable(main)) {
+        vm_.invoke_global(main);
+    }
+    if (options_.vm_stats) vm_.print_stats(std::cout);
+    if (options_.ic_stats) vm_.print_ic_stats(std::cout);
+    if (!options_.opcode_profile.empty()) {
+        if (!vm::VM::kProfiling) {
+            error_reporter_.report_general(ErrorCode::Interpreter_ProfileUnavailable);
+        } else if (std::ofstream profile(options_.opcode_profile); profile) {
+            vm_.profile().write(profile);
+        } else {
+            error_reporter_.report_general(ErrorCode::Interpreter_ProfileWriteError,
+                                           options_.opcode_profile);
+        }
+    }
 
     // Return true if no FATAL errors occurred (like stream read error)
     // The caller should check interpreter.had_error() for lexical/parse/etc. errors
     return true;
 }
 
-Interpreter::Interpreter(bool verbose)
-    : verbose_(verbose) {}
+Interpreter::Interpreter(InterpreterOptions options)
+    : verbose_(options.verbose), options_(options), vm_(error_reporter_) {
+    if (options_.jit) {
+        if (vm::Jit::kAvailable) {
+            vm_.enable_jit(vm::CodeCache::kDefaultCapacity, options_.trace);
+        } else {
+            error_reporter_.report_general(ErrorCode::Interpreter_JitUnavailable);
+        }
+    }
+}
 
 bool Interpreter::had_error() const {
     return error_reporter_.had_error();
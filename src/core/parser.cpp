@@ -0,0 +1,839 @@
+/**
+ * @file parser.cpp
+ * @brief Implementation of the recursive descent Parser.
+ */
+#include "tooi/core/parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <utility>
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+// Thrown after a syntax error has been reported, to unwind to the enclosing statement list.
+struct ParseError {};
+
+bool is_modifier(TokenType type) {
+    return type == TokenType::PUBLIC || type == TokenType::PRIVATE || type == TokenType::PURE ||
+           type == TokenType::RUNNABLE;
+}
+
+// Extracts the type suffix of a numeric literal (e.g. "42u64" -> "u64").
+std::string numeric_suffix(const std::string& lexeme) {
+    size_t pos = 0;
+    while (pos < lexeme.size() && (std::isdigit(static_cast<unsigned char>(lexeme[pos])) ||
+                                   lexeme[pos] == '.')) {
+        ++pos;
+    }
+    return lexeme.substr(pos);
+}
+
+TypeRef suffix_to_type(const std::string& suffix) {
+    if (suffix == "i" || suffix == "i32") return Type::int32();
+    if (suffix == "i64") return Type::int64();
+    if (suffix == "u" || suffix == "u32") return Type::uint32();
+    if (suffix == "u64") return Type::uint64();
+    if (suffix == "f") return Type::float32();
+    if (suffix == "d") return Type::float64();
+    return nullptr;
+}
+
+}  // anonymous namespace
+
+Parser::Parser(std::vector<Token> tokens, const std::string& source, ErrorReporter& error_reporter,
+               bool defer_acts)
+    : tokens_(std::move(tokens)),
+      source_(source),
+      error_reporter_(error_reporter),
+      defer_acts_(defer_acts) {
+    if (tokens_.empty() || tokens_.back().type != TokenType::END_OF_FILE) {
+        int line = tokens_.empty() ? 1 : tokens_.back().line;
+        tokens_.push_back(Token::make_eof(line));
+    }
+}
+
+template <typename... Args>
+void Parser::error_at(const Token& token, ErrorCode code, Args&&... args) {
+    SourceLocation loc = location_of(token);
+    error_reporter_.report_at(loc.line, loc.column, loc.length, source_line(source_, loc.line),
+                              code, std::forward<Args>(args)...);
+    had_error_ = true;
+    throw ParseError{};
+}
+
+Program Parser::parse() {
+    Program program;
+    program.statements = statement_list();
+    // statement_list() stops at a stray '}', which is an error at the top level.
+    while (!is_at_end()) {
+        try {
+            error_at(peek(), ErrorCode::Parser_UnexpectedToken, peek().lexeme);
+        } catch (const ParseError&) {
+            advance();
+            auto rest = statement_list();
+            for (auto& stmt : rest) program.statements.push_back(std::move(stmt));
+        }
+    }
+    return program;
+}
+
+bool Parser::parse_deferred(ActDecl& act, const std::string& source,
+                            ErrorReporter& error_reporter) {
+    Parser parser(std::move(act.deferred->tokens), source, error_reporter);
+    parser.act_depth_ = 1;
+    Program body = parser.parse();
+    act.body = std::move(body.statements);
+    return !parser.had_error_;
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+std::vector<StmtPtr> Parser::statement_list() {
+    std::vector<StmtPtr> statements;
+    while (!is_at_end() && !check(TokenType::RIGHT_BRACE)) {
+        size_t start = current_;
+        try {
+            statements.push_back(statement());
+        } catch (const ParseError&) {
+            synchronize();
+            if (current_ == start) advance();  // Always make progress
+        }
+    }
+    return statements;
+}
+
+StmtPtr Parser::statement() {
+    if (match(TokenType::LET)) return bind_statement(false);
+    if (match(TokenType::SET)) return bind_statement(true);
+    if (match(TokenType::ADD)) return add_statement();
+    if (match(TokenType::IF)) return if_statement();
+    if (match(TokenType::WHILE)) return while_statement();
+    if (match(TokenType::FOR)) return for_statement();
+    if (check(TokenType::LEFT_BRACE)) return block();
+    if (match(TokenType::DONE)) {
+        SourceLocation loc = location_of(previous());
+        consume(TokenType::SEMICOLON, "';' after 'done'");
+        return std::make_unique<DoneStmt>(loc);
+    }
+    if (match(TokenType::SKIP)) {
+        SourceLocation loc = location_of(previous());
+        consume(TokenType::SEMICOLON, "';' after 'skip'");
+        return std::make_unique<SkipStmt>(loc);
+    }
+    if (match(TokenType::BE)) {
+        SourceLocation loc = location_of(previous());
+        ExprPtr value;
+        if (!check(TokenType::SEMICOLON)) value = expression();
+        consume(TokenType::SEMICOLON, "';' after 'be'");
+        return std::make_unique<BeStmt>(std::move(value), loc);
+    }
+
+    SourceLocation loc = location_of(peek());
+    ExprPtr expr = expression();
+    consume(TokenType::SEMICOLON, "';' after expression");
+    return std::make_unique<ExpressionStmt>(std::move(expr), loc);
+}
+
+StmtPtr Parser::add_statement() {
+    SourceLocation loc = location_of(previous());
+    std::string module = consume_identifier("module name after 'add'");
+    consume(TokenType::SEMICOLON, "';' after 'add'");
+    return std::make_unique<AddStmt>(std::move(module), loc);
+}
+
+StmtPtr Parser::bind_statement(bool is_set) {
+    SourceLocation loc = location_of(previous());
+    auto stmt = std::make_unique<BindStmt>(is_set, binding_target(), loc);
+
+    if (match(TokenType::COLON)) {
+        if (stmt->target->kind != ExprKind::Identifier) {
+            error_at(previous(), ErrorCode::Parser_InvalidBindingTarget);
+        }
+        stmt->annotation = annotation();
+    }
+
+    std::string name = stmt->target->kind == ExprKind::Identifier
+                           ? static_cast<IdentifierExpr&>(*stmt->target).name
+                           : std::string();
+    bool is_pure = stmt->annotation && stmt->annotation->is_pure;
+
+    switch (peek().type) {
+        case TokenType::MINUS_GREATER:
+            advance();
+            stmt->op = BindOp::Assign;
+            stmt->value = expression();
+            break;
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::ASTERISK:
+        case TokenType::SLASH:
+        case TokenType::PERCENT:
+            stmt->op = BindOp::Compound;
+            stmt->compound_op = advance().type;
+            stmt->value = expression();
+            break;
+        case TokenType::EQUAL_GREATER: {
+            SourceLocation object_loc = location_of(advance());
+            auto object = mode_block(object_loc);
+            if (match(TokenType::AT)) object->act = act_block(name, is_pure);
+            stmt->op = BindOp::Define;
+            stmt->value = std::move(object);
+            break;
+        }
+        case TokenType::GREATER_GREATER: {
+            SourceLocation object_loc = location_of(advance());
+            stmt->op = BindOp::Append;
+            stmt->value = mode_block(object_loc);
+            break;
+        }
+        case TokenType::AT: {
+            SourceLocation object_loc = location_of(advance());
+            auto object = std::make_unique<ObjectExpr>(object_loc);
+            object->act = act_block(name, is_pure);
+            stmt->op = BindOp::Act;
+            stmt->value = std::move(object);
+            break;
+        }
+        default:
+            stmt->op = BindOp::Declare;
+            break;
+    }
+
+    if (stmt->op != BindOp::Declare && stmt->op != BindOp::Assign &&
+        stmt->op != BindOp::Compound && stmt->annotation) {
+        auto& object = static_cast<ObjectExpr&>(*stmt->value);
+        object.is_pure = stmt->annotation->is_pure;
+        object.is_runnable = stmt->annotation->is_runnable;
+    }
+    if (stmt->op == BindOp::Declare && stmt->target->kind != ExprKind::Identifier) {
+        error_at(peek(), ErrorCode::Parser_ExpectedToken, "'->' or an operator after binding target",
+                 peek().lexeme);
+    }
+
+    consume(TokenType::SEMICOLON, "';' after binding");
+    return stmt;
+}
+
+ExprPtr Parser::binding_target() {
+    ExprPtr target;
+    if (match(TokenType::SELF)) {
+        target = std::make_unique<SelfExpr>(location_of(previous()));
+        if (!check(TokenType::DOT) && !check(TokenType::LEFT_BRACKET)) {
+            error_at(previous(), ErrorCode::Parser_InvalidBindingTarget);
+        }
+    } else {
+        const Token& name = peek();
+        std::string identifier = consume_identifier("binding name after 'let'/'set'");
+        target = std::make_unique<IdentifierExpr>(std::move(identifier), location_of(name));
+    }
+
+    while (true) {
+        if (match(TokenType::DOT)) {
+            const Token& name = peek();
+            std::string property = consume_identifier("property name after '.'");
+            target =
+                std::make_unique<PropertyExpr>(std::move(target), std::move(property), location_of(name));
+        } else if (match(TokenType::LEFT_BRACKET)) {
+            SourceLocation loc = location_of(previous());
+            ExprPtr index = expression();
+            consume(TokenType::RIGHT_BRACKET, "']' after index");
+            target = std::make_unique<IndexExpr>(std::move(target), std::move(index), loc);
+        } else {
+            break;
+        }
+    }
+    return target;
+}
+
+TypeAnnotation Parser::annotation() {
+    TypeAnnotation result;
+    while (is_modifier(peek().type)) {
+        switch (advance().type) {
+            case TokenType::PUBLIC:
+                result.is_public = true;
+                break;
+            case TokenType::PRIVATE:
+                result.is_private = true;
+                break;
+            case TokenType::PURE:
+                result.is_pure = true;
+                break;
+            default:
+                result.is_runnable = true;
+                break;
+        }
+    }
+    if (is_type_start()) {
+        result.type = type();
+    } else if (!result.is_public && !result.is_private && !result.is_pure && !result.is_runnable) {
+        error_at(peek(), ErrorCode::Parser_ExpectedType, peek().lexeme);
+    }
+    return result;
+}
+
+bool Parser::is_type_start() const {
+    TokenType type = peek().type;
+    return Type::from_keyword(type) != nullptr || type == TokenType::LEFT_BRACKET ||
+           type == TokenType::LEFT_PAREN || type == TokenType::IDENTIFIER_LITERAL;
+}
+
+TypeRef Parser::type() {
+    if (TypeRef keyword = Type::from_keyword(peek().type)) {
+        advance();
+        return keyword;
+    }
+    if (match(TokenType::IDENTIFIER_LITERAL)) {
+        // Named object types (e.g. `: editable`) are checked structurally at runtime.
+        auto info = std::make_shared<ObjectInfo>();
+        info->name = previous().lexeme;
+        return Type::object_of(std::move(info));
+    }
+    if (match(TokenType::LEFT_BRACKET)) {
+        TypeRef first = type();
+        if (match(TokenType::MINUS_GREATER)) {
+            TypeRef value = type();
+            consume(TokenType::RIGHT_BRACKET, "']' after assoc type");
+            return Type::assoc_of(std::move(first), std::move(value));
+        }
+        consume(TokenType::RIGHT_BRACKET, "']' after array element type");
+        return Type::array_of(std::move(first));
+    }
+    if (match(TokenType::LEFT_PAREN)) {
+        std::vector<TypeRef> elements;
+        do {
+            elements.push_back(type());
+        } while (match(TokenType::COMMA));
+        consume(TokenType::RIGHT_PAREN, "')' after tuple type");
+        return Type::tuple_of(std::move(elements));
+    }
+    error_at(peek(), ErrorCode::Parser_ExpectedType, peek().lexeme);
+}
+
+std::unique_ptr<ObjectExpr> Parser::mode_block(SourceLocation loc) {
+    auto object = std::make_unique<ObjectExpr>(loc);
+    consume(TokenType::LEFT_BRACE, "'{' to start mode block");
+    while (!is_at_end() && !check(TokenType::RIGHT_BRACE)) {
+        size_t start = current_;
+        try {
+            object->mode.push_back(mode_entry());
+        } catch (const ParseError&) {
+            synchronize();
+            if (current_ == start) advance();  // Always make progress
+        }
+        while (match(TokenType::SEMICOLON) || match(TokenType::COMMA)) {
+        }
+    }
+    consume(TokenType::RIGHT_BRACE, "'}' to close mode block");
+    return object;
+}
+
+ModeEntry Parser::mode_entry() {
+    ModeEntry entry;
+    entry.loc = location_of(peek());
+
+    if (match(TokenType::STRING_LITERAL)) {
+        // Assoc-style entry: "key" -> value
+        entry.name = std::get<std::string>(previous().literal);
+        consume(TokenType::MINUS_GREATER, "'->' after property key");
+        entry.value = expression();
+        return entry;
+    }
+
+    if (match(TokenType::PARAM)) {
+        entry.kind = ModeEntry::Kind::Param;
+        entry.loc = location_of(peek());
+        entry.name = consume_identifier("parameter name after 'param'");
+        if (match(TokenType::COLON)) entry.declared_type = type();
+        if (match(TokenType::MINUS_GREATER)) entry.value = expression();
+        return entry;
+    }
+
+    if (match(TokenType::LET)) {
+        entry.is_set = false;
+    } else if (match(TokenType::SET)) {
+        entry.is_set = true;
+    } else {
+        error_at(peek(), ErrorCode::Parser_InvalidModeEntry, peek().lexeme);
+    }
+
+    entry.loc = location_of(peek());
+    entry.name = consume_identifier("property name");
+    std::optional<TypeAnnotation> annotation;
+    if (match(TokenType::COLON)) {
+        annotation = this->annotation();
+        entry.declared_type = annotation->type;
+        entry.is_private = annotation->is_private;
+    }
+    bool is_pure = annotation && annotation->is_pure;
+
+    if (match(TokenType::MINUS_GREATER)) {
+        entry.value = expression();
+    } else if (check(TokenType::EQUAL_GREATER) || check(TokenType::AT)) {
+        // Nested object: let inner => { ... } @ { ... }
+        SourceLocation object_loc = location_of(peek());
+        std::unique_ptr<ObjectExpr> object;
+        if (match(TokenType::EQUAL_GREATER)) {
+            object = mode_block(object_loc);
+            if (match(TokenType::AT)) object->act = act_block(entry.name, is_pure);
+        } else {
+            advance();
+            object = std::make_unique<ObjectExpr>(object_loc);
+            object->act = act_block(entry.name, is_pure);
+        }
+        if (annotation) {
+            object->is_pure = annotation->is_pure;
+            object->is_runnable = annotation->is_runnable;
+        }
+        entry.value = std::move(object);
+    }
+    return entry;
+}
+
+std::unique_ptr<ActDecl> Parser::act_block(const std::string& name, bool is_pure) {
+    auto act = std::make_unique<ActDecl>();
+    act->name = name;
+    act->loc = location_of(peek());
+    consume(TokenType::LEFT_BRACE, "'{' to start act block");
+    size_t end = defer_acts_ && act_depth_ == 0 && !is_pure ? deferrable_body_end() : 0;
+    if (end > 0) {
+        act->deferred = std::make_unique<DeferredBody>();
+        std::vector<Token>& body = act->deferred->tokens;
+        body.reserve(end - current_ + 1);
+        body.insert(body.end(), std::make_move_iterator(tokens_.begin() + current_),
+                    std::make_move_iterator(tokens_.begin() + end));
+        const Token& close = tokens_[end];
+        body.emplace_back(TokenType::END_OF_FILE, "", std::monostate{}, close.line, close.column);
+        current_ = end;
+    } else {
+        act_depth_++;
+        act->body = statement_list();
+        act_depth_--;
+    }
+    consume(TokenType::RIGHT_BRACE, "'}' to close act block");
+    return act;
+}
+
+// The position of the '}' that closes the act body starting at the current
+// token, or 0 if the body cannot be deferred: it is unbalanced, or contains
+// `>>` or `@ {` on a binding target (`let x @ { ... }`), which may change the
+// type of an object defined outside of it.
+size_t Parser::deferrable_body_end() const {
+    int depth = 1;
+    for (size_t i = current_; i < tokens_.size(); ++i) {
+        switch (tokens_[i].type) {
+            case TokenType::LEFT_BRACE:
+                depth++;
+                break;
+            case TokenType::RIGHT_BRACE:
+                if (--depth == 0) return i;
+                break;
+            case TokenType::GREATER_GREATER:
+                return 0;
+            case TokenType::AT:
+                if (tokens_[i + 1].type == TokenType::LEFT_BRACE &&
+                    tokens_[i - 1].type != TokenType::RIGHT_BRACE) {
+                    return 0;
+                }
+                break;
+            case TokenType::END_OF_FILE:
+                return 0;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+std::unique_ptr<BlockStmt> Parser::block() {
+    auto block = std::make_unique<BlockStmt>(location_of(peek()));
+    consume(TokenType::LEFT_BRACE, "'{' to start block");
+    block->statements = statement_list();
+    consume(TokenType::RIGHT_BRACE, "'}' to close block");
+    return block;
+}
+
+StmtPtr Parser::if_statement() {
+    SourceLocation loc = location_of(previous());
+    consume(TokenType::LEFT_PAREN, "'(' after 'if'");
+    ExprPtr condition = expression();
+    consume(TokenType::RIGHT_PAREN, "')' after if condition");
+    StmtPtr then_branch = block();
+    StmtPtr else_branch;
+    if (match(TokenType::ELSE)) {
+        if (match(TokenType::IF)) {
+            else_branch = if_statement();
+        } else {
+            else_branch = block();
+        }
+    }
+    return std::make_unique<IfStmt>(std::move(condition), std::move(then_branch),
+                                    std::move(else_branch), loc);
+}
+
+StmtPtr Parser::while_statement() {
+    SourceLocation loc = location_of(previous());
+    consume(TokenType::LEFT_PAREN, "'(' after 'while'");
+    ExprPtr condition = expression();
+    consume(TokenType::RIGHT_PAREN, "')' after while condition");
+    return std::make_unique<WhileStmt>(std::move(condition), block(), loc);
+}
+
+StmtPtr Parser::for_statement() {
+    SourceLocation loc = location_of(previous());
+    consume(TokenType::LEFT_PAREN, "'(' after 'for'");
+    std::string variable = consume_identifier("loop variable after 'for ('");
+    consume(TokenType::IN, "'in' after loop variable");
+    ExprPtr iterable = expression();
+    consume(TokenType::RIGHT_PAREN, "')' after for clause");
+    return std::make_unique<ForStmt>(std::move(variable), std::move(iterable), block(), loc);
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+ExprPtr Parser::expression() {
+    return logic_or();
+}
+
+ExprPtr Parser::logic_or() {
+    ExprPtr expr = logic_and();
+    while (match(TokenType::OR)) {
+        SourceLocation loc = location_of(previous());
+        expr = std::make_unique<LogicalExpr>(TokenType::OR, std::move(expr), logic_and(), loc);
+    }
+    return expr;
+}
+
+ExprPtr Parser::logic_and() {
+    ExprPtr expr = equality();
+    while (match(TokenType::AND)) {
+        SourceLocation loc = location_of(previous());
+        expr = std::make_unique<LogicalExpr>(TokenType::AND, std::move(expr), equality(), loc);
+    }
+    return expr;
+}
+
+ExprPtr Parser::equality() {
+    ExprPtr expr = comparison();
+    while (check(TokenType::EQUAL_EQUAL) || check(TokenType::BANG_EQUAL)) {
+        const Token& op = advance();
+        expr = std::make_unique<BinaryExpr>(op.type, std::move(expr), comparison(),
+                                            location_of(op));
+    }
+    return expr;
+}
+
+ExprPtr Parser::comparison() {
+    ExprPtr expr = term();
+    while (check(TokenType::LESS) || check(TokenType::LESS_EQUAL) || check(TokenType::GREATER) ||
+           check(TokenType::GREATER_EQUAL)) {
+        const Token& op = advance();
+        expr = std::make_unique<BinaryExpr>(op.type, std::move(expr), term(), location_of(op));
+    }
+    return expr;
+}
+
+ExprPtr Parser::term() {
+    ExprPtr expr = factor();
+    while (check(TokenType::PLUS) || check(TokenType::MINUS)) {
+        const Token& op = advance();
+        expr = std::make_unique<BinaryExpr>(op.type, std::move(expr), factor(), location_of(op));
+    }
+    return expr;
+}
+
+ExprPtr Parser::factor() {
+    ExprPtr expr = cast();
+    while (check(TokenType::ASTERISK) || check(TokenType::SLASH) || check(TokenType::PERCENT)) {
+        const Token& op = advance();
+        expr = std::make_unique<BinaryExpr>(op.type, std::move(expr), cast(), location_of(op));
+    }
+    return expr;
+}
+
+ExprPtr Parser::cast() {
+    ExprPtr expr = unary();
+    while (match(TokenType::AS)) {
+        SourceLocation loc = location_of(previous());
+        TypeRef target = type();
+        expr = std::make_unique<CastExpr>(std::move(expr), std::move(target), CastKind::Explicit,
+                                          loc);
+    }
+    return expr;
+}
+
+ExprPtr Parser::unary() {
+    if (check(TokenType::MINUS) || check(TokenType::NOT) || check(TokenType::BANG)) {
+        const Token& op = advance();
+        TokenType type = op.type == TokenType::MINUS ? TokenType::MINUS : TokenType::NOT;
+        SourceLocation loc = location_of(op);
+        ExprPtr operand = unary();
+        if (type == TokenType::MINUS && operand->kind == ExprKind::Literal) {
+            // Fold `-<number>` into a negative literal so that e.g. -2147483648 fits in int.
+            auto& literal = static_cast<LiteralExpr&>(*operand);
+            if (const int64_t* value = std::get_if<int64_t>(&literal.value)) {
+                literal.value = -*value;
+            } else if (const double* value = std::get_if<double>(&literal.value)) {
+                literal.value = -*value;
+            } else if (const uint64_t* value = std::get_if<uint64_t>(&literal.value);
+                       value && *value == static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1) {
+                literal.value = std::numeric_limits<int64_t>::min();
+            } else {
+                return std::make_unique<UnaryExpr>(type, std::move(operand), loc);
+            }
+            literal.loc.length += literal.loc.column - loc.column;
+            literal.loc.column = loc.column;
+            return operand;
+        }
+        return std::make_unique<UnaryExpr>(type, std::move(operand), loc);
+    }
+    if (match(TokenType::NEW)) {
+        SourceLocation loc = location_of(previous());
+        return std::make_unique<NewExpr>(unary(), loc);
+    }
+    return postfix();
+}
+
+ExprPtr Parser::postfix() {
+    ExprPtr expr = primary();
+    while (true) {
+        if (match(TokenType::DOT)) {
+            if (match(TokenType::AT)) {
+                const Token& name = peek();
+                std::string method = consume_identifier("act name after '.@'");
+                auto invoke = std::make_unique<InvokeExpr>(std::move(expr), std::move(method),
+                                                           location_of(name));
+                if (check(TokenType::LEFT_PAREN)) arguments(invoke->args);
+                expr = std::move(invoke);
+            } else {
+                const Token& name = peek();
+                std::string property = consume_identifier("property name after '.'");
+                expr = std::make_unique<PropertyExpr>(std::move(expr), std::move(property),
+                                                      location_of(name));
+            }
+        } else if (match(TokenType::LEFT_BRACKET)) {
+            SourceLocation loc = location_of(previous());
+            ExprPtr index = expression();
+            consume(TokenType::RIGHT_BRACKET, "']' after index");
+            expr = std::make_unique<IndexExpr>(std::move(expr), std::move(index), loc);
+        } else {
+            return expr;
+        }
+    }
+}
+
+void Parser::arguments(std::vector<ExprPtr>& args) {
+    consume(TokenType::LEFT_PAREN, "'(' to start arguments");
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            args.push_back(expression());
+            // `a -> b` pairs (e.g. `arr.@insert(5 -> 1)`) pass both values in order.
+            if (match(TokenType::MINUS_GREATER)) args.push_back(expression());
+        } while (match(TokenType::COMMA));
+    }
+    consume(TokenType::RIGHT_PAREN, "')' after arguments");
+}
+
+ExprPtr Parser::primary() {
+    const Token& token = peek();
+    SourceLocation loc = location_of(token);
+
+    switch (token.type) {
+        case TokenType::NUMBER_LITERAL:
+            advance();
+            return number_literal(token);
+        case TokenType::STRING_LITERAL:
+            advance();
+            return std::make_unique<LiteralExpr>(std::get<std::string>(token.literal), loc);
+        case TokenType::TRUE:
+            advance();
+            return std::make_unique<LiteralExpr>(true, loc);
+        case TokenType::FALSE:
+            advance();
+            return std::make_unique<LiteralExpr>(false, loc);
+        case TokenType::NIL:
+            advance();
+            return std::make_unique<LiteralExpr>(std::monostate{}, loc);
+        case TokenType::IDENTIFIER_LITERAL:
+            advance();
+            return std::make_unique<IdentifierExpr>(token.lexeme, loc);
+        case TokenType::SELF:
+            advance();
+            return std::make_unique<SelfExpr>(loc);
+        case TokenType::AT: {
+            advance();
+            const Token& name = peek();
+            std::string target = consume_identifier("object name after '@'");
+            auto invoke = std::make_unique<InvokeExpr>(nullptr, std::move(target),
+                                                       location_of(name));
+            if (check(TokenType::LEFT_PAREN)) arguments(invoke->args);
+            return invoke;
+        }
+        case TokenType::LEFT_PAREN: {
+            advance();
+            ExprPtr first = expression();
+            if (!check(TokenType::COMMA)) {
+                consume(TokenType::RIGHT_PAREN, "')' after expression");
+                return first;
+            }
+            auto tuple = std::make_unique<TupleExpr>(loc);
+            tuple->elements.push_back(std::move(first));
+            while (match(TokenType::COMMA)) {
+                tuple->elements.push_back(expression());
+            }
+            consume(TokenType::RIGHT_PAREN, "')' after tuple elements");
+            return tuple;
+        }
+        case TokenType::LEFT_BRACKET: {
+            advance();
+            if (match(TokenType::RIGHT_BRACKET)) return std::make_unique<ArrayExpr>(loc);
+            ExprPtr first = expression();
+            if (match(TokenType::MINUS_GREATER)) {
+                auto assoc = std::make_unique<AssocExpr>(loc);
+                assoc->keys.push_back(std::move(first));
+                assoc->values.push_back(expression());
+                while (match(TokenType::COMMA)) {
+                    if (check(TokenType::RIGHT_BRACKET)) break;  // Trailing comma
+                    assoc->keys.push_back(expression());
+                    consume(TokenType::MINUS_GREATER, "'->' between key and value");
+                    assoc->values.push_back(expression());
+                }
+                consume(TokenType::RIGHT_BRACKET, "']' after assoc entries");
+                return assoc;
+            }
+            auto array = std::make_unique<ArrayExpr>(loc);
+            array->elements.push_back(std::move(first));
+            while (match(TokenType::COMMA)) {
+                if (check(TokenType::RIGHT_BRACKET)) break;  // Trailing comma
+                array->elements.push_back(expression());
+            }
+            consume(TokenType::RIGHT_BRACKET, "']' after array elements");
+            return array;
+        }
+        default:
+            error_at(token, ErrorCode::Parser_ExpectedExpression, token.lexeme);
+    }
+}
+
+ExprPtr Parser::number_literal(const Token& token) {
+    SourceLocation loc = location_of(token);
+    TypeRef suffix_type = suffix_to_type(numeric_suffix(token.lexeme));
+    std::unique_ptr<LiteralExpr> literal;
+
+    if (const double* value = std::get_if<double>(&token.literal)) {
+        literal = std::make_unique<LiteralExpr>(*value, loc);
+    } else {
+        uint64_t magnitude = std::get<uint64_t>(token.literal);
+        bool is_unsigned = suffix_type && suffix_type->is_integer() && !suffix_type->is_signed();
+        if (is_unsigned ||
+            magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            literal = std::make_unique<LiteralExpr>(magnitude, loc);
+        } else {
+            literal = std::make_unique<LiteralExpr>(static_cast<int64_t>(magnitude), loc);
+        }
+    }
+    literal->suffix_type = std::move(suffix_type);
+    return literal;
+}
+
+// ============================================================================
+// Token helpers
+// ============================================================================
+
+bool Parser::is_at_end() const {
+    return peek().type == TokenType::END_OF_FILE;
+}
+
+const Token& Parser::peek() const {
+    return tokens_[current_];
+}
+
+const Token& Parser::peek_next() const {
+    return current_ + 1 < tokens_.size() ? tokens_[current_ + 1] : tokens_.back();
+}
+
+const Token& Parser::previous() const {
+    return tokens_[current_ - 1];
+}
+
+const Token& Parser::advance() {
+    if (!is_at_end()) current_++;
+    return previous();
+}
+
+bool Parser::check(TokenType type) const {
+    return peek().type == type;
+}
+
+bool Parser::match(TokenType type) {
+    if (!check(type)) return false;
+    advance();
+    return true;
+}
+
+const Token& Parser::consume(TokenType type, const char* expected) {
+    if (check(type)) return advance();
+    const Token& found = peek();
+    error_at(found, ErrorCode::Parser_ExpectedToken, expected,
+             found.type == TokenType::END_OF_FILE ? "end of file" : found.lexeme);
+}
+
+std::string Parser::consume_identifier(const char* context) {
+    if (check(TokenType::IDENTIFIER_LITERAL)) return advance().lexeme;
+    const Token& found = peek();
+    error_at(found, ErrorCode::Parser_ExpectedIdentifier, context,
+             found.type == TokenType::END_OF_FILE ? "end of file" : found.lexeme);
+}
+
+void Parser::synchronize() {
+    // Skip to the next statement boundary, keeping braces balanced so that an
+    // error inside a nested block does not swallow the rest of the program.
+    int depth = 0;
+    while (!is_at_end()) {
+        switch (peek().type) {
+            case TokenType::LEFT_BRACE:
+                ++depth;
+                break;
+            case TokenType::RIGHT_BRACE:
+                if (depth == 0) return;  // Let the enclosing block close itself
+                if (--depth == 0) {
+                    advance();
+                    match(TokenType::SEMICOLON);
+                    return;
+                }
+                break;
+            case TokenType::SEMICOLON:
+                if (depth == 0) {
+                    advance();
+                    return;
+                }
+                break;
+            case TokenType::LET:
+            case TokenType::SET:
+            case TokenType::IF:
+            case TokenType::WHILE:
+            case TokenType::FOR:
+            case TokenType::ADD:
+                if (depth == 0) return;
+                break;
+            default:
+                break;
+        }
+        advance();
+    }
+}
+
+SourceLocation Parser::location_of(const Token& token) {
+    return SourceLocation{token.line, token.column,
+                          std::max(1, static_cast<int>(token.lexeme.length()))};
+}
+
+}  // namespace core
+}  // namespace tooi
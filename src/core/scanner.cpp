@@ -332,7 +332,7 @@ void Scanner::add_token(TokenType type) {
 
 void Scanner::add_token(TokenType type, const TokenLiteral& literal) {
     std::string text = source_.substr(start_, current_ - start_);
-    tokens_.emplace_back(type, std::move(text), literal, line_);
+    tokens_.emplace_back(type, std::move(text), literal, line_, (start_ - line_start_) + 1);
 }
 
 bool Scanner::match(char expected) {
@@ -0,0 +1,1380 @@
+/**
+ * @file type_checker.cpp
+ * @brief Implementation of name resolution, type inference and type checking.
+ */
+#include "tooi/core/type_checker.h"
+
+#include <utility>
+
+#include "tooi/core/parser.h"
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+const char* operator_lexeme(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS:
+            return "+";
+        case TokenType::MINUS:
+            return "-";
+        case TokenType::ASTERISK:
+            return "*";
+        case TokenType::SLASH:
+            return "/";
+        case TokenType::PERCENT:
+            return "%";
+        case TokenType::LESS:
+            return "<";
+        case TokenType::LESS_EQUAL:
+            return "<=";
+        case TokenType::GREATER:
+            return ">";
+        case TokenType::GREATER_EQUAL:
+            return ">=";
+        case TokenType::EQUAL_EQUAL:
+            return "==";
+        case TokenType::BANG_EQUAL:
+            return "!=";
+        case TokenType::AND:
+            return "and";
+        case TokenType::OR:
+            return "or";
+        case TokenType::NOT:
+            return "not";
+        default:
+            return "?";
+    }
+}
+
+bool is_comparison(TokenType op) {
+    return op == TokenType::LESS || op == TokenType::LESS_EQUAL || op == TokenType::GREATER ||
+           op == TokenType::GREATER_EQUAL;
+}
+
+bool is_equality(TokenType op) {
+    return op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL;
+}
+
+// An integer literal without a suffix adapts to the type it is combined with.
+bool is_untyped_int_literal(const Expr& expr) {
+    if (expr.kind != ExprKind::Literal) return false;
+    const auto& literal = static_cast<const LiteralExpr&>(expr);
+    return !literal.suffix_type && (std::holds_alternative<int64_t>(literal.value) ||
+                                    std::holds_alternative<uint64_t>(literal.value));
+}
+
+// Magnitude and sign of an integer literal.
+std::pair<uint64_t, bool> literal_magnitude(const LiteralExpr& literal) {
+    if (const int64_t* value = std::get_if<int64_t>(&literal.value)) {
+        if (*value < 0) return {0 - static_cast<uint64_t>(*value), true};
+        return {static_cast<uint64_t>(*value), false};
+    }
+    return {std::get<uint64_t>(literal.value), false};
+}
+
+std::string literal_text(const LiteralExpr& literal) {
+    auto [magnitude, negative] = literal_magnitude(literal);
+    return (negative ? "-" : "") + std::to_string(magnitude);
+}
+
+// Retypes a numeric literal in place. The caller has checked that the value fits.
+void retype_literal(LiteralExpr& literal, const TypeRef& target) {
+    if (target->is_float()) {
+        if (const int64_t* value = std::get_if<int64_t>(&literal.value)) {
+            literal.value = static_cast<double>(*value);
+        } else if (const uint64_t* value = std::get_if<uint64_t>(&literal.value)) {
+            literal.value = static_cast<double>(*value);
+        }
+    } else if (target->is_integer()) {
+        if (target->is_signed()) {
+            if (const uint64_t* value = std::get_if<uint64_t>(&literal.value)) {
+                literal.value = static_cast<int64_t>(*value);
+            }
+        } else if (const int64_t* value = std::get_if<int64_t>(&literal.value)) {
+            literal.value = static_cast<uint64_t>(*value);
+        }
+    }
+    literal.type = target;
+}
+
+// Copies a side-effect free expression (used to desugar compound bindings).
+ExprPtr clone_pure(const Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::Literal: {
+            const auto& literal = static_cast<const LiteralExpr&>(expr);
+            auto copy = std::make_unique<LiteralExpr>(literal.value, literal.loc);
+            copy->suffix_type = literal.suffix_type;
+            return copy;
+        }
+        case ExprKind::Identifier: {
+            const auto& identifier = static_cast<const IdentifierExpr&>(expr);
+            return std::make_unique<IdentifierExpr>(identifier.name, identifier.loc);
+        }
+        case ExprKind::Self:
+            return std::make_unique<SelfExpr>(expr.loc);
+        case ExprKind::Unary: {
+            const auto& unary = static_cast<const UnaryExpr&>(expr);
+            ExprPtr operand = clone_pure(*unary.operand);
+            if (!operand) return nullptr;
+            return std::make_unique<UnaryExpr>(unary.op, std::move(operand), unary.loc);
+        }
+        case ExprKind::Binary: {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            ExprPtr left = clone_pure(*binary.left);
+            ExprPtr right = clone_pure(*binary.right);
+            if (!left || !right) return nullptr;
+            return std::make_unique<BinaryExpr>(binary.op, std::move(left), std::move(right),
+                                                binary.loc);
+        }
+        case ExprKind::Cast: {
+            const auto& cast = static_cast<const CastExpr&>(expr);
+            ExprPtr operand = clone_pure(*cast.operand);
+            if (!operand) return nullptr;
+            return std::make_unique<CastExpr>(std::move(operand), cast.target, cast.cast_kind,
+                                              cast.loc);
+        }
+        case ExprKind::Property: {
+            const auto& property = static_cast<const PropertyExpr&>(expr);
+            ExprPtr object = clone_pure(*property.object);
+            if (!object) return nullptr;
+            return std::make_unique<PropertyExpr>(std::move(object), property.name, property.loc);
+        }
+        case ExprKind::Index: {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            ExprPtr object = clone_pure(*index.object);
+            ExprPtr key = clone_pure(*index.index);
+            if (!object || !key) return nullptr;
+            return std::make_unique<IndexExpr>(std::move(object), std::move(key), index.loc);
+        }
+        default:
+            return nullptr;
+    }
+}
+
+// Values created by the expression itself, which no one else can observe yet.
+bool is_new_value(const Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::Literal:
+        case ExprKind::Array:
+        case ExprKind::Tuple:
+        case ExprKind::Assoc:
+        case ExprKind::Object:
+        case ExprKind::New:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Short description of a binding target for diagnostics.
+std::string target_text(const Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::Identifier:
+            return static_cast<const IdentifierExpr&>(expr).name;
+        case ExprKind::Self:
+            return "self";
+        case ExprKind::Property: {
+            const auto& property = static_cast<const PropertyExpr&>(expr);
+            return target_text(*property.object) + "." + property.name;
+        }
+        case ExprKind::Index:
+            return target_text(*static_cast<const IndexExpr&>(expr).object) + "[]";
+        default:
+            return "value";
+    }
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// GlobalTable
+// ============================================================================
+
+int GlobalTable::declare(const std::string& name, TypeRef type, bool is_set) {
+    auto it = index_.find(name);
+    GlobalInfo info{name, std::move(type), is_set, std::nullopt, declarations_++};
+    if (it != index_.end()) {
+        globals_[it->second] = std::move(info);
+        return it->second;
+    }
+    int index = static_cast<int>(globals_.size());
+    globals_.push_back(std::move(info));
+    index_.emplace(name, index);
+    return index;
+}
+
+int GlobalTable::find(const std::string& name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? -1 : it->second;
+}
+
+// ============================================================================
+// TypeChecker
+// ============================================================================
+
+TypeChecker::TypeChecker(GlobalTable& globals, const std::string& source,
+                         ErrorReporter& error_reporter)
+    : globals_(globals), source_(source), error_reporter_(error_reporter) {}
+
+template <typename... Args>
+void TypeChecker::error(const SourceLocation& loc, ErrorCode code, Args&&... args) {
+    error_reporter_.report_at(loc.line, loc.column, loc.length, source_line(source_, loc.line),
+                              code, std::forward<Args>(args)...);
+    had_error_ = true;
+}
+
+bool TypeChecker::check(Program& program) {
+    FunctionContext script;
+    function_ = &script;
+    had_error_ = false;
+    check_block(program.statements);
+    function_ = nullptr;
+    return !had_error_;
+}
+
+bool TypeChecker::check_deferred(ActDecl& act) {
+    DeferredBody& deferred = *act.deferred;
+    FunctionContext script;
+    function_ = &script;
+    had_error_ = false;
+    visible_declarations_ = deferred.visible_declarations;
+    check_act_body(act, deferred.self, deferred.self_type);
+    visible_declarations_ = SIZE_MAX;
+    function_ = nullptr;
+    return !had_error_;
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+void TypeChecker::check_block(std::vector<StmtPtr>& statements) {
+    for (auto& stmt : statements) check_statement(*stmt);
+}
+
+void TypeChecker::check_statement(Stmt& stmt) {
+    switch (stmt.kind) {
+        case StmtKind::Add:
+            check_add(static_cast<AddStmt&>(stmt));
+            break;
+        case StmtKind::Bind:
+            check_bind(static_cast<BindStmt&>(stmt));
+            break;
+        case StmtKind::Expression:
+            check_expr(static_cast<ExpressionStmt&>(stmt).expr);
+            break;
+        case StmtKind::Block:
+            check_block(static_cast<BlockStmt&>(stmt).statements);
+            break;
+        case StmtKind::If: {
+            auto& if_stmt = static_cast<IfStmt&>(stmt);
+            check_condition(if_stmt.condition, "in if condition");
+            check_statement(*if_stmt.then_branch);
+            if (if_stmt.else_branch) check_statement(*if_stmt.else_branch);
+            break;
+        }
+        case StmtKind::While: {
+            auto& while_stmt = static_cast<WhileStmt&>(stmt);
+            check_condition(while_stmt.condition, "in while condition");
+            function_->loop_depth++;
+            check_statement(*while_stmt.body);
+            function_->loop_depth--;
+            break;
+        }
+        case StmtKind::For:
+            check_for(static_cast<ForStmt&>(stmt));
+            break;
+        case StmtKind::Done:
+        case StmtKind::Skip:
+            if (function_->loop_depth == 0) {
+                error(stmt.loc, ErrorCode::Semantic_LoopControlOutsideLoop,
+                      stmt.kind == StmtKind::Done ? "done" : "skip");
+            }
+            break;
+        case StmtKind::Be: {
+            auto& be = static_cast<BeStmt&>(stmt);
+            if (!function_->act) error(stmt.loc, ErrorCode::Semantic_BeOutsideAct);
+            if (be.value) check_expr(be.value);
+            break;
+        }
+    }
+}
+
+void TypeChecker::check_add(AddStmt& stmt) {
+    if (function_->act || function_->enclosing) {
+        error(stmt.loc, ErrorCode::Semantic_AddNotTopLevel);
+        return;
+    }
+    if (stmt.module != "io") {
+        error(stmt.loc, ErrorCode::Semantic_UnknownModule, stmt.module);
+        return;
+    }
+    int index = globals_.declare(stmt.module, Type::module(stmt.module), true);
+    stmt.resolution = Resolution{BindingKind::Global, index, true};
+}
+
+void TypeChecker::check_condition(ExprPtr& condition, const char* context) {
+    TypeRef type = check_expr(condition);
+    // proto conditions use truthiness at runtime (nil and false are false).
+    if (type->kind != TypeKind::Bool && !type->is_proto()) {
+        error(condition->loc, ErrorCode::Semantic_ExpectedBool, context, type->to_string());
+    }
+}
+
+void TypeChecker::check_for(ForStmt& stmt) {
+    TypeRef iterable = check_expr(stmt.iterable);
+    TypeRef item;
+    switch (iterable->kind) {
+        case TypeKind::Array:
+            item = iterable->element();
+            break;
+        case TypeKind::Assoc:
+            item = iterable->key();  // Iterating an assoc array yields its keys
+            break;
+        case TypeKind::String:
+            item = Type::string();
+            break;
+        case TypeKind::Tuple: {
+            item = iterable->elements.empty() ? Type::proto() : iterable->elements[0];
+            for (const auto& element : iterable->elements) {
+                if (!types_equal(element, item)) item = Type::proto();
+            }
+            break;
+        }
+        case TypeKind::Proto:
+            item = Type::proto();
+            break;
+        default:
+            error(stmt.iterable->loc, ErrorCode::Semantic_NotIndexable, iterable->to_string());
+            item = Type::proto();
+            break;
+    }
+    Binding binding = declare(stmt.variable, item, false);
+    stmt.resolution = binding.resolution;
+    stmt.variable_type = item;
+    note_local_binding(binding.resolution, false);
+
+    function_->loop_depth++;
+    check_statement(*stmt.body);
+    function_->loop_depth--;
+}
+
+void TypeChecker::check_bind(BindStmt& stmt) {
+    if (stmt.op == BindOp::Compound) desugar_compound(stmt);
+    if (stmt.target->kind == ExprKind::Identifier) {
+        check_name_bind(stmt);
+    } else {
+        check_member_bind(stmt);
+    }
+}
+
+void TypeChecker::desugar_compound(BindStmt& stmt) {
+    ExprPtr current = clone_pure(*stmt.target);
+    if (!current) {
+        error(stmt.target->loc, ErrorCode::Semantic_ComplexCompoundTarget);
+        // Keep checking with a placeholder so that later errors are still found.
+        current = std::make_unique<LiteralExpr>(std::monostate{}, stmt.target->loc);
+    }
+    SourceLocation loc = stmt.value->loc;
+    stmt.value = std::make_unique<BinaryExpr>(stmt.compound_op, std::move(current),
+                                              std::move(stmt.value), loc);
+    stmt.op = BindOp::Assign;
+}
+
+void TypeChecker::check_name_bind(BindStmt& stmt) {
+    auto& target = static_cast<IdentifierExpr&>(*stmt.target);
+    const std::string& name = target.name;
+    TypeRef annotated = stmt.annotation ? stmt.annotation->type : nullptr;
+    std::optional<Binding> existing = lookup(name);
+    if (existing) {
+        // Captures are by value: rebinding a captured name introduces a local.
+        BindingKind kind = existing->resolution.kind;
+        bool rebinds_capture = kind == BindingKind::Upvalue && stmt.op != BindOp::Append &&
+                               stmt.op != BindOp::Act;
+        if (kind == BindingKind::Dynamic || rebinds_capture) existing.reset();
+    }
+
+    // A new binding is introduced by `set`, by an annotation, or for an unbound name.
+    bool declares = stmt.is_set || stmt.annotation.has_value() || !existing;
+    if (stmt.op == BindOp::Append) declares = false;
+    if (stmt.op == BindOp::Act && existing) declares = false;
+
+    if (existing && existing->resolution.is_set &&
+        (!declares || existing->resolution.kind == BindingKind::Global ||
+         existing->resolution.kind == BindingKind::Local)) {
+        // Immutable bindings can neither be rebound nor redeclared in the same scope.
+        bool same_scope = existing->resolution.kind == BindingKind::Local ||
+                          (existing->resolution.kind == BindingKind::Global && !function_->act);
+        if (!declares || same_scope) {
+            error(target.loc, ErrorCode::Semantic_AssignToImmutable, name);
+        }
+    }
+
+    TypeRef type;
+    switch (stmt.op) {
+        case BindOp::Declare:
+            if (!declares) {
+                // `let x;` on an existing binding is a no-op redeclaration.
+                type = existing->type;
+                break;
+            }
+            type = annotated ? annotated : Type::proto();
+            break;
+        case BindOp::Assign: {
+            TypeRef value_type = check_expr(stmt.value);
+            if (declares) {
+                if (annotated) {
+                    coerce(stmt.value, annotated, name);
+                    type = annotated;
+                } else {
+                    type = binding_type_of(value_type);
+                }
+            } else {
+                coerce(stmt.value, existing->type, name);
+                type = existing->type;
+            }
+            break;
+        }
+        case BindOp::Define: {
+            TypeRef object_type = check_object(static_cast<ObjectExpr&>(*stmt.value), name);
+            if (!declares && !is_assignable(existing->type, object_type)) {
+                error(target.loc, ErrorCode::Semantic_TypeMismatch, object_type->to_string(),
+                      name, existing->type->to_string());
+            }
+            type = declares ? object_type : existing->type;
+            break;
+        }
+        case BindOp::Append:
+        case BindOp::Act:
+            if (!existing) {
+                if (stmt.op == BindOp::Append) {
+                    error(target.loc, ErrorCode::Semantic_UndefinedName, name);
+                    type = Type::proto();
+                    break;
+                }
+                // `let name @ { ... };` on an unbound name defines a new act-only object.
+                type = check_object(static_cast<ObjectExpr&>(*stmt.value), name);
+                break;
+            }
+            check_object_update(stmt, existing->type, name);
+            type = existing->type;
+            break;
+        case BindOp::Compound:
+            break;  // Desugared above
+    }
+
+    Binding binding = declares ? declare(name, type, stmt.is_set) : *existing;
+    target.resolution = binding.resolution;
+    target.type = type;
+    stmt.declares = declares;
+    stmt.binding_type = type;
+
+    if (function_->pure && (declares || stmt.op != BindOp::Declare)) {
+        if (binding.resolution.kind != BindingKind::Local) {
+            error(target.loc, ErrorCode::Semantic_PureMutation, pure_act_name(), name);
+        } else if (!declares && (stmt.op == BindOp::Append || stmt.op == BindOp::Act)) {
+            // `>>` and `@` change the object the local holds.
+            function_->local_mutations.emplace_back(binding.resolution.slot, target.loc);
+        } else {
+            note_local_binding(binding.resolution,
+                               stmt.op != BindOp::Assign || is_new_value(*stmt.value));
+        }
+    }
+}
+
+void TypeChecker::check_object_update(BindStmt& stmt, const TypeRef& target_type,
+                                      const std::string& name) {
+    auto& object = static_cast<ObjectExpr&>(*stmt.value);
+    const char* op = stmt.op == BindOp::Append ? ">>" : "@";
+    if (target_type->kind != TypeKind::Object && !target_type->is_proto()) {
+        error(stmt.target->loc, ErrorCode::Semantic_NotAnObject, op, name,
+              target_type->to_string());
+        return;
+    }
+
+    std::shared_ptr<ObjectInfo> info = target_type->object;
+    if (!info) info = std::make_shared<ObjectInfo>();
+    if (stmt.op == BindOp::Append) {
+        check_mode_entries(object, *info);
+        object.type = target_type;
+    } else {
+        TypeRef self_type = target_type->kind == TypeKind::Object ? target_type
+                                                                  : Type::object_of(info);
+        check_act(*object.act, info, self_type);
+        info->has_act = true;
+        object.type = self_type;
+    }
+}
+
+void TypeChecker::check_member_bind(BindStmt& stmt) {
+    // The target is evaluated for its container; its own type is the slot type.
+    TypeRef slot_type = Type::proto();
+    std::string name;
+    if (stmt.target->kind == ExprKind::Property) {
+        auto& property = static_cast<PropertyExpr&>(*stmt.target);
+        name = property.name;
+        TypeRef object_type = check_expr(property.object);
+        switch (object_type->kind) {
+            case TypeKind::Object:
+                if (object_type->object) {
+                    auto it = object_type->object->properties.find(name);
+                    if (it != object_type->object->properties.end()) {
+                        if (it->second.is_set) {
+                            error(property.loc, ErrorCode::Semantic_AssignToImmutable, name);
+                        }
+                        if (it->second.is_private && !is_self_access(*property.object)) {
+                            error(property.loc, ErrorCode::Semantic_PrivateAccess, name);
+                        }
+                        slot_type = it->second.type;
+                    }
+                }
+                break;
+            case TypeKind::Proto:
+                break;
+            default:
+                error(property.loc, ErrorCode::Semantic_UnknownMember, object_type->to_string(),
+                      name);
+                break;
+        }
+    } else {
+        auto& index = static_cast<IndexExpr&>(*stmt.target);
+        name = "element";
+        TypeRef object_type = check_expr(index.object);
+        TypeRef index_type = check_expr(index.index);
+        switch (object_type->kind) {
+            case TypeKind::Array:
+                if (!index_type->is_integer() && !index_type->is_proto()) {
+                    error(index.index->loc, ErrorCode::Semantic_InvalidIndex,
+                          index_type->to_string(), object_type->to_string());
+                }
+                slot_type = object_type->element();
+                break;
+            case TypeKind::Assoc:
+                coerce(index.index, object_type->key(), "key");
+                slot_type = object_type->value();
+                break;
+            case TypeKind::Proto:
+                break;
+            case TypeKind::Tuple:
+            case TypeKind::String:
+                error(index.loc, ErrorCode::Semantic_AssignToImmutable, object_type->to_string());
+                break;
+            default:
+                error(index.loc, ErrorCode::Semantic_NotIndexable, object_type->to_string());
+                break;
+        }
+    }
+    stmt.target->type = slot_type;
+
+    switch (stmt.op) {
+        case BindOp::Declare:
+        case BindOp::Compound:
+            break;
+        case BindOp::Assign:
+            check_expr(stmt.value);
+            coerce(stmt.value, slot_type, name);
+            break;
+        case BindOp::Define: {
+            TypeRef object_type = check_object(static_cast<ObjectExpr&>(*stmt.value), name);
+            if (!is_assignable(slot_type, object_type)) {
+                error(stmt.target->loc, ErrorCode::Semantic_TypeMismatch,
+                      object_type->to_string(), name, slot_type->to_string());
+            }
+            break;
+        }
+        case BindOp::Append:
+        case BindOp::Act:
+            check_object_update(stmt, slot_type, name);
+            break;
+    }
+    stmt.binding_type = slot_type;
+
+    // Element and property stores change the container; `>>` and `@` change the member itself.
+    const Expr& container = stmt.target->kind == ExprKind::Property
+                                ? *static_cast<PropertyExpr&>(*stmt.target).object
+                                : *static_cast<IndexExpr&>(*stmt.target).object;
+    bool updates_member = stmt.op == BindOp::Append || stmt.op == BindOp::Act;
+    check_pure_mutation(updates_member ? *stmt.target : container, stmt.target->loc);
+}
+
+// ============================================================================
+// Objects
+// ============================================================================
+
+TypeRef TypeChecker::check_object(ObjectExpr& object, const std::string& name) {
+    auto info = std::make_shared<ObjectInfo>();
+    info->name = name;
+    info->is_pure = object.is_pure;
+    TypeRef type = Type::object_of(info);
+    object.type = type;
+
+    check_mode_entries(object, *info);
+    if (object.act) {
+        check_act(*object.act, info, type);
+        info->has_act = true;
+    }
+    return type;
+}
+
+void TypeChecker::check_mode_entries(ObjectExpr& object, ObjectInfo& info) {
+    // Initializers are evaluated in the scope that contains the object literal.
+    for (auto& entry : object.mode) {
+        TypeRef type = entry.declared_type;
+        if (entry.value) {
+            TypeRef value_type = entry.value->kind == ExprKind::Object
+                                     ? check_object(static_cast<ObjectExpr&>(*entry.value),
+                                                    entry.name)
+                                     : check_expr(entry.value);
+            if (type) {
+                coerce(entry.value, type, entry.name);
+            } else {
+                type = binding_type_of(value_type);
+            }
+        }
+        if (!type) type = Type::proto();
+        entry.type = type;
+
+        if (entry.kind == ModeEntry::Kind::Param) {
+            bool replaced = false;
+            for (auto& param : info.params) {
+                if (param.first == entry.name) {
+                    param.second = type;
+                    replaced = true;
+                }
+            }
+            if (!replaced) info.params.emplace_back(entry.name, type);
+        } else {
+            info.properties[entry.name] = PropertyInfo{type, entry.is_set, entry.is_private};
+        }
+    }
+}
+
+void TypeChecker::check_act(ActDecl& act, const std::shared_ptr<ObjectInfo>& self,
+                            const TypeRef& self_type) {
+    if (act.deferred && self->is_pure) {
+        // An act added to a pure object: pure acts may be evaluated at compile time.
+        if (!Parser::parse_deferred(act, source_, error_reporter_)) had_error_ = true;
+        act.deferred.reset();
+    }
+    if (!act.deferred) {
+        check_act_body(act, self, self_type);
+        return;
+    }
+    // Later mode entries must not leak into the body, so keep the object as it is now.
+    act.deferred->self = std::make_shared<ObjectInfo>(*self);
+    act.deferred->self_type = self_type;
+    act.deferred->visible_declarations = globals_.declarations();
+    act.locals.clear();
+    act.upvalues.clear();
+    act.param_count = static_cast<int>(self->params.size());
+}
+
+void TypeChecker::check_act_body(ActDecl& act, const std::shared_ptr<ObjectInfo>& self,
+                                 const TypeRef& self_type) {
+    FunctionContext context;
+    context.act = &act;
+    context.enclosing = function_;
+    context.self = self;
+    context.self_type = self_type;
+    function_ = &context;
+
+    act.locals.clear();
+    act.upvalues.clear();
+    for (const auto& param : self->params) {
+        declare(param.first, param.second, false);
+    }
+    act.param_count = static_cast<int>(self->params.size());
+    context.pure = self->is_pure;
+    for (int slot = 0; slot < act.param_count; ++slot) context.owned_locals[slot] = false;
+    check_block(act.body);
+    if (context.pure) check_pure_locals();
+
+    function_ = context.enclosing;
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+TypeRef TypeChecker::check_expr(ExprPtr& expr) {
+    TypeRef type;
+    switch (expr->kind) {
+        case ExprKind::Literal:
+            type = check_literal(static_cast<LiteralExpr&>(*expr));
+            break;
+        case ExprKind::Identifier:
+            type = check_identifier(static_cast<IdentifierExpr&>(*expr));
+            break;
+        case ExprKind::Self:
+            if (!function_->act) {
+                error(expr->loc, ErrorCode::Semantic_SelfOutsideAct);
+                type = Type::proto();
+            } else {
+                type = function_->self_type;
+            }
+            break;
+        case ExprKind::Unary:
+            type = check_unary(static_cast<UnaryExpr&>(*expr));
+            break;
+        case ExprKind::Binary:
+            type = check_binary(static_cast<BinaryExpr&>(*expr));
+            break;
+        case ExprKind::Logical:
+            type = check_logical(static_cast<LogicalExpr&>(*expr));
+            break;
+        case ExprKind::Cast:
+            type = check_cast(static_cast<CastExpr&>(*expr));
+            break;
+        case ExprKind::Array:
+            type = check_array(static_cast<ArrayExpr&>(*expr));
+            break;
+        case ExprKind::Tuple:
+            type = check_tuple(static_cast<TupleExpr&>(*expr));
+            break;
+        case ExprKind::Assoc:
+            type = check_assoc(static_cast<AssocExpr&>(*expr));
+            break;
+        case ExprKind::Index:
+            type = check_index(static_cast<IndexExpr&>(*expr));
+            break;
+        case ExprKind::Property:
+            type = check_property(static_cast<PropertyExpr&>(*expr));
+            break;
+        case ExprKind::Invoke:
+            type = check_invoke(static_cast<InvokeExpr&>(*expr));
+            break;
+        case ExprKind::New:
+            type = check_new(static_cast<NewExpr&>(*expr));
+            break;
+        case ExprKind::Object:
+            type = check_object(static_cast<ObjectExpr&>(*expr), "");
+            break;
+    }
+    expr->type = type;
+    return type;
+}
+
+TypeRef TypeChecker::check_literal(LiteralExpr& expr) {
+    if (expr.type) return expr.type;  // Already retyped by a coercion
+    return std::visit(
+        [&](auto&& value) -> TypeRef {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::monostate>) {
+                return Type::nil();
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return Type::boolean();
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                return Type::string();
+            } else if constexpr (std::is_same_v<T, double>) {
+                return expr.suffix_type ? expr.suffix_type : Type::float64();
+            } else {
+                auto [magnitude, negative] = literal_magnitude(expr);
+                if (expr.suffix_type) {
+                    if (!integer_fits(expr.suffix_type, magnitude, negative)) {
+                        error(expr.loc, ErrorCode::Semantic_IntegerLiteralOutOfRange,
+                              literal_text(expr), expr.suffix_type->to_string());
+                    }
+                    retype_literal(expr, expr.suffix_type);
+                    return expr.suffix_type;
+                }
+                if (integer_fits(Type::int32(), magnitude, negative)) return Type::int32();
+                if (integer_fits(Type::int64(), magnitude, negative)) return Type::int64();
+                retype_literal(expr, Type::uint64());
+                return Type::uint64();
+            }
+        },
+        expr.value);
+}
+
+TypeRef TypeChecker::check_identifier(IdentifierExpr& expr) {
+    std::optional<Binding> binding = lookup(expr.name);
+    if (!binding) {
+        error(expr.loc, ErrorCode::Semantic_UndefinedName, expr.name);
+        expr.resolution = Resolution{BindingKind::Dynamic, -1, false};
+        return Type::proto();
+    }
+    expr.resolution = binding->resolution;
+    return binding->type;
+}
+
+TypeRef TypeChecker::check_unary(UnaryExpr& expr) {
+    TypeRef operand = check_expr(expr.operand);
+    if (expr.op == TokenType::MINUS) {
+        if (operand->is_numeric() || operand->is_proto()) return operand;
+    } else {
+        if (operand->kind == TypeKind::Bool || operand->is_proto()) return Type::boolean();
+    }
+    error(expr.loc, ErrorCode::Semantic_InvalidUnaryOperand, operator_lexeme(expr.op),
+          operand->to_string());
+    return Type::proto();
+}
+
+TypeRef TypeChecker::check_binary(BinaryExpr& expr) {
+    TypeRef left = check_expr(expr.left);
+    TypeRef right = check_expr(expr.right);
+    TokenType op = expr.op;
+
+    if (is_equality(op)) {
+        if (left->is_numeric() && right->is_numeric()) {
+            TypeRef common = promote_numeric(left, right);
+            widen(expr.left, common);
+            widen(expr.right, common);
+        }
+        return Type::boolean();
+    }
+
+    // String concatenation converts the other operand at runtime.
+    if (op == TokenType::PLUS &&
+        (left->kind == TypeKind::String || right->kind == TypeKind::String)) {
+        return Type::string();
+    }
+
+    if (left->is_proto() || right->is_proto()) {
+        bool left_ok = left->is_proto() || left->is_numeric() ||
+                       (is_comparison(op) && left->kind == TypeKind::String);
+        bool right_ok = right->is_proto() || right->is_numeric() ||
+                        (is_comparison(op) && right->kind == TypeKind::String);
+        if (left_ok && right_ok) return is_comparison(op) ? Type::boolean() : Type::proto();
+    } else if (left->is_numeric() && right->is_numeric()) {
+        // An unsuffixed integer literal takes the type of the other operand when it fits.
+        TypeRef common;
+        if (is_untyped_int_literal(*expr.left) && !is_untyped_int_literal(*expr.right)) {
+            auto [magnitude, negative] =
+                literal_magnitude(static_cast<LiteralExpr&>(*expr.left));
+            if (integer_fits(right, magnitude, negative)) common = right;
+        } else if (is_untyped_int_literal(*expr.right) && !is_untyped_int_literal(*expr.left)) {
+            auto [magnitude, negative] =
+                literal_magnitude(static_cast<LiteralExpr&>(*expr.right));
+            if (integer_fits(left, magnitude, negative)) common = left;
+        }
+        if (!common) common = promote_numeric(left, right);
+        widen(expr.left, common);
+        widen(expr.right, common);
+        return is_comparison(op) ? Type::boolean() : common;
+    } else if (is_comparison(op) && left->kind == TypeKind::String &&
+               right->kind == TypeKind::String) {
+        return Type::boolean();
+    }
+
+    error(expr.loc, ErrorCode::Semantic_InvalidOperands, operator_lexeme(op), left->to_string(),
+          right->to_string());
+    return is_comparison(op) ? Type::boolean() : Type::proto();
+}
+
+TypeRef TypeChecker::check_logical(LogicalExpr& expr) {
+    TypeRef left = check_expr(expr.left);
+    TypeRef right = check_expr(expr.right);
+    for (const TypeRef* type : {&left, &right}) {
+        if ((*type)->kind != TypeKind::Bool && !(*type)->is_proto()) {
+            error(expr.loc, ErrorCode::Semantic_InvalidOperands, operator_lexeme(expr.op),
+                  left->to_string(), right->to_string());
+            break;
+        }
+    }
+    return Type::boolean();
+}
+
+TypeRef TypeChecker::check_cast(CastExpr& expr) {
+    TypeRef source = check_expr(expr.operand);
+    const TypeRef& target = expr.target;
+    if (expr.cast_kind != CastKind::Explicit) return target;  // Already checked
+
+    bool valid;
+    if (source->is_proto() || target->is_proto() || types_equal(source, target)) {
+        valid = true;
+    } else if (target->kind == TypeKind::String) {
+        valid = source->kind != TypeKind::Module;
+    } else if (target->is_numeric() || target->kind == TypeKind::Bool) {
+        valid = source->is_numeric() || source->kind == TypeKind::String ||
+                source->kind == TypeKind::Bool;
+    } else {
+        valid = is_assignable(target, source);
+    }
+    if (!valid) {
+        error(expr.loc, ErrorCode::Semantic_InvalidCast, source->to_string(), target->to_string());
+    }
+    return target;
+}
+
+TypeRef TypeChecker::check_array(ArrayExpr& expr) {
+    TypeRef element;
+    for (auto& item : expr.elements) {
+        TypeRef type = binding_type_of(check_expr(item));
+        if (!element) {
+            element = type;
+        } else if (!types_equal(element, type)) {
+            element = Type::proto();
+        }
+    }
+    return Type::array_of(element ? element : Type::proto());
+}
+
+TypeRef TypeChecker::check_tuple(TupleExpr& expr) {
+    std::vector<TypeRef> elements;
+    for (auto& item : expr.elements) {
+        elements.push_back(binding_type_of(check_expr(item)));
+    }
+    return Type::tuple_of(std::move(elements));
+}
+
+TypeRef TypeChecker::check_assoc(AssocExpr& expr) {
+    TypeRef key;
+    TypeRef value;
+    for (size_t i = 0; i < expr.keys.size(); ++i) {
+        TypeRef key_type = binding_type_of(check_expr(expr.keys[i]));
+        TypeRef value_type = binding_type_of(check_expr(expr.values[i]));
+        key = !key ? key_type : (types_equal(key, key_type) ? key : Type::proto());
+        value = !value ? value_type : (types_equal(value, value_type) ? value : Type::proto());
+    }
+    return Type::assoc_of(key ? key : Type::proto(), value ? value : Type::proto());
+}
+
+TypeRef TypeChecker::check_index(IndexExpr& expr) {
+    TypeRef object = check_expr(expr.object);
+    TypeRef index = check_expr(expr.index);
+
+    switch (object->kind) {
+        case TypeKind::Array:
+        case TypeKind::String:
+            if (!index->is_integer() && !index->is_proto()) {
+                error(expr.index->loc, ErrorCode::Semantic_InvalidIndex, index->to_string(),
+                      object->to_string());
+            }
+            return object->kind == TypeKind::Array ? object->element() : Type::string();
+        case TypeKind::Tuple: {
+            if (expr.index->kind == ExprKind::Literal && index->is_integer()) {
+                auto [magnitude, negative] =
+                    literal_magnitude(static_cast<LiteralExpr&>(*expr.index));
+                if (negative || magnitude >= object->elements.size()) {
+                    error(expr.index->loc, ErrorCode::Semantic_TupleIndexOutOfRange,
+                          literal_text(static_cast<LiteralExpr&>(*expr.index)),
+                          object->to_string());
+                    return Type::proto();
+                }
+                return object->elements[magnitude];
+            }
+            if (!index->is_integer() && !index->is_proto()) {
+                error(expr.index->loc, ErrorCode::Semantic_InvalidIndex, index->to_string(),
+                      object->to_string());
+            }
+            return Type::proto();
+        }
+        case TypeKind::Assoc:
+            coerce(expr.index, object->key(), "key");
+            return object->value();
+        case TypeKind::Proto:
+            return Type::proto();
+        default:
+            error(expr.loc, ErrorCode::Semantic_NotIndexable, object->to_string());
+            return Type::proto();
+    }
+}
+
+TypeRef TypeChecker::check_property(PropertyExpr& expr) {
+    TypeRef object = check_expr(expr.object);
+    switch (object->kind) {
+        case TypeKind::Array:
+        case TypeKind::Tuple:
+        case TypeKind::String:
+        case TypeKind::Assoc:
+            if (expr.name == "length") return Type::int32();
+            break;
+        case TypeKind::Object:
+            if (object->object) {
+                auto it = object->object->properties.find(expr.name);
+                if (it != object->object->properties.end() && it->second.is_private &&
+                    !is_self_access(*expr.object)) {
+                    error(expr.loc, ErrorCode::Semantic_PrivateAccess, expr.name);
+                }
+            }
+            // Properties can be rebound through untyped aliases, so reads are dynamic.
+            return Type::proto();
+        case TypeKind::Proto:
+            return Type::proto();
+        default:
+            break;
+    }
+    error(expr.loc, ErrorCode::Semantic_UnknownMember, object->to_string(), expr.name);
+    return Type::proto();
+}
+
+TypeRef TypeChecker::check_invoke(InvokeExpr& expr) {
+    TypeRef target;
+    if (expr.receiver) {
+        TypeRef receiver = check_expr(expr.receiver);
+        if (receiver->kind != TypeKind::Object && !receiver->is_proto()) {
+            return check_builtin_invoke(expr, receiver);
+        }
+        target = Type::proto();
+        if (receiver->kind == TypeKind::Object && receiver->object) {
+            auto it = receiver->object->properties.find(expr.name);
+            if (it != receiver->object->properties.end()) {
+                if (it->second.is_private && !is_self_access(*expr.receiver)) {
+                    error(expr.loc, ErrorCode::Semantic_PrivateAccess, expr.name);
+                }
+                target = it->second.type;
+            }
+        }
+    } else {
+        std::optional<Binding> binding = lookup(expr.name);
+        if (!binding) {
+            error(expr.loc, ErrorCode::Semantic_UndefinedName, expr.name);
+            expr.resolution = Resolution{BindingKind::Dynamic, -1, false};
+            target = Type::proto();
+        } else {
+            expr.resolution = binding->resolution;
+            target = binding->type;
+        }
+    }
+
+    for (auto& arg : expr.args) check_expr(arg);
+
+    if (function_->pure) {
+        bool pure_target = target->kind == TypeKind::Object && target->object &&
+                           target->object->is_pure;
+        // A pure act may invoke itself by name (it is not bound yet while it is checked).
+        bool recursion = !expr.receiver && expr.name == function_->self->name &&
+                         (expr.resolution.kind == BindingKind::Global ||
+                          expr.resolution.kind == BindingKind::Dynamic);
+        if (!pure_target && !recursion) {
+            error(expr.loc, ErrorCode::Semantic_PureCall, pure_act_name(), expr.name);
+        }
+    }
+
+    if (target->kind == TypeKind::Object) {
+        if (target->object) {
+            const auto& params = target->object->params;
+            if (target->object->has_act && expr.args.size() > params.size()) {
+                error(expr.loc, ErrorCode::Semantic_TooManyArguments, expr.name, params.size(),
+                      expr.args.size());
+            }
+            for (size_t i = 0; i < expr.args.size() && i < params.size(); ++i) {
+                if (!is_assignable(params[i].second, expr.args[i]->type)) {
+                    error(expr.args[i]->loc, ErrorCode::Semantic_TypeMismatch,
+                          expr.args[i]->type->to_string(), params[i].first,
+                          params[i].second->to_string());
+                }
+            }
+        }
+    } else if (!target->is_proto()) {
+        error(expr.loc, ErrorCode::Semantic_NotInvocable, expr.name, target->to_string());
+    }
+    return Type::proto();
+}
+
+TypeRef TypeChecker::check_builtin_invoke(InvokeExpr& expr, const TypeRef& receiver) {
+    for (auto& arg : expr.args) check_expr(arg);
+    const std::string& name = expr.name;
+    size_t argc = expr.args.size();
+    auto arity = [&](size_t expected) {
+        if (argc > expected) {
+            error(expr.loc, ErrorCode::Semantic_TooManyArguments, name, expected, argc);
+        }
+    };
+
+    if (function_->pure) {
+        bool resizes = name == "push" || name == "pop" || name == "insert" || name == "remove";
+        bool mutates = (receiver->kind == TypeKind::Array && resizes) ||
+                       (receiver->kind == TypeKind::Assoc && name == "remove");
+        if (receiver->kind == TypeKind::Module) {
+            error(expr.loc, ErrorCode::Semantic_PureIO, pure_act_name(), receiver->name, name);
+        } else if (mutates) {
+            check_pure_mutation(*expr.receiver, expr.loc);
+        }
+    }
+
+    switch (receiver->kind) {
+        case TypeKind::Module:
+            if (receiver->name == "io") {
+                if (name == "print" || name == "print_line") return Type::nil();
+                if (name == "read_line") {
+                    arity(0);
+                    return Type::string();
+                }
+            }
+            break;
+        case TypeKind::Array:
+            if (name == "push") {
+                arity(1);
+                if (argc == 1) coerce(expr.args[0], receiver->element(), "element");
+                return Type::nil();
+            }
+            if (name == "pop") {
+                arity(0);
+                return receiver->element();
+            }
+            if (name == "insert") {
+                arity(2);
+                if (argc >= 1) coerce(expr.args[0], receiver->element(), "element");
+                if (argc >= 2 && !expr.args[1]->type->is_integer() &&
+                    !expr.args[1]->type->is_proto()) {
+                    error(expr.args[1]->loc, ErrorCode::Semantic_InvalidIndex,
+                          expr.args[1]->type->to_string(), receiver->to_string());
+                }
+                return Type::nil();
+            }
+            if (name == "remove") {
+                arity(1);
+                return receiver->element();
+            }
+            break;
+        case TypeKind::Assoc:
+            if (name == "remove") {
+                arity(1);
+                if (argc == 1) coerce(expr.args[0], receiver->key(), "key");
+                return receiver->value();
+            }
+            if (name == "has") {
+                arity(1);
+                if (argc == 1) coerce(expr.args[0], receiver->key(), "key");
+                return Type::boolean();
+            }
+            if (name == "keys") {
+                arity(0);
+                return Type::array_of(receiver->key());
+            }
+            break;
+        default:
+            break;
+    }
+    error(expr.loc, ErrorCode::Semantic_UnknownMember, receiver->to_string(), name);
+    return Type::proto();
+}
+
+TypeRef TypeChecker::check_new(NewExpr& expr) {
+    TypeRef operand = check_expr(expr.operand);
+    if (operand->kind == TypeKind::Module) {
+        error(expr.loc, ErrorCode::Semantic_InvalidUnaryOperand, "new", operand->to_string());
+        return Type::proto();
+    }
+    return operand;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+std::optional<TypeChecker::Binding> TypeChecker::lookup(const std::string& name) {
+    FunctionContext& context = *function_;
+    if (context.act) {
+        auto local = context.locals.find(name);
+        if (local != context.locals.end()) {
+            const LocalInfo& info = context.act->locals[local->second];
+            return Binding{Resolution{BindingKind::Local, local->second, info.is_set}, info.type};
+        }
+        if (context.self) {
+            auto property = context.self->properties.find(name);
+            if (property != context.self->properties.end()) {
+                // Properties are dynamically typed on read, but keep the declared type for
+                // checking stores.
+                return Binding{Resolution{BindingKind::Property, -1, property->second.is_set},
+                               property->second.type};
+            }
+        }
+        TypeRef type;
+        int upvalue = resolve_upvalue(context, name, type);
+        if (upvalue >= 0) {
+            return Binding{Resolution{BindingKind::Upvalue, upvalue, false}, type};
+        }
+    }
+    int global = globals_.find(name);
+    if (global >= 0 && globals_.at(global).declaration < visible_declarations_) {
+        const GlobalInfo& info = globals_.at(global);
+        return Binding{Resolution{BindingKind::Global, global, info.is_set}, info.type};
+    }
+    if (context.act) {
+        // Resolved at runtime against `self` and the globals (e.g. properties added with `>>`).
+        return Binding{Resolution{BindingKind::Dynamic, -1, false}, Type::proto()};
+    }
+    return std::nullopt;
+}
+
+int TypeChecker::resolve_upvalue(FunctionContext& context, const std::string& name,
+                                 TypeRef& type) {
+    auto existing = context.upvalues.find(name);
+    if (existing != context.upvalues.end()) {
+        type = context.act->upvalues[existing->second].type;
+        return existing->second;
+    }
+    FunctionContext* enclosing = context.enclosing;
+    if (!enclosing || !enclosing->act) return -1;
+
+    UpvalueInfo upvalue;
+    upvalue.name = name;
+    auto local = enclosing->locals.find(name);
+    if (local != enclosing->locals.end()) {
+        upvalue.from_local = true;
+        upvalue.index = local->second;
+        upvalue.type = enclosing->act->locals[local->second].type;
+    } else {
+        int index = resolve_upvalue(*enclosing, name, type);
+        if (index < 0) return -1;
+        upvalue.from_local = false;
+        upvalue.index = index;
+        upvalue.type = type;
+    }
+    type = upvalue.type;
+    int slot = static_cast<int>(context.act->upvalues.size());
+    context.act->upvalues.push_back(std::move(upvalue));
+    context.upvalues.emplace(name, slot);
+    return slot;
+}
+
+TypeChecker::Binding TypeChecker::declare(const std::string& name, TypeRef type, bool is_set) {
+    FunctionContext& context = *function_;
+    if (!context.act) {
+        int index = globals_.declare(name, type, is_set);
+        return Binding{Resolution{BindingKind::Global, index, is_set}, type};
+    }
+    auto existing = context.locals.find(name);
+    if (existing != context.locals.end()) {
+        // Redeclaration reuses the slot with the new type.
+        context.act->locals[existing->second] = LocalInfo{name, type, is_set};
+        return Binding{Resolution{BindingKind::Local, existing->second, is_set}, type};
+    }
+    int slot = static_cast<int>(context.act->locals.size());
+    context.act->locals.push_back(LocalInfo{name, type, is_set});
+    context.locals.emplace(name, slot);
+    return Binding{Resolution{BindingKind::Local, slot, is_set}, type};
+}
+
+bool TypeChecker::coerce(ExprPtr& expr, const TypeRef& target, const std::string& what) {
+    const TypeRef& source = expr->type;
+    if (!target || types_equal(source, target)) return true;
+
+    // Unsuffixed integer literals adapt to any numeric type they fit in.
+    if (is_untyped_int_literal(*expr) && target->is_numeric()) {
+        auto& literal = static_cast<LiteralExpr&>(*expr);
+        auto [magnitude, negative] = literal_magnitude(literal);
+        if (!integer_fits(target, magnitude, negative)) {
+            error(expr->loc, ErrorCode::Semantic_IntegerLiteralOutOfRange, literal_text(literal),
+                  target->to_string());
+            return false;
+        }
+        retype_literal(literal, target);
+        return true;
+    }
+    // Float literals may be narrowed to float32.
+    if (expr->kind == ExprKind::Literal && source->is_float() && target->is_float()) {
+        expr->type = target;
+        return true;
+    }
+
+    // Composite literals are typed by their context, element by element.
+    if (expr->kind == ExprKind::Array && target->kind == TypeKind::Array) {
+        bool ok = true;
+        for (auto& element : static_cast<ArrayExpr&>(*expr).elements) {
+            ok = coerce(element, target->element(), what) && ok;
+        }
+        expr->type = target;
+        return ok;
+    }
+    if (expr->kind == ExprKind::Tuple && target->kind == TypeKind::Tuple &&
+        static_cast<TupleExpr&>(*expr).elements.size() == target->elements.size()) {
+        bool ok = true;
+        auto& elements = static_cast<TupleExpr&>(*expr).elements;
+        for (size_t i = 0; i < elements.size(); ++i) {
+            ok = coerce(elements[i], target->elements[i], what) && ok;
+        }
+        expr->type = target;
+        return ok;
+    }
+    if (expr->kind == ExprKind::Assoc && target->kind == TypeKind::Assoc) {
+        bool ok = true;
+        auto& assoc = static_cast<AssocExpr&>(*expr);
+        for (size_t i = 0; i < assoc.keys.size(); ++i) {
+            ok = coerce(assoc.keys[i], target->key(), what) && ok;
+            ok = coerce(assoc.values[i], target->value(), what) && ok;
+        }
+        expr->type = target;
+        return ok;
+    }
+
+    if (!is_assignable(target, source)) {
+        error(expr->loc, ErrorCode::Semantic_TypeMismatch, source->to_string(), what,
+              target->to_string());
+        return false;
+    }
+    if (target->is_proto()) return true;
+    if (source->is_numeric() && target->is_numeric()) {
+        widen(expr, target);
+    } else if (source->is_proto()) {
+        SourceLocation loc = expr->loc;
+        expr = std::make_unique<CastExpr>(std::move(expr), target, CastKind::Check, loc);
+        expr->type = target;
+    }
+    return true;
+}
+
+void TypeChecker::widen(ExprPtr& expr, const TypeRef& target) {
+    if (types_equal(expr->type, target)) return;
+    if (expr->kind == ExprKind::Literal) {
+        auto& literal = static_cast<LiteralExpr&>(*expr);
+        if (std::holds_alternative<double>(literal.value)) {
+            if (target->is_float()) {
+                literal.type = target;
+                return;
+            }
+        } else {
+            auto [magnitude, negative] = literal_magnitude(literal);
+            if (integer_fits(target, magnitude, negative)) {
+                retype_literal(literal, target);
+                return;
+            }
+        }
+    }
+    SourceLocation loc = expr->loc;
+    expr = std::make_unique<CastExpr>(std::move(expr), target, CastKind::Widen, loc);
+    expr->type = target;
+}
+
+TypeRef TypeChecker::binding_type_of(const TypeRef& value_type) {
+    // A binding initialized with nil can later hold anything.
+    if (value_type->kind == TypeKind::Nil) return Type::proto();
+    return value_type;
+}
+
+void TypeChecker::check_pure_mutation(const Expr& container, const SourceLocation& loc) {
+    if (!function_->pure) return;
+    if (container.kind == ExprKind::Identifier) {
+        const auto& identifier = static_cast<const IdentifierExpr&>(container);
+        if (identifier.resolution.kind == BindingKind::Local) {
+            // Decided at the end of the act, once every binding of the local is known.
+            function_->local_mutations.emplace_back(identifier.resolution.slot, loc);
+            return;
+        }
+    }
+    error(loc, ErrorCode::Semantic_PureMutation, pure_act_name(), target_text(container));
+}
+
+void TypeChecker::note_local_binding(const Resolution& resolution, bool is_new_value) {
+    if (!function_->pure || resolution.kind != BindingKind::Local) return;
+    auto [it, inserted] = function_->owned_locals.emplace(resolution.slot, is_new_value);
+    if (!inserted) it->second = it->second && is_new_value;
+}
+
+void TypeChecker::check_pure_locals() {
+    // A local may be mutated only if every value it is ever bound to was created by
+    // the act itself; otherwise it could alias state owned by someone else.
+    for (const auto& [slot, loc] : function_->local_mutations) {
+        auto owned = function_->owned_locals.find(slot);
+        if (owned == function_->owned_locals.end() || !owned->second) {
+            error(loc, ErrorCode::Semantic_PureMutation, pure_act_name(),
+                  function_->act->locals[slot].name);
+        }
+    }
+}
+
+std::string TypeChecker::pure_act_name() const {
+    const std::string& name = function_->self->name;
+    return name.empty() ? "<anonymous>" : name;
+}
+
+bool TypeChecker::is_self_access(const Expr& expr) {
+    return expr.kind == ExprKind::Self;
+}
+
+}  // namespace core
+}  // namespace tooi
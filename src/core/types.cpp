@@ -0,0 +1,332 @@
+/**
+ * @file types.cpp
+ * @brief Implementation of the static type representation used by the type checker.
+ */
+#include "tooi/core/types.h"
+
+#include <limits>
+
+namespace tooi {
+namespace core {
+
+namespace {
+
+TypeRef make_singleton(TypeKind kind) {
+    return std::make_shared<const Type>(kind);
+}
+
+// Integer rank used for the usual arithmetic conversions.
+int integer_rank(TypeKind kind) {
+    switch (kind) {
+        case TypeKind::Byte:
+            return 0;
+        case TypeKind::Int32:
+            return 1;
+        case TypeKind::UInt32:
+            return 2;
+        case TypeKind::Int64:
+            return 3;
+        case TypeKind::UInt64:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+}  // anonymous namespace
+
+// --- Factories ---
+
+TypeRef Type::proto() {
+    static const TypeRef type = make_singleton(TypeKind::Proto);
+    return type;
+}
+
+TypeRef Type::nil() {
+    static const TypeRef type = make_singleton(TypeKind::Nil);
+    return type;
+}
+
+TypeRef Type::boolean() {
+    static const TypeRef type = make_singleton(TypeKind::Bool);
+    return type;
+}
+
+TypeRef Type::byte() {
+    static const TypeRef type = make_singleton(TypeKind::Byte);
+    return type;
+}
+
+TypeRef Type::int32() {
+    static const TypeRef type = make_singleton(TypeKind::Int32);
+    return type;
+}
+
+TypeRef Type::int64() {
+    static const TypeRef type = make_singleton(TypeKind::Int64);
+    return type;
+}
+
+TypeRef Type::uint32() {
+    static const TypeRef type = make_singleton(TypeKind::UInt32);
+    return type;
+}
+
+TypeRef Type::uint64() {
+    static const TypeRef type = make_singleton(TypeKind::UInt64);
+    return type;
+}
+
+TypeRef Type::float32() {
+    static const TypeRef type = make_singleton(TypeKind::Float32);
+    return type;
+}
+
+TypeRef Type::float64() {
+    static const TypeRef type = make_singleton(TypeKind::Float64);
+    return type;
+}
+
+TypeRef Type::string() {
+    static const TypeRef type = make_singleton(TypeKind::String);
+    return type;
+}
+
+TypeRef Type::array_of(TypeRef element) {
+    auto type = std::make_shared<Type>(TypeKind::Array);
+    type->elements.push_back(std::move(element));
+    return type;
+}
+
+TypeRef Type::tuple_of(std::vector<TypeRef> elements) {
+    auto type = std::make_shared<Type>(TypeKind::Tuple);
+    type->elements = std::move(elements);
+    return type;
+}
+
+TypeRef Type::assoc_of(TypeRef key, TypeRef value) {
+    auto type = std::make_shared<Type>(TypeKind::Assoc);
+    type->elements.push_back(std::move(key));
+    type->elements.push_back(std::move(value));
+    return type;
+}
+
+TypeRef Type::object_of(std::shared_ptr<ObjectInfo> info) {
+    auto type = std::make_shared<Type>(TypeKind::Object);
+    type->object = std::move(info);
+    return type;
+}
+
+TypeRef Type::module(std::string name) {
+    auto type = std::make_shared<Type>(TypeKind::Module);
+    type->name = std::move(name);
+    return type;
+}
+
+TypeRef Type::from_keyword(TokenType keyword) {
+    switch (keyword) {
+        case TokenType::INT:
+        case TokenType::INT32:
+            return int32();
+        case TokenType::INT64:
+            return int64();
+        case TokenType::UINT:
+        case TokenType::UINT32:
+            return uint32();
+        case TokenType::UINT64:
+            return uint64();
+        case TokenType::FLOAT:
+        case TokenType::FLOAT32:
+            return float32();
+        case TokenType::FLOAT64:
+            return float64();
+        case TokenType::BYTE:
+            return byte();
+        case TokenType::BOOL:
+            return boolean();
+        case TokenType::STRING:
+            return string();
+        case TokenType::PROTO:
+            return proto();
+        default:
+            return nullptr;
+    }
+}
+
+// --- Classification ---
+
+bool Type::is_integer() const {
+    return integer_rank(kind) >= 0;
+}
+
+int Type::bit_width() const {
+    switch (kind) {
+        case TypeKind::Byte:
+            return 8;
+        case TypeKind::Int32:
+        case TypeKind::UInt32:
+        case TypeKind::Float32:
+            return 32;
+        case TypeKind::Int64:
+        case TypeKind::UInt64:
+        case TypeKind::Float64:
+            return 64;
+        default:
+            return 0;
+    }
+}
+
+std::string Type::to_string() const {
+    switch (kind) {
+        case TypeKind::Proto:
+            return "proto";
+        case TypeKind::Nil:
+            return "nil";
+        case TypeKind::Bool:
+            return "bool";
+        case TypeKind::Byte:
+            return "byte";
+        case TypeKind::Int32:
+            return "int";
+        case TypeKind::Int64:
+            return "int64";
+        case TypeKind::UInt32:
+            return "uint";
+        case TypeKind::UInt64:
+            return "uint64";
+        case TypeKind::Float32:
+            return "float";
+        case TypeKind::Float64:
+            return "float64";
+        case TypeKind::String:
+            return "string";
+        case TypeKind::Array:
+            return "[" + element()->to_string() + "]";
+        case TypeKind::Tuple: {
+            std::string result = "(";
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (i > 0) result += ", ";
+                result += elements[i]->to_string();
+            }
+            return result + ")";
+        }
+        case TypeKind::Assoc:
+            return "[" + key()->to_string() + " -> " + value()->to_string() + "]";
+        case TypeKind::Object:
+            return (object && !object->name.empty()) ? "object " + object->name : "object";
+        case TypeKind::Module:
+            return "module " + name;
+    }
+    return "<unknown type>";
+}
+
+// --- Relations ---
+
+bool types_equal(const TypeRef& a, const TypeRef& b) {
+    if (a == b) return true;
+    if (!a || !b || a->kind != b->kind) return false;
+    switch (a->kind) {
+        case TypeKind::Array:
+        case TypeKind::Tuple:
+        case TypeKind::Assoc:
+            if (a->elements.size() != b->elements.size()) return false;
+            for (size_t i = 0; i < a->elements.size(); ++i) {
+                if (!types_equal(a->elements[i], b->elements[i])) return false;
+            }
+            return true;
+        case TypeKind::Module:
+            return a->name == b->name;
+        default:
+            return true;  // Primitive kinds and objects
+    }
+}
+
+bool is_assignable(const TypeRef& target, const TypeRef& source) {
+    if (!target || !source) return false;
+    if (target->is_proto() || source->is_proto()) return true;
+    if (types_equal(target, source)) return true;
+
+    // nil is a valid value for every reference type, never for primitives.
+    if (source->kind == TypeKind::Nil) {
+        return !target->is_primitive() && target->kind != TypeKind::Module;
+    }
+
+    // Lossless numeric widening.
+    if (target->is_integer() && source->is_integer()) {
+        int target_width = target->bit_width();
+        int source_width = source->bit_width();
+        bool source_unsigned = !source->is_signed();
+        bool target_unsigned = !target->is_signed();
+        if (source_unsigned == target_unsigned) return target_width >= source_width;
+        // unsigned -> signed needs a strictly wider target; signed -> unsigned is never lossless
+        return source_unsigned && target_width > source_width;
+    }
+    if (target->is_float() && source->is_float()) {
+        return target->bit_width() >= source->bit_width();
+    }
+    if (target->is_float() && source->is_integer()) {
+        return true;  // Integers convert implicitly to floating point
+    }
+
+    // Arrays and assoc arrays are mutable, so their element types must match
+    // exactly (types_equal above): a `[proto]` alias of an `[int]` could store
+    // strings into it. Tuples are immutable and convert element by element.
+    switch (target->kind) {
+        case TypeKind::Tuple:
+            if (source->kind != TypeKind::Tuple ||
+                source->elements.size() != target->elements.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < target->elements.size(); ++i) {
+                if (!is_assignable(target->elements[i], source->elements[i])) return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+TypeRef promote_numeric(const TypeRef& a, const TypeRef& b) {
+    if (a->is_float() || b->is_float()) {
+        if (a->kind == TypeKind::Float64 || b->kind == TypeKind::Float64) return Type::float64();
+        if (a->is_float() && b->is_float()) return Type::float32();
+        // float32 combined with a 64-bit integer would lose too much precision
+        const TypeRef& integer = a->is_float() ? b : a;
+        return integer->bit_width() == 64 ? Type::float64() : Type::float32();
+    }
+    // Arithmetic on bytes happens at int width, like C's integer promotion.
+    TypeRef lhs = a->kind == TypeKind::Byte ? Type::int32() : a;
+    TypeRef rhs = b->kind == TypeKind::Byte ? Type::int32() : b;
+    return integer_rank(lhs->kind) >= integer_rank(rhs->kind) ? lhs : rhs;
+}
+
+bool integer_fits(const TypeRef& type, uint64_t magnitude, bool negative) {
+    if (type->is_float()) return true;
+    if (negative) {
+        switch (type->kind) {
+            case TypeKind::Int32:
+                return magnitude <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) + 1;
+            case TypeKind::Int64:
+                return magnitude <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1;
+            default:
+                return magnitude == 0;
+        }
+    }
+    switch (type->kind) {
+        case TypeKind::Byte:
+            return magnitude <= std::numeric_limits<uint8_t>::max();
+        case TypeKind::Int32:
+            return magnitude <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max());
+        case TypeKind::UInt32:
+            return magnitude <= std::numeric_limits<uint32_t>::max();
+        case TypeKind::Int64:
+            return magnitude <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        case TypeKind::UInt64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace core
+}  // namespace tooi
@@ -0,0 +1,158 @@
+/**
+ * @file analysis.cpp
+ * @brief Implementation of dominator and loop analysis.
+ */
+#include "tooi/ir/analysis.h"
+
+#include <algorithm>
+
+namespace tooi {
+namespace ir {
+
+// ============================================================================
+// DominatorTree
+// ============================================================================
+
+DominatorTree::DominatorTree(const Function& function) {
+    // Postorder by iterative depth-first search.
+    std::vector<BasicBlock*> postorder;
+    std::unordered_set<const BasicBlock*> visited;
+    std::vector<std::pair<BasicBlock*, size_t>> stack;
+    stack.emplace_back(function.entry(), 0);
+    visited.insert(function.entry());
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        std::vector<BasicBlock*> successors = block->successors();
+        if (next < successors.size()) {
+            BasicBlock* successor = successors[next++];
+            if (visited.insert(successor).second) stack.emplace_back(successor, 0);
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    rpo_.assign(postorder.rbegin(), postorder.rend());
+    for (size_t i = 0; i < rpo_.size(); ++i) order_[rpo_[i]] = static_cast<int>(i);
+
+    idom_.assign(rpo_.size(), -1);
+    idom_[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (a > b) a = idom_[a];
+            while (b > a) b = idom_[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo_.size(); ++i) {
+            int new_idom = -1;
+            for (const BasicBlock* pred : rpo_[i]->predecessors) {
+                auto it = order_.find(pred);
+                if (it == order_.end() || idom_[it->second] < 0) continue;
+                new_idom = new_idom < 0 ? it->second : intersect(it->second, new_idom);
+            }
+            if (new_idom != idom_[i]) {
+                idom_[i] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    children_.assign(rpo_.size(), {});
+    for (size_t i = 1; i < rpo_.size(); ++i) children_[idom_[i]].push_back(rpo_[i]);
+}
+
+BasicBlock* DominatorTree::idom(const BasicBlock* block) const {
+    auto it = order_.find(block);
+    if (it == order_.end() || it->second == 0) return nullptr;
+    return rpo_[idom_[it->second]];
+}
+
+bool DominatorTree::dominates(const BasicBlock* a, const BasicBlock* b) const {
+    auto ia = order_.find(a);
+    auto ib = order_.find(b);
+    if (ia == order_.end() || ib == order_.end()) return false;
+    int target = ia->second;
+    int current = ib->second;
+    // Dominators precede the blocks they dominate in reverse postorder.
+    while (current > target) current = idom_[current];
+    return current == target;
+}
+
+bool DominatorTree::is_reachable(const BasicBlock* block) const {
+    return order_.count(block) != 0;
+}
+
+const std::vector<BasicBlock*>& DominatorTree::children(const BasicBlock* block) const {
+    static const std::vector<BasicBlock*> none;
+    auto it = order_.find(block);
+    return it == order_.end() ? none : children_[it->second];
+}
+
+// ============================================================================
+// Loops
+// ============================================================================
+
+std::vector<std::unique_ptr<Loop>> find_loops(const DominatorTree& dominators) {
+    std::unordered_map<const BasicBlock*, Loop*> by_header;
+    std::vector<std::unique_ptr<Loop>> loops;
+
+    for (BasicBlock* block : dominators.reverse_postorder()) {
+        for (BasicBlock* successor : block->successors()) {
+            if (!dominators.dominates(successor, block)) continue;
+            // Back edge block -> successor: collect the blocks that reach it.
+            Loop*& loop = by_header[successor];
+            if (!loop) {
+                loops.push_back(std::make_unique<Loop>());
+                loop = loops.back().get();
+                loop->header = successor;
+                loop->members.insert(successor);
+            }
+            std::vector<BasicBlock*> worklist{block};
+            while (!worklist.empty()) {
+                BasicBlock* current = worklist.back();
+                worklist.pop_back();
+                if (!loop->members.insert(current).second) continue;
+                for (BasicBlock* pred : current->predecessors) {
+                    if (dominators.is_reachable(pred)) worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    for (auto& loop : loops) {
+        for (BasicBlock* block : dominators.reverse_postorder()) {
+            if (loop->contains(block)) loop->blocks.push_back(block);
+        }
+        BasicBlock* outside = nullptr;
+        int outside_count = 0;
+        for (BasicBlock* pred : loop->header->predecessors) {
+            if (!loop->contains(pred)) {
+                outside = pred;
+                outside_count++;
+            }
+        }
+        if (outside_count == 1 && outside->successors().size() == 1) loop->preheader = outside;
+    }
+
+    // Innermost first: a loop nested in another has fewer blocks.
+    std::sort(loops.begin(), loops.end(),
+              [](const auto& a, const auto& b) { return a->blocks.size() < b->blocks.size(); });
+    for (size_t i = 0; i < loops.size(); ++i) {
+        for (size_t j = i + 1; j < loops.size(); ++j) {
+            if (loops[j]->contains(loops[i]->header)) {
+                loops[i]->parent = loops[j].get();
+                break;
+            }
+        }
+    }
+    for (auto& loop : loops) {
+        for (Loop* parent = loop->parent; parent; parent = parent->parent) loop->depth++;
+    }
+    return loops;
+}
+
+}  // namespace ir
+}  // namespace tooi
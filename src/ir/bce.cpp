@@ -0,0 +1,183 @@
+/**
+ * @file bce.cpp
+ * @brief Bounds-check elimination for sequence element accesses.
+ */
+#include <unordered_set>
+
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+namespace {
+
+const Instruction* strip_widening(const Instruction* value) {
+    while (value->op == Opcode::Convert && value->cast_kind == core::CastKind::Widen) {
+        value = value->operands[0];
+    }
+    return value;
+}
+
+// True if the integer value can never be negative. Values on a cycle are
+// assumed non-negative while they are being examined: induction variables
+// only grow by non-negative steps, and overflow traps instead of wrapping.
+bool is_non_negative(const Instruction* value, std::unordered_set<const Instruction*>& visiting) {
+    if (value->type && value->type->is_integer() && !value->type->is_signed()) return true;
+    switch (value->op) {
+        case Opcode::Const:
+            if (const int64_t* v = std::get_if<int64_t>(&value->constant)) return *v >= 0;
+            return std::holds_alternative<uint64_t>(value->constant);
+        case Opcode::Length:
+            return true;
+        case Opcode::Convert:
+            return value->cast_kind == core::CastKind::Widen &&
+                   is_non_negative(value->operands[0], visiting);
+        case Opcode::Add:
+        case Opcode::Mul:
+        case Opcode::Phi: {
+            if (!visiting.insert(value).second) return true;
+            for (const Instruction* operand : value->operands) {
+                if (!is_non_negative(operand, visiting)) return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// If the branch condition proves `index < length(sequence)` on one edge,
+// returns the target of that edge and the compared length.
+BasicBlock* in_bounds_target(const Instruction& branch, const Instruction* sequence,
+                             const Instruction* index, const Instruction** length) {
+    const Instruction* condition = branch.operands[0];
+    if (condition->operands.size() != 2) return nullptr;
+    const Instruction* left = strip_widening(condition->operands[0]);
+    const Instruction* right = strip_widening(condition->operands[1]);
+    auto is_length = [&](const Instruction* value) {
+        if (value->op != Opcode::Length || value->operands[0] != sequence) return false;
+        *length = value;
+        return true;
+    };
+    switch (condition->op) {
+        case Opcode::Lt:  // index < length
+            return left == index && is_length(right) ? branch.targets[0] : nullptr;
+        case Opcode::Gt:  // length > index
+            return right == index && is_length(left) ? branch.targets[0] : nullptr;
+        case Opcode::Ge:  // index >= length
+            return left == index && is_length(right) ? branch.targets[1] : nullptr;
+        case Opcode::Le:  // length <= index
+            return right == index && is_length(left) ? branch.targets[1] : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+bool is_call(const Instruction& instruction) {
+    return instruction.op == Opcode::Invoke || instruction.op == Opcode::CallMethod;
+}
+
+// True if a call can run on some path from `from` (just after `after`) to `to`
+// (just before `before`), which could change the length of a mutable array.
+bool call_between(const Instruction* after, const Instruction* before) {
+    BasicBlock* from = after->block;
+    BasicBlock* to = before->block;
+    if (from == to && from->position_of(after) < from->position_of(before)) {
+        for (size_t i = from->position_of(after) + 1; i < from->position_of(before); ++i) {
+            if (is_call(*from->instructions[i])) return true;
+        }
+        return false;
+    }
+
+    // Blocks on a path from `from` to `to`: reachable forward from `from`'s
+    // successors and backward from `to`'s predecessors.
+    std::unordered_set<const BasicBlock*> forward;
+    std::vector<BasicBlock*> worklist = from->successors();
+    while (!worklist.empty()) {
+        BasicBlock* block = worklist.back();
+        worklist.pop_back();
+        if (!forward.insert(block).second) continue;
+        for (BasicBlock* successor : block->successors()) worklist.push_back(successor);
+    }
+    std::unordered_set<const BasicBlock*> backward;
+    worklist = to->predecessors;
+    while (!worklist.empty()) {
+        BasicBlock* block = worklist.back();
+        worklist.pop_back();
+        if (!backward.insert(block).second) continue;
+        for (BasicBlock* pred : block->predecessors) worklist.push_back(pred);
+    }
+
+    for (const BasicBlock* block : forward) {
+        if (!backward.count(block) || block == from || block == to) continue;
+        for (const auto& instruction : block->instructions) {
+            if (is_call(*instruction)) return true;
+        }
+    }
+    // The tail of `from` and the head of `to`. If either lies on a cycle
+    // through the other blocks, it is covered in full.
+    bool from_on_path = forward.count(from) && backward.count(from);
+    bool to_on_path = forward.count(to) && backward.count(to);
+    bool seen = false;
+    for (const auto& instruction : from->instructions) {
+        if ((seen || from_on_path) && is_call(*instruction)) return true;
+        if (instruction.get() == after) seen = true;
+    }
+    for (const auto& instruction : to->instructions) {
+        if (!to_on_path && instruction.get() == before) break;
+        if (is_call(*instruction)) return true;
+    }
+    return false;
+}
+
+bool is_proven_in_bounds(const Instruction& access, const DominatorTree& dominators) {
+    const Instruction* sequence = access.operands[0];
+    const Instruction* index = access.operands[1];
+    core::TypeKind kind = sequence->type->kind;
+    bool immutable = kind == core::TypeKind::String || kind == core::TypeKind::Tuple;
+    if (kind != core::TypeKind::Array && !immutable) return false;
+    if (!index->type->is_integer()) return false;
+    std::unordered_set<const Instruction*> visiting;
+    if (!is_non_negative(strip_widening(index), visiting)) return false;
+
+    index = strip_widening(index);
+    for (BasicBlock* block = dominators.idom(access.block); block;
+         block = dominators.idom(block)) {
+        const Instruction* branch = block->terminator();
+        if (!branch || branch->op != Opcode::Branch) continue;
+        const Instruction* length = nullptr;
+        BasicBlock* target = in_bounds_target(*branch, sequence, index, &length);
+        // The edge must be the only way into the region that contains the access.
+        if (!target || target->predecessors.size() != 1 ||
+            !dominators.dominates(target, access.block)) {
+            continue;
+        }
+        if (immutable) return true;
+        if (!call_between(length, &access)) return true;
+    }
+    return false;
+}
+
+}  // anonymous namespace
+
+int eliminate_bounds_checks(Function& function) {
+    DominatorTree dominators(function);
+    int removed = 0;
+    for (BasicBlock* block : dominators.reverse_postorder()) {
+        for (auto& instruction : block->instructions) {
+            if ((instruction->op != Opcode::Index && instruction->op != Opcode::SetIndex) ||
+                !instruction->bounds_check) {
+                continue;
+            }
+            if (is_proven_in_bounds(*instruction, dominators)) {
+                instruction->bounds_check = false;
+                removed++;
+            }
+        }
+    }
+    return removed;
+}
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,1038 @@
+/**
+ * @file builder.cpp
+ * @brief Implementation of the AST to SSA lowering.
+ */
+#include "tooi/ir/builder.h"
+
+#include <cassert>
+
+namespace tooi {
+namespace ir {
+
+using core::BindingKind;
+using core::ExprKind;
+using core::SourceLocation;
+using core::StmtKind;
+using core::TokenType;
+using core::Type;
+using core::TypeKind;
+using core::TypeRef;
+
+namespace {
+
+// The zero value a binding of the given type starts with.
+core::LiteralValue zero_of(const TypeRef& type) {
+    if (type->kind == TypeKind::Bool) return false;
+    if (type->is_float()) return 0.0;
+    if (type->is_integer()) {
+        return type->is_signed() ? core::LiteralValue{int64_t{0}} : core::LiteralValue{uint64_t{0}};
+    }
+    return std::monostate{};
+}
+
+// Position after the phis (and, in the entry block, the params) of a block.
+size_t first_non_phi(const BasicBlock* block) {
+    size_t position = 0;
+    while (position < block->instructions.size() &&
+           (block->instructions[position]->op == Opcode::Phi ||
+            block->instructions[position]->op == Opcode::Param)) {
+        position++;
+    }
+    return position;
+}
+
+Opcode binary_opcode(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS:
+            return Opcode::Add;
+        case TokenType::MINUS:
+            return Opcode::Sub;
+        case TokenType::ASTERISK:
+            return Opcode::Mul;
+        case TokenType::SLASH:
+            return Opcode::Div;
+        case TokenType::PERCENT:
+            return Opcode::Mod;
+        case TokenType::EQUAL_EQUAL:
+            return Opcode::Eq;
+        case TokenType::BANG_EQUAL:
+            return Opcode::Ne;
+        case TokenType::LESS:
+            return Opcode::Lt;
+        case TokenType::LESS_EQUAL:
+            return Opcode::Le;
+        case TokenType::GREATER:
+            return Opcode::Gt;
+        default:
+            return Opcode::Ge;
+    }
+}
+
+bool is_builtin_receiver(const TypeRef& type) {
+    return type->kind != TypeKind::Object && !type->is_proto();
+}
+
+}  // anonymous namespace
+
+Builder::Builder(const core::GlobalTable& globals) : globals_(globals) {}
+
+// ============================================================================
+// Functions
+// ============================================================================
+
+std::unique_ptr<Module> Builder::build(const core::Program& program) {
+    auto module = std::make_unique<Module>();
+    module_ = module.get();
+
+    FunctionState state;
+    state.function = module->create_function("<script>");
+    state.function->is_script = true;
+    state_ = &state;
+
+    scan_block(program.statements);
+    state.current = new_block();
+    seal_block(state.current);
+    lower_block(program.statements);
+    finish_function();
+
+    state_ = nullptr;
+    module_ = nullptr;
+    return module;
+}
+
+Function* Builder::build_act(const core::ObjectExpr& object, const std::string& name) {
+    const core::ActDecl& act = *object.act;
+    Function* function = module_->create_function(name.empty() ? "<act>" : name);
+    function->decl = &act;
+    function->param_count = act.param_count;
+    function->upvalue_count = static_cast<int>(act.upvalues.size());
+    // A deferred body stays without blocks until build_deferred().
+    if (act.deferred) return function;
+
+    // Params keep the type they were declared with, even if the body redeclares them.
+    const core::ObjectInfo* info = object.type ? object.type->object.get() : nullptr;
+    // The checker verified the body against the object's purity, which `@` does not change.
+    function->is_pure = info ? info->is_pure : object.is_pure;
+    build_body(*function, info);
+    return function;
+}
+
+void Builder::build_deferred(Module& module, Function& function) {
+    module_ = &module;
+    // Deferred acts are never pure; see core::Parser.
+    build_body(function, function.decl->deferred->self.get());
+    module_ = nullptr;
+}
+
+void Builder::build_body(Function& function, const core::ObjectInfo* info) {
+    const core::ActDecl& act = *function.decl;
+    FunctionState state;
+    state.function = &function;
+    state.act = &act;
+    FunctionState* enclosing = state_;
+    state_ = &state;
+
+    std::vector<TypeRef> param_types;
+    for (int i = 0; i < act.param_count; ++i) {
+        bool known = info && i < static_cast<int>(info->params.size());
+        param_types.push_back(known ? info->params[i].second : Type::proto());
+        scan_binding(core::Resolution{BindingKind::Local, i, false}, param_types.back());
+    }
+    scan_block(act.body);
+
+    state.current = new_block();
+    seal_block(state.current);
+    for (int i = 0; i < act.param_count; ++i) {
+        Instruction* param = emit(Opcode::Param, param_types[i], act.loc);
+        param->index = i;
+        write_variable(VarKey{VarKey::Kind::Local, i}, state.current, param);
+    }
+    lower_block(act.body);
+    finish_function();
+
+    state_ = enclosing;
+}
+
+void Builder::finish_function() {
+    if (!state_->current->terminator()) {
+        Instruction* nil = constant(std::monostate{}, Type::nil(), {});
+        emit(Opcode::Return, nullptr, {}, {nil});
+    }
+    assert(state_->incomplete_phis.empty());
+}
+
+// Records the globals a function uses and the type(s) each variable is used with.
+void Builder::scan_block(const std::vector<core::StmtPtr>& statements) {
+    for (const auto& stmt : statements) scan_statement(*stmt);
+}
+
+void Builder::scan_statement(const core::Stmt& stmt) {
+    switch (stmt.kind) {
+        case StmtKind::Add: {
+            const auto& add = static_cast<const core::AddStmt&>(stmt);
+            scan_binding(add.resolution, Type::module(add.module));
+            break;
+        }
+        case StmtKind::Bind: {
+            const auto& bind = static_cast<const core::BindStmt&>(stmt);
+            if (bind.target->kind == ExprKind::Identifier) {
+                const auto& target = static_cast<const core::IdentifierExpr&>(*bind.target);
+                scan_binding(target.resolution, bind.binding_type);
+            } else {
+                scan_expr(*bind.target);
+            }
+            if (bind.value) scan_expr(*bind.value);
+            break;
+        }
+        case StmtKind::Expression:
+            scan_expr(*static_cast<const core::ExpressionStmt&>(stmt).expr);
+            break;
+        case StmtKind::Block:
+            scan_block(static_cast<const core::BlockStmt&>(stmt).statements);
+            break;
+        case StmtKind::If: {
+            const auto& if_stmt = static_cast<const core::IfStmt&>(stmt);
+            scan_expr(*if_stmt.condition);
+            scan_statement(*if_stmt.then_branch);
+            if (if_stmt.else_branch) scan_statement(*if_stmt.else_branch);
+            break;
+        }
+        case StmtKind::While: {
+            const auto& while_stmt = static_cast<const core::WhileStmt&>(stmt);
+            scan_expr(*while_stmt.condition);
+            scan_statement(*while_stmt.body);
+            break;
+        }
+        case StmtKind::For: {
+            const auto& for_stmt = static_cast<const core::ForStmt&>(stmt);
+            scan_expr(*for_stmt.iterable);
+            scan_binding(for_stmt.resolution, for_stmt.variable_type);
+            scan_statement(*for_stmt.body);
+            break;
+        }
+        case StmtKind::Be: {
+            const auto& be = static_cast<const core::BeStmt&>(stmt);
+            if (be.value) scan_expr(*be.value);
+            break;
+        }
+        case StmtKind::Done:
+        case StmtKind::Skip:
+            break;
+    }
+}
+
+void Builder::scan_expr(const core::Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::Identifier: {
+            const auto& identifier = static_cast<const core::IdentifierExpr&>(expr);
+            scan_binding(identifier.resolution, expr.type);
+            break;
+        }
+        case ExprKind::Unary:
+            scan_expr(*static_cast<const core::UnaryExpr&>(expr).operand);
+            break;
+        case ExprKind::Binary: {
+            const auto& binary = static_cast<const core::BinaryExpr&>(expr);
+            scan_expr(*binary.left);
+            scan_expr(*binary.right);
+            break;
+        }
+        case ExprKind::Logical: {
+            const auto& logical = static_cast<const core::LogicalExpr&>(expr);
+            scan_expr(*logical.left);
+            scan_expr(*logical.right);
+            break;
+        }
+        case ExprKind::Cast:
+            scan_expr(*static_cast<const core::CastExpr&>(expr).operand);
+            break;
+        case ExprKind::Array:
+            for (const auto& element : static_cast<const core::ArrayExpr&>(expr).elements) {
+                scan_expr(*element);
+            }
+            break;
+        case ExprKind::Tuple:
+            for (const auto& element : static_cast<const core::TupleExpr&>(expr).elements) {
+                scan_expr(*element);
+            }
+            break;
+        case ExprKind::Assoc: {
+            const auto& assoc = static_cast<const core::AssocExpr&>(expr);
+            for (size_t i = 0; i < assoc.keys.size(); ++i) {
+                scan_expr(*assoc.keys[i]);
+                scan_expr(*assoc.values[i]);
+            }
+            break;
+        }
+        case ExprKind::Index: {
+            const auto& index = static_cast<const core::IndexExpr&>(expr);
+            scan_expr(*index.object);
+            scan_expr(*index.index);
+            break;
+        }
+        case ExprKind::Property:
+            scan_expr(*static_cast<const core::PropertyExpr&>(expr).object);
+            break;
+        case ExprKind::Invoke: {
+            const auto& invoke = static_cast<const core::InvokeExpr&>(expr);
+            if (invoke.receiver) {
+                scan_expr(*invoke.receiver);
+            } else if (invoke.resolution.kind == BindingKind::Global) {
+                state_->globals_used.insert(invoke.resolution.slot);
+            }
+            for (const auto& arg : invoke.args) scan_expr(*arg);
+            break;
+        }
+        case ExprKind::New:
+            scan_expr(*static_cast<const core::NewExpr&>(expr).operand);
+            break;
+        case ExprKind::Object:
+            // Act bodies become functions of their own; only initializers run here.
+            for (const auto& entry : static_cast<const core::ObjectExpr&>(expr).mode) {
+                if (entry.value) scan_expr(*entry.value);
+            }
+            break;
+        case ExprKind::Literal:
+        case ExprKind::Self:
+            break;
+    }
+}
+
+void Builder::scan_binding(const core::Resolution& resolution, const TypeRef& type) {
+    VarKey key;
+    if (resolution.kind == BindingKind::Local) {
+        key = VarKey{VarKey::Kind::Local, resolution.slot};
+    } else if (resolution.kind == BindingKind::Global) {
+        key = VarKey{VarKey::Kind::Global, resolution.slot};
+        state_->globals_used.insert(resolution.slot);
+    } else {
+        return;
+    }
+    // A slot redeclared with another type can hold either, so merges must be dynamic.
+    auto [it, inserted] = state_->types.emplace(key, type);
+    if (!inserted && !core::types_equal(it->second, type)) it->second = Type::proto();
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+void Builder::lower_block(const std::vector<core::StmtPtr>& statements) {
+    for (const auto& stmt : statements) lower_statement(*stmt);
+}
+
+void Builder::lower_statement(const core::Stmt& stmt) {
+    switch (stmt.kind) {
+        case StmtKind::Add: {
+            const auto& add = static_cast<const core::AddStmt&>(stmt);
+            Instruction* module = emit(Opcode::AddModule, Type::module(add.module), stmt.loc);
+            module->name = add.module;
+            assign(add.resolution, add.module, module, stmt.loc);
+            break;
+        }
+        case StmtKind::Bind:
+            lower_bind(static_cast<const core::BindStmt&>(stmt));
+            break;
+        case StmtKind::Expression:
+            lower_expr(*static_cast<const core::ExpressionStmt&>(stmt).expr);
+            break;
+        case StmtKind::Block:
+            lower_block(static_cast<const core::BlockStmt&>(stmt).statements);
+            break;
+        case StmtKind::If:
+            lower_if(static_cast<const core::IfStmt&>(stmt));
+            break;
+        case StmtKind::While:
+            lower_while(static_cast<const core::WhileStmt&>(stmt));
+            break;
+        case StmtKind::For:
+            lower_for(static_cast<const core::ForStmt&>(stmt));
+            break;
+        case StmtKind::Done:
+            lower_jump_statement(state_->loops.back().break_target);
+            break;
+        case StmtKind::Skip:
+            lower_jump_statement(state_->loops.back().continue_target);
+            break;
+        case StmtKind::Be: {
+            const auto& be = static_cast<const core::BeStmt&>(stmt);
+            Instruction* value = be.value ? lower_expr(*be.value)
+                                          : constant(std::monostate{}, Type::nil(), stmt.loc);
+            emit(Opcode::Return, nullptr, stmt.loc, {value});
+            state_->current = new_block();
+            seal_block(state_->current);
+            break;
+        }
+    }
+}
+
+void Builder::lower_bind(const core::BindStmt& stmt) {
+    SourceLocation loc = stmt.loc;
+    if (stmt.target->kind == ExprKind::Identifier) {
+        const auto& target = static_cast<const core::IdentifierExpr&>(*stmt.target);
+        const core::Resolution& resolution = target.resolution;
+        switch (stmt.op) {
+            case core::BindOp::Declare:
+                if (stmt.declares) {
+                    assign(resolution, target.name, default_value(stmt.binding_type, loc), loc);
+                }
+                break;
+            case core::BindOp::Assign:
+            case core::BindOp::Compound:
+                assign(resolution, target.name, lower_expr(*stmt.value), loc);
+                break;
+            case core::BindOp::Define:
+                assign(resolution, target.name,
+                       lower_object(static_cast<const core::ObjectExpr&>(*stmt.value), target.name),
+                       loc);
+                break;
+            case core::BindOp::Append: {
+                Instruction* object = read_binding(resolution, target.name, stmt.binding_type, loc);
+                lower_mode_entries(object, static_cast<const core::ObjectExpr&>(*stmt.value));
+                break;
+            }
+            case core::BindOp::Act: {
+                const auto& object = static_cast<const core::ObjectExpr&>(*stmt.value);
+                if (stmt.declares) {
+                    assign(resolution, target.name, lower_object(object, target.name), loc);
+                } else {
+                    Instruction* current =
+                        read_binding(resolution, target.name, stmt.binding_type, loc);
+                    emit(Opcode::SetAct, nullptr, loc, {current, make_act(object, target.name)});
+                }
+                break;
+            }
+        }
+        return;
+    }
+
+    // Member targets: evaluate the container (and index), then the value.
+    Instruction* container;
+    Instruction* index = nullptr;
+    std::string name;
+    if (stmt.target->kind == ExprKind::Property) {
+        const auto& property = static_cast<const core::PropertyExpr&>(*stmt.target);
+        container = lower_expr(*property.object);
+        name = property.name;
+    } else {
+        const auto& index_expr = static_cast<const core::IndexExpr&>(*stmt.target);
+        container = lower_expr(*index_expr.object);
+        index = lower_expr(*index_expr.index);
+        name = "element";
+    }
+    auto store = [&](Instruction* value) {
+        if (index) {
+            emit(Opcode::SetIndex, nullptr, loc, {container, index, value});
+        } else {
+            emit(Opcode::SetProp, nullptr, loc, {container, value})->name = name;
+        }
+    };
+    auto load = [&]() {
+        if (index) return emit(Opcode::Index, Type::proto(), loc, {container, index});
+        Instruction* value = emit(Opcode::GetProp, Type::proto(), loc, {container});
+        value->name = name;
+        return value;
+    };
+    switch (stmt.op) {
+        case core::BindOp::Declare:
+            break;
+        case core::BindOp::Assign:
+        case core::BindOp::Compound:
+            store(lower_expr(*stmt.value));
+            break;
+        case core::BindOp::Define:
+            store(lower_object(static_cast<const core::ObjectExpr&>(*stmt.value), name));
+            break;
+        case core::BindOp::Append:
+            lower_mode_entries(load(), static_cast<const core::ObjectExpr&>(*stmt.value));
+            break;
+        case core::BindOp::Act: {
+            Instruction* current = load();
+            emit(Opcode::SetAct, nullptr, loc,
+                 {current, make_act(static_cast<const core::ObjectExpr&>(*stmt.value), name)});
+            break;
+        }
+    }
+}
+
+void Builder::lower_if(const core::IfStmt& stmt) {
+    Instruction* condition = lower_condition(*stmt.condition);
+    BasicBlock* then_block = new_block();
+    BasicBlock* else_block = stmt.else_branch ? new_block() : nullptr;
+    BasicBlock* merge = new_block();
+    branch(condition, then_block, else_block ? else_block : merge);
+    seal_block(then_block);
+
+    state_->current = then_block;
+    lower_statement(*stmt.then_branch);
+    jump(merge);
+
+    if (else_block) {
+        seal_block(else_block);
+        state_->current = else_block;
+        lower_statement(*stmt.else_branch);
+        jump(merge);
+    }
+    seal_block(merge);
+    state_->current = merge;
+}
+
+void Builder::lower_while(const core::WhileStmt& stmt) {
+    BasicBlock* header = new_block();
+    jump(header);
+    state_->current = header;
+    Instruction* condition = lower_condition(*stmt.condition);
+    BasicBlock* body = new_block();
+    BasicBlock* exit = new_block();
+    branch(condition, body, exit);
+    seal_block(body);
+
+    state_->current = body;
+    state_->loops.push_back(LoopTargets{exit, header});
+    lower_statement(*stmt.body);
+    state_->loops.pop_back();
+    jump(header);
+
+    seal_block(header);
+    seal_block(exit);
+    state_->current = exit;
+}
+
+void Builder::lower_for(const core::ForStmt& stmt) {
+    SourceLocation loc = stmt.loc;
+    Instruction* sequence = lower_expr(*stmt.iterable);
+    const TypeRef& iterable = stmt.iterable->type;
+    if (iterable->kind == TypeKind::Assoc) {
+        Instruction* keys =
+            emit(Opcode::CallMethod, Type::array_of(iterable->key()), loc, {sequence});
+        keys->name = "keys";
+        sequence = keys;
+    } else if (iterable->is_proto()) {
+        sequence = emit(Opcode::IterSource, Type::proto(), loc, {sequence});
+    }
+
+    // A hidden int counter walks the sequence: for (i = 0; i < length; i + 1).
+    VarKey counter{VarKey::Kind::Temp, state_->next_temp++};
+    write_variable(counter, state_->current, constant(int64_t{0}, Type::int32(), loc));
+
+    BasicBlock* header = new_block();
+    jump(header);
+    state_->current = header;
+    Instruction* i = read(counter, nullptr);
+    Instruction* length = emit(Opcode::Length, Type::int32(), loc, {sequence});
+    Instruction* condition = emit(Opcode::Lt, Type::boolean(), loc, {i, length});
+    BasicBlock* body = new_block();
+    BasicBlock* latch = new_block();
+    BasicBlock* exit = new_block();
+    branch(condition, body, exit);
+    seal_block(body);
+
+    state_->current = body;
+    Instruction* item = emit(Opcode::Index, stmt.variable_type, loc, {sequence, i});
+    assign(stmt.resolution, stmt.variable, item, loc);
+    state_->loops.push_back(LoopTargets{exit, latch});
+    lower_statement(*stmt.body);
+    state_->loops.pop_back();
+    jump(latch);
+
+    seal_block(latch);
+    state_->current = latch;
+    Instruction* one = constant(int64_t{1}, Type::int32(), loc);
+    Instruction* next = emit(Opcode::Add, Type::int32(), loc, {read(counter, nullptr), one});
+    write_variable(counter, latch, next);
+    jump(header);
+
+    seal_block(header);
+    seal_block(exit);
+    state_->current = exit;
+}
+
+void Builder::lower_jump_statement(BasicBlock* target) {
+    jump(target);
+    // Code after done/skip/be is unreachable; it goes to a block without predecessors.
+    state_->current = new_block();
+    seal_block(state_->current);
+}
+
+// ============================================================================
+// Objects
+// ============================================================================
+
+Instruction* Builder::lower_object(const core::ObjectExpr& object, const std::string& name) {
+    Instruction* result = emit(Opcode::NewObject, object.type, object.loc);
+    result->name = name;
+    lower_mode_entries(result, object);
+    if (object.act) emit(Opcode::SetAct, nullptr, object.loc, {result, make_act(object, name)});
+    return result;
+}
+
+void Builder::lower_mode_entries(Instruction* object, const core::ObjectExpr& expr) {
+    for (const auto& entry : expr.mode) {
+        if (entry.kind != core::ModeEntry::Kind::Property) continue;  // Params: see make_act
+        Instruction* value;
+        if (!entry.value) {
+            value = default_value(entry.declared_type ? entry.declared_type : Type::proto(),
+                                  entry.loc);
+        } else if (entry.value->kind == ExprKind::Object) {
+            value = lower_object(static_cast<const core::ObjectExpr&>(*entry.value), entry.name);
+        } else {
+            value = lower_expr(*entry.value);
+        }
+        Instruction* define = emit(Opcode::DefineProp, nullptr, entry.loc, {object, value});
+        define->name = entry.name;
+        define->is_set = entry.is_set;
+        define->is_private = entry.is_private;
+        define->property_type = entry.type;
+    }
+}
+
+Instruction* Builder::make_act(const core::ObjectExpr& object, const std::string& name) {
+    Function* function = build_act(object, name);
+    const core::ActDecl& act = *object.act;
+
+    std::vector<Instruction*> operands;
+    for (const auto& upvalue : act.upvalues) {
+        if (upvalue.from_local) {
+            operands.push_back(read(VarKey{VarKey::Kind::Local, upvalue.index}, upvalue.type));
+        } else {
+            Instruction* value = emit(Opcode::Upvalue, upvalue.type, object.loc);
+            value->index = upvalue.index;
+            operands.push_back(value);
+        }
+    }
+    // Param defaults belong to the act: `@` on an existing object starts from zero values.
+    const core::ObjectInfo* info = object.type ? object.type->object.get() : nullptr;
+    for (int i = 0; i < act.param_count; ++i) {
+        const auto& [param_name, param_type] = info->params[i];
+        const core::ModeEntry* declaration = nullptr;
+        for (const auto& entry : object.mode) {
+            if (entry.kind == core::ModeEntry::Kind::Param && entry.name == param_name) {
+                declaration = &entry;
+            }
+        }
+        if (declaration && declaration->value) {
+            const core::Expr& value = *declaration->value;
+            operands.push_back(value.kind == ExprKind::Object
+                                   ? lower_object(static_cast<const core::ObjectExpr&>(value),
+                                                  param_name)
+                                   : lower_expr(value));
+        } else {
+            operands.push_back(default_value(param_type, object.loc));
+        }
+    }
+    Instruction* closure = emit(Opcode::MakeAct, Type::proto(), object.loc, operands);
+    closure->index = function->index;
+    return closure;
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+Instruction* Builder::lower_expr(const core::Expr& expr) {
+    SourceLocation loc = expr.loc;
+    switch (expr.kind) {
+        case ExprKind::Literal:
+            return constant(static_cast<const core::LiteralExpr&>(expr).value, expr.type, loc);
+        case ExprKind::Identifier: {
+            const auto& identifier = static_cast<const core::IdentifierExpr&>(expr);
+            return read_binding(identifier.resolution, identifier.name, expr.type, loc);
+        }
+        case ExprKind::Self:
+            return emit(Opcode::Self, expr.type, loc);
+        case ExprKind::Unary: {
+            const auto& unary = static_cast<const core::UnaryExpr&>(expr);
+            if (unary.op == TokenType::MINUS) {
+                return emit(Opcode::Neg, expr.type, loc, {lower_expr(*unary.operand)});
+            }
+            return emit(Opcode::Not, Type::boolean(), loc, {lower_condition(*unary.operand)});
+        }
+        case ExprKind::Binary: {
+            const auto& binary = static_cast<const core::BinaryExpr&>(expr);
+            Instruction* left = lower_expr(*binary.left);
+            Instruction* right = lower_expr(*binary.right);
+            Opcode op = binary.op == TokenType::PLUS && expr.type->kind == TypeKind::String
+                            ? Opcode::Concat
+                            : binary_opcode(binary.op);
+            return emit(op, expr.type, loc, {left, right});
+        }
+        case ExprKind::Logical:
+            return lower_logical(static_cast<const core::LogicalExpr&>(expr));
+        case ExprKind::Cast: {
+            const auto& cast = static_cast<const core::CastExpr&>(expr);
+            Instruction* operand = lower_expr(*cast.operand);
+            if (core::types_equal(operand->type, cast.target)) return operand;
+            Instruction* converted = emit(Opcode::Convert, cast.target, loc, {operand});
+            converted->cast_kind = cast.cast_kind;
+            return converted;
+        }
+        case ExprKind::Array: {
+            std::vector<Instruction*> elements;
+            for (const auto& element : static_cast<const core::ArrayExpr&>(expr).elements) {
+                elements.push_back(lower_expr(*element));
+            }
+            return emit(Opcode::NewArray, expr.type, loc, elements);
+        }
+        case ExprKind::Tuple: {
+            std::vector<Instruction*> elements;
+            for (const auto& element : static_cast<const core::TupleExpr&>(expr).elements) {
+                elements.push_back(lower_expr(*element));
+            }
+            return emit(Opcode::NewTuple, expr.type, loc, elements);
+        }
+        case ExprKind::Assoc: {
+            const auto& assoc = static_cast<const core::AssocExpr&>(expr);
+            std::vector<Instruction*> entries;
+            for (size_t i = 0; i < assoc.keys.size(); ++i) {
+                entries.push_back(lower_expr(*assoc.keys[i]));
+                entries.push_back(lower_expr(*assoc.values[i]));
+            }
+            return emit(Opcode::NewAssoc, expr.type, loc, entries);
+        }
+        case ExprKind::Index: {
+            const auto& index = static_cast<const core::IndexExpr&>(expr);
+            Instruction* object = lower_expr(*index.object);
+            Instruction* position = lower_expr(*index.index);
+            return emit(Opcode::Index, expr.type, loc, {object, position});
+        }
+        case ExprKind::Property: {
+            const auto& property = static_cast<const core::PropertyExpr&>(expr);
+            Instruction* object = lower_expr(*property.object);
+            if (property.name == "length" && is_builtin_receiver(object->type)) {
+                return emit(Opcode::Length, Type::int32(), loc, {object});
+            }
+            Instruction* value = emit(Opcode::GetProp, expr.type, loc, {object});
+            value->name = property.name;
+            return value;
+        }
+        case ExprKind::Invoke:
+            return lower_invoke(static_cast<const core::InvokeExpr&>(expr));
+        case ExprKind::New: {
+            Instruction* operand = lower_expr(*static_cast<const core::NewExpr&>(expr).operand);
+            return emit(Opcode::CloneObject, expr.type, loc, {operand});
+        }
+        case ExprKind::Object:
+            return lower_object(static_cast<const core::ObjectExpr&>(expr), "");
+    }
+    return nullptr;
+}
+
+Instruction* Builder::lower_condition(const core::Expr& expr) {
+    Instruction* value = lower_expr(expr);
+    if (value->type->kind == TypeKind::Bool) return value;
+    return emit(Opcode::Truthy, Type::boolean(), expr.loc, {value});
+}
+
+Instruction* Builder::lower_logical(const core::LogicalExpr& expr) {
+    bool is_and = expr.op == TokenType::AND;
+    Instruction* left = lower_condition(*expr.left);
+    BasicBlock* left_end = state_->current;
+    BasicBlock* right_block = new_block();
+    BasicBlock* merge = new_block();
+    if (is_and) {
+        branch(left, right_block, merge);
+    } else {
+        branch(left, merge, right_block);
+    }
+    seal_block(right_block);
+
+    state_->current = right_block;
+    Instruction* right = lower_condition(*expr.right);
+    BasicBlock* right_end = state_->current;
+    jump(merge);
+    seal_block(merge);
+    state_->current = merge;
+
+    // Leaving early, the result is the left operand itself (false for and, true for or).
+    auto phi = state_->function->create(Opcode::Phi, Type::boolean(), expr.loc);
+    Instruction* result = merge->insert(0, std::move(phi));
+    result->add_operand(left);
+    result->incoming.push_back(left_end);
+    result->add_operand(right);
+    result->incoming.push_back(right_end);
+    return result;
+}
+
+Instruction* Builder::lower_invoke(const core::InvokeExpr& expr) {
+    SourceLocation loc = expr.loc;
+    Instruction* callee = nullptr;
+    Instruction* receiver = nullptr;
+    if (!expr.receiver) {
+        callee = read_binding(expr.resolution, expr.name, Type::proto(), loc);
+    } else {
+        receiver = lower_expr(*expr.receiver);
+        if (receiver->type->kind == TypeKind::Object) {
+            callee = emit(Opcode::GetProp, Type::proto(), loc, {receiver});
+            callee->name = expr.name;
+        }
+    }
+
+    std::vector<Instruction*> operands{callee ? callee : receiver};
+    for (const auto& arg : expr.args) operands.push_back(lower_expr(*arg));
+    Instruction* call = emit(callee ? Opcode::Invoke : Opcode::CallMethod, expr.type, loc, operands);
+    if (!callee) call->name = expr.name;
+    // Builtin methods of statically known receivers never run user code.
+    if (callee || !is_builtin_receiver(receiver->type)) after_call(call);
+    return call;
+}
+
+Instruction* Builder::read_binding(const core::Resolution& resolution, const std::string& name,
+                                   const TypeRef& expected, SourceLocation loc) {
+    switch (resolution.kind) {
+        case BindingKind::Local:
+            return read(VarKey{VarKey::Kind::Local, resolution.slot}, expected);
+        case BindingKind::Global:
+            return read(VarKey{VarKey::Kind::Global, resolution.slot}, expected);
+        case BindingKind::Upvalue: {
+            const auto& upvalue = state_->act->upvalues[resolution.slot];
+            Instruction* value = emit(Opcode::Upvalue, upvalue.type, loc);
+            value->index = resolution.slot;
+            return coerce(state_->current, value, expected);
+        }
+        case BindingKind::Property: {
+            Instruction* self = emit(Opcode::Self, Type::proto(), loc);
+            Instruction* value = emit(Opcode::GetProp, Type::proto(), loc, {self});
+            value->name = name;
+            return coerce(state_->current, value, expected);
+        }
+        case BindingKind::Dynamic:
+        case BindingKind::Unresolved:
+            break;
+    }
+    Instruction* value = emit(Opcode::LoadName, Type::proto(), loc);
+    value->name = name;
+    return coerce(state_->current, value, expected);
+}
+
+void Builder::assign(const core::Resolution& resolution, const std::string& name,
+                     Instruction* value, SourceLocation loc) {
+    switch (resolution.kind) {
+        case BindingKind::Local:
+            write_variable(VarKey{VarKey::Kind::Local, resolution.slot}, state_->current, value);
+            break;
+        case BindingKind::Global: {
+            // Written through so that acts, dynamic lookups and later runs see the value.
+            Instruction* store = emit(Opcode::StoreGlobal, nullptr, loc, {value});
+            store->index = resolution.slot;
+            store->name = name;
+            write_variable(VarKey{VarKey::Kind::Global, resolution.slot}, state_->current, value);
+            break;
+        }
+        case BindingKind::Property: {
+            Instruction* self = emit(Opcode::Self, Type::proto(), loc);
+            emit(Opcode::SetProp, nullptr, loc, {self, value})->name = name;
+            break;
+        }
+        case BindingKind::Upvalue:
+        case BindingKind::Dynamic:
+        case BindingKind::Unresolved:
+            // The type checker turns assignments to these into local declarations.
+            assert(false && "unexpected binding kind in assignment");
+            break;
+    }
+}
+
+void Builder::after_call(Instruction* call) {
+    // The act may have rebound any global: later reads go back to memory.
+    state_->last_call[state_->current] = call;
+    for (int slot : state_->globals_used) {
+        write_variable(VarKey{VarKey::Kind::Global, slot}, state_->current, &reload_marker_);
+    }
+}
+
+// ============================================================================
+// Emission helpers
+// ============================================================================
+
+Instruction* Builder::emit(Opcode op, TypeRef type, SourceLocation loc,
+                           const std::vector<Instruction*>& operands) {
+    Instruction* instruction =
+        state_->current->append(state_->function->create(op, std::move(type), loc));
+    for (Instruction* operand : operands) instruction->add_operand(operand);
+    return instruction;
+}
+
+Instruction* Builder::constant(core::LiteralValue value, TypeRef type, SourceLocation loc) {
+    Instruction* instruction = emit(Opcode::Const, std::move(type), loc);
+    instruction->constant = std::move(value);
+    return instruction;
+}
+
+Instruction* Builder::default_value(const TypeRef& type, SourceLocation loc) {
+    return constant(zero_of(type), type, loc);
+}
+
+Instruction* Builder::coerce(BasicBlock* block, Instruction* value, const TypeRef& type) {
+    if (!type || type->is_proto() || core::types_equal(value->type, type)) return value;
+    if (value->type->kind == TypeKind::Nil && !type->is_primitive()) return value;
+    auto converted = state_->function->create(Opcode::Convert, type, value->loc);
+    converted->cast_kind = value->type->is_numeric() && core::is_assignable(type, value->type)
+                               ? core::CastKind::Widen
+                               : core::CastKind::Check;
+    Instruction* result = block->insert_before_terminator(std::move(converted));
+    result->add_operand(value);
+    return result;
+}
+
+void Builder::jump(BasicBlock* target) {
+    Instruction* instruction = emit(Opcode::Jump, nullptr, {});
+    instruction->targets.push_back(target);
+    link(state_->current, target);
+}
+
+void Builder::branch(Instruction* condition, BasicBlock* if_true, BasicBlock* if_false) {
+    Instruction* instruction = emit(Opcode::Branch, nullptr, condition->loc, {condition});
+    instruction->targets = {if_true, if_false};
+    link(state_->current, if_true);
+    link(state_->current, if_false);
+}
+
+BasicBlock* Builder::new_block() { return state_->function->create_block(); }
+
+// ============================================================================
+// SSA construction
+// ============================================================================
+
+void Builder::write_variable(VarKey key, const BasicBlock* block, Instruction* value) {
+    state_->current_def[key][block] = value;
+}
+
+Instruction* Builder::read(VarKey key, const TypeRef& expected) {
+    return coerce(state_->current, read_variable(key, state_->current), expected);
+}
+
+Instruction* Builder::read_variable(VarKey key, BasicBlock* block) {
+    auto& definitions = state_->current_def[key];
+    auto it = definitions.find(block);
+    if (it == definitions.end()) return read_variable_recursive(key, block);
+    if (it->second != &reload_marker_) {
+        // The definition may be a phi of another variable that has since been removed.
+        it->second = resolve(it->second);
+        return it->second;
+    }
+
+    // Materialize the reload right after the last call of the block.
+    Instruction* call = state_->last_call.at(block);
+    auto load = state_->function->create(Opcode::LoadGlobal, Type::proto(), call->loc);
+    load->index = key.index;
+    Instruction* value = block->insert(block->position_of(call) + 1, std::move(load));
+    definitions[block] = value;
+    return value;
+}
+
+Instruction* Builder::read_variable_recursive(VarKey key, BasicBlock* block) {
+    Instruction* value;
+    if (!state_->sealed.count(block)) {
+        // Not all predecessors are known yet: complete the phi when the block is sealed.
+        value = new_phi(key, block);
+        state_->incomplete_phis[block].emplace_back(key, value);
+        state_->pending_phis.insert(value);
+    } else if (block->predecessors.size() == 1) {
+        value = read_variable(key, block->predecessors[0]);
+    } else if (block->predecessors.empty()) {
+        value = undefined_value(key, block);
+    } else {
+        // Break cycles with an operandless phi first.
+        Instruction* phi = new_phi(key, block);
+        write_variable(key, block, phi);
+        value = add_phi_operands(key, phi);
+    }
+    write_variable(key, block, value);
+    return value;
+}
+
+Instruction* Builder::new_phi(VarKey key, BasicBlock* block) {
+    Instruction* phi = block->insert(0, state_->function->create(Opcode::Phi, variable_type(key)));
+    state_->phi_vars.emplace(phi, key);
+    return phi;
+}
+
+Instruction* Builder::add_phi_operands(VarKey key, Instruction* phi) {
+    std::vector<BasicBlock*> predecessors = phi->block->predecessors;
+    for (BasicBlock* pred : predecessors) {
+        Instruction* value = coerce(pred, read_variable(key, pred), phi->type);
+        phi->add_operand(value);
+        phi->incoming.push_back(pred);
+    }
+    return try_remove_trivial_phi(phi);
+}
+
+Instruction* Builder::try_remove_trivial_phi(Instruction* phi) {
+    Instruction* same = nullptr;
+    for (Instruction* operand : phi->operands) {
+        if (operand == same || operand == phi) continue;
+        if (same) return phi;  // Merges at least two values
+        same = operand;
+    }
+    VarKey key = state_->phi_vars.at(phi);
+    BasicBlock* block = phi->block;
+    if (!same) same = undefined_value(key, block);  // Unreachable or only self-referencing
+
+    std::vector<Instruction*> users;
+    for (Instruction* user : phi->users) {
+        if (user != phi) users.push_back(user);
+    }
+    phi->drop_operands();
+    phi->replace_all_uses_with(same);
+    for (auto& [def_block, value] : state_->current_def[key]) {
+        if (value == phi) value = same;
+    }
+    state_->replaced_phis[phi] = same;
+    state_->removed_phis.push_back(block->remove(phi));
+
+    // Removing this phi may have made phis that used it trivial.
+    for (Instruction* user : users) {
+        if (user->op == Opcode::Phi && user->block && !state_->pending_phis.count(user)) {
+            try_remove_trivial_phi(user);
+        }
+    }
+    return resolve(same);
+}
+
+Instruction* Builder::resolve(Instruction* value) const {
+    auto it = state_->replaced_phis.find(value);
+    while (it != state_->replaced_phis.end()) {
+        value = it->second;
+        it = state_->replaced_phis.find(value);
+    }
+    return value;
+}
+
+Instruction* Builder::undefined_value(VarKey key, BasicBlock* block) {
+    std::unique_ptr<Instruction> value;
+    if (key.kind == VarKey::Kind::Global) {
+        // First use of a global in the function: read it from memory.
+        value = state_->function->create(Opcode::LoadGlobal, Type::proto());
+        value->index = key.index;
+    } else {
+        TypeRef type = variable_type(key);
+        value = state_->function->create(Opcode::Const, type);
+        value->constant = zero_of(type);
+    }
+    return block->insert(first_non_phi(block), std::move(value));
+}
+
+TypeRef Builder::variable_type(VarKey key) const {
+    if (key.kind == VarKey::Kind::Temp) return Type::int32();
+    auto it = state_->types.find(key);
+    if (it != state_->types.end()) return it->second;
+    if (key.kind == VarKey::Kind::Global) return globals_.at(key.index).type;
+    return state_->act->locals[key.index].type;
+}
+
+void Builder::seal_block(BasicBlock* block) {
+    auto it = state_->incomplete_phis.find(block);
+    while (it != state_->incomplete_phis.end()) {
+        std::vector<std::pair<VarKey, Instruction*>> phis = std::move(it->second);
+        state_->incomplete_phis.erase(it);
+        for (auto& [key, phi] : phis) {
+            state_->pending_phis.erase(phi);
+            if (phi->block) add_phi_operands(key, phi);
+        }
+        it = state_->incomplete_phis.find(block);
+    }
+    state_->sealed.insert(block);
+}
+
+}  // namespace ir
+}  // namespace tooi
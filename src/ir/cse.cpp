@@ -0,0 +1,158 @@
+/**
+ * @file cse.cpp
+ * @brief Common subexpression elimination by dominator-scoped value numbering.
+ */
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <tuple>
+#include <variant>
+
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+namespace {
+
+// A float constant by its bits: NaN is unordered, and 0.0 compares equal to -0.0.
+struct FloatBits {
+    uint64_t bits;
+    auto operator<=>(const FloatBits&) const = default;
+};
+
+using ConstantKey = std::variant<std::monostate, bool, int64_t, uint64_t, FloatBits, std::string>;
+
+ConstantKey constant_key(const core::LiteralValue& value) {
+    return std::visit(
+        [](const auto& constant) -> ConstantKey {
+            if constexpr (std::is_same_v<std::decay_t<decltype(constant)>, double>) {
+                return FloatBits{std::bit_cast<uint64_t>(constant)};
+            } else {
+                return constant;
+            }
+        },
+        value);
+}
+
+// Everything that makes two instructions compute the same value.
+using ValueKey = std::tuple<Opcode, std::string, std::vector<Instruction*>, ConstantKey, int,
+                            std::string, core::CastKind>;
+
+ValueKey key_of(const Instruction& instruction) {
+    std::vector<Instruction*> operands = instruction.operands;
+    bool commutative = instruction.op == Opcode::Add || instruction.op == Opcode::Mul ||
+                       instruction.op == Opcode::Eq || instruction.op == Opcode::Ne;
+    if (commutative) std::sort(operands.begin(), operands.end());
+    return ValueKey{instruction.op,
+                    instruction.type ? instruction.type->to_string() : std::string(),
+                    std::move(operands),
+                    constant_key(instruction.constant),
+                    instruction.index,
+                    instruction.name,
+                    instruction.cast_kind};
+}
+
+bool is_memory_read(const Instruction& instruction) {
+    switch (instruction.op) {
+        case Opcode::LoadGlobal:
+        case Opcode::LoadName:
+        case Opcode::GetProp:
+        case Opcode::Index:
+        case Opcode::Length:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Forgets the remembered memory reads that an instruction may overwrite.
+void kill_reads(const Instruction& writer, std::map<ValueKey, Instruction*>& reads) {
+    auto kill_if = [&](auto predicate) {
+        for (auto it = reads.begin(); it != reads.end();) {
+            it = predicate(*it->second) ? reads.erase(it) : std::next(it);
+        }
+    };
+    switch (writer.op) {
+        case Opcode::Invoke:
+        case Opcode::CallMethod:
+            reads.clear();
+            break;
+        case Opcode::StoreGlobal:
+            kill_if([&](const Instruction& read) {
+                return read.op == Opcode::LoadName ||
+                       (read.op == Opcode::LoadGlobal && read.index == writer.index);
+            });
+            break;
+        case Opcode::SetProp:
+        case Opcode::DefineProp:
+            kill_if([](const Instruction& read) {
+                return read.op == Opcode::GetProp || read.op == Opcode::LoadName;
+            });
+            break;
+        case Opcode::SetIndex:
+            // Storing to an assoc array may add a key, changing its length.
+            kill_if([](const Instruction& read) {
+                return read.op == Opcode::Index || read.op == Opcode::Length;
+            });
+            break;
+        default:
+            break;
+    }
+}
+
+class ValueNumbering {
+public:
+    explicit ValueNumbering(Function& function) : dominators_(function) {}
+
+    int run(BasicBlock* entry) {
+        visit(entry);
+        return removed_;
+    }
+
+private:
+    DominatorTree dominators_;
+    std::map<ValueKey, Instruction*> available_;  // Pure values of the dominating blocks
+    int removed_ = 0;
+
+    void visit(BasicBlock* block) {
+        std::vector<ValueKey> scope;
+        std::map<ValueKey, Instruction*> reads;
+        for (size_t i = 0; i < block->instructions.size();) {
+            Instruction* instruction = block->instructions[i].get();
+            std::map<ValueKey, Instruction*>* table = nullptr;
+            if (instruction->is_pure()) {
+                table = &available_;
+            } else if (is_memory_read(*instruction)) {
+                table = &reads;
+            } else {
+                kill_reads(*instruction, reads);
+            }
+            if (table) {
+                ValueKey key = key_of(*instruction);
+                auto it = table->find(key);
+                if (it != table->end()) {
+                    instruction->replace_all_uses_with(it->second);
+                    block->erase(instruction);
+                    removed_++;
+                    continue;
+                }
+                table->emplace(key, instruction);
+                if (table == &available_) scope.push_back(std::move(key));
+            }
+            ++i;
+        }
+        for (BasicBlock* child : dominators_.children(block)) visit(child);
+        for (const ValueKey& key : scope) available_.erase(key);
+    }
+};
+
+}  // anonymous namespace
+
+int eliminate_common_subexpressions(Function& function) {
+    return ValueNumbering(function).run(function.entry());
+}
+
+}  // namespace ir
+}  // namespace tooi
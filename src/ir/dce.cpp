@@ -0,0 +1,136 @@
+/**
+ * @file dce.cpp
+ * @brief Constant branch folding and dead code elimination.
+ */
+#include <algorithm>
+#include <unordered_set>
+
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+namespace {
+
+// Turns branches on constant conditions into jumps.
+int fold_constant_branches(Function& function) {
+    int folded = 0;
+    for (const auto& block : function.blocks) {
+        Instruction* branch = block->terminator();
+        if (!branch || branch->op != Opcode::Branch) continue;
+        const Instruction* condition = branch->operands[0];
+        const bool* value = condition->op == Opcode::Const
+                                ? std::get_if<bool>(&condition->constant)
+                                : nullptr;
+        if (!value) continue;
+        BasicBlock* taken = branch->targets[*value ? 0 : 1];
+        BasicBlock* dropped = branch->targets[*value ? 1 : 0];
+        if (taken != dropped) unlink(block.get(), dropped);
+        auto jump = function.create(Opcode::Jump, nullptr, branch->loc);
+        jump->targets.push_back(taken);
+        block->erase(branch);
+        block->append(std::move(jump));
+        folded++;
+    }
+    return folded;
+}
+
+int remove_unreachable_blocks(Function& function) {
+    std::unordered_set<const BasicBlock*> reachable;
+    std::vector<BasicBlock*> worklist{function.entry()};
+    while (!worklist.empty()) {
+        BasicBlock* block = worklist.back();
+        worklist.pop_back();
+        if (!reachable.insert(block).second) continue;
+        for (BasicBlock* successor : block->successors()) worklist.push_back(successor);
+    }
+
+    std::vector<BasicBlock*> dead;
+    for (const auto& block : function.blocks) {
+        if (!reachable.count(block.get())) dead.push_back(block.get());
+    }
+    // Values of dead blocks may only be used by other dead blocks and by phis
+    // of their successors, so drop all of those uses before deleting anything.
+    int removed = 0;
+    for (BasicBlock* block : dead) {
+        for (auto& instruction : block->instructions) instruction->drop_operands();
+        removed += static_cast<int>(block->instructions.size());
+    }
+    for (BasicBlock* block : dead) {
+        for (BasicBlock* successor : block->successors()) {
+            if (reachable.count(successor)) unlink(block, successor);
+        }
+    }
+    for (BasicBlock* block : dead) function.remove_block(block);
+    return removed;
+}
+
+// Replaces phis whose operands (other than the phi itself) are all the same value.
+int remove_trivial_phis(Function& function) {
+    int removed = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& block : function.blocks) {
+            for (size_t i = 0; i < block->instructions.size();) {
+                Instruction* phi = block->instructions[i].get();
+                if (phi->op != Opcode::Phi) break;
+                Instruction* same = nullptr;
+                bool trivial = true;
+                for (Instruction* operand : phi->operands) {
+                    if (operand == phi || operand == same) continue;
+                    if (same) trivial = false;
+                    same = operand;
+                }
+                if (!trivial || !same) {
+                    ++i;
+                    continue;
+                }
+                phi->drop_operands();
+                phi->replace_all_uses_with(same);
+                block->erase(phi);
+                removed++;
+                changed = true;
+            }
+        }
+    }
+    return removed;
+}
+
+int remove_unused_values(Function& function) {
+    int removed = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& block : function.blocks) {
+            for (size_t i = block->instructions.size(); i-- > 0;) {
+                Instruction* instruction = block->instructions[i].get();
+                // A phi used only by itself (a loop-carried value nobody reads) is unused too.
+                bool unused = std::all_of(
+                    instruction->users.begin(), instruction->users.end(),
+                    [&](const Instruction* user) { return user == instruction; });
+                if (!unused || instruction->has_side_effects() || instruction->may_trap()) {
+                    continue;
+                }
+                instruction->drop_operands();
+                block->erase(instruction);
+                removed++;
+                changed = true;
+            }
+        }
+    }
+    return removed;
+}
+
+}  // anonymous namespace
+
+int eliminate_dead_code(Function& function) {
+    int changes = fold_constant_branches(function);
+    changes += remove_unreachable_blocks(function);
+    changes += remove_trivial_phis(function);
+    changes += remove_unused_values(function);
+    return changes;
+}
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,465 @@
+/**
+ * @file inline.cpp
+ * @brief Inlining of small acts at their call sites.
+ */
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+using core::TypeKind;
+using core::TypeRef;
+
+namespace {
+
+// True if the instruction may run user code, which could replace the act of any object.
+bool runs_user_code(const Instruction& instruction) {
+    if (instruction.op == Opcode::Invoke) return true;
+    if (instruction.op != Opcode::CallMethod) return false;
+    const TypeRef& receiver = instruction.operands[0]->type;
+    return receiver->kind == TypeKind::Object || receiver->is_proto();
+}
+
+// The value without the implicit conversions the builder inserted around it.
+Instruction* strip(Instruction* value) {
+    while (value->op == Opcode::Convert && value->cast_kind != core::CastKind::Explicit) {
+        value = value->operands[0];
+    }
+    return value;
+}
+
+/**
+ * The act an object was defined with: its SetAct in the defining block, or
+ * null if it has none or more than one. Acts set later through other
+ * bindings are not visible here; callers decide whether they need a guard.
+ */
+Instruction* defining_closure(const Instruction* object) {
+    if (object->op != Opcode::NewObject) return nullptr;
+    Instruction* closure = nullptr;
+    std::vector<const Instruction*> values{object};
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (const Instruction* user : values[i]->users) {
+            if (user->op == Opcode::Convert) {
+                values.push_back(user);
+            } else if (user->op == Opcode::SetAct && user->operands[0] == values[i]) {
+                if (closure || user->block != object->block) return nullptr;
+                closure = user->operands[1];
+            }
+        }
+    }
+    return closure && closure->op == Opcode::MakeAct ? closure : nullptr;
+}
+
+// True if every SetAct on the object (through conversions and phis) is its definition.
+bool has_only_defining_act(const Instruction* object, const Instruction* closure) {
+    std::vector<const Instruction*> values{object};
+    std::unordered_set<const Instruction*> seen{object};
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (const Instruction* user : values[i]->users) {
+            if (user->op == Opcode::Convert || user->op == Opcode::Phi) {
+                if (seen.insert(user).second) values.push_back(user);
+            } else if (user->op == Opcode::SetAct && user->operands[0] == values[i] &&
+                       user->operands[1] != closure) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// True if the invocation is reached from the definition of the object's act
+// on a straight-line path that runs no user code.
+bool act_is_unchanged(const Instruction& invoke, const Instruction* closure) {
+    const BasicBlock* block = invoke.block;
+    size_t end = block->position_of(&invoke);
+    std::unordered_set<const BasicBlock*> visited;
+    while (block && visited.insert(block).second) {
+        for (size_t i = end; i-- > 0;) {
+            const Instruction* instruction = block->instructions[i].get();
+            if (instruction->op == Opcode::SetAct && instruction->operands[1] == closure) {
+                return true;
+            }
+            if (runs_user_code(*instruction)) return false;
+        }
+        block = block->predecessors.size() == 1 ? block->predecessors[0] : nullptr;
+        if (block) end = block->instructions.size() - 1;  // Skip the terminator
+    }
+    return false;
+}
+
+/**
+ * Objects stored to globals anywhere in the module. A global is only
+ * predicted if all of its stores hold objects defined with the same act.
+ */
+class GlobalObjects {
+public:
+    explicit GlobalObjects(const Module& module) {
+        std::unordered_set<int> unknown;
+        for (const auto& function : module.functions) {
+            for (const auto& block : function->blocks) {
+                for (const auto& instruction : block->instructions) {
+                    if (instruction->op != Opcode::StoreGlobal) continue;
+                    int slot = instruction->index;
+                    Instruction* object = strip(instruction->operands[0]);
+                    const Instruction* closure = defining_closure(object);
+                    auto it = objects_.find(slot);
+                    if (!closure || unknown.count(slot) ||
+                        (it != objects_.end() &&
+                         defining_closure(it->second)->index != closure->index)) {
+                        unknown.insert(slot);
+                        objects_.erase(slot);
+                        continue;
+                    }
+                    if (it == objects_.end()) objects_.emplace(slot, object);
+                }
+            }
+        }
+    }
+
+    /// An object defined with the act every store to the global holds, or null.
+    Instruction* object(int slot) const {
+        auto it = objects_.find(slot);
+        return it == objects_.end() ? nullptr : it->second;
+    }
+
+private:
+    std::unordered_map<int, Instruction*> objects_;
+};
+
+// The object an invoked value is predicted to be. `phis` guards against cycles.
+Instruction* predicted_object(Instruction* value, const GlobalObjects& globals,
+                              std::unordered_set<const Instruction*>& phis) {
+    value = strip(value);
+    switch (value->op) {
+        case Opcode::NewObject:
+            return value;
+        case Opcode::LoadGlobal:
+            return globals.object(value->index);
+        case Opcode::Phi: {
+            // Loops reload globals after calls: all incoming values must agree on the act.
+            if (!phis.insert(value).second) return nullptr;
+            Instruction* object = nullptr;
+            for (Instruction* operand : value->operands) {
+                if (phis.count(strip(operand))) continue;  // Back edge to a phi being predicted
+                Instruction* incoming = predicted_object(operand, globals, phis);
+                if (!incoming || (object && defining_closure(object)->index !=
+                                                defining_closure(incoming)->index)) {
+                    return nullptr;
+                }
+                if (!object) object = incoming;
+            }
+            return object;
+        }
+        case Opcode::GetProp: {
+            // A mode entry of a known object, as defined there.
+            const Instruction* owner = predicted_object(value->operands[0], globals, phis);
+            if (!owner) return nullptr;
+            Instruction* entry = nullptr;
+            for (const Instruction* user : owner->users) {
+                if (user->op == Opcode::DefineProp && user->operands[0] == owner &&
+                    user->name == value->name) {
+                    if (entry) return nullptr;  // Redefined with `>>`
+                    entry = strip(user->operands[1]);
+                }
+            }
+            return entry && entry->op == Opcode::NewObject ? entry : nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * How a call site is inlined. With a closure, the copy takes upvalues and
+ * param defaults from it; otherwise they are constants copied from the
+ * act's only MakeAct.
+ */
+struct Plan {
+    Instruction* invoke = nullptr;
+    const Function* callee = nullptr;
+    Instruction* closure = nullptr;  // MakeAct
+    bool closure_available = false;  // The closure is a value of the caller
+    bool guarded = true;
+    int depth = 0;  // Loop nesting of the call site
+};
+
+bool is_inlinable(const Function& caller, const Plan& plan) {
+    const Function& callee = *plan.callee;
+    if (callee.blocks.empty()) return false;  // Deferred act, not built yet
+    if (&callee == &caller || callee.is_script || !callee.entry()->predecessors.empty()) {
+        return false;
+    }
+    int limit = kInlineSizeLimit * (1 + std::min(plan.depth, 3));
+    if (callee.instruction_count() > static_cast<size_t>(limit)) return false;
+    int args = static_cast<int>(plan.invoke->operands.size()) - 1;
+    if (args > callee.param_count) return false;
+
+    bool returns = false;
+    for (const auto& block : callee.blocks) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == Opcode::LoadName) return false;  // Depends on the running act
+            if (instruction->op == Opcode::Return) returns = true;
+        }
+    }
+    if (!returns) return false;
+    if (plan.closure_available) return true;
+
+    // Upvalues and the defaults of missing params come from the act's closure,
+    // which is only known here if they are constants.
+    for (size_t i = 0; i < plan.closure->operands.size(); ++i) {
+        bool used = i < static_cast<size_t>(callee.upvalue_count) ||
+                    i >= static_cast<size_t>(callee.upvalue_count + args);
+        if (used && plan.closure->operands[i]->op != Opcode::Const) return false;
+    }
+    return true;
+}
+
+// Inserts an implicit conversion of a value to a static type, as the builder does.
+Instruction* coerce(Function& function, BasicBlock* block, Instruction* value,
+                    const TypeRef& type) {
+    if (!type || type->is_proto() || core::types_equal(value->type, type)) return value;
+    if (value->type->kind == TypeKind::Nil && !type->is_primitive()) return value;
+    auto converted = function.create(Opcode::Convert, type, value->loc);
+    converted->cast_kind = value->type->is_numeric() && core::is_assignable(type, value->type)
+                               ? core::CastKind::Widen
+                               : core::CastKind::Check;
+    Instruction* result = block->insert_before_terminator(std::move(converted));
+    result->add_operand(value);
+    return result;
+}
+
+// Moves the instructions after `position` into a new block that takes over the successors.
+BasicBlock* split_after(Function& function, BasicBlock* block, size_t position) {
+    BasicBlock* tail = function.create_block();
+    auto first = block->instructions.begin() + static_cast<std::ptrdiff_t>(position + 1);
+    for (auto it = first; it != block->instructions.end(); ++it) tail->append(std::move(*it));
+    block->instructions.erase(first, block->instructions.end());
+    for (BasicBlock* successor : tail->successors()) {
+        std::replace(successor->predecessors.begin(), successor->predecessors.end(), block, tail);
+        for (auto& instruction : successor->instructions) {
+            if (instruction->op != Opcode::Phi) break;
+            std::replace(instruction->incoming.begin(), instruction->incoming.end(), block, tail);
+        }
+    }
+    return tail;
+}
+
+// Copies the callee's blocks into the caller in place of the invocation.
+void inline_call(Function& caller, const Plan& plan) {
+    Instruction* invoke = plan.invoke;
+    const Function& callee = *plan.callee;
+    BasicBlock* before = invoke->block;
+    BasicBlock* after = split_after(caller, before, before->position_of(invoke));
+    Instruction* object = invoke->operands[0];
+
+    // Closure operands: values of the caller, or copies of the constants.
+    std::unordered_map<const Instruction*, Instruction*> closure_values;
+    auto closure_operand = [&](size_t i) {
+        Instruction* value = plan.closure->operands[i];
+        if (plan.closure_available) return value;
+        Instruction*& copy = closure_values[value];
+        if (!copy) {
+            copy = before->append(caller.create(Opcode::Const, value->type, value->loc));
+            copy->constant = value->constant;
+        }
+        return copy;
+    };
+
+    std::unordered_map<const BasicBlock*, BasicBlock*> blocks;
+    for (const auto& block : callee.blocks) blocks[block.get()] = caller.create_block();
+    for (const auto& block : callee.blocks) {
+        BasicBlock* copy = blocks[block.get()];
+        for (const BasicBlock* pred : block->predecessors) {
+            copy->predecessors.push_back(blocks[pred]);
+        }
+    }
+
+    // First pass: create the copies, so operands defined later can be mapped.
+    std::unordered_map<const Instruction*, Instruction*> values;
+    std::vector<std::pair<const Instruction*, Instruction*>> copies;
+    std::vector<std::pair<const Instruction*, BasicBlock*>> returns;
+    int args = static_cast<int>(invoke->operands.size()) - 1;
+    for (const auto& block : callee.blocks) {
+        BasicBlock* target = blocks[block.get()];
+        for (const auto& instruction : block->instructions) {
+            switch (instruction->op) {
+                case Opcode::Param: {
+                    int index = instruction->index;
+                    Instruction* value =
+                        index < args ? invoke->operands[index + 1]
+                                     : closure_operand(callee.upvalue_count + index);
+                    values[instruction.get()] = coerce(caller, target, value, instruction->type);
+                    continue;
+                }
+                case Opcode::Upvalue:
+                    values[instruction.get()] =
+                        coerce(caller, target, closure_operand(instruction->index),
+                               instruction->type);
+                    continue;
+                case Opcode::Self:
+                    values[instruction.get()] = object;
+                    continue;
+                case Opcode::Return: {
+                    returns.emplace_back(instruction.get(), target);
+                    Instruction* jump = target->append(caller.create(Opcode::Jump, nullptr,
+                                                                     instruction->loc));
+                    jump->targets.push_back(after);
+                    continue;
+                }
+                default:
+                    break;
+            }
+            auto copy = caller.create(instruction->op, instruction->type, instruction->loc);
+            copy->constant = instruction->constant;
+            copy->index = instruction->index;
+            copy->name = instruction->name;
+            copy->cast_kind = instruction->cast_kind;
+            copy->bounds_check = instruction->bounds_check;
+            copy->is_set = instruction->is_set;
+            copy->is_private = instruction->is_private;
+            copy->property_type = instruction->property_type;
+            Instruction* value = target->append(std::move(copy));
+            values[instruction.get()] = value;
+            copies.emplace_back(instruction.get(), value);
+        }
+    }
+
+    // Second pass: operands, targets and phi edges.
+    for (auto& [original, copy] : copies) {
+        for (const Instruction* operand : original->operands) {
+            copy->add_operand(values.at(operand));
+        }
+        for (const BasicBlock* target : original->targets) {
+            copy->targets.push_back(blocks.at(target));
+        }
+        for (const BasicBlock* pred : original->incoming) {
+            copy->incoming.push_back(blocks.at(pred));
+        }
+    }
+
+    // Enter the copy, behind a check of the act unless it cannot have changed.
+    BasicBlock* entry = blocks.at(callee.entry());
+    std::vector<std::pair<Instruction*, BasicBlock*>> results;
+    std::unique_ptr<Instruction> removed;
+    if (plan.guarded) {
+        auto check = caller.create(Opcode::ActIs, core::Type::boolean(), invoke->loc);
+        Instruction* guard = before->insert(before->position_of(invoke), std::move(check));
+        guard->add_operand(object);
+        if (plan.closure_available) {
+            guard->add_operand(plan.closure);
+        } else {
+            guard->index = callee.index;
+        }
+        BasicBlock* fallback = caller.create_block();
+        fallback->append(before->remove(invoke));
+        Instruction* jump = fallback->append(caller.create(Opcode::Jump, nullptr, invoke->loc));
+        jump->targets.push_back(after);
+        link(fallback, after);
+        results.emplace_back(invoke, fallback);
+
+        Instruction* branch =
+            before->append(caller.create(Opcode::Branch, nullptr, invoke->loc));
+        branch->add_operand(guard);
+        branch->targets = {entry, fallback};
+        link(before, entry);
+        link(before, fallback);
+    } else {
+        removed = before->remove(invoke);
+        Instruction* jump = before->append(caller.create(Opcode::Jump, nullptr, invoke->loc));
+        jump->targets.push_back(entry);
+        link(before, entry);
+    }
+    for (auto& [original, block] : returns) {
+        Instruction* value = values.at(original->operands[0]);
+        results.emplace_back(coerce(caller, block, value, invoke->type), block);
+        link(block, after);
+    }
+
+    // The invocation's value is the phi of the returned values (and of the fallback).
+    if (results.size() == 1) {
+        invoke->replace_all_uses_with(results.front().first);
+    } else {
+        Instruction* phi =
+            after->insert(0, caller.create(Opcode::Phi, invoke->type, invoke->loc));
+        invoke->replace_all_uses_with(phi);
+        for (auto& [value, block] : results) {
+            phi->add_operand(value);
+            phi->incoming.push_back(block);
+        }
+    }
+    if (removed) removed->drop_operands();
+}
+
+}  // anonymous namespace
+
+int inline_small_acts(Function& function, InlineStats* stats) {
+    // Predicting callees scans the whole module; a function without calls needs none.
+    bool invokes = false;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block->instructions) {
+            invokes = invokes || instruction->op == Opcode::Invoke;
+        }
+    }
+    if (!invokes) return 0;
+
+    const Module& module = *function.module;
+    GlobalObjects globals(module);
+    DominatorTree dominators(function);
+    auto loops = find_loops(dominators);
+
+    std::vector<Plan> plans;
+    for (const auto& block : function.blocks) {
+        if (!dominators.is_reachable(block.get())) continue;
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op != Opcode::Invoke) continue;
+            std::unordered_set<const Instruction*> phis;
+            Instruction* object = predicted_object(instruction->operands[0], globals, phis);
+            Instruction* closure = object ? defining_closure(object) : nullptr;
+            if (!closure) continue;
+
+            Plan plan;
+            plan.invoke = instruction.get();
+            plan.callee = module.functions[closure->index].get();
+            plan.closure = closure;
+            const BasicBlock* home = closure->block;
+            plan.closure_available =
+                home->function == &function && dominators.dominates(home, block.get()) &&
+                (home != block.get() ||
+                 home->position_of(closure) < block->position_of(instruction.get()));
+            plan.guarded = !(strip(instruction->operands[0]) == object &&
+                             has_only_defining_act(object, closure) &&
+                             act_is_unchanged(*instruction, closure));
+            for (const auto& loop : loops) {
+                if (loop->contains(block.get())) plan.depth = std::max(plan.depth, loop->depth);
+            }
+            if (is_inlinable(function, plan)) plans.push_back(plan);
+        }
+    }
+
+    // The hottest call sites get the growth budget first.
+    std::stable_sort(plans.begin(), plans.end(),
+                     [](const Plan& a, const Plan& b) { return a.depth > b.depth; });
+    int growth = 0;
+    int inlined = 0;
+    for (const Plan& plan : plans) {
+        int size = static_cast<int>(plan.callee->instruction_count());
+        if (growth + size > kInlineGrowthLimit) continue;
+        inline_call(function, plan);
+        growth += size;
+        inlined++;
+        if (stats) {
+            stats->call_sites++;
+            if (plan.guarded) stats->guarded++;
+            stats->instructions += size;
+        }
+    }
+    return inlined;
+}
+
+}  // namespace ir
+}  // namespace tooi
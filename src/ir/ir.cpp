@@ -0,0 +1,370 @@
+/**
+ * @file ir.cpp
+ * @brief Implementation of the IR data structures and the IR printer.
+ */
+#include "tooi/ir/ir.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "tooi/core/conversions.h"
+
+namespace tooi {
+namespace ir {
+
+namespace {
+
+void remove_one_use(Instruction* value, Instruction* user) {
+    auto it = std::find(value->users.begin(), value->users.end(), user);
+    assert(it != value->users.end());
+    value->users.erase(it);
+}
+
+bool is_integer_or_proto(const core::TypeRef& type) {
+    return !type || type->is_integer() || type->is_proto();
+}
+
+std::string constant_text(const Instruction& instruction) {
+    const core::LiteralValue& value = instruction.constant;
+    if (std::holds_alternative<std::monostate>(value)) return "nil";
+    if (const bool* v = std::get_if<bool>(&value)) return *v ? "true" : "false";
+    if (const int64_t* v = std::get_if<int64_t>(&value)) return core::format_int(*v);
+    if (const uint64_t* v = std::get_if<uint64_t>(&value)) return core::format_uint(*v);
+    if (const double* v = std::get_if<double>(&value)) {
+        return core::format_float(*v, instruction.type->kind == core::TypeKind::Float32);
+    }
+    return "\"" + std::get<std::string>(value) + "\"";
+}
+
+}  // anonymous namespace
+
+const char* opcode_name(Opcode op) {
+    static const char* const names[] = {
+#define TOOI_IR_OPCODE_NAME(name) #name,
+        TOOI_IR_OPCODES(TOOI_IR_OPCODE_NAME)
+#undef TOOI_IR_OPCODE_NAME
+    };
+    return names[static_cast<int>(op)];
+}
+
+// ============================================================================
+// Instruction
+// ============================================================================
+
+void Instruction::add_operand(Instruction* value) {
+    operands.push_back(value);
+    value->users.push_back(this);
+}
+
+void Instruction::set_operand(size_t i, Instruction* value) {
+    remove_one_use(operands[i], this);
+    operands[i] = value;
+    value->users.push_back(this);
+}
+
+void Instruction::remove_operand(size_t i) {
+    remove_one_use(operands[i], this);
+    operands.erase(operands.begin() + static_cast<std::ptrdiff_t>(i));
+    if (op == Opcode::Phi) incoming.erase(incoming.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+void Instruction::drop_operands() {
+    for (Instruction* operand : operands) remove_one_use(operand, this);
+    operands.clear();
+    incoming.clear();
+}
+
+void Instruction::replace_all_uses_with(Instruction* value) {
+    assert(value != this);
+    std::vector<Instruction*> current = std::move(users);
+    users.clear();
+    for (Instruction* user : current) {
+        for (auto& operand : user->operands) {
+            if (operand == this) {
+                operand = value;
+                value->users.push_back(user);
+                break;  // `current` holds one entry per use
+            }
+        }
+    }
+}
+
+bool Instruction::is_terminator() const {
+    return op == Opcode::Jump || op == Opcode::Branch || op == Opcode::Return;
+}
+
+bool Instruction::has_side_effects() const {
+    switch (op) {
+        case Opcode::StoreGlobal:
+        case Opcode::SetProp:
+        case Opcode::DefineProp:
+        case Opcode::SetAct:
+        case Opcode::Invoke:
+        case Opcode::CallMethod:
+        case Opcode::SetIndex:
+        case Opcode::Jump:
+        case Opcode::Branch:
+        case Opcode::Return:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Instruction::may_trap() const {
+    switch (op) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Neg:
+            return is_integer_or_proto(type);  // Integer overflow
+        case Opcode::Div:
+        case Opcode::Mod:
+            return is_integer_or_proto(type);  // Division by zero
+        case Opcode::Lt:
+        case Opcode::Le:
+        case Opcode::Gt:
+        case Opcode::Ge:
+            return operands[0]->type->is_proto() || operands[1]->type->is_proto();
+        case Opcode::Convert:
+            return cast_kind != core::CastKind::Widen;
+        case Opcode::Length:
+        case Opcode::IterSource:
+            return operands[0]->type->is_proto();
+        case Opcode::Index: {
+            // Proven in-range integer indexing of a sequence cannot fail.
+            core::TypeKind kind = operands[0]->type->kind;
+            bool sequence = kind == core::TypeKind::Array || kind == core::TypeKind::String ||
+                            kind == core::TypeKind::Tuple;
+            return bounds_check || !sequence || !operands[1]->type->is_integer();
+        }
+        case Opcode::LoadName:
+        case Opcode::GetProp:
+        case Opcode::CloneObject:
+            return true;
+        default:
+            return has_side_effects();
+    }
+}
+
+bool Instruction::is_pure() const {
+    switch (op) {
+        case Opcode::Const:
+        case Opcode::Param:
+        case Opcode::Self:
+        case Opcode::Upvalue:
+        case Opcode::AddModule:
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod:
+        case Opcode::Neg:
+        case Opcode::Not:
+        case Opcode::Eq:
+        case Opcode::Ne:
+        case Opcode::Lt:
+        case Opcode::Le:
+        case Opcode::Gt:
+        case Opcode::Ge:
+        case Opcode::Truthy:
+        case Opcode::Concat:
+        case Opcode::Convert:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ============================================================================
+// BasicBlock
+// ============================================================================
+
+Instruction* BasicBlock::terminator() const {
+    if (instructions.empty() || !instructions.back()->is_terminator()) return nullptr;
+    return instructions.back().get();
+}
+
+std::vector<BasicBlock*> BasicBlock::successors() const {
+    Instruction* last = terminator();
+    return last ? last->targets : std::vector<BasicBlock*>{};
+}
+
+Instruction* BasicBlock::append(std::unique_ptr<Instruction> instruction) {
+    instruction->block = this;
+    instructions.push_back(std::move(instruction));
+    return instructions.back().get();
+}
+
+Instruction* BasicBlock::insert(size_t position, std::unique_ptr<Instruction> instruction) {
+    instruction->block = this;
+    auto it = instructions.insert(instructions.begin() + static_cast<std::ptrdiff_t>(position),
+                                  std::move(instruction));
+    return it->get();
+}
+
+Instruction* BasicBlock::insert_before_terminator(std::unique_ptr<Instruction> instruction) {
+    size_t position = terminator() ? instructions.size() - 1 : instructions.size();
+    return insert(position, std::move(instruction));
+}
+
+size_t BasicBlock::position_of(const Instruction* instruction) const {
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].get() == instruction) return i;
+    }
+    assert(false && "instruction not in block");
+    return instructions.size();
+}
+
+std::unique_ptr<Instruction> BasicBlock::remove(Instruction* instruction) {
+    size_t position = position_of(instruction);
+    std::unique_ptr<Instruction> owned = std::move(instructions[position]);
+    instructions.erase(instructions.begin() + static_cast<std::ptrdiff_t>(position));
+    owned->block = nullptr;
+    return owned;
+}
+
+void BasicBlock::erase(Instruction* instruction) {
+    assert(instruction->users.empty());
+    instruction->drop_operands();
+    remove(instruction);
+}
+
+int BasicBlock::predecessor_index(const BasicBlock* block) const {
+    for (size_t i = 0; i < predecessors.size(); ++i) {
+        if (predecessors[i] == block) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// ============================================================================
+// Function / Module
+// ============================================================================
+
+BasicBlock* Function::create_block() {
+    auto block = std::make_unique<BasicBlock>();
+    block->id = next_block_id_++;
+    block->function = this;
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void Function::remove_block(BasicBlock* block) {
+    // Drop uses held by the block's instructions first; values defined here
+    // may only be used inside the block itself.
+    for (auto& instruction : block->instructions) instruction->drop_operands();
+    auto it = std::find_if(blocks.begin(), blocks.end(),
+                           [&](const auto& owned) { return owned.get() == block; });
+    assert(it != blocks.end());
+    blocks.erase(it);
+}
+
+std::unique_ptr<Instruction> Function::create(Opcode op, core::TypeRef type,
+                                              core::SourceLocation loc) {
+    auto instruction = std::make_unique<Instruction>(op, std::move(type), loc);
+    instruction->id = next_value_id_++;
+    return instruction;
+}
+
+size_t Function::instruction_count() const {
+    size_t count = 0;
+    for (const auto& block : blocks) count += block->instructions.size();
+    return count;
+}
+
+Function* Module::create_function(std::string name) {
+    auto function = std::make_unique<Function>();
+    function->name = std::move(name);
+    function->index = static_cast<int>(functions.size());
+    function->module = this;
+    functions.push_back(std::move(function));
+    return functions.back().get();
+}
+
+size_t Module::instruction_count() const {
+    size_t count = 0;
+    for (const auto& function : functions) count += function->instruction_count();
+    return count;
+}
+
+void link(BasicBlock* from, BasicBlock* to) {
+    to->predecessors.push_back(from);
+}
+
+void unlink(BasicBlock* from, BasicBlock* to) {
+    int index = to->predecessor_index(from);
+    assert(index >= 0);
+    to->predecessors.erase(to->predecessors.begin() + index);
+    for (auto& instruction : to->instructions) {
+        if (instruction->op != Opcode::Phi) break;
+        auto it = std::find(instruction->incoming.begin(), instruction->incoming.end(), from);
+        if (it != instruction->incoming.end()) {
+            instruction->remove_operand(static_cast<size_t>(it - instruction->incoming.begin()));
+        }
+    }
+}
+
+// ============================================================================
+// Printer
+// ============================================================================
+
+void print_function(const Function& function, std::ostream& out) {
+    out << "function " << function.index << " " << function.name << " (params "
+        << function.param_count << ", upvalues " << function.upvalue_count << ")\n";
+    for (const auto& block : function.blocks) {
+        out << "  b" << block->id << ":";
+        if (!block->predecessors.empty()) {
+            out << " ; preds";
+            for (const BasicBlock* pred : block->predecessors) out << " b" << pred->id;
+        }
+        out << "\n";
+        for (const auto& instruction : block->instructions) {
+            out << "    ";
+            if (instruction->type && !instruction->is_terminator() &&
+                instruction->op != Opcode::StoreGlobal && instruction->op != Opcode::SetProp &&
+                instruction->op != Opcode::DefineProp && instruction->op != Opcode::SetAct &&
+                instruction->op != Opcode::SetIndex) {
+                out << "%" << instruction->id << " : " << instruction->type->to_string() << " = ";
+            }
+            out << opcode_name(instruction->op);
+            switch (instruction->op) {
+                case Opcode::Const:
+                    out << " " << constant_text(*instruction);
+                    break;
+                case Opcode::Param:
+                case Opcode::Upvalue:
+                case Opcode::LoadGlobal:
+                case Opcode::StoreGlobal:
+                case Opcode::MakeAct:
+                    out << " #" << instruction->index;
+                    break;
+                case Opcode::ActIs:
+                    if (instruction->operands.size() == 1) out << " #" << instruction->index;
+                    break;
+                case Opcode::Convert:
+                    out << " to " << instruction->type->to_string();
+                    break;
+                default:
+                    break;
+            }
+            if (!instruction->name.empty()) out << " '" << instruction->name << "'";
+            for (size_t i = 0; i < instruction->operands.size(); ++i) {
+                out << (i == 0 ? " " : ", ") << "%" << instruction->operands[i]->id;
+                if (instruction->op == Opcode::Phi) out << " [b" << instruction->incoming[i]->id << "]";
+            }
+            for (const BasicBlock* target : instruction->targets) out << " -> b" << target->id;
+            if ((instruction->op == Opcode::Index || instruction->op == Opcode::SetIndex) &&
+                !instruction->bounds_check) {
+                out << " (unchecked)";
+            }
+            out << "\n";
+        }
+    }
+}
+
+void print_module(const Module& module, std::ostream& out) {
+    for (const auto& function : module.functions) print_function(*function, out);
+}
+
+}  // namespace ir
+}  // namespace tooi
@@ -0,0 +1,113 @@
+/**
+ * @file licm.cpp
+ * @brief Loop-invariant code motion.
+ */
+#include <algorithm>
+#include <set>
+
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+namespace {
+
+// What a loop may change, collected once before hoisting.
+struct LoopEffects {
+    bool has_calls = false;
+    bool has_index_stores = false;
+    std::set<int> stored_globals;
+};
+
+LoopEffects effects_of(const Loop& loop) {
+    LoopEffects effects;
+    for (const BasicBlock* block : loop.blocks) {
+        for (const auto& instruction : block->instructions) {
+            switch (instruction->op) {
+                case Opcode::Invoke:
+                case Opcode::CallMethod:
+                    effects.has_calls = true;
+                    break;
+                case Opcode::SetIndex:
+                    effects.has_index_stores = true;
+                    break;
+                case Opcode::StoreGlobal:
+                    effects.stored_globals.insert(instruction->index);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return effects;
+}
+
+// True if executing the instruction earlier than the loop does changes nothing
+// observable. `at_header_start`: no side effect or possible trap precedes it in the header.
+bool can_hoist(const Instruction& instruction, const LoopEffects& effects, bool at_header_start) {
+    switch (instruction.op) {
+        case Opcode::Length: {
+            // Arrays only change length through calls; assoc arrays also through stores.
+            const core::TypeRef& type = instruction.operands[0]->type;
+            bool grows_on_store = type->kind == core::TypeKind::Assoc || type->is_proto();
+            if (effects.has_calls || (grows_on_store && effects.has_index_stores)) return false;
+            break;
+        }
+        case Opcode::LoadGlobal:
+            if (effects.has_calls || effects.stored_globals.count(instruction.index)) return false;
+            break;
+        default:
+            if (!instruction.is_pure()) return false;
+            break;
+    }
+    return !instruction.may_trap() || at_header_start;
+}
+
+int hoist_from(const Loop& loop) {
+    LoopEffects effects = effects_of(loop);
+    BasicBlock* preheader = loop.preheader;
+    auto is_invariant = [&](const Instruction* value) { return !loop.contains(value->block); };
+
+    int hoisted = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BasicBlock* block : loop.blocks) {
+            bool at_header_start = block == loop.header;
+            for (size_t i = 0; i < block->instructions.size();) {
+                Instruction* instruction = block->instructions[i].get();
+                if (instruction->op != Opcode::Phi && !instruction->is_terminator() &&
+                    std::all_of(instruction->operands.begin(), instruction->operands.end(),
+                                is_invariant) &&
+                    can_hoist(*instruction, effects, at_header_start)) {
+                    preheader->insert_before_terminator(block->remove(instruction));
+                    hoisted++;
+                    changed = true;
+                    continue;
+                }
+                if (instruction->op != Opcode::Phi && instruction->may_trap()) {
+                    at_header_start = false;
+                }
+                ++i;
+            }
+        }
+    }
+    return hoisted;
+}
+
+}  // anonymous namespace
+
+int hoist_loop_invariants(Function& function) {
+    DominatorTree dominators(function);
+    int hoisted = 0;
+    // Innermost loops first, so that code hoisted into an inner preheader can
+    // move further out of the enclosing loop.
+    for (const auto& loop : find_loops(dominators)) {
+        if (loop->preheader) hoisted += hoist_from(*loop);
+    }
+    return hoisted;
+}
+
+}  // namespace ir
+}  // namespace tooi
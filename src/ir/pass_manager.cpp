@@ -0,0 +1,82 @@
+/**
+ * @file pass_manager.cpp
+ * @brief Implementation of the optimization pipeline driver.
+ */
+#include "tooi/ir/pass_manager.h"
+
+#include <chrono>
+#include <iomanip>
+
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+PassManager::PassManager()
+    : passes_{evaluate_pure_calls,
+              [this](Function& function) { return inline_small_acts(function, &inline_stats_); },
+              eliminate_common_subexpressions,
+              hoist_loop_invariants,
+              eliminate_bounds_checks,
+              eliminate_dead_code} {
+    for (const std::string& name : pass_names()) stats_.push_back(PassStats{name});
+}
+
+const std::vector<std::string>& PassManager::pass_names() {
+    static const std::vector<std::string> names{"ctfe", "inline", "cse", "licm", "bce", "dce"};
+    return names;
+}
+
+bool PassManager::disable(const std::string& name) {
+    for (PassStats& stats : stats_) {
+        if (stats.name == name) {
+            stats.enabled = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PassManager::run(Module& module, bool defer_acts) {
+    for (size_t i = 0; i < passes_.size(); ++i) {
+        for (const auto& function : module.functions) {
+            if (function->blocks.empty()) continue;  // Deferred act, see start()
+            if (defer_acts && i >= kInterproceduralPasses && !function->is_script) continue;
+            run_pass(i, *function);
+        }
+    }
+}
+
+void PassManager::start(Function& function) {
+    for (size_t i = 0; i < kInterproceduralPasses; ++i) run_pass(i, function);
+}
+
+void PassManager::finish(Function& function) {
+    for (size_t i = kInterproceduralPasses; i < passes_.size(); ++i) run_pass(i, function);
+}
+
+void PassManager::run_pass(size_t pass, Function& function) {
+    PassStats& stats = stats_[pass];
+    if (!stats.enabled) return;
+    auto start = std::chrono::steady_clock::now();
+    stats.changes += passes_[pass](function);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.milliseconds += elapsed.count();
+}
+
+void PassManager::print_stats(std::ostream& out) const {
+    out << "  Passes:\n";
+    for (const PassStats& stats : stats_) {
+        out << "    " << std::left << std::setw(7) << stats.name << std::right;
+        if (!stats.enabled) {
+            out << "disabled\n";
+            continue;
+        }
+        out << std::setw(6) << stats.changes << " change(s)  " << std::fixed
+            << std::setprecision(3) << stats.milliseconds << " ms\n";
+        out.unsetf(std::ios::fixed);
+    }
+}
+
+}  // namespace ir
+}  // namespace tooi
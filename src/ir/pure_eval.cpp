@@ -0,0 +1,605 @@
+/**
+ * @file pure_eval.cpp
+ * @brief Compile-time evaluation of pure acts invoked with constant arguments.
+ */
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tooi/core/constant_folding.h"
+#include "tooi/ir/passes.h"
+
+namespace tooi {
+namespace ir {
+
+using core::LiteralValue;
+using core::Type;
+using core::TypeKind;
+using core::TypeRef;
+
+namespace {
+
+// Invocations nested deeper than this are left to the runtime.
+const int kMaxEvaluationDepth = 64;
+
+struct ObjectState;
+
+/**
+ * A runtime value as the evaluator sees it. The type is always the concrete
+ * runtime type, never `proto`.
+ */
+struct Value {
+    TypeRef type;
+    LiteralValue scalar;                           // Primitives and strings
+    std::shared_ptr<std::vector<Value>> elements;  // Arrays and tuples
+    std::shared_ptr<const ObjectState> object;     // Objects
+
+    bool is_scalar() const { return !elements && !object; }
+};
+
+// An object that was fully built before the evaluated invocation.
+struct ObjectState {
+    TypeRef type;
+    const Function* act = nullptr;
+    std::vector<std::optional<Value>> closure;  // Upvalues, then param defaults
+    // Properties; a property whose value is not known maps to std::nullopt.
+    std::map<std::string, std::optional<Value>> properties;
+};
+
+Value scalar(TypeRef type, LiteralValue value) {
+    if (std::holds_alternative<std::monostate>(value)) type = Type::nil();
+    return Value{std::move(type), std::move(value), nullptr, nullptr};
+}
+
+// True if the instruction may run user code, which could rebind globals or modify objects.
+// Builtin methods of statically known receivers cannot.
+bool is_call(const Instruction& instruction) {
+    if (instruction.op == Opcode::Invoke) return true;
+    if (instruction.op != Opcode::CallMethod) return false;
+    const TypeRef& receiver = instruction.operands[0]->type;
+    return receiver->kind == TypeKind::Object || receiver->is_proto();
+}
+
+core::TokenType token_of(Opcode op) {
+    switch (op) {
+        case Opcode::Add:
+            return core::TokenType::PLUS;
+        case Opcode::Sub:
+            return core::TokenType::MINUS;
+        case Opcode::Mul:
+            return core::TokenType::ASTERISK;
+        case Opcode::Div:
+            return core::TokenType::SLASH;
+        case Opcode::Mod:
+            return core::TokenType::PERCENT;
+        case Opcode::Eq:
+            return core::TokenType::EQUAL_EQUAL;
+        case Opcode::Ne:
+            return core::TokenType::BANG_EQUAL;
+        case Opcode::Lt:
+            return core::TokenType::LESS;
+        case Opcode::Le:
+            return core::TokenType::LESS_EQUAL;
+        case Opcode::Gt:
+            return core::TokenType::GREATER;
+        default:
+            return core::TokenType::GREATER_EQUAL;
+    }
+}
+
+/**
+ * What is known at an invocation: the instructions that ran since the last
+ * call before it (on the straight-line path leading to it) and the globals
+ * they stored. Nothing else can have changed them in between.
+ */
+class CallSite {
+public:
+    explicit CallSite(const Instruction& invoke) {
+        const BasicBlock* block = invoke.block;
+        size_t end = block->position_of(&invoke);
+        std::unordered_set<const BasicBlock*> visited;
+        std::unordered_set<int> stored_later;
+        while (block && visited.insert(block).second) {
+            for (size_t i = end; i-- > 0;) {
+                const Instruction* instruction = block->instructions[i].get();
+                if (is_call(*instruction)) return;
+                visible_.insert(instruction);
+                if (instruction->op == Opcode::StoreGlobal) {
+                    // Walking backwards: the first store seen is the latest one.
+                    globals_.emplace(instruction->index, instruction->operands[0]);
+                    global_names_.emplace(instruction->name, instruction->operands[0]);
+                    stored_later.insert(instruction->index);
+                } else if (instruction->op == Opcode::LoadGlobal &&
+                           !stored_later.count(instruction->index)) {
+                    // Reads the same value the global still holds at the invocation.
+                    current_loads_.insert(instruction);
+                }
+            }
+            block = block->predecessors.size() == 1 ? block->predecessors[0] : nullptr;
+            if (block) end = block->instructions.size() - 1;  // Skip the terminator
+        }
+    }
+
+    std::optional<Value> value_of(const Instruction* instruction);
+    std::optional<Value> global(int index);
+    std::optional<Value> global(const std::string& name);
+
+private:
+    std::unordered_set<const Instruction*> visible_;
+    std::unordered_set<const Instruction*> current_loads_;
+    std::unordered_map<int, const Instruction*> globals_;
+    std::unordered_map<std::string, const Instruction*> global_names_;
+    std::unordered_map<const Instruction*, std::shared_ptr<const ObjectState>> objects_;
+
+    std::shared_ptr<const ObjectState> object_of(const Instruction* object);
+};
+
+std::optional<Value> CallSite::global(int index) {
+    auto it = globals_.find(index);
+    if (it == globals_.end()) return std::nullopt;
+    return value_of(it->second);
+}
+
+std::optional<Value> CallSite::global(const std::string& name) {
+    auto it = global_names_.find(name);
+    if (it == global_names_.end()) return std::nullopt;
+    return value_of(it->second);
+}
+
+std::optional<Value> CallSite::value_of(const Instruction* instruction) {
+    if (instruction->op == Opcode::Const) return scalar(instruction->type, instruction->constant);
+    if (instruction->op == Opcode::Convert && instruction->cast_kind != core::CastKind::Explicit) {
+        return value_of(instruction->operands[0]);  // Checked or widened before it was stored
+    }
+    if (instruction->op == Opcode::LoadGlobal) {
+        if (!current_loads_.count(instruction)) return std::nullopt;
+        return global(instruction->index);
+    }
+    if (instruction->op != Opcode::NewObject) return std::nullopt;
+    auto object = object_of(instruction);
+    if (!object) return std::nullopt;
+    return Value{object->type, {}, nullptr, object};
+}
+
+// An object is known if it was created since the last call and its mode and
+// act were only set by its own definition.
+std::shared_ptr<const ObjectState> CallSite::object_of(const Instruction* object) {
+    auto cached = objects_.find(object);
+    if (cached != objects_.end()) return cached->second;
+    objects_[object] = nullptr;
+    if (!visible_.count(object)) return nullptr;
+
+    const Instruction* set_act = nullptr;
+    std::vector<const Instruction*> defines;
+    // Users of the object, also through conversions and phis: (user, value it uses).
+    std::vector<std::pair<const Instruction*, const Instruction*>> users;
+    std::unordered_set<const Instruction*> expanded;
+    for (const Instruction* user : object->users) users.emplace_back(user, object);
+    for (size_t i = 0; i < users.size(); ++i) {
+        const auto [user, value] = users[i];
+        bool is_target = user->operands[0] == value;
+        switch (user->op) {
+            case Opcode::Convert:
+            case Opcode::Phi:
+                if (!expanded.insert(user).second) break;
+                for (const Instruction* next : user->users) users.emplace_back(next, user);
+                break;
+            case Opcode::SetAct:
+                if (set_act || !is_target) return nullptr;
+                set_act = user;
+                break;
+            case Opcode::DefineProp:
+                if (is_target) defines.push_back(user);
+                break;
+            case Opcode::SetProp:
+                if (is_target) return nullptr;
+                break;
+            default:
+                break;
+        }
+    }
+    // The act and the mode entries must be those of the object's own definition.
+    if (!set_act || set_act->block != object->block) return nullptr;
+    const Instruction* closure = set_act->operands[1];
+    if (closure->op != Opcode::MakeAct) return nullptr;
+    size_t act_position = object->block->position_of(set_act);
+    for (const Instruction* define : defines) {
+        if (define->block != object->block || define->block->position_of(define) > act_position) {
+            return nullptr;
+        }
+    }
+
+    auto state = std::make_shared<ObjectState>();
+    state->type = object->type;
+    state->act = object->block->function->module->functions[closure->index].get();
+    for (const Instruction* operand : closure->operands) {
+        state->closure.push_back(value_of(operand));
+    }
+    for (const Instruction* define : defines) {
+        state->properties[define->name] = value_of(define->operands[1]);
+    }
+    objects_[object] = state;
+    return state;
+}
+
+// Conversion of a value to the static type of a Convert or Param instruction.
+std::optional<Value> convert(const Value& value, const TypeRef& target, core::CastKind kind) {
+    if (target->is_proto() || core::types_equal(value.type, target)) return value;
+    if (kind == core::CastKind::Explicit) {
+        if (!value.is_scalar()) return std::nullopt;
+        auto result = core::convert_literal(value.scalar, value.type, target);
+        if (!result) return std::nullopt;
+        return scalar(target, std::move(*result));
+    }
+    // nil is a valid value of every non-primitive type.
+    if (value.type->kind == TypeKind::Nil && !target->is_primitive()) return value;
+    if (value.object && target->kind == TypeKind::Object) return value;
+    if (kind == core::CastKind::Widen && value.type->is_numeric() && target->is_numeric()) {
+        auto result = core::convert_numeric(value.scalar, value.type, target);
+        if (!result) return std::nullopt;
+        return scalar(target, std::move(*result));
+    }
+    return std::nullopt;  // The runtime check would fail or follows rules not modelled here
+}
+
+// Index of an element access, if it is an integer that fits a size.
+std::optional<size_t> element_index(const Value& index, size_t size) {
+    if (!index.is_scalar() || !index.type->is_integer()) return std::nullopt;
+    if (index.type->is_signed()) {
+        int64_t value = core::as_signed(index.scalar);
+        if (value < 0 || static_cast<uint64_t>(value) >= size) return std::nullopt;
+        return static_cast<size_t>(value);
+    }
+    uint64_t value = core::as_unsigned(index.scalar);
+    if (value >= size) return std::nullopt;
+    return static_cast<size_t>(value);
+}
+
+/**
+ * Interprets the IR of pure acts. Every operation either computes exactly
+ * what the runtime would, or gives up (std::nullopt): runtime errors,
+ * unknown values and anything with an effect outside the evaluation leave
+ * the invocation to the runtime.
+ */
+class Evaluator {
+public:
+    explicit Evaluator(CallSite& site) : site_(site) {}
+
+    std::optional<Value> invoke(const Value& callee, const std::vector<Value>& args, int depth);
+    /// Folds an operator or conversion whose operands are all constants.
+    std::optional<Value> fold(const Instruction& instruction);
+
+private:
+    struct Frame {
+        const Value* self;
+        const std::vector<Value>* args;
+        std::vector<Value> values;  // By instruction id
+
+        const Value& operator[](const Instruction* instruction) const {
+            return values[instruction->id];
+        }
+        void set(const Instruction* instruction, Value value) {
+            values[instruction->id] = std::move(value);
+        }
+    };
+
+    CallSite& site_;
+    int steps_ = 0;
+
+    std::optional<Value> execute(const Instruction& instruction, Frame& frame, int depth);
+    std::optional<Value> call_method(const Instruction& instruction, Frame& frame);
+};
+
+std::optional<Value> Evaluator::invoke(const Value& callee, const std::vector<Value>& args,
+                                       int depth) {
+    if (!callee.object || depth > kMaxEvaluationDepth) return std::nullopt;
+    const Function* function = callee.object->act;
+    if (!function->is_pure || static_cast<int>(args.size()) > function->param_count) {
+        return std::nullopt;
+    }
+
+    Frame frame{&callee, &args, std::vector<Value>(function->id_limit())};
+    const BasicBlock* previous = nullptr;
+    const BasicBlock* block = function->entry();
+    while (true) {
+        // Phis read their operands on entry to the block, all at once.
+        std::vector<std::pair<const Instruction*, Value>> phis;
+        size_t i = 0;
+        for (; i < block->instructions.size(); ++i) {
+            const Instruction* phi = block->instructions[i].get();
+            if (phi->op != Opcode::Phi) break;
+            for (size_t j = 0; j < phi->incoming.size(); ++j) {
+                if (phi->incoming[j] == previous) phis.emplace_back(phi, frame[phi->operands[j]]);
+            }
+        }
+        for (auto& [phi, value] : phis) frame.set(phi, std::move(value));
+
+        for (; i < block->instructions.size(); ++i) {
+            const Instruction& instruction = *block->instructions[i];
+            if (++steps_ > kEvaluationStepBudget) return std::nullopt;
+            if (instruction.op == Opcode::Return) return frame[instruction.operands[0]];
+            if (instruction.op == Opcode::Jump || instruction.op == Opcode::Branch) {
+                size_t target = 0;
+                if (instruction.op == Opcode::Branch) {
+                    const bool* condition =
+                        std::get_if<bool>(&frame[instruction.operands[0]].scalar);
+                    if (!condition) return std::nullopt;
+                    target = *condition ? 0 : 1;
+                }
+                previous = block;
+                block = instruction.targets[target];
+                break;
+            }
+            std::optional<Value> result = execute(instruction, frame, depth);
+            if (!result) return std::nullopt;
+            frame.set(&instruction, std::move(*result));
+        }
+    }
+}
+
+std::optional<Value> Evaluator::fold(const Instruction& instruction) {
+    Frame frame{nullptr, nullptr, std::vector<Value>(instruction.block->function->id_limit())};
+    for (const Instruction* operand : instruction.operands) {
+        if (operand->op != Opcode::Const) return std::nullopt;
+        frame.set(operand, scalar(operand->type, operand->constant));
+    }
+    return execute(instruction, frame, 0);
+}
+
+std::optional<Value> Evaluator::execute(const Instruction& instruction, Frame& frame, int depth) {
+    const ObjectState* self = frame.self ? frame.self->object.get() : nullptr;
+    auto operand = [&](size_t i) -> const Value& { return frame[instruction.operands[i]]; };
+    switch (instruction.op) {
+        case Opcode::Const:
+            return scalar(instruction.type, instruction.constant);
+        case Opcode::Param: {
+            size_t index = static_cast<size_t>(instruction.index);
+            std::optional<Value> value =
+                index < frame.args->size()
+                    ? (*frame.args)[index]
+                    : self->closure[self->act->upvalue_count + instruction.index];
+            if (!value) return std::nullopt;
+            return convert(*value, instruction.type, core::CastKind::Widen);
+        }
+        case Opcode::Upvalue:
+            return self->closure[instruction.index];
+        case Opcode::Self:
+            return *frame.self;
+        case Opcode::LoadGlobal:
+            return site_.global(instruction.index);
+        case Opcode::LoadName: {
+            auto property = self->properties.find(instruction.name);
+            if (property != self->properties.end()) return property->second;
+            return site_.global(instruction.name);
+        }
+        case Opcode::GetProp: {
+            const Value& object = operand(0);
+            if (!object.object) return std::nullopt;
+            auto property = object.object->properties.find(instruction.name);
+            if (property == object.object->properties.end()) return std::nullopt;
+            return property->second;
+        }
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod: {
+            const Value& a = operand(0);
+            const Value& b = operand(1);
+            if (!a.is_scalar() || !b.is_scalar() || !core::types_equal(a.type, b.type)) {
+                return std::nullopt;
+            }
+            auto result =
+                core::fold_arithmetic(token_of(instruction.op), a.scalar, b.scalar, a.type);
+            if (!result) return std::nullopt;
+            return scalar(a.type, std::move(*result));
+        }
+        case Opcode::Neg: {
+            const Value& a = operand(0);
+            if (!a.is_scalar()) return std::nullopt;
+            auto result = core::fold_negate(a.scalar, a.type);
+            if (!result) return std::nullopt;
+            return scalar(a.type, std::move(*result));
+        }
+        case Opcode::Not: {
+            const bool* value = std::get_if<bool>(&operand(0).scalar);
+            if (!value) return std::nullopt;
+            return scalar(Type::boolean(), !*value);
+        }
+        case Opcode::Truthy: {
+            const Value& a = operand(0);
+            const bool* flag = std::get_if<bool>(&a.scalar);
+            return scalar(Type::boolean(), a.type->kind != TypeKind::Nil && (!flag || *flag));
+        }
+        case Opcode::Eq:
+        case Opcode::Ne:
+        case Opcode::Lt:
+        case Opcode::Le:
+        case Opcode::Gt:
+        case Opcode::Ge: {
+            const Value& a = operand(0);
+            const Value& b = operand(1);
+            if (!a.is_scalar() || !b.is_scalar() || !core::types_equal(a.type, b.type)) {
+                return std::nullopt;
+            }
+            auto result =
+                core::fold_comparison(token_of(instruction.op), a.scalar, b.scalar, a.type);
+            if (!result) return std::nullopt;
+            return scalar(Type::boolean(), *result);
+        }
+        case Opcode::Concat: {
+            const Value& a = operand(0);
+            const Value& b = operand(1);
+            if (!a.is_scalar() || !b.is_scalar()) return std::nullopt;
+            return scalar(Type::string(), core::display_string(a.scalar, a.type) +
+                                              core::display_string(b.scalar, b.type));
+        }
+        case Opcode::Convert:
+            return convert(operand(0), instruction.type, instruction.cast_kind);
+        case Opcode::NewArray:
+        case Opcode::NewTuple: {
+            auto elements = std::make_shared<std::vector<Value>>();
+            for (const Instruction* element : instruction.operands) {
+                elements->push_back(frame[element]);
+            }
+            return Value{instruction.type, {}, std::move(elements), nullptr};
+        }
+        case Opcode::Index: {
+            const Value& sequence = operand(0);
+            if (sequence.elements) {
+                auto index = element_index(operand(1), sequence.elements->size());
+                if (!index) return std::nullopt;
+                return (*sequence.elements)[*index];
+            }
+            const std::string* text = std::get_if<std::string>(&sequence.scalar);
+            if (!text) return std::nullopt;
+            auto index = element_index(operand(1), text->size());
+            if (!index) return std::nullopt;
+            return scalar(Type::string(), std::string(1, (*text)[*index]));
+        }
+        case Opcode::SetIndex: {
+            const Value& sequence = operand(0);
+            if (!sequence.elements || sequence.type->kind != TypeKind::Array) return std::nullopt;
+            auto index = element_index(operand(1), sequence.elements->size());
+            if (!index) return std::nullopt;
+            (*sequence.elements)[*index] = operand(2);
+            return scalar(Type::nil(), {});
+        }
+        case Opcode::Length: {
+            const Value& sequence = operand(0);
+            size_t length;
+            if (sequence.elements) {
+                length = sequence.elements->size();
+            } else if (const std::string* text = std::get_if<std::string>(&sequence.scalar)) {
+                length = text->size();
+            } else {
+                return std::nullopt;
+            }
+            return scalar(instruction.type, static_cast<int64_t>(length));
+        }
+        case Opcode::IterSource: {
+            const Value& sequence = operand(0);
+            if (!sequence.elements && !std::holds_alternative<std::string>(sequence.scalar)) {
+                return std::nullopt;
+            }
+            return sequence;
+        }
+        case Opcode::CallMethod:
+            return call_method(instruction, frame);
+        case Opcode::Invoke: {
+            std::vector<Value> args;
+            for (size_t i = 1; i < instruction.operands.size(); ++i) args.push_back(operand(i));
+            return invoke(operand(0), args, depth + 1);
+        }
+        default:
+            // Object creation and stores outside the evaluation are not modelled.
+            return std::nullopt;
+    }
+}
+
+std::optional<Value> Evaluator::call_method(const Instruction& instruction, Frame& frame) {
+    const Value& receiver = frame[instruction.operands[0]];
+    if (!receiver.elements || receiver.type->kind != TypeKind::Array) return std::nullopt;
+    std::vector<Value>& elements = *receiver.elements;
+    if (instruction.name == "push" && instruction.operands.size() == 2) {
+        elements.push_back(frame[instruction.operands[1]]);
+        return scalar(Type::nil(), {});
+    }
+    if (instruction.name == "pop" && instruction.operands.size() == 1 && !elements.empty()) {
+        Value last = elements.back();
+        elements.pop_back();
+        return last;
+    }
+    return std::nullopt;
+}
+
+bool is_foldable(Opcode op) {
+    switch (op) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod:
+        case Opcode::Neg:
+        case Opcode::Not:
+        case Opcode::Truthy:
+        case Opcode::Eq:
+        case Opcode::Ne:
+        case Opcode::Lt:
+        case Opcode::Le:
+        case Opcode::Gt:
+        case Opcode::Ge:
+        case Opcode::Concat:
+        case Opcode::Convert:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Instruction* replace_with_constant(Instruction* instruction, Value value) {
+    BasicBlock* block = instruction->block;
+    auto constant = block->function->create(Opcode::Const, value.type, instruction->loc);
+    constant->constant = std::move(value.scalar);
+    Instruction* result = block->insert(block->position_of(instruction), std::move(constant));
+    instruction->replace_all_uses_with(result);
+    instruction->drop_operands();
+    block->erase(instruction);
+    return result;
+}
+
+// Folds the operations that became constant once an invocation was evaluated
+// (its result is usually `proto`, so the AstOptimizer could not fold them).
+int fold_users(Instruction* constant, Evaluator& evaluator) {
+    int folded = 0;
+    std::vector<Instruction*> worklist{constant};
+    while (!worklist.empty()) {
+        Instruction* value = worklist.back();
+        worklist.pop_back();
+        std::unordered_set<Instruction*> users(value->users.begin(), value->users.end());
+        for (Instruction* user : users) {
+            if (!is_foldable(user->op)) continue;
+            std::optional<Value> result = evaluator.fold(*user);
+            if (!result || !result->is_scalar()) continue;
+            worklist.push_back(replace_with_constant(user, std::move(*result)));
+            folded++;
+        }
+    }
+    return folded;
+}
+
+}  // anonymous namespace
+
+int evaluate_pure_calls(Function& function) {
+    int evaluated = 0;  // Invocations and the operations folded after them
+    for (const auto& block : function.blocks) {
+        for (size_t i = 0; i < block->instructions.size(); ++i) {
+            Instruction* invoke = block->instructions[i].get();
+            if (invoke->op != Opcode::Invoke) continue;
+            std::vector<Value> args;
+            for (size_t j = 1; j < invoke->operands.size(); ++j) {
+                const Instruction* arg = invoke->operands[j];
+                if (arg->op != Opcode::Const) break;
+                args.push_back(scalar(arg->type, arg->constant));
+            }
+            if (args.size() + 1 != invoke->operands.size()) continue;
+
+            CallSite site(*invoke);
+            std::optional<Value> callee = site.value_of(invoke->operands[0]);
+            if (!callee) continue;
+            Evaluator evaluator(site);
+            std::optional<Value> result = evaluator.invoke(*callee, args, 0);
+            // Only primitive results can be embedded in the code.
+            if (!result || !result->is_scalar()) continue;
+
+            Instruction* constant = replace_with_constant(invoke, std::move(*result));
+            evaluated += fold_users(constant, evaluator);
+            evaluated++;
+        }
+    }
+    return evaluated;
+}
+
+}  // namespace ir
+}  // namespace tooi
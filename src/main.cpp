@@ -86,7 +86,7 @@ int main(int argc, char* argv[]) {
                 // Use Magenta for verbose status
                 std::cout << BOLD_MAGENTA << "Starting REPL in verbose mode..." << RESET << std::endl;
             }
-            Repl repl(verbose); // Pass flag to Repl constructor
+            Repl repl(args_parser.get_options()); // Pass settings to Repl constructor
             repl.run();
         } break;
         case RunMode::FILE: {
@@ -95,7 +95,7 @@ int main(int argc, char* argv[]) {
                 std::cout << BOLD_MAGENTA << "Running file in verbose mode: " << args_parser.get_filename() << RESET << std::endl;
             }
             // Pass flag to run_from_file
-            if (!tooi::cli::run_from_file(args_parser.get_filename(), verbose)) {
+            if (!tooi::cli::run_from_file(args_parser.get_filename(), args_parser.get_options())) {
                 // run_from_file now returns false if errors occurred
                 exit_code = 1;
             }
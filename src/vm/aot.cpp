@@ -0,0 +1,282 @@
+/**
+ * @file aot.cpp
+ * @brief Translation of compiled scripts to C++, and attaching the result at startup.
+ */
+#include "tooi/vm/aot.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+// The kinds typed fast paths exist for, with the C++ type of their payload.
+const std::pair<ValueKind, const char*> kTypedKinds[] = {
+    {ValueKind::Int32, "int32_t"},  {ValueKind::Int64, "int64_t"},
+    {ValueKind::UInt32, "uint32_t"}, {ValueKind::UInt64, "uint64_t"},
+    {ValueKind::Float64, "double"},
+};
+
+bool is_arithmetic(Opcode op) { return op >= Opcode::Add && op <= Opcode::Mod; }
+bool is_comparison(Opcode op) { return op >= Opcode::Eq && op <= Opcode::Ge; }
+
+// A C++ string literal holding `text`, one source line per literal.
+std::string string_literal(const std::string& text) {
+    std::string literal = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        auto c = static_cast<unsigned char>(text[i]);
+        if (c == '\n') {
+            literal += "\\n\"";
+            if (i + 1 == text.size()) return literal;
+            literal += "\n    \"";
+        } else if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += static_cast<char>(c);
+        } else if (c >= 0x20 && c < 0x7f) {
+            literal += static_cast<char>(c);
+        } else {
+            // Always three octal digits, so that a digit after it is not taken in
+            literal += {'\\', static_cast<char>('0' + (c >> 6)),
+                        static_cast<char>('0' + (c >> 3 & 7)), static_cast<char>('0' + (c & 7))};
+        }
+    }
+    return literal + '"';
+}
+
+/**
+ * @class ChunkWriter
+ * @brief Writes the AotFunction of one chunk.
+ *
+ * Mirrors the Jit's templates instruction for instruction: a statement per
+ * instruction working on the frame's slots, under a label the function's
+ * entry switch can jump to, and `return position` wherever the interpreter
+ * has to take over.
+ */
+class ChunkWriter {
+public:
+    ChunkWriter(const Chunk& chunk, std::ostream& out) : chunk_(chunk), out_(out) {}
+
+    void write() {
+        const std::vector<uint32_t>& code = chunk_.code;
+        std::vector<uint32_t> starts;
+        for (uint32_t position = 0; position < code.size();) {
+            starts.push_back(position);
+            position += static_cast<uint32_t>(instruction_length(part_at(position)));
+        }
+        out_ << "// " << (chunk_.name.empty() ? "<script>" : chunk_.name) << "\n"
+             << "uint32_t chunk_" << chunk_.index << "(Value* slots, const Value* constants,"
+             << " JitContext* context,\n"
+             << "                 uint32_t position) {\n"
+             << "    (void)constants;\n"
+             << "    (void)context;\n"
+             << "    switch (position) {\n";
+        for (uint32_t position : starts) {
+            out_ << "        case " << position << ": goto at_" << position << ";\n";
+        }
+        out_ << "        default: return position;\n"
+             << "    }\n";
+        for (uint32_t position : starts) {
+            out_ << "at_" << position << ":  // " << opcode_name(part_at(position)) << "\n";
+            instruction(position, part_at(position));
+        }
+        out_ << "    return " << starts.back() << ";\n"
+             << "}\n\n";
+    }
+
+private:
+    const Chunk& chunk_;
+    std::ostream& out_;
+
+    // A superinstruction only stands for its first part; the others follow in place.
+    Opcode part_at(uint32_t position) const {
+        return superinstruction_parts(decode_op(chunk_.code[position])).front();
+    }
+
+    static std::string slot(uint32_t index) { return "slots[" + std::to_string(index) + "]"; }
+
+    static std::string source(uint32_t operand) {
+        if (operand & kConstantFlag) {
+            return "constants[" + std::to_string(operand & ~kConstantFlag) + "]";
+        }
+        return slot(operand);
+    }
+
+    void instruction(uint32_t position, Opcode op) {
+        const uint32_t* words = &chunk_.code[position];
+        uint32_t a = decode_operand(words[0]);
+        switch (op) {
+            case Opcode::Move:
+                statement(slot(a) + " = " + source(words[1]));
+                return;
+            case Opcode::LoadSelf:
+                statement(slot(a) + " = context->self");
+                return;
+            case Opcode::LoadGlobal:
+                statement(slot(a) + " = context->globals[" + std::to_string(words[1]) + "]");
+                return;
+            case Opcode::StoreGlobal:
+                statement("context->globals[" + std::to_string(a) + "] = " + source(words[1]));
+                return;
+            case Opcode::Not:
+                statement(slot(a) + " = Value::boolean(!" + source(words[1]) + ".truthy())");
+                return;
+            case Opcode::Truthy:
+                statement(slot(a) + " = Value::boolean(" + source(words[1]) + ".truthy())");
+                return;
+            case Opcode::Jump:
+                if (a <= position) {
+                    // A loop back edge: let the interpreter collect if the heap asks for it.
+                    statement("if (*context->heap_count >= *context->heap_threshold) return " +
+                              std::to_string(position));
+                }
+                statement("goto at_" + std::to_string(a));
+                return;
+            case Opcode::JumpIfFalse:
+                statement("if (!" + source(words[1]) + ".truthy()) goto at_" + std::to_string(a));
+                return;
+            case Opcode::JumpIfTrue:
+                statement("if (" + source(words[1]) + ".truthy()) goto at_" + std::to_string(a));
+                return;
+            case Opcode::GetProp:
+            case Opcode::GetPropObject:
+                statement("if (!cached_property(" + source(words[1]) + ", context->caches[" +
+                          std::to_string(words[3]) + "], " + slot(a) + ")) return " +
+                          std::to_string(position));
+                return;
+            case Opcode::Cast:
+            case Opcode::Coerce:
+                conversion(position, op, a, words[1], chunk_.types[words[2]]);
+                return;
+            default:
+                break;
+        }
+        Opcode generic = generic_opcode(op);
+        if (!is_arithmetic(generic) && !is_comparison(generic)) {
+            statement("return " + std::to_string(position));
+            return;
+        }
+        // A typed instruction has one fast path. A generic one tries those of
+        // int and float64, the kinds it is most often quickened to.
+        const char* fast = is_arithmetic(generic) ? "typed_arithmetic" : "typed_compare";
+        std::string condition;
+        for (const auto& [kind, type] : kTypedKinds) {
+            Opcode typed = typed_opcode(generic, kind);
+            bool applies = op == generic ? typed != generic &&
+                                               (kind == ValueKind::Int32 ||
+                                                kind == ValueKind::Float64)
+                                         : typed == op;
+            if (!applies) continue;
+            if (!condition.empty()) condition += " &&\n        ";
+            condition += std::string("!") + fast + "<Opcode::" + opcode_name(generic) + ", " +
+                         type + ">(" + source(words[1]) + ", " + source(words[2]) + ", " +
+                         slot(a) + ")";
+        }
+        if (condition.empty()) condition = "true";
+        statement("if (" + condition + ") return " + std::to_string(position));
+    }
+
+    // Conversions to the type a value already has, and `as float64` of an int.
+    void conversion(uint32_t position, Opcode op, uint32_t a, uint32_t x,
+                    const core::TypeRef& target) {
+        std::string exit = "return " + std::to_string(position);
+        if (target->is_proto()) {
+            statement(slot(a) + " = " + source(x));
+            return;
+        }
+        if (!target->is_primitive()) {
+            statement(exit);
+            return;
+        }
+        ValueKind kind = kind_of(target);
+        for (const auto& [typed, type] : kTypedKinds) {
+            if (typed != kind) continue;
+            std::string copy = "if (Operand<" + std::string(type) + ">::is(" + source(x) +
+                               ")) " + slot(a) + " = " + source(x);
+            if (kind == ValueKind::Float64 && op == Opcode::Cast) {
+                copy += ";\n    else if (" + source(x) + ".is_int32()) " + slot(a) +
+                        " = Value::number(ValueKind::Float64, " + source(x) + ".as_int())";
+            }
+            statement(copy + ";\n    else " + exit);
+            return;
+        }
+        statement(exit);
+    }
+
+    void statement(const std::string& text) { out_ << "    " << text << ";\n"; }
+};
+
+}  // anonymous namespace
+
+uint64_t fingerprint(const Chunk& chunk) {
+    // FNV-1a over the words, the opcode byte taken from the unfused instruction
+    uint64_t hash = 0xcbf29ce484222325u;
+    auto mix = [&](uint32_t word) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash ^= (word >> shift) & 0xff;
+            hash *= 0x100000001b3u;
+        }
+    };
+    for (size_t position = 0; position < chunk.code.size();) {
+        Opcode op = superinstruction_parts(decode_op(chunk.code[position])).front();
+        size_t length = instruction_length(op);
+        mix(encode(op, decode_operand(chunk.code[position])));
+        for (size_t i = 1; i < length; ++i) mix(chunk.code[position + i]);
+        position += length;
+    }
+    return hash;
+}
+
+bool attach(const AotProgram& program, Chunk& chunk) {
+    auto index = static_cast<size_t>(chunk.index);
+    if (index >= program.count || fingerprint(chunk) != program.fingerprints[index]) return false;
+    chunk.aot = program.functions[index];
+    return true;
+}
+
+void emit_cpp(const CompiledModule& module, const std::string& source,
+              const core::InterpreterOptions& options, std::ostream& out) {
+    std::string disabled_passes;
+    for (const std::string& name : options.disabled_passes) {
+        disabled_passes += (disabled_passes.empty() ? "" : ",") + name;
+    }
+    out << "// Generated by tooi --emit-cpp. Build it against the runtime library, e.g.\n"
+        << "//   c++ -std=c++23 -O2 -I <tooi>/include -I <build>/generated program.cpp \\\n"
+        << "//       -L <build> -ltooi_runtime -llinenoise -lfmt -o program\n"
+        << "#include \"tooi/cli/run_compiled.h\"\n"
+        << "#include \"tooi/vm/fast_paths.h\"\n"
+        << "#include \"tooi/vm/jit.h\"\n\n"
+        << "namespace {\n\n"
+        << "using namespace tooi::vm;\n\n";
+    for (const auto& chunk : module.functions) ChunkWriter(*chunk, out).write();
+
+    out << "const AotFunction kFunctions[] = {";
+    for (const auto& chunk : module.functions) {
+        out << (chunk->index % 4 ? " " : "\n    ") << "chunk_" << chunk->index << ",";
+    }
+    out << "\n};\n\n"
+        << "const uint64_t kFingerprints[] = {";
+    for (const auto& chunk : module.functions) {
+        out << (chunk->index % 4 ? " " : "\n    ") << "0x" << std::hex << fingerprint(*chunk)
+            << std::dec << "u,";
+    }
+    out << "\n};\n\n"
+        << "const AotProgram kProgram = {\n"
+        << "    " << string_literal(source) << ",\n"
+        << "    " << (options.optimize ? "true" : "false") << ",\n"
+        << "    " << string_literal(disabled_passes) << ",\n"
+        << "    kFunctions,\n"
+        << "    kFingerprints,\n"
+        << "    " << module.functions.size() << ",\n"
+        << "};\n\n"
+        << "}  // namespace\n\n"
+        << "int main(int argc, char* argv[]) {\n"
+        << "    return tooi::cli::run_compiled(kProgram, argc, argv);\n"
+        << "}\n";
+}
+
+}  // namespace vm
+}  // namespace tooi
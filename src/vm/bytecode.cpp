@@ -0,0 +1,277 @@
+/**
+ * @file bytecode.cpp
+ * @brief Opcode tables and the bytecode disassembler.
+ */
+#include "tooi/vm/bytecode.h"
+
+#include <iomanip>
+#include <iterator>
+
+#include "tooi/vm/object.h"
+
+namespace tooi {
+namespace vm {
+
+const char* opcode_name(Opcode op) {
+    static const char* const names[] = {
+#define TOOI_VM_OPCODE_NAME(name, ...) #name,
+        TOOI_VM_OPCODES(TOOI_VM_OPCODE_NAME)
+        TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_OPCODE_NAME)
+#undef TOOI_VM_OPCODE_NAME
+    };
+    return names[static_cast<int>(op)];
+}
+
+const std::vector<OperandKind>& operand_kinds(Opcode op) {
+    using enum OperandKind;
+    static const std::vector<OperandKind> kinds[] = {
+#define TOOI_VM_OPCODE_OPERANDS(name, ...) {__VA_ARGS__},
+        TOOI_VM_OPCODES(TOOI_VM_OPCODE_OPERANDS)
+#undef TOOI_VM_OPCODE_OPERANDS
+    };
+    // A superinstruction is encoded as its first instruction.
+    if (static_cast<size_t>(op) >= std::size(kinds)) {
+        return operand_kinds(superinstruction_parts(op).front());
+    }
+    return kinds[static_cast<int>(op)];
+}
+
+const std::vector<Opcode>& superinstruction_parts(Opcode op) {
+    using enum Opcode;
+    static const std::vector<Opcode> parts[] = {
+#define TOOI_VM_OPCODE_PARTS(name, ...) {name},
+        TOOI_VM_OPCODES(TOOI_VM_OPCODE_PARTS)
+#undef TOOI_VM_OPCODE_PARTS
+#define TOOI_VM_SUPERINSTRUCTION_PARTS(name, ...) {__VA_ARGS__},
+        TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_SUPERINSTRUCTION_PARTS)
+#undef TOOI_VM_SUPERINSTRUCTION_PARTS
+    };
+    static_assert(std::size(parts) <= 256, "opcodes must fit in the opcode byte");
+    return parts[static_cast<int>(op)];
+}
+
+void fuse_superinstruction(std::vector<uint32_t>& code, size_t position) {
+    static const std::vector<Opcode> superinstructions = {
+#define TOOI_VM_SUPERINSTRUCTION_OPCODE(name, ...) Opcode::name,
+        TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_SUPERINSTRUCTION_OPCODE)
+#undef TOOI_VM_SUPERINSTRUCTION_OPCODE
+    };
+    // Instructions are compared by their first part, since a following one
+    // may itself have been fused already.
+    auto part_at = [&](size_t at) { return superinstruction_parts(decode_op(code[at])).front(); };
+    Opcode best = part_at(position);
+    size_t best_length = 1;
+    for (Opcode fused : superinstructions) {
+        const std::vector<Opcode>& parts = superinstruction_parts(fused);
+        if (parts.size() <= best_length) continue;
+        size_t at = position;
+        size_t matched = 0;
+        while (matched < parts.size() && at < code.size() && part_at(at) == parts[matched]) {
+            at += instruction_length(parts[matched++]);
+        }
+        if (matched == parts.size()) {
+            best = fused;
+            best_length = parts.size();
+        }
+    }
+    if (best_length > 1) code[position] = encode(best, decode_operand(code[position]));
+}
+
+void unfuse_superinstructions(std::vector<uint32_t>& code, size_t position) {
+    // Instructions only have known lengths from the start of the code. A
+    // superinstruction has at most three parts, so only the two instructions
+    // before `position` can cover it.
+    size_t before[2] = {position, position};
+    for (size_t at = 0; at < position; at += instruction_length(decode_op(code[at]))) {
+        before[0] = before[1];
+        before[1] = at;
+    }
+    for (size_t start : before) {
+        if (start == position) continue;
+        const std::vector<Opcode>& parts = superinstruction_parts(decode_op(code[start]));
+        size_t end = start;
+        for (Opcode part : parts) end += instruction_length(part);
+        if (parts.size() == 1 || end <= position) continue;
+        code[start] = encode(parts.front(), decode_operand(code[start]));
+        fuse_superinstruction(code, start);
+    }
+}
+
+#define TOOI_VM_TYPED_OPCODE(type)    \
+    switch (op) {                     \
+        case Opcode::Add:             \
+            return Opcode::Add##type; \
+        case Opcode::Sub:             \
+            return Opcode::Sub##type; \
+        case Opcode::Mul:             \
+            return Opcode::Mul##type; \
+        case Opcode::Div:             \
+            return Opcode::Div##type; \
+        case Opcode::Mod:             \
+            return Opcode::Mod##type; \
+        case Opcode::Eq:              \
+            return Opcode::Eq##type;  \
+        case Opcode::Ne:              \
+            return Opcode::Ne##type;  \
+        case Opcode::Lt:              \
+            return Opcode::Lt##type;  \
+        case Opcode::Le:              \
+            return Opcode::Le##type;  \
+        case Opcode::Gt:              \
+            return Opcode::Gt##type;  \
+        case Opcode::Ge:              \
+            return Opcode::Ge##type;  \
+        default:                      \
+            return op;                \
+    }
+
+Opcode typed_opcode(Opcode op, ValueKind kind) {
+    switch (kind) {
+        case ValueKind::Int32:
+            TOOI_VM_TYPED_OPCODE(I32)
+        case ValueKind::Int64:
+            TOOI_VM_TYPED_OPCODE(I64)
+        case ValueKind::UInt32:
+            TOOI_VM_TYPED_OPCODE(U32)
+        case ValueKind::UInt64:
+            TOOI_VM_TYPED_OPCODE(U64)
+        case ValueKind::Float64:
+            TOOI_VM_TYPED_OPCODE(F64)
+        default:
+            return op;
+    }
+}
+
+#undef TOOI_VM_TYPED_OPCODE
+
+#define TOOI_VM_GENERIC_CASES(type) \
+    case Opcode::Add##type:         \
+        return Opcode::Add;         \
+    case Opcode::Sub##type:         \
+        return Opcode::Sub;         \
+    case Opcode::Mul##type:         \
+        return Opcode::Mul;         \
+    case Opcode::Div##type:         \
+        return Opcode::Div;         \
+    case Opcode::Mod##type:         \
+        return Opcode::Mod;         \
+    case Opcode::Eq##type:          \
+        return Opcode::Eq;          \
+    case Opcode::Ne##type:          \
+        return Opcode::Ne;          \
+    case Opcode::Lt##type:          \
+        return Opcode::Lt;          \
+    case Opcode::Le##type:          \
+        return Opcode::Le;          \
+    case Opcode::Gt##type:          \
+        return Opcode::Gt;          \
+    case Opcode::Ge##type:          \
+        return Opcode::Ge;
+
+Opcode generic_opcode(Opcode op) {
+    switch (op) {
+        TOOI_VM_GENERIC_CASES(I32)
+        TOOI_VM_GENERIC_CASES(I64)
+        TOOI_VM_GENERIC_CASES(U32)
+        TOOI_VM_GENERIC_CASES(U64)
+        TOOI_VM_GENERIC_CASES(F64)
+        case Opcode::ConcatStr:
+            return Opcode::Concat;
+        case Opcode::GetPropObject:
+            return Opcode::GetProp;
+        default: {
+            // A superinstruction falls back to its first instruction.
+            Opcode first = superinstruction_parts(op).front();
+            return first == op ? op : generic_opcode(first);
+        }
+    }
+}
+
+#undef TOOI_VM_GENERIC_CASES
+
+namespace {
+
+std::string constant_text(const Value& value) {
+    std::string text = std::string(kind_name(value.kind())) + " ";
+    if (value.is(ValueKind::String)) return text + '"' + as_string(value)->text + '"';
+    return text + display_string(value);
+}
+
+}  // anonymous namespace
+
+void print_chunk(const Chunk& chunk, std::ostream& out) {
+    out << "chunk " << chunk.name << " (params " << chunk.param_count << ", slots "
+        << chunk.slot_count << ")\n";
+    for (size_t pc = 0; pc < chunk.code.size();) {
+        Opcode op = decode_op(chunk.code[pc]);
+        out << "  " << std::setw(4) << std::setfill('0') << pc << std::setfill(' ') << "  "
+            << std::left << std::setw(13) << opcode_name(op) << ' ' << std::right;
+        std::string comment;
+        const std::vector<OperandKind>& kinds = operand_kinds(op);
+        for (size_t i = 0; i < kinds.size(); ++i) {
+            uint32_t operand = i == 0 ? decode_operand(chunk.code[pc]) : chunk.code[pc + i];
+            if (i > 0) out << ", ";
+            switch (kinds[i]) {
+                case OperandKind::Register:
+                    out << "s" << operand;
+                    break;
+                case OperandKind::Source:
+                    if (operand & kConstantFlag) {
+                        uint32_t index = operand & ~kConstantFlag;
+                        out << "#" << index;
+                        comment += (comment.empty() ? "" : ", ") + std::string("#") +
+                                   std::to_string(index) + " = " +
+                                   constant_text(chunk.constants[index]);
+                    } else {
+                        out << "s" << operand;
+                    }
+                    break;
+                case OperandKind::Upvalue:
+                    out << "u" << operand;
+                    break;
+                case OperandKind::Global:
+                    out << "g" << operand;
+                    break;
+                case OperandKind::Name:
+                    out << "'" << chunk.names[operand] << "'";
+                    break;
+                case OperandKind::Type:
+                    out << chunk.types[operand]->to_string();
+                    break;
+                case OperandKind::Count:
+                    out << operand;
+                    break;
+                case OperandKind::Function:
+                    out << "f" << operand;
+                    comment += (comment.empty() ? "" : ", ") + std::string("f") +
+                               std::to_string(operand) + " = " +
+                               chunk.module->functions[operand]->name;
+                    break;
+                case OperandKind::Target:
+                    out << "-> " << std::setw(4) << std::setfill('0') << operand
+                        << std::setfill(' ');
+                    break;
+                case OperandKind::Cache:
+                    out << "ic" << operand;
+                    break;
+                case OperandKind::Flags:
+                    out << ((operand & kPropertyIsSet) ? "set" : "let");
+                    if (operand & kPropertyIsPrivate) out << " private";
+                    break;
+            }
+        }
+        if (!comment.empty()) out << "  ; " << comment;
+        out << "\n";
+        pc += kinds.size();
+    }
+}
+
+void print_compiled_module(const CompiledModule& module, std::ostream& out) {
+    for (size_t i = 0; i < module.functions.size(); ++i) {
+        if (i > 0) out << "\n";
+        print_chunk(*module.functions[i], out);
+    }
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,81 @@
+/**
+ * @file code_cache.cpp
+ * @brief Implementation of the executable memory that holds JIT-compiled code.
+ */
+#include "tooi/vm/code_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define TOOI_HAS_MMAP 1
+#else
+#define TOOI_HAS_MMAP 0
+#endif
+
+namespace tooi {
+namespace vm {
+
+CodeCache::~CodeCache() {
+    while (!blocks_.empty()) release(blocks_.begin());
+}
+
+NativeCode* CodeCache::install(NativeCode*& owner, uint32_t& hotness,
+                               const std::vector<uint8_t>& code, std::vector<uint32_t> entries) {
+#if TOOI_HAS_MMAP
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t mapped = (code.size() + page - 1) / page * page;
+    if (mapped > capacity_) return nullptr;
+    while (used_ + mapped > capacity_) {
+        auto oldest = std::min_element(blocks_.begin(), blocks_.end(),
+                                       [](const NativeCode& x, const NativeCode& y) {
+                                           return x.last_used < y.last_used;
+                                       });
+        release(oldest);
+        evictions_++;
+    }
+
+    void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                        0);
+    if (memory == MAP_FAILED) return nullptr;
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped);
+        return nullptr;
+    }
+    used_ += mapped;
+    blocks_.push_back(NativeCode{&owner, &hotness, static_cast<const uint8_t*>(memory), mapped,
+                                 code.size(), std::move(entries)});
+    NativeCode& native = blocks_.back();
+    touch(native);
+    owner = &native;
+    return &native;
+#else
+    (void)owner;
+    (void)hotness;
+    (void)code;
+    (void)entries;
+    return nullptr;
+#endif
+}
+
+void CodeCache::evict(NativeCode*& owner) {
+    auto block = std::find_if(blocks_.begin(), blocks_.end(),
+                              [&](const NativeCode& native) { return &native == owner; });
+    if (block != blocks_.end()) release(block);
+}
+
+void CodeCache::release(std::list<NativeCode>::iterator block) {
+#if TOOI_HAS_MMAP
+    munmap(const_cast<uint8_t*>(block->code), block->mapped);
+#endif
+    used_ -= block->mapped;
+    *block->owner = nullptr;
+    *block->hotness = 0;
+    blocks_.erase(block);
+}
+
+}  // namespace vm
+}  // namespace tooi
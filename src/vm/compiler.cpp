@@ -0,0 +1,714 @@
+/**
+ * @file compiler.cpp
+ * @brief Implementation of the IR to bytecode compiler.
+ */
+#include "tooi/vm/compiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <map>
+#include <unordered_map>
+
+#include "tooi/core/constant_folding.h"
+#include "tooi/ir/analysis.h"
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+using IrOp = ir::Opcode;
+
+// Instructions that define a value.
+bool has_result(IrOp op) {
+    switch (op) {
+        case IrOp::StoreGlobal:
+        case IrOp::SetProp:
+        case IrOp::DefineProp:
+        case IrOp::SetAct:
+        case IrOp::SetIndex:
+        case IrOp::Jump:
+        case IrOp::Branch:
+        case IrOp::Return:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Builtin methods with an opcode of their own, for receivers of a known collection type.
+struct Intrinsic {
+    core::TypeKind receiver;
+    const char* name;
+    size_t argc;
+    Opcode op;
+};
+
+const Intrinsic kIntrinsics[] = {
+    {core::TypeKind::Array, "push", 1, Opcode::ArrayPush},
+    {core::TypeKind::Array, "pop", 0, Opcode::ArrayPop},
+    {core::TypeKind::Array, "insert", 2, Opcode::ArrayInsert},
+    {core::TypeKind::Array, "remove", 1, Opcode::ArrayRemove},
+    {core::TypeKind::Assoc, "has", 1, Opcode::AssocHas},
+    {core::TypeKind::Assoc, "remove", 1, Opcode::AssocRemove},
+};
+
+// The intrinsic a method call compiles to, if any.
+const Intrinsic* intrinsic(const ir::Instruction& call) {
+    if (call.op != IrOp::CallMethod) return nullptr;
+    core::TypeKind receiver = call.operands[0]->type->kind;
+    for (const Intrinsic& candidate : kIntrinsics) {
+        if (candidate.receiver == receiver && call.name == candidate.name &&
+            call.operands.size() == candidate.argc + 1) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+// Instructions that read their operands from the window.
+bool uses_window(const ir::Instruction& instruction) {
+    switch (instruction.op) {
+        case IrOp::MakeAct:
+        case IrOp::Invoke:
+        case IrOp::NewArray:
+        case IrOp::NewTuple:
+        case IrOp::NewAssoc:
+            return true;
+        case IrOp::CallMethod:
+            return !intrinsic(instruction);  // Intrinsics read their operands in place
+        default:
+            return false;
+    }
+}
+
+// Values used in place rather than computed into a slot.
+bool is_operand_only(const ir::Instruction& instruction) {
+    return instruction.op == IrOp::Const || instruction.op == IrOp::Phi ||
+           (instruction.op == IrOp::Param && instruction.type->is_proto());
+}
+
+// An invocation whose value its block returns right away: the callee can take over the frame.
+bool is_tail_call(const ir::Instruction& instruction) {
+    if (instruction.op != IrOp::Invoke) return false;
+    const ir::BasicBlock* block = instruction.block;
+    const ir::Instruction* terminator = block->terminator();
+    if (terminator->op != IrOp::Return || terminator->operands[0] != &instruction) return false;
+    for (size_t i = block->position_of(&instruction) + 1;
+         block->instructions[i].get() != terminator; ++i) {
+        if (!is_operand_only(*block->instructions[i])) return false;
+    }
+    return true;
+}
+
+bool has_phis(const ir::BasicBlock* block) {
+    return !block->instructions.empty() && block->instructions.front()->op == IrOp::Phi;
+}
+
+Opcode simple_opcode(IrOp op) {
+    switch (op) {
+        case IrOp::Add:
+            return Opcode::Add;
+        case IrOp::Sub:
+            return Opcode::Sub;
+        case IrOp::Mul:
+            return Opcode::Mul;
+        case IrOp::Div:
+            return Opcode::Div;
+        case IrOp::Mod:
+            return Opcode::Mod;
+        case IrOp::Neg:
+            return Opcode::Neg;
+        case IrOp::Not:
+            return Opcode::Not;
+        case IrOp::Eq:
+            return Opcode::Eq;
+        case IrOp::Ne:
+            return Opcode::Ne;
+        case IrOp::Lt:
+            return Opcode::Lt;
+        case IrOp::Le:
+            return Opcode::Le;
+        case IrOp::Gt:
+            return Opcode::Gt;
+        case IrOp::Ge:
+            return Opcode::Ge;
+        case IrOp::Truthy:
+            return Opcode::Truthy;
+        case IrOp::Concat:
+            return Opcode::Concat;
+        case IrOp::CloneObject:
+            return Opcode::CloneObject;
+        case IrOp::Index:
+            return Opcode::Index;
+        case IrOp::Length:
+            return Opcode::Length;
+        default:
+            assert(op == IrOp::IterSource);
+            return Opcode::IterSource;
+    }
+}
+
+// The typed form of a binary opcode, when both operands are statically of one type.
+Opcode static_typed_opcode(Opcode op, const ir::Instruction& left, const ir::Instruction& right) {
+    if (left.type->kind != right.type->kind || !left.type->is_primitive()) return op;
+    return typed_opcode(op, kind_of(left.type));
+}
+
+/**
+ * Compiles one function. Slots are assigned before any code is emitted,
+ * since the window sits above all value slots.
+ */
+class FunctionCompiler {
+public:
+    FunctionCompiler(const ir::Function& function, Chunk& chunk, Heap& heap)
+        : function_(function), chunk_(chunk), heap_(heap), next_slot_(function.param_count) {}
+
+    void compile();
+
+private:
+    const ir::Function& function_;
+    Chunk& chunk_;
+    Heap& heap_;
+    std::vector<ir::BasicBlock*> order_;
+    int next_slot_;
+    int window_ = 0;   ///< First window slot
+    int scratch_ = 0;  ///< Slot for unused results and for breaking copy cycles
+    core::SourceLocation loc_;
+    std::unordered_map<const ir::Instruction*, int> slots_;
+    std::unordered_map<const ir::Instruction*, int> window_positions_;
+    std::unordered_map<const ir::BasicBlock*, size_t> labels_;
+    std::vector<std::pair<size_t, const ir::BasicBlock*>> fixups_;  ///< Jump word, target
+    std::map<std::pair<int, uint64_t>, uint32_t> scalar_constants_;
+    std::unordered_map<std::string, uint32_t> string_constants_;
+    std::unordered_map<std::string, uint32_t> names_;
+
+    void assign_slots();
+    /// The phi whose slot the value can be computed into, if any.
+    const ir::Instruction* coalesced_phi(const ir::Instruction& value) const;
+    /// The window position the value can be computed into, or -1.
+    int window_position(const ir::Instruction& value) const;
+
+    void compile_block(const ir::BasicBlock* block, const ir::BasicBlock* next);
+    void compile_instruction(const ir::Instruction& instruction);
+    void compile_branch(const ir::BasicBlock* block, const ir::Instruction& branch,
+                        const ir::BasicBlock* next);
+    /// Copies the phi operands of the edge into the phis' slots.
+    void emit_edge(const ir::BasicBlock* from, const ir::BasicBlock* to);
+    void jump_to(Opcode op, const ir::BasicBlock* target, uint32_t condition = 0);
+    /// Moves the operands of a window instruction into place; returns the window.
+    uint32_t fill_window(const ir::Instruction& instruction);
+
+    void emit(Opcode op, std::initializer_list<uint32_t> operands);
+    /// Slot written by an instruction.
+    uint32_t result(const ir::Instruction& instruction);
+    /// Source operand reading a value.
+    uint32_t source(const ir::Instruction* value);
+    uint32_t constant(const ir::Instruction& value);
+    uint32_t name(const std::string& text);
+    uint32_t type(const core::TypeRef& type);
+    /// A new inline cache for a property access or method call site.
+    uint32_t cache();
+};
+
+void FunctionCompiler::compile() {
+    chunk_.name = function_.name;
+    chunk_.index = function_.index;
+    chunk_.param_count = function_.param_count;
+    chunk_.upvalue_count = function_.upvalue_count;
+
+    ir::DominatorTree dominators(function_);
+    order_ = dominators.reverse_postorder();
+    assign_slots();
+    for (size_t i = 0; i < order_.size(); ++i) {
+        labels_[order_[i]] = chunk_.code.size();
+        compile_block(order_[i], i + 1 < order_.size() ? order_[i + 1] : nullptr);
+    }
+    for (auto [position, target] : fixups_) {
+        chunk_.code[position] = encode(decode_op(chunk_.code[position]),
+                                       static_cast<uint32_t>(labels_.at(target)));
+    }
+    // Sequences with a superinstruction run as one (see bytecode.h).
+    for (size_t position = 0; position < chunk_.code.size();
+         position += instruction_length(decode_op(chunk_.code[position]))) {
+        fuse_superinstruction(chunk_.code, position);
+    }
+}
+
+void FunctionCompiler::assign_slots() {
+    // Phis first, so that the values coalesced with them can share their slot.
+    for (const ir::BasicBlock* block : order_) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == IrOp::Phi) slots_[instruction.get()] = next_slot_++;
+        }
+    }
+    int window_size = 0;
+    for (const ir::BasicBlock* block : order_) {
+        for (const auto& instruction : block->instructions) {
+            if (uses_window(*instruction)) {
+                window_size = std::max(window_size, static_cast<int>(instruction->operands.size()));
+            }
+            if (is_operand_only(*instruction) || instruction->op == IrOp::Param ||
+                !has_result(instruction->op) || instruction->users.empty()) {
+                continue;
+            }
+            if (const ir::Instruction* phi = coalesced_phi(*instruction)) {
+                slots_[instruction.get()] = slots_.at(phi);
+            } else if (int position = window_position(*instruction); position >= 0) {
+                window_positions_[instruction.get()] = position;
+            } else {
+                slots_[instruction.get()] = next_slot_++;
+            }
+        }
+    }
+    window_ = next_slot_;
+    scratch_ = window_ + window_size;
+    chunk_.slot_count = scratch_ + 1;
+    assert(static_cast<uint32_t>(chunk_.slot_count) < kConstantFlag);
+}
+
+const ir::Instruction* FunctionCompiler::coalesced_phi(const ir::Instruction& value) const {
+    if (value.users.size() != 1 || value.users[0]->op != IrOp::Phi) return nullptr;
+    const ir::Instruction* phi = value.users[0];
+    const ir::BasicBlock* block = value.block;
+    const ir::Instruction* terminator = block->terminator();
+    if (terminator->op != IrOp::Jump || terminator->targets[0] != phi->block) return nullptr;
+    // The phi's current value must be dead once the value is written: it may
+    // not be read later in the block nor by the copies on the edge.
+    size_t position = block->position_of(&value);
+    for (const ir::Instruction* user : phi->users) {
+        if (user->block == block && block->position_of(user) > position) return nullptr;
+        if (user->op == IrOp::Phi && user->block == phi->block) return nullptr;
+    }
+    return phi;
+}
+
+int FunctionCompiler::window_position(const ir::Instruction& value) const {
+    if (value.users.size() != 1) return -1;
+    const ir::Instruction* user = value.users[0];
+    if (!uses_window(*user) || user->block != value.block) return -1;
+    const ir::BasicBlock* block = value.block;
+    size_t end = block->position_of(user);
+    for (size_t i = block->position_of(&value) + 1; i < end; ++i) {
+        if (uses_window(*block->instructions[i])) return -1;
+    }
+    for (size_t i = 0; i < user->operands.size(); ++i) {
+        if (user->operands[i] == &value) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void FunctionCompiler::compile_block(const ir::BasicBlock* block, const ir::BasicBlock* next) {
+    for (const auto& instruction : block->instructions) {
+        if (instruction->is_terminator()) break;
+        if (!is_operand_only(*instruction)) compile_instruction(*instruction);
+    }
+    const ir::Instruction* terminator = block->terminator();
+    assert(terminator);
+    loc_ = terminator->loc;
+    switch (terminator->op) {
+        case IrOp::Jump: {
+            const ir::BasicBlock* target = terminator->targets[0];
+            emit_edge(block, target);
+            if (target != next) jump_to(Opcode::Jump, target);
+            break;
+        }
+        case IrOp::Branch:
+            compile_branch(block, *terminator, next);
+            break;
+        default:
+            // A tail call returns in its place
+            if (!is_tail_call(*terminator->operands[0])) {
+                emit(Opcode::Return, {source(terminator->operands[0])});
+            }
+            break;
+    }
+}
+
+void FunctionCompiler::compile_branch(const ir::BasicBlock* block, const ir::Instruction& branch,
+                                      const ir::BasicBlock* next) {
+    uint32_t condition = source(branch.operands[0]);
+    const ir::BasicBlock* if_true = branch.targets[0];
+    const ir::BasicBlock* if_false = branch.targets[1];
+    bool true_copies = has_phis(if_true);
+    bool false_copies = has_phis(if_false);
+
+    if (!true_copies && !false_copies) {
+        if (if_true == next) {
+            jump_to(Opcode::JumpIfFalse, if_false, condition);
+        } else {
+            jump_to(Opcode::JumpIfTrue, if_true, condition);
+            if (if_false != next) jump_to(Opcode::Jump, if_false);
+        }
+    } else if (!false_copies) {
+        jump_to(Opcode::JumpIfFalse, if_false, condition);
+        emit_edge(block, if_true);
+        if (if_true != next) jump_to(Opcode::Jump, if_true);
+    } else if (!true_copies) {
+        jump_to(Opcode::JumpIfTrue, if_true, condition);
+        emit_edge(block, if_false);
+        if (if_false != next) jump_to(Opcode::Jump, if_false);
+    } else {
+        // Both edges copy: the false edge gets a stub after the true edge.
+        size_t stub = chunk_.code.size();
+        emit(Opcode::JumpIfFalse, {0, condition});
+        emit_edge(block, if_true);
+        jump_to(Opcode::Jump, if_true);
+        chunk_.code[stub] = encode(Opcode::JumpIfFalse, static_cast<uint32_t>(chunk_.code.size()));
+        emit_edge(block, if_false);
+        if (if_false != next) jump_to(Opcode::Jump, if_false);
+    }
+}
+
+void FunctionCompiler::emit_edge(const ir::BasicBlock* from, const ir::BasicBlock* to) {
+    struct Copy {
+        uint32_t target;
+        uint32_t source;
+    };
+    std::vector<Copy> copies;
+    for (const auto& instruction : to->instructions) {
+        if (instruction->op != IrOp::Phi) break;
+        for (size_t i = 0; i < instruction->incoming.size(); ++i) {
+            if (instruction->incoming[i] != from) continue;
+            uint32_t target = result(*instruction);
+            uint32_t value = source(instruction->operands[i]);
+            if (value != target) copies.push_back({target, value});
+            break;
+        }
+    }
+    // Sequentialize the parallel copy: a copy can go once no other pending
+    // copy reads its target. If only cycles remain, one target is saved first.
+    while (!copies.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < copies.size(); ++i) {
+            bool read = false;
+            for (const Copy& other : copies) read = read || other.source == copies[i].target;
+            if (read) continue;
+            emit(Opcode::Move, {copies[i].target, copies[i].source});
+            copies.erase(copies.begin() + static_cast<std::ptrdiff_t>(i));
+            progress = true;
+            break;
+        }
+        if (progress) continue;
+        uint32_t saved = copies.front().target;
+        emit(Opcode::Move, {static_cast<uint32_t>(scratch_), saved});
+        for (Copy& copy : copies) {
+            if (copy.source == saved) copy.source = static_cast<uint32_t>(scratch_);
+        }
+    }
+}
+
+void FunctionCompiler::jump_to(Opcode jump, const ir::BasicBlock* target, uint32_t condition) {
+    fixups_.emplace_back(chunk_.code.size(), target);
+    if (jump == Opcode::Jump) {
+        emit(jump, {0});
+    } else {
+        emit(jump, {0, condition});
+    }
+}
+
+uint32_t FunctionCompiler::fill_window(const ir::Instruction& instruction) {
+    for (size_t i = 0; i < instruction.operands.size(); ++i) {
+        const ir::Instruction* value = instruction.operands[i];
+        if (window_positions_.count(value)) continue;  // Computed in place
+        emit(Opcode::Move, {static_cast<uint32_t>(window_ + i), source(value)});
+    }
+    return static_cast<uint32_t>(window_);
+}
+
+void FunctionCompiler::compile_instruction(const ir::Instruction& instruction) {
+    if (has_result(instruction.op) && instruction.users.empty() &&
+        !instruction.has_side_effects() && !instruction.may_trap()) {
+        return;  // Dead (only left behind with --no-opt)
+    }
+    loc_ = instruction.loc;
+    const auto& operands = instruction.operands;
+    switch (instruction.op) {
+        case IrOp::Param: {
+            // Arguments arrive unconverted: check or widen them in place.
+            uint32_t slot = static_cast<uint32_t>(instruction.index);
+            emit(Opcode::Coerce, {slot, slot, type(instruction.type)});
+            break;
+        }
+        case IrOp::Self:
+            emit(Opcode::LoadSelf, {result(instruction)});
+            break;
+        case IrOp::Upvalue:
+            emit(Opcode::LoadUpvalue,
+                 {result(instruction), static_cast<uint32_t>(instruction.index)});
+            break;
+        case IrOp::LoadGlobal:
+            emit(Opcode::LoadGlobal,
+                 {result(instruction), static_cast<uint32_t>(instruction.index)});
+            break;
+        case IrOp::StoreGlobal:
+            emit(Opcode::StoreGlobal,
+                 {static_cast<uint32_t>(instruction.index), source(operands[0])});
+            break;
+        case IrOp::LoadName:
+            emit(Opcode::LoadName, {result(instruction), name(instruction.name)});
+            break;
+        case IrOp::AddModule:
+            emit(Opcode::AddModule, {result(instruction), name(instruction.name)});
+            break;
+        case IrOp::Convert:
+            emit(instruction.cast_kind == core::CastKind::Explicit ? Opcode::Cast : Opcode::Coerce,
+                 {result(instruction), source(operands[0]), type(instruction.type)});
+            break;
+        case IrOp::NewObject:
+            emit(Opcode::NewObject, {result(instruction), name(instruction.name)});
+            break;
+        case IrOp::GetProp: {
+            bool object = operands[0]->type->kind == core::TypeKind::Object;
+            emit(object ? Opcode::GetPropObject : Opcode::GetProp,
+                 {result(instruction), source(operands[0]), name(instruction.name), cache()});
+            break;
+        }
+        case IrOp::SetProp:
+            emit(Opcode::SetProp,
+                 {source(operands[0]), name(instruction.name), source(operands[1]), cache()});
+            break;
+        case IrOp::DefineProp: {
+            const core::TypeRef& declared = instruction.property_type;
+            emit(Opcode::DefineProp,
+                 {source(operands[0]), name(instruction.name), source(operands[1]),
+                  (instruction.is_set ? kPropertyIsSet : 0) |
+                      (instruction.is_private ? kPropertyIsPrivate : 0),
+                  type(declared ? declared : core::Type::proto())});
+            break;
+        }
+        case IrOp::SetAct:
+            emit(Opcode::SetAct, {source(operands[0]), source(operands[1])});
+            break;
+        case IrOp::SetIndex:
+            emit(Opcode::SetIndex,
+                 {source(operands[0]), source(operands[1]), source(operands[2])});
+            break;
+        case IrOp::ActIs:
+            if (operands.size() == 2) {
+                emit(Opcode::ActIs,
+                     {result(instruction), source(operands[0]), source(operands[1])});
+            } else {
+                emit(Opcode::ActIsFunction, {result(instruction), source(operands[0]),
+                                             static_cast<uint32_t>(instruction.index)});
+            }
+            break;
+        case IrOp::MakeAct: {
+            uint32_t window = fill_window(instruction);
+            emit(Opcode::MakeAct,
+                 {result(instruction), static_cast<uint32_t>(instruction.index), window});
+            break;
+        }
+        case IrOp::Invoke: {
+            uint32_t window = fill_window(instruction);
+            uint32_t argc = static_cast<uint32_t>(operands.size() - 1);
+            if (is_tail_call(instruction)) {
+                emit(Opcode::TailInvoke, {window, argc});
+            } else {
+                emit(Opcode::Invoke, {result(instruction), window, argc});
+            }
+            break;
+        }
+        case IrOp::CallMethod: {
+            if (const Intrinsic* builtin = intrinsic(instruction)) {
+                // Array (or assoc) methods run inline; the VM checks the receiver's kind.
+                switch (builtin->argc) {
+                    case 0:
+                        emit(builtin->op, {result(instruction), source(operands[0])});
+                        break;
+                    case 1:
+                        emit(builtin->op,
+                             {result(instruction), source(operands[0]), source(operands[1])});
+                        break;
+                    default:
+                        emit(builtin->op, {result(instruction), source(operands[0]),
+                                           source(operands[1]), source(operands[2])});
+                        break;
+                }
+                break;
+            }
+            uint32_t window = fill_window(instruction);
+            uint32_t argc = static_cast<uint32_t>(operands.size() - 1);
+            emit(Opcode::CallMethod,
+                 {result(instruction), window, name(instruction.name), argc, cache()});
+            break;
+        }
+        case IrOp::NewArray:
+        case IrOp::NewTuple:
+        case IrOp::NewAssoc: {
+            uint32_t window = fill_window(instruction);
+            Opcode opcode = instruction.op == IrOp::NewArray   ? Opcode::NewArray
+                            : instruction.op == IrOp::NewTuple ? Opcode::NewTuple
+                                                               : Opcode::NewAssoc;
+            emit(opcode,
+                 {result(instruction), window, static_cast<uint32_t>(operands.size())});
+            break;
+        }
+        default:
+            if (operands.size() == 1) {
+                emit(simple_opcode(instruction.op), {result(instruction), source(operands[0])});
+            } else {
+                emit(static_typed_opcode(simple_opcode(instruction.op), *operands[0], *operands[1]),
+                     {result(instruction), source(operands[0]), source(operands[1])});
+            }
+            break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Emission helpers
+// ----------------------------------------------------------------------------
+
+void FunctionCompiler::emit(Opcode opcode, std::initializer_list<uint32_t> operands) {
+    assert(operands.size() == instruction_length(opcode));
+    bool first = true;
+    for (uint32_t operand : operands) {
+        assert(operand <= kMaxOperand || !first);
+        chunk_.code.push_back(first ? encode(opcode, operand) : operand);
+        chunk_.locations.push_back(loc_);
+        first = false;
+    }
+}
+
+uint32_t FunctionCompiler::result(const ir::Instruction& instruction) {
+    if (auto it = window_positions_.find(&instruction); it != window_positions_.end()) {
+        return static_cast<uint32_t>(window_ + it->second);
+    }
+    auto it = slots_.find(&instruction);
+    return static_cast<uint32_t>(it != slots_.end() ? it->second : scratch_);
+}
+
+uint32_t FunctionCompiler::source(const ir::Instruction* value) {
+    switch (value->op) {
+        case IrOp::Const:
+            return constant(*value) | kConstantFlag;
+        case IrOp::Param:
+            return static_cast<uint32_t>(value->index);
+        default:
+            return result(*value);
+    }
+}
+uint32_t FunctionCompiler::constant(const ir::Instruction& value) {
+    const core::LiteralValue& literal = value.constant;
+    const core::TypeRef& type = value.type;
+    if (const std::string* text = std::get_if<std::string>(&literal)) {
+        auto [it, inserted] =
+            string_constants_.emplace(*text, static_cast<uint32_t>(chunk_.constants.size()));
+        if (inserted) chunk_.constants.push_back(heap_.string(*text));
+        return it->second;
+    }
+
+    // Scalars are deduplicated by kind and 64-bit pattern, before a wide integer is boxed.
+    ValueKind kind = ValueKind::Nil;
+    uint64_t bits = 0;
+    if (const bool* flag = std::get_if<bool>(&literal)) {
+        kind = ValueKind::Bool;
+        bits = *flag;
+    } else if (!std::holds_alternative<std::monostate>(literal)) {
+        // Numbers take the kind of their static type; untyped ones that of the literal.
+        kind = type->is_numeric()                          ? kind_of(type)
+               : std::holds_alternative<double>(literal)   ? ValueKind::Float64
+               : std::holds_alternative<uint64_t>(literal) ? ValueKind::UInt64
+                                                           : ValueKind::Int64;
+        if (is_float_kind(kind)) {
+            bits = std::bit_cast<uint64_t>(core::as_double(literal));
+        } else if (is_signed_kind(kind)) {
+            bits = static_cast<uint64_t>(core::as_signed(literal));
+        } else {
+            bits = core::as_unsigned(literal);
+        }
+    }
+    auto [it, inserted] = scalar_constants_.emplace(std::make_pair(static_cast<int>(kind), bits),
+                                                    static_cast<uint32_t>(chunk_.constants.size()));
+    if (!inserted) return it->second;
+    if (kind == ValueKind::Bool) {
+        chunk_.constants.push_back(Value::boolean(bits != 0));
+    } else if (is_float_kind(kind)) {
+        chunk_.constants.push_back(Value::number(kind, std::bit_cast<double>(bits)));
+    } else if (is_signed_kind(kind)) {
+        chunk_.constants.push_back(Value::signed_int(kind, static_cast<int64_t>(bits), heap_));
+    } else if (is_unsigned_kind(kind)) {
+        chunk_.constants.push_back(Value::unsigned_int(kind, bits, heap_));
+    } else {
+        chunk_.constants.push_back(Value::nil());
+    }
+    return it->second;
+}
+
+uint32_t FunctionCompiler::name(const std::string& text) {
+    auto [it, inserted] = names_.emplace(text, static_cast<uint32_t>(chunk_.names.size()));
+    if (inserted) chunk_.names.push_back(text);
+    return it->second;
+}
+
+uint32_t FunctionCompiler::type(const core::TypeRef& type) {
+    chunk_.types.push_back(type);
+    return static_cast<uint32_t>(chunk_.types.size() - 1);
+}
+
+uint32_t FunctionCompiler::cache() {
+    chunk_.caches.emplace_back();
+    return static_cast<uint32_t>(chunk_.caches.size() - 1);
+}
+
+// A chunk without code yet, for Compiler::compile_act().
+std::unique_ptr<Chunk> lazy_chunk(const ir::Function& function, const CompiledModule& module) {
+    auto chunk = std::make_unique<Chunk>();
+    chunk->module = &module;
+    chunk->name = function.name;
+    chunk->index = function.index;
+    chunk->param_count = function.param_count;
+    chunk->upvalue_count = function.upvalue_count;
+    return chunk;
+}
+
+}  // anonymous namespace
+
+Compiler::Compiler(Heap& heap) : heap_(heap) {}
+
+std::unique_ptr<CompiledModule> Compiler::compile(const ir::Module& module, std::string source) {
+    auto result = std::make_unique<CompiledModule>();
+    result->source = std::move(source);
+    for (const auto& function : module.functions) {
+        auto chunk = std::make_unique<Chunk>();
+        chunk->module = result.get();
+        FunctionCompiler(*function, *chunk, heap_).compile();
+        result->functions.push_back(std::move(chunk));
+    }
+    return result;
+}
+
+std::unique_ptr<CompiledModule> Compiler::compile_lazily(
+    std::shared_ptr<ir::Module> module, std::string source,
+    std::function<void(ir::Function&)> prepare) {
+    auto result = std::make_unique<CompiledModule>();
+    result->source = std::move(source);
+    for (const auto& function : module->functions) {
+        if (!function->is_script) {
+            result->functions.push_back(lazy_chunk(*function, *result));
+            continue;
+        }
+        auto chunk = std::make_unique<Chunk>();
+        chunk->module = result.get();
+        FunctionCompiler(*function, *chunk, heap_).compile();
+        result->functions.push_back(std::move(chunk));
+    }
+    result->ir = std::move(module);
+    result->prepare = std::move(prepare);
+    return result;
+}
+
+void Compiler::compile_act(Chunk& chunk) {
+    const CompiledModule& module = *chunk.module;
+    ir::Function& function = *module.ir->functions[chunk.index];
+    if (module.prepare) module.prepare(function);
+    // Building a deferred act body adds the acts nested in it.
+    for (size_t i = module.functions.size(); i < module.ir->functions.size(); ++i) {
+        module.functions.push_back(lazy_chunk(*module.ir->functions[i], module));
+    }
+    FunctionCompiler(function, chunk, heap_).compile();
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,48 @@
+/**
+ * @file deopt.cpp
+ * @brief Implementation of deoptimization reasons and shape dependencies.
+ */
+#include "tooi/vm/deopt.h"
+
+#include "tooi/vm/object.h"
+
+namespace tooi {
+namespace vm {
+
+const char* deopt_reason_name(DeoptReason reason) {
+    switch (reason) {
+        case DeoptReason::Kind:
+            return "kind";
+        case DeoptReason::Shape:
+            return "shape";
+        case DeoptReason::Act:
+            return "act";
+        case DeoptReason::Overflow:
+            return "overflow";
+        case DeoptReason::Range:
+            return "range";
+    }
+    return "?";
+}
+
+void Dependencies::add(Object& object, NativeCode*& owner) {
+    object.watched = true;
+    dependents_[&object].push_back({&owner, owner});
+}
+
+size_t Dependencies::invalidate(Object& object, CodeCache& cache) {
+    object.watched = false;
+    auto it = dependents_.find(&object);
+    if (it == dependents_.end()) return 0;
+    size_t evicted = 0;
+    for (const Dependent& dependent : it->second) {
+        if (*dependent.owner != dependent.code) continue;  // Evicted or replaced already
+        cache.evict(*dependent.owner);
+        evicted++;
+    }
+    dependents_.erase(it);
+    return evicted;
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,197 @@
+/**
+ * @file heap.cpp
+ * @brief Implementation of the garbage-collected heap, assoc arrays and object shapes.
+ */
+#include "tooi/vm/heap.h"
+
+#include <algorithm>
+
+namespace tooi {
+namespace vm {
+
+// ============================================================================
+// AssocObject
+// ============================================================================
+
+const Value* AssocObject::find(const Value& key) const {
+    const Table& table = table_.get();
+    auto it = table.index.find(key);
+    return it == table.index.end() ? nullptr : &table.entries[it->second].second;
+}
+
+void AssocObject::set(const Value& key, const Value& value) {
+    Table& table = table_.writable();
+    auto [it, inserted] = table.index.emplace(key, table.entries.size());
+    if (inserted) {
+        table.entries.emplace_back(key, value);
+    } else {
+        table.entries[it->second].second = value;
+    }
+}
+
+bool AssocObject::remove(const Value& key, Value* removed) {
+    if (!find(key)) return false;
+    Table& table = table_.writable();
+    auto it = table.index.find(key);
+    size_t position = it->second;
+    if (removed) *removed = table.entries[position].second;
+    table.index.erase(it);
+    table.entries.erase(table.entries.begin() + static_cast<std::ptrdiff_t>(position));
+    for (auto& [entry_key, entry_position] : table.index) {
+        if (entry_position > position) entry_position--;
+    }
+    return true;
+}
+
+// ============================================================================
+// Shapes and objects
+// ============================================================================
+
+namespace {
+
+bool same_declared_type(const core::TypeRef& a, const core::TypeRef& b) {
+    return a == b || (a && b && core::types_equal(a, b));
+}
+
+}  // anonymous namespace
+
+Shape* Shape::transition(const std::string& name, bool is_set, bool is_private,
+                         const core::TypeRef& type) {
+    const Property* existing = find(name);
+    if (existing && existing->is_set == is_set && existing->is_private == is_private &&
+        same_declared_type(existing->type, type)) {
+        return this;
+    }
+    for (const Transition& transition : transitions) {
+        if (transition.name == name && transition.is_set == is_set &&
+            transition.is_private == is_private && same_declared_type(transition.type, type)) {
+            return transition.target.get();
+        }
+    }
+    auto target = std::make_unique<Shape>();
+    target->properties = properties;
+    target->slot_count = slot_count;
+    auto [it, added] = target->properties.try_emplace(name, Property{slot_count});
+    if (added) target->slot_count++;
+    it->second.is_set = is_set;
+    it->second.is_private = is_private;
+    it->second.type = type;
+    transitions.push_back(Transition{name, is_set, is_private, type, std::move(target)});
+    return transitions.back().target.get();
+}
+
+void Object::define(const std::string& property, const Value& value, bool is_set,
+                    bool is_private, const core::TypeRef& type) {
+    shape = shape->transition(property, is_set, is_private, type);
+    std::vector<Value>& values = writable_slots();
+    values.resize(shape->slot_count);
+    values[shape->find(property)->slot] = value;
+}
+
+void Object::unshare_slots() {
+    auto* own = storage_ ? new SlotStorage{storage_->values} : new SlotStorage;
+    release_slots();
+    storage_ = own;
+}
+
+// ============================================================================
+// Value
+// ============================================================================
+
+Value Value::box_integer(ValueKind kind, uint64_t value, Heap& heap) {
+    return Value::heap(heap.make<IntegerObject>(kind, value));
+}
+
+// ============================================================================
+// Heap
+// ============================================================================
+
+Heap::~Heap() {
+    while (objects_) {
+        HeapObject* next = objects_->next;
+        delete objects_;
+        objects_ = next;
+    }
+}
+
+Object* Heap::copy(Object& original) {
+    Object* copy = object(original.name);
+    copy->shape = original.shape;
+    copy->share_slots(original);
+    copy->act = original.act;
+    std::span<const Value> values = original.slots();
+    for (size_t slot = 0; slot < values.size(); ++slot) {
+        if (values[slot].is(ValueKind::Array)) {
+            auto* array = make<ArrayObject>(ValueKind::Array, std::vector<Value>());
+            array->share_elements(*as_array(values[slot]));
+            copy->writable_slots()[slot] = Value::heap(array);
+        } else if (values[slot].is(ValueKind::Assoc)) {
+            auto* assoc = make<AssocObject>();
+            assoc->share_entries(*as_assoc(values[slot]));
+            copy->writable_slots()[slot] = Value::heap(assoc);
+        }
+    }
+    return copy;
+}
+
+void Heap::mark(HeapObject* object) {
+    if (!object || object->marked) return;
+    object->marked = true;
+    gray_.push_back(object);
+}
+
+void Heap::trace(HeapObject* object) {
+    switch (object->kind) {
+        case ValueKind::Array:
+        case ValueKind::Tuple:
+            for (const Value& element : static_cast<ArrayObject*>(object)->elements()) {
+                mark(element);
+            }
+            break;
+        case ValueKind::Assoc:
+            for (const auto& [key, value] : static_cast<AssocObject*>(object)->entries()) {
+                mark(key);
+                mark(value);
+            }
+            break;
+        case ValueKind::Object: {
+            auto* instance = static_cast<Object*>(object);
+            for (const Value& value : instance->slots()) mark(value);
+            mark(instance->act);
+            break;
+        }
+        case ValueKind::Closure:
+            for (const Value& value : static_cast<Closure*>(object)->captured) mark(value);
+            break;
+        default:
+            break;
+    }
+}
+
+void Heap::collect(const std::function<void(Heap&)>& mark_roots) {
+    mark_roots(*this);
+    while (!gray_.empty()) {
+        HeapObject* object = gray_.back();
+        gray_.pop_back();
+        trace(object);
+    }
+
+    // Sweep: free what was not reached and clear the marks of the rest.
+    HeapObject** link = &objects_;
+    while (*link) {
+        HeapObject* object = *link;
+        if (object->marked) {
+            object->marked = false;
+            link = &object->next;
+        } else {
+            *link = object->next;
+            delete object;
+            count_--;
+        }
+    }
+    threshold_ = std::max(kMinThreshold, count_ * 2);
+    collections_++;
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,386 @@
+/**
+ * @file jit.cpp
+ * @brief Implementation of the baseline JIT: the opcode templates.
+ */
+#include "tooi/vm/jit.h"
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "tooi/vm/assembler.h"
+
+namespace tooi {
+namespace vm {
+
+#if TOOI_JIT_AVAILABLE
+
+namespace {
+
+using namespace x64;
+
+// ----------------------------------------------------------------------------
+// Templates
+//
+// Native code keeps the frame's slots in rbx, the chunk's constants in r12,
+// the JitContext in r13, and two constants for boxing: the int32 tag in r14
+// and the bits of nil (the boxed prefix) in r15. A Value is loaded into a
+// general register as its 64 bits. Leaving native code returns the position
+// of the instruction to interpret next in eax.
+// ----------------------------------------------------------------------------
+
+const uint64_t kNilBits = Value::nil().bits();
+const uint64_t kInt32Bits = Value::int32(0).bits();
+const uint64_t kNaNBits =
+    Value::number(ValueKind::Float64, std::numeric_limits<double>::quiet_NaN()).bits();
+
+class TemplateCompiler {
+public:
+    TemplateCompiler(const Chunk& chunk, Jit& jit)
+        : chunk_(chunk), jit_(jit), labels_(chunk.code.size()) {}
+
+    std::vector<uint8_t> compile(std::vector<uint32_t>& entries);
+
+private:
+    const Chunk& chunk_;
+    Jit& jit_;
+    Assembler as_;
+    std::vector<Label> labels_;        ///< Per code word; bound at instruction starts
+    std::map<uint32_t, Label> exits_;  ///< Stubs leaving native code at a position
+    Label leave_;                      ///< Epilogue returning to Jit::run
+
+    void instruction(uint32_t position, Opcode op);
+
+    Label& exit_at(uint32_t position) { return exits_[position]; }
+    void leave_at(uint32_t position) {
+        as_.mov32(rax, position);
+        as_.jmp(leave_);
+    }
+
+    void load_source(Reg dst, uint32_t operand) {
+        if (operand & kConstantFlag) {
+            as_.load(dst, r12, slot(operand & ~kConstantFlag));
+        } else {
+            as_.load(dst, rbx, slot(operand));
+        }
+    }
+    void store_slot(uint32_t slot_index, Reg src) { as_.store(rbx, slot(slot_index), src); }
+    static int32_t slot(uint32_t index) { return static_cast<int32_t>(index * sizeof(Value)); }
+
+    // Leaves at `position` unless `value` holds an int32 (rdx is clobbered).
+    void guard_int32(Reg value, uint32_t position) {
+        as_.mov(rdx, value);
+        as_.shr64(rdx, 48);
+        as_.cmp32(rdx, static_cast<uint32_t>(kInt32Bits >> 48));
+        as_.jump_if(kNotEqual, exit_at(position));
+    }
+    // Leaves at `position` unless `value` holds a float64, i.e. is not boxed.
+    void guard_float64(Reg value, uint32_t position) {
+        as_.mov(rdx, value);
+        as_.shr64(rdx, 51);
+        as_.cmp32(rdx, static_cast<uint32_t>(kNilBits >> 51));
+        as_.jump_if(kEqual, exit_at(position));
+    }
+    // Boxes the int32 in eax into rax.
+    void box_int32() {
+        as_.movsxd(rax, rax);
+        as_.shl64(rax, 16);
+        as_.shr64(rax, 16);
+        as_.alu64(kOr, rax, r14);
+    }
+    // Turns the 0 or 1 in rax into false or true.
+    void box_bool() {
+        as_.alu64(kAdd, rax, r15);
+        as_.add64(rax, 1);
+    }
+    // Sets the flags for `rax - nil`: below or equal to 1 exactly for nil and false.
+    void test_falsy() {
+        as_.alu64(kSub, rax, r15);
+        as_.cmp64(rax, 1);
+    }
+
+    void int32_arithmetic(uint32_t position, Opcode op, uint32_t a, uint32_t x, uint32_t y);
+    void int32_compare(uint32_t position, Cond cond, uint32_t a, uint32_t x, uint32_t y);
+    void float64_arithmetic(uint32_t position, Sse op, uint32_t a, uint32_t x, uint32_t y);
+    void float64_compare(uint32_t position, Opcode op, uint32_t a, uint32_t x, uint32_t y);
+};
+
+std::vector<uint8_t> TemplateCompiler::compile(std::vector<uint32_t>& entries) {
+    // Jit::run calls the code at offset 0 as
+    // uint32_t (Value* slots, const Value* constants, JitContext*, const uint8_t* entry).
+    for (Reg r : {rbx, r12, r13, r14, r15}) as_.push(r);
+    as_.mov(rbx, rdi);
+    as_.mov(r12, rsi);
+    as_.mov(r13, rdx);
+    as_.mov(r14, kInt32Bits);
+    as_.mov(r15, kNilBits);
+    as_.jmp(rcx);
+    as_.bind(leave_);
+    for (Reg r : {r15, r14, r13, r12, rbx}) as_.pop(r);
+    as_.ret();
+
+    const std::vector<uint32_t>& code = chunk_.code;
+    entries.assign(code.size(), NativeCode::kNoEntry);
+    for (uint32_t position = 0; position < code.size();) {
+        // A superinstruction only stands for its first part; the others follow in place.
+        Opcode op = superinstruction_parts(decode_op(code[position])).front();
+        as_.bind(labels_[position]);
+        entries[position] = static_cast<uint32_t>(as_.size());
+        instruction(position, op);
+        position += static_cast<uint32_t>(instruction_length(op));
+    }
+    for (auto& [position, label] : exits_) {
+        as_.bind(label);
+        leave_at(position);
+    }
+    return std::move(as_.code);
+}
+
+void TemplateCompiler::instruction(uint32_t position, Opcode op) {
+    const uint32_t* words = &chunk_.code[position];
+    uint32_t a = decode_operand(words[0]);
+    switch (op) {
+        case Opcode::Move:
+            load_source(rax, words[1]);
+            store_slot(a, rax);
+            break;
+        case Opcode::LoadSelf:
+            as_.load(rax, r13, offsetof(JitContext, self));
+            store_slot(a, rax);
+            break;
+        case Opcode::LoadGlobal:
+            as_.load(rax, r13, offsetof(JitContext, globals));
+            as_.load(rax, rax, slot(words[1]));
+            store_slot(a, rax);
+            break;
+        case Opcode::StoreGlobal:
+            as_.load(rcx, r13, offsetof(JitContext, globals));
+            load_source(rax, words[1]);
+            as_.store(rcx, slot(a), rax);
+            break;
+        case Opcode::Not:
+        case Opcode::Truthy:
+            load_source(rax, words[1]);
+            test_falsy();
+            as_.set(op == Opcode::Not ? kBelowEqual : kAbove, rax);
+            box_bool();
+            store_slot(a, rax);
+            break;
+        case Opcode::Jump:
+            if (a <= position) {
+                // A loop back edge: let the interpreter collect if the heap asks for it.
+                as_.load(rax, r13, offsetof(JitContext, heap_count));
+                as_.load(rax, rax, 0);
+                as_.load(rcx, r13, offsetof(JitContext, heap_threshold));
+                as_.load(rcx, rcx, 0);
+                as_.alu64(kCmp, rax, rcx);
+                as_.jump_if(kAboveEqual, exit_at(position));
+                if (jit_.tracing()) {
+                    // The interpreter hands the loop to its trace, unless it is blacklisted.
+                    as_.mov(rax, reinterpret_cast<uint64_t>(jit_.blacklisted(chunk_, a)));
+                    as_.cmp_byte_zero(rax);
+                    as_.jump_if(kEqual, exit_at(position));
+                }
+            }
+            as_.jmp(labels_[a]);
+            break;
+        case Opcode::JumpIfFalse:
+        case Opcode::JumpIfTrue:
+            load_source(rax, words[1]);
+            test_falsy();
+            as_.jump_if(op == Opcode::JumpIfFalse ? kBelowEqual : kAbove, labels_[a]);
+            break;
+
+        case Opcode::AddI32:
+        case Opcode::SubI32:
+        case Opcode::MulI32:
+        case Opcode::DivI32:
+        case Opcode::ModI32:
+            int32_arithmetic(position, op, a, words[1], words[2]);
+            break;
+        case Opcode::EqI32:
+            int32_compare(position, kEqual, a, words[1], words[2]);
+            break;
+        case Opcode::NeI32:
+            int32_compare(position, kNotEqual, a, words[1], words[2]);
+            break;
+        case Opcode::LtI32:
+            int32_compare(position, kLess, a, words[1], words[2]);
+            break;
+        case Opcode::LeI32:
+            int32_compare(position, kLessEqual, a, words[1], words[2]);
+            break;
+        case Opcode::GtI32:
+            int32_compare(position, kGreater, a, words[1], words[2]);
+            break;
+        case Opcode::GeI32:
+            int32_compare(position, kGreaterEqual, a, words[1], words[2]);
+            break;
+
+        case Opcode::AddF64:
+            float64_arithmetic(position, kAddsd, a, words[1], words[2]);
+            break;
+        case Opcode::SubF64:
+            float64_arithmetic(position, kSubsd, a, words[1], words[2]);
+            break;
+        case Opcode::MulF64:
+            float64_arithmetic(position, kMulsd, a, words[1], words[2]);
+            break;
+        case Opcode::DivF64:
+            float64_arithmetic(position, kDivsd, a, words[1], words[2]);
+            break;
+        case Opcode::EqF64:
+        case Opcode::NeF64:
+        case Opcode::LtF64:
+        case Opcode::LeF64:
+        case Opcode::GtF64:
+        case Opcode::GeF64:
+            float64_compare(position, op, a, words[1], words[2]);
+            break;
+
+        default:
+            // No template: the interpreter executes the instruction.
+            leave_at(position);
+            break;
+    }
+}
+
+void TemplateCompiler::int32_arithmetic(uint32_t position, Opcode op, uint32_t a, uint32_t x,
+                                        uint32_t y) {
+    Label& exit = exit_at(position);
+    load_source(rax, x);
+    guard_int32(rax, position);
+    load_source(rcx, y);
+    guard_int32(rcx, position);
+    switch (op) {
+        case Opcode::AddI32:
+            as_.alu32(kAdd, rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        case Opcode::SubI32:
+            as_.alu32(kSub, rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        case Opcode::MulI32:
+            as_.imul32(rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        default: {
+            // Division by zero and INT32_MIN / -1 are left to the generic operation.
+            Label divide;
+            as_.alu32(kTest, rcx, rcx);
+            as_.jump_if(kEqual, exit);
+            as_.cmp32(rcx, UINT32_MAX);
+            as_.jump_if(kNotEqual, divide);
+            as_.cmp32(rax, 0x80000000u);
+            as_.jump_if(kEqual, exit);
+            as_.bind(divide);
+            as_.cdq();
+            as_.idiv32(rcx);
+            if (op == Opcode::ModI32) as_.mov(rax, rdx);
+            break;
+        }
+    }
+    box_int32();
+    store_slot(a, rax);
+}
+
+void TemplateCompiler::int32_compare(uint32_t position, Cond cond, uint32_t a, uint32_t x,
+                                     uint32_t y) {
+    load_source(rax, x);
+    guard_int32(rax, position);
+    load_source(rcx, y);
+    guard_int32(rcx, position);
+    as_.alu32(kCmp, rax, rcx);
+    as_.set(cond, rax);
+    box_bool();
+    store_slot(a, rax);
+}
+
+void TemplateCompiler::float64_arithmetic(uint32_t position, Sse op, uint32_t a, uint32_t x,
+                                          uint32_t y) {
+    load_source(rax, x);
+    guard_float64(rax, position);
+    load_source(rcx, y);
+    guard_float64(rcx, position);
+    as_.movq_to_xmm(0, rax);
+    as_.movq_to_xmm(1, rcx);
+    as_.sse(op, 0, 1);
+    as_.movq_from_xmm(rax, 0);
+    Label done;
+    as_.ucomisd(0, 0);  // Only a NaN is unordered with itself
+    as_.jump_if(kNoParity, done);
+    as_.mov(rax, kNaNBits);
+    as_.bind(done);
+    store_slot(a, rax);
+}
+
+void TemplateCompiler::float64_compare(uint32_t position, Opcode op, uint32_t a, uint32_t x,
+                                       uint32_t y) {
+    load_source(rax, x);
+    guard_float64(rax, position);
+    load_source(rcx, y);
+    guard_float64(rcx, position);
+    as_.movq_to_xmm(0, rax);
+    as_.movq_to_xmm(1, rcx);
+    // An unordered comparison (a NaN operand) sets ZF, PF and CF, so "above"
+    // conditions are false for it, as are < and friends in C++.
+    switch (op) {
+        case Opcode::LtF64:
+        case Opcode::LeF64:
+            as_.ucomisd(1, 0);
+            as_.set(op == Opcode::LtF64 ? kAbove : kAboveEqual, rax);
+            break;
+        case Opcode::GtF64:
+        case Opcode::GeF64:
+            as_.ucomisd(0, 1);
+            as_.set(op == Opcode::GtF64 ? kAbove : kAboveEqual, rax);
+            break;
+        default:
+            as_.ucomisd(0, 1);
+            if (op == Opcode::EqF64) {
+                as_.set(kEqual, rax);
+                as_.set(kNoParity, rcx);
+                as_.alu32(kAnd, rax, rcx);
+            } else {
+                as_.set(kNotEqual, rax);
+                as_.set(kParity, rcx);
+                as_.alu32(kOr, rax, rcx);
+            }
+            break;
+    }
+    box_bool();
+    store_slot(a, rax);
+}
+
+}  // anonymous namespace
+
+bool Jit::compile(const Chunk& chunk) {
+    std::vector<uint32_t> entries;
+    std::vector<uint8_t> code = TemplateCompiler(chunk, *this).compile(entries);
+    if (!cache_.install(chunk.native, chunk.hotness, code, std::move(entries))) {
+        chunk.hotness = 0;  // Try again once it gets hot again
+        return false;
+    }
+    stats_.compiled++;
+    return true;
+}
+
+uint32_t Jit::run(const Chunk& chunk, const uint8_t* entry, Value* slots, const Value* constants,
+                  JitContext& context) {
+    using Code = uint32_t (*)(Value*, const Value*, JitContext*, const uint8_t*);
+    auto code = reinterpret_cast<Code>(const_cast<uint8_t*>(chunk.native->code));
+    return code(slots, constants, &context, entry);
+}
+
+#else
+
+bool Jit::compile(const Chunk&) { return false; }
+
+uint32_t Jit::run(const Chunk&, const uint8_t*, Value*, const Value*, JitContext&) { return 0; }
+
+#endif
+
+}  // namespace vm
+}  // namespace tooi
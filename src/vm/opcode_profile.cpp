@@ -0,0 +1,39 @@
+/**
+ * @file opcode_profile.cpp
+ * @brief Implementation of the opcode sequence profile written by --opcode-profile.
+ */
+#include "tooi/vm/opcode_profile.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+void write_sequences(std::ostream& out, const char* label,
+                     const std::unordered_map<uint32_t, uint64_t>& counts, int length) {
+    std::vector<std::pair<uint32_t, uint64_t>> sorted(counts.begin(), counts.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& x, const auto& y) {
+        return x.second != y.second ? x.second > y.second : x.first < y.first;
+    });
+    for (const auto& [key, count] : sorted) {
+        out << label << ' ' << count;
+        for (int i = length - 1; i >= 0; --i) {
+            out << ' ' << opcode_name(static_cast<Opcode>((key >> (8 * i)) & 0xff));
+        }
+        out << '\n';
+    }
+}
+
+}  // anonymous namespace
+
+void OpcodeProfile::write(std::ostream& out) const {
+    write_sequences(out, "pair", pairs_, 2);
+    write_sequences(out, "triple", triples_, 3);
+}
+
+}  // namespace vm
+}  // namespace tooi
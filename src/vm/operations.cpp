@@ -0,0 +1,410 @@
+/**
+ * @file operations.cpp
+ * @brief Implementation of the dynamic semantics of operators and conversions.
+ */
+#include "tooi/vm/operations.h"
+
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include "tooi/core/constant_folding.h"
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+using core::ErrorCode;
+using core::TypeKind;
+using core::TypeRef;
+
+const char* symbol(Opcode op) {
+    switch (op) {
+        case Opcode::Add:
+            return "+";
+        case Opcode::Sub:
+            return "-";
+        case Opcode::Mul:
+            return "*";
+        case Opcode::Div:
+            return "/";
+        case Opcode::Mod:
+            return "%";
+        case Opcode::Eq:
+            return "==";
+        case Opcode::Ne:
+            return "!=";
+        case Opcode::Lt:
+            return "<";
+        case Opcode::Le:
+            return "<=";
+        case Opcode::Gt:
+            return ">";
+        default:
+            return ">=";
+    }
+}
+
+double to_double(const Value& value) {
+    ValueKind kind = value.kind();
+    if (is_float_kind(kind)) return value.as_double();
+    return is_signed_kind(kind) ? static_cast<double>(value.as_int())
+                                : static_cast<double>(value.as_uint());
+}
+
+bool fits(ValueKind kind, uint64_t magnitude, bool negative) {
+    return core::integer_fits(primitive_type(kind), magnitude, negative);
+}
+
+bool fits_signed(ValueKind kind, int64_t value) {
+    if (kind == ValueKind::Int32) return value >= INT32_MIN && value <= INT32_MAX;
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    return fits(kind, magnitude, value < 0);
+}
+
+// Converts a number to another numeric kind, if the value is representable.
+bool convert_number(const Value& value, ValueKind kind, Value& result, Heap& heap) {
+    if (is_float_kind(kind)) {
+        result = Value::number(kind, to_double(value));
+        return true;
+    }
+    ValueKind source = value.kind();
+    if (is_float_kind(source)) {
+        double truncated = std::trunc(value.as_double());
+        if (!std::isfinite(truncated)) return false;
+        if (is_signed_kind(kind)) {
+            if (truncated < -9223372036854775808.0 || truncated >= 9223372036854775808.0) {
+                return false;
+            }
+            auto number = static_cast<int64_t>(truncated);
+            if (!fits_signed(kind, number)) return false;
+            result = Value::signed_int(kind, number, heap);
+            return true;
+        }
+        if (truncated < 0 || truncated >= 18446744073709551616.0) return false;
+        auto number = static_cast<uint64_t>(truncated);
+        if (!fits(kind, number, false)) return false;
+        result = Value::unsigned_int(kind, number, heap);
+        return true;
+    }
+    // Integers: the bits of a signed value reinterpreted as unsigned and back are unchanged.
+    uint64_t bits = is_signed_kind(source) ? static_cast<uint64_t>(value.as_int())
+                                           : value.as_uint();
+    bool negative = is_signed_kind(source) && static_cast<int64_t>(bits) < 0;
+    uint64_t magnitude = negative ? 0 - bits : bits;
+    if (!fits(kind, magnitude, negative)) return false;
+    result = is_signed_kind(kind) ? Value::signed_int(kind, static_cast<int64_t>(bits), heap)
+                                  : Value::unsigned_int(kind, bits, heap);
+    return true;
+}
+
+[[noreturn]] void overflow(Opcode op, ValueKind kind) {
+    throw RuntimeError(ErrorCode::Runtime_IntegerOverflow, symbol(op), kind_name(kind));
+}
+
+Value signed_arithmetic(Opcode op, int64_t a, int64_t b, ValueKind kind, Heap& heap) {
+    int64_t result = 0;
+    switch (op) {
+        case Opcode::Add:
+            if (__builtin_add_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        case Opcode::Sub:
+            if (__builtin_sub_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        case Opcode::Mul:
+            if (__builtin_mul_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        default:
+            if (b == 0) throw RuntimeError(ErrorCode::Runtime_DivisionByZero);
+            if (a == std::numeric_limits<int64_t>::min() && b == -1) overflow(op, kind);
+            result = op == Opcode::Div ? a / b : a % b;
+            break;
+    }
+    if (!fits_signed(kind, result)) overflow(op, kind);
+    return Value::signed_int(kind, result, heap);
+}
+
+Value unsigned_arithmetic(Opcode op, uint64_t a, uint64_t b, ValueKind kind, Heap& heap) {
+    uint64_t result = 0;
+    switch (op) {
+        case Opcode::Add:
+            if (__builtin_add_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        case Opcode::Sub:
+            if (__builtin_sub_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        case Opcode::Mul:
+            if (__builtin_mul_overflow(a, b, &result)) overflow(op, kind);
+            break;
+        default:
+            if (b == 0) throw RuntimeError(ErrorCode::Runtime_DivisionByZero);
+            result = op == Opcode::Div ? a / b : a % b;
+            break;
+    }
+    if (!fits(kind, result, false)) overflow(op, kind);
+    return Value::unsigned_int(kind, result, heap);
+}
+
+Value float_arithmetic(Opcode op, double a, double b, ValueKind kind) {
+    switch (op) {
+        case Opcode::Add:
+            return Value::number(kind, a + b);
+        case Opcode::Sub:
+            return Value::number(kind, a - b);
+        case Opcode::Mul:
+            return Value::number(kind, a * b);
+        case Opcode::Div:
+            return Value::number(kind, a / b);
+        default:
+            return Value::number(kind, std::fmod(a, b));
+    }
+}
+
+// Three-way comparison of two numbers of any kinds; nullopt if unordered (NaN).
+std::optional<int> compare_numbers(const Value& a, const Value& b) {
+    auto order = [](auto x, auto y) { return x < y ? -1 : (y < x ? 1 : 0); };
+    ValueKind a_kind = a.kind();
+    ValueKind b_kind = b.kind();
+    if (is_float_kind(a_kind) || is_float_kind(b_kind)) {
+        double x = to_double(a);
+        double y = to_double(b);
+        if (std::isnan(x) || std::isnan(y)) return std::nullopt;
+        return order(x, y);
+    }
+    bool a_signed = is_signed_kind(a_kind);
+    bool b_signed = is_signed_kind(b_kind);
+    if (a_signed && b_signed) return order(a.as_int(), b.as_int());
+    if (!a_signed && !b_signed) return order(a.as_uint(), b.as_uint());
+    if (a_signed && a.as_int() < 0) return -1;
+    if (b_signed && b.as_int() < 0) return 1;
+    // Both non-negative
+    uint64_t x = a_signed ? static_cast<uint64_t>(a.as_int()) : a.as_uint();
+    uint64_t y = b_signed ? static_cast<uint64_t>(b.as_int()) : b.as_uint();
+    return order(x, y);
+}
+
+core::LiteralValue to_literal(const Value& value) {
+    ValueKind kind = value.kind();
+    switch (kind) {
+        case ValueKind::Bool:
+            return value.as_bool();
+        case ValueKind::String:
+            return as_string(value)->text;
+        case ValueKind::Nil:
+            return std::monostate{};
+        default:
+            break;
+    }
+    if (is_float_kind(kind)) return value.as_double();
+    if (is_signed_kind(kind)) return value.as_int();
+    return value.as_uint();
+}
+
+Value from_literal(const core::LiteralValue& literal, ValueKind kind, Heap& heap) {
+    if (kind == ValueKind::Bool) return Value::boolean(std::get<bool>(literal));
+    if (is_float_kind(kind)) return Value::number(kind, core::as_double(literal));
+    if (is_signed_kind(kind)) return Value::signed_int(kind, core::as_signed(literal), heap);
+    return Value::unsigned_int(kind, core::as_unsigned(literal), heap);
+}
+
+}  // anonymous namespace
+
+std::string describe(const Value& value) {
+    if (value.is(ValueKind::String)) return "\"" + as_string(value)->text + "\"";
+    return display_string(value);
+}
+
+Value arithmetic(Opcode op, const Value& a, const Value& b, Heap& heap) {
+    // The common cases are recognized from the tags alone, without computing kinds.
+    if (a.is_int32() && b.is_int32()) {
+        return signed_arithmetic(op, a.as_int(), b.as_int(), ValueKind::Int32, heap);
+    }
+    if (a.is_float64() && b.is_float64()) {
+        return float_arithmetic(op, a.as_double(), b.as_double(), ValueKind::Float64);
+    }
+    ValueKind a_kind = a.kind();
+    ValueKind b_kind = b.kind();
+    if (a_kind == b_kind) {
+        switch (a_kind) {
+            case ValueKind::Int32:
+            case ValueKind::Int64:
+                return signed_arithmetic(op, a.as_int(), b.as_int(), a_kind, heap);
+            case ValueKind::UInt32:
+            case ValueKind::UInt64:
+                return unsigned_arithmetic(op, a.as_uint(), b.as_uint(), a_kind, heap);
+            case ValueKind::Float32:
+            case ValueKind::Float64:
+                return float_arithmetic(op, a.as_double(), b.as_double(), a_kind);
+            default:
+                break;  // Bytes are promoted to int below
+        }
+    }
+    if (is_numeric_kind(a_kind) && is_numeric_kind(b_kind)) {
+        ValueKind kind =
+            kind_of(core::promote_numeric(primitive_type(a_kind), primitive_type(b_kind)));
+        Value x;
+        Value y;
+        if (!convert_number(a, kind, x, heap) || !convert_number(b, kind, y, heap)) {
+            overflow(op, kind);
+        }
+        return arithmetic(op, x, y, heap);
+    }
+    if (op == Opcode::Add && (a_kind == ValueKind::String || b_kind == ValueKind::String)) {
+        return concat(a, b, heap);
+    }
+    throw RuntimeError(ErrorCode::Runtime_InvalidOperands, symbol(op), kind_name(a_kind),
+                       kind_name(b_kind));
+}
+
+Value negate(const Value& value, Heap& heap) {
+    ValueKind kind = value.kind();
+    switch (kind) {
+        case ValueKind::Int32:
+        case ValueKind::Int64:
+            return signed_arithmetic(Opcode::Sub, 0, value.as_int(), kind, heap);
+        case ValueKind::Byte:
+            return Value::int32(-static_cast<int64_t>(value.as_uint()));
+        case ValueKind::UInt32:
+        case ValueKind::UInt64:
+            return unsigned_arithmetic(Opcode::Sub, 0, value.as_uint(), kind, heap);
+        case ValueKind::Float32:
+        case ValueKind::Float64:
+            return Value::number(kind, -value.as_double());
+        default:
+            throw RuntimeError(ErrorCode::Runtime_InvalidUnaryOperand, "-", kind_name(kind));
+    }
+}
+
+bool compare(Opcode op, const Value& a, const Value& b) {
+    if (op == Opcode::Eq) return values_equal(a, b);
+    if (op == Opcode::Ne) return !values_equal(a, b);
+
+    std::optional<int> order;
+    ValueKind a_kind = a.is_int32() ? ValueKind::Int32 : a.kind();
+    ValueKind b_kind = b.is_int32() ? ValueKind::Int32 : b.kind();
+    if (a_kind == ValueKind::Int32 && b_kind == ValueKind::Int32) {
+        order = a.as_int() < b.as_int() ? -1 : (b.as_int() < a.as_int() ? 1 : 0);
+    } else if (is_numeric_kind(a_kind) && is_numeric_kind(b_kind)) {
+        order = compare_numbers(a, b);
+        if (!order) return false;  // Ordered comparisons involving NaN are false
+    } else if (a_kind == ValueKind::String && b_kind == ValueKind::String) {
+        order = as_string(a)->text.compare(as_string(b)->text);
+    } else {
+        throw RuntimeError(ErrorCode::Runtime_InvalidOperands, symbol(op), kind_name(a_kind),
+                           kind_name(b_kind));
+    }
+    switch (op) {
+        case Opcode::Lt:
+            return *order < 0;
+        case Opcode::Le:
+            return *order <= 0;
+        case Opcode::Gt:
+            return *order > 0;
+        default:
+            return *order >= 0;
+    }
+}
+
+Value concat(const Value& a, const Value& b, Heap& heap) {
+    return heap.string(display_string(a) + display_string(b));
+}
+
+Value cast(const Value& value, const TypeRef& target, Heap& heap) {
+    if (target->is_proto()) return value;
+    if (target->kind == TypeKind::String) {
+        return value.is(ValueKind::String) ? value : heap.string(display_string(value));
+    }
+    if (!target->is_primitive()) return coerce(value, target, heap);
+
+    ValueKind kind = kind_of(target);
+    ValueKind source_kind = value.kind();
+    if (source_kind == kind) return value;
+    if (source_kind == ValueKind::String && target->is_numeric()) {
+        // Parsed where it is, rather than copied into a literal first
+        if (auto result = core::parse_number(as_string(value)->text, target)) {
+            return from_literal(*result, kind, heap);
+        }
+    } else if (Value result; is_numeric_kind(source_kind) && target->is_numeric() &&
+                             convert_number(value, kind, result, heap)) {
+        return result;
+    }
+    TypeRef source = primitive_type(source_kind);
+    if (source && source_kind != ValueKind::Nil) {
+        std::optional<core::LiteralValue> result =
+            core::convert_literal(to_literal(value), source, target);
+        if (result) return from_literal(*result, kind, heap);
+    }
+    throw RuntimeError(ErrorCode::Runtime_InvalidConversion, describe(value),
+                       kind_name(source_kind), target->to_string());
+}
+
+bool has_type(const Value& value, const TypeRef& type) {
+    switch (type->kind) {
+        case TypeKind::Proto:
+            return true;
+        case TypeKind::Nil:
+            return value.is_nil();
+        case TypeKind::Module:
+            return value.is(ValueKind::Module) && as_module(value)->name == type->name;
+        default:
+            break;
+    }
+    if (type->is_primitive()) return value.is(kind_of(type));
+    // nil is a valid value of every reference type.
+    if (value.is_nil()) return true;
+    if (!value.is(kind_of(type))) return false;
+
+    switch (type->kind) {
+        case TypeKind::Array:
+            if (type->element()->is_proto()) return true;
+            for (const Value& element : as_array(value)->elements()) {
+                if (!has_type(element, type->element())) return false;
+            }
+            return true;
+        case TypeKind::Tuple: {
+            const std::vector<Value>& elements = as_array(value)->elements();
+            if (elements.size() != type->elements.size()) return false;
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (!has_type(elements[i], type->elements[i])) return false;
+            }
+            return true;
+        }
+        case TypeKind::Assoc:
+            for (const auto& [key, entry] : as_assoc(value)->entries()) {
+                if (!has_type(key, type->key()) || !has_type(entry, type->value())) return false;
+            }
+            return true;
+        default:
+            return true;  // Strings and objects
+    }
+}
+
+Value coerce(const Value& value, const TypeRef& target, Heap& heap) {
+    if (has_type(value, target)) return value;
+    ValueKind kind = value.kind();
+    if (is_numeric_kind(kind) && target->is_numeric() &&
+        core::is_assignable(target, primitive_type(kind))) {
+        Value result;
+        if (convert_number(value, kind_of(target), result, heap)) return result;
+    }
+    throw RuntimeError(ErrorCode::Runtime_TypeMismatch, target->to_string(), kind_name(kind));
+}
+
+Value zero_value(const TypeRef& type, Heap& heap) {
+    switch (type->kind) {
+        case TypeKind::Bool:
+            return Value::boolean(false);
+        case TypeKind::Float32:
+        case TypeKind::Float64:
+            return Value::number(kind_of(type), 0.0);
+        default:
+            break;
+    }
+    if (type->is_signed()) return Value::signed_int(kind_of(type), 0, heap);
+    if (type->is_integer()) return Value::unsigned_int(kind_of(type), 0, heap);
+    return Value::nil();
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,1149 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the tracing tier: the recorder, dead code elimination and the
+ *        trace compiler.
+ */
+#include "tooi/vm/trace.h"
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "tooi/core/types.h"
+#include "tooi/vm/assembler.h"
+#include "tooi/vm/object.h"
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+using namespace x64;
+
+// ----------------------------------------------------------------------------
+// Recorder
+// ----------------------------------------------------------------------------
+
+/// A frame slot (its index) or a global (its index with bit 32 set).
+using Location = uint64_t;
+
+Location slot_location(uint32_t index) { return index; }
+Location global_location(uint32_t index) { return uint64_t{1} << 32 | index; }
+bool is_global(Location location) { return (location >> 32) != 0; }
+uint32_t location_index(Location location) { return static_cast<uint32_t>(location); }
+
+TraceRep rep_of(ValueKind kind) {
+    switch (kind) {
+        case ValueKind::Int32:
+            return TraceRep::Int32;
+        case ValueKind::Float64:
+            return TraceRep::Float64;
+        case ValueKind::Bool:
+            return TraceRep::Bool;
+        default:
+            return TraceRep::Any;
+    }
+}
+
+/// The kinds a value entering the loop is checked for, once, before the first iteration.
+bool is_entry_kind(ValueKind kind) {
+    return kind == ValueKind::Int32 || kind == ValueKind::Float64 || kind == ValueKind::Array ||
+           kind == ValueKind::Tuple;
+}
+
+bool is_sequence(const Value& value) {
+    return value.is(ValueKind::Array) || value.is(ValueKind::Tuple);
+}
+
+Cond compare_cond(Opcode op) {
+    switch (op) {
+        case Opcode::Eq:
+            return kEqual;
+        case Opcode::Ne:
+            return kNotEqual;
+        case Opcode::Lt:
+            return kLess;
+        case Opcode::Le:
+            return kLessEqual;
+        case Opcode::Gt:
+            return kGreater;
+        default:
+            return kGreaterEqual;
+    }
+}
+
+template <typename T>
+bool holds(Cond cond, T x, T y) {
+    switch (cond) {
+        case kEqual:
+            return x == y;
+        case kNotEqual:
+            return x != y;
+        case kLess:
+            return x < y;
+        case kLessEqual:
+            return x <= y;
+        case kGreater:
+            return x > y;
+        default:
+            return x >= y;
+    }
+}
+
+class Recorder {
+public:
+    Recorder(const Chunk& chunk, Value* slots, JitContext& context, Trace& trace)
+        : chunk_(chunk), slots_(slots), context_(context), trace_(trace) {}
+
+    bool run(uint32_t& resume);
+
+private:
+    const Chunk& chunk_;
+    Value* slots_;
+    JitContext& context_;
+    Trace& trace_;
+    std::map<Location, uint32_t> entries_;  ///< Values the loop reads before writing them
+    std::map<Location, uint32_t> values_;   ///< Current value of every location used
+    std::set<Location> written_;
+    std::map<uint32_t, uint32_t> constants_;  ///< Const instruction per constant index
+    std::map<std::pair<uint32_t, ValueKind>, uint32_t> unboxed_;
+    std::map<uint32_t, Object*> objects_;  ///< Object each Property instruction read
+    std::optional<uint32_t> self_;
+
+    const TraceInstruction& at(uint32_t value) const { return trace_.instructions[value]; }
+    uint32_t emit(const TraceInstruction& instruction) {
+        trace_.instructions.push_back(instruction);
+        return static_cast<uint32_t>(trace_.instructions.size() - 1);
+    }
+    uint32_t constant(const Value& value) {
+        TraceInstruction instruction{TraceOp::Const, rep_of(value.kind()), value.kind()};
+        instruction.constant = value;
+        return emit(instruction);
+    }
+    /// A side exit to `position` with the writes of the iteration so far.
+    uint32_t exit(uint32_t position, std::optional<DeoptReason> reason) {
+        TraceExit exit{position, {}, reason};
+        for (Location location : written_) {
+            exit.writes.push_back({is_global(location), location_index(location),
+                                   values_[location]});
+        }
+        trace_.exits.push_back(std::move(exit));
+        return static_cast<uint32_t>(trace_.exits.size() - 1);
+    }
+
+    Value& memory(Location location) {
+        return is_global(location) ? context_.globals[location_index(location)]
+                                   : slots_[location_index(location)];
+    }
+    const Value& source(uint32_t operand) const {
+        return (operand & kConstantFlag) ? chunk_.constants[operand & ~kConstantFlag]
+                                         : slots_[operand];
+    }
+    uint32_t read(Location location);
+    uint32_t operand(uint32_t operand);
+    uint32_t self();
+    void write(Location location, uint32_t value, Value concrete) {
+        memory(location) = concrete;
+        values_[location] = value;
+        written_.insert(location);
+    }
+
+    std::optional<uint32_t> as_kind(uint32_t value, ValueKind kind, uint32_t position);
+    std::optional<bool> known_truthiness(uint32_t value) const;
+
+    bool arithmetic(Opcode op, uint32_t position, uint32_t a, uint32_t x, uint32_t y);
+    bool compare(Opcode op, uint32_t position, uint32_t a, uint32_t x, uint32_t y);
+    void truthiness(Opcode op, uint32_t a, uint32_t x);
+    bool convert(uint32_t position, uint32_t a, uint32_t x, const core::TypeRef& type);
+    bool sequence(Opcode op, uint32_t position, const uint32_t* words);
+    bool property(uint32_t position, const uint32_t* words);
+    void hoist_invariants();
+    bool close();
+};
+
+uint32_t Recorder::read(Location location) {
+    auto known = values_.find(location);
+    if (known != values_.end()) return known->second;
+    ValueKind kind = memory(location).kind();
+    TraceInstruction entry{is_global(location) ? TraceOp::Global : TraceOp::Slot, TraceRep::Any};
+    entry.x = location_index(location);
+    if (is_entry_kind(kind)) {
+        entry.rep = rep_of(kind);
+        entry.kind = kind;
+    }
+    uint32_t value = emit(entry);
+    entries_[location] = value;
+    values_[location] = value;
+    return value;
+}
+
+uint32_t Recorder::operand(uint32_t operand) {
+    if (!(operand & kConstantFlag)) return read(slot_location(operand));
+    uint32_t index = operand & ~kConstantFlag;
+    auto known = constants_.find(index);
+    if (known != constants_.end()) return known->second;
+    return constants_[index] = constant(chunk_.constants[index]);
+}
+
+uint32_t Recorder::self() {
+    if (!self_) self_ = emit(TraceInstruction{TraceOp::Self, TraceRep::Any});
+    return *self_;
+}
+
+// The value as one of a kind: as it is if its kind is known, through an
+// Unbox guard if not; nothing if it is known to be of another kind.
+std::optional<uint32_t> Recorder::as_kind(uint32_t value, ValueKind kind, uint32_t position) {
+    if (at(value).kind == kind) return value;
+    if (at(value).kind) return std::nullopt;
+    auto known = unboxed_.find({value, kind});
+    if (known != unboxed_.end()) return known->second;
+    TraceInstruction unbox{TraceOp::Unbox, rep_of(kind), kind, value};
+    unbox.exit = exit(position, DeoptReason::Kind);
+    return unboxed_[{value, kind}] = emit(unbox);
+}
+
+std::optional<bool> Recorder::known_truthiness(uint32_t value) const {
+    const TraceInstruction& instruction = at(value);
+    if (instruction.op == TraceOp::Const) return instruction.constant.truthy();
+    if (instruction.kind && *instruction.kind != ValueKind::Bool) return true;  // Not nil either
+    return std::nullopt;
+}
+
+bool Recorder::arithmetic(Opcode op, uint32_t position, uint32_t a, uint32_t x, uint32_t y) {
+    const Value& left = source(x);
+    const Value& right = source(y);
+    Opcode base = generic_opcode(op);
+    ValueKind kind = left.kind();
+    if (right.kind() != kind || (kind != ValueKind::Int32 && kind != ValueKind::Float64)) {
+        return false;
+    }
+    if (op != base && typed_opcode(base, kind) != op) return false;
+
+    Value result;
+    TraceOp trace_op;
+    if (kind == ValueKind::Int32) {
+        auto l = static_cast<int32_t>(left.as_int());
+        auto r = static_cast<int32_t>(right.as_int());
+        int32_t number = 0;
+        switch (base) {
+            case Opcode::Add:
+                if (__builtin_add_overflow(l, r, &number)) return false;
+                trace_op = TraceOp::AddI32;
+                break;
+            case Opcode::Sub:
+                if (__builtin_sub_overflow(l, r, &number)) return false;
+                trace_op = TraceOp::SubI32;
+                break;
+            case Opcode::Mul:
+                if (__builtin_mul_overflow(l, r, &number)) return false;
+                trace_op = TraceOp::MulI32;
+                break;
+            default:
+                if (r == 0 || (l == std::numeric_limits<int32_t>::min() && r == -1)) return false;
+                number = base == Opcode::Div ? l / r : l % r;
+                trace_op = base == Opcode::Div ? TraceOp::DivI32 : TraceOp::ModI32;
+                break;
+        }
+        result = Value::int32(number);
+    } else {
+        double l = left.as_double();
+        double r = right.as_double();
+        double number = 0;
+        switch (base) {
+            case Opcode::Add:
+                number = l + r;
+                trace_op = TraceOp::AddF64;
+                break;
+            case Opcode::Sub:
+                number = l - r;
+                trace_op = TraceOp::SubF64;
+                break;
+            case Opcode::Mul:
+                number = l * r;
+                trace_op = TraceOp::MulF64;
+                break;
+            case Opcode::Div:
+                number = l / r;
+                trace_op = TraceOp::DivF64;
+                break;
+            default:
+                return false;  // fmod has no instruction
+        }
+        result = Value::number(ValueKind::Float64, number);
+    }
+
+    std::optional<uint32_t> lhs = as_kind(operand(x), kind, position);
+    std::optional<uint32_t> rhs = as_kind(operand(y), kind, position);
+    if (!lhs || !rhs) return false;
+    uint32_t value;
+    if (at(*lhs).op == TraceOp::Const && at(*rhs).op == TraceOp::Const) {
+        value = constant(result);
+    } else {
+        TraceInstruction instruction{trace_op, rep_of(kind), kind, *lhs, *rhs};
+        if (kind == ValueKind::Int32) instruction.exit = exit(position, DeoptReason::Overflow);
+        value = emit(instruction);
+    }
+    write(slot_location(a), value, result);
+    return true;
+}
+
+bool Recorder::compare(Opcode op, uint32_t position, uint32_t a, uint32_t x, uint32_t y) {
+    const Value& left = source(x);
+    const Value& right = source(y);
+    Opcode base = generic_opcode(op);
+    ValueKind kind = left.kind();
+    if (right.kind() != kind || (kind != ValueKind::Int32 && kind != ValueKind::Float64)) {
+        return false;
+    }
+    if (op != base && typed_opcode(base, kind) != op) return false;
+
+    Cond cond = compare_cond(base);
+    bool truth = kind == ValueKind::Int32 ? holds(cond, left.as_int(), right.as_int())
+                                          : holds(cond, left.as_double(), right.as_double());
+    std::optional<uint32_t> lhs = as_kind(operand(x), kind, position);
+    std::optional<uint32_t> rhs = as_kind(operand(y), kind, position);
+    if (!lhs || !rhs) return false;
+    uint32_t value;
+    if (at(*lhs).op == TraceOp::Const && at(*rhs).op == TraceOp::Const) {
+        value = constant(Value::boolean(truth));
+    } else {
+        TraceOp trace_op = kind == ValueKind::Int32 ? TraceOp::CompareI32 : TraceOp::CompareF64;
+        TraceInstruction instruction{trace_op, TraceRep::Bool, ValueKind::Bool, *lhs, *rhs};
+        instruction.cond = cond;
+        value = emit(instruction);
+    }
+    write(slot_location(a), value, Value::boolean(truth));
+    return true;
+}
+
+void Recorder::truthiness(Opcode op, uint32_t a, uint32_t x) {
+    uint32_t value = operand(x);
+    Value result = Value::boolean((op == Opcode::Not) != source(x).truthy());
+    uint32_t id;
+    if (known_truthiness(value)) {
+        id = constant(result);
+    } else if (at(value).rep == TraceRep::Bool && op == Opcode::Truthy) {
+        id = value;
+    } else {
+        TraceOp trace_op = op == Opcode::Not ? TraceOp::Not : TraceOp::Truthy;
+        id = emit(TraceInstruction{trace_op, TraceRep::Bool, ValueKind::Bool, value});
+    }
+    write(slot_location(a), id, result);
+}
+
+// Cast and Coerce between int32 and float64; other conversions end the trace.
+bool Recorder::convert(uint32_t position, uint32_t a, uint32_t x, const core::TypeRef& type) {
+    const Value& input = source(x);
+    ValueKind kind = input.kind();
+    if (kind != ValueKind::Int32 && kind != ValueKind::Float64) return false;
+    bool to_float = type->kind == core::TypeKind::Float64;
+    if (!to_float && !(type->kind == core::TypeKind::Int32 && kind == ValueKind::Int32)) {
+        return false;
+    }
+    std::optional<uint32_t> value = as_kind(operand(x), kind, position);
+    if (!value) return false;
+    if (kind == ValueKind::Float64 || !to_float) {
+        write(slot_location(a), *value, input);
+        return true;
+    }
+    Value result = Value::number(ValueKind::Float64, static_cast<double>(input.as_int()));
+    uint32_t id = at(*value).op == TraceOp::Const
+                      ? constant(result)
+                      : emit(TraceInstruction{TraceOp::Int32ToFloat64, TraceRep::Float64,
+                                              ValueKind::Float64, *value});
+    write(slot_location(a), id, result);
+    return true;
+}
+
+// Index, Length and IterSource on arrays and tuples.
+bool Recorder::sequence(Opcode op, uint32_t position, const uint32_t* words) {
+    uint32_t a = decode_operand(words[0]);
+    const Value& container = source(words[1]);
+    if (!is_sequence(container)) return false;
+    const std::vector<Value>& elements = as_array(container)->elements();
+    std::optional<uint32_t> sequence = as_kind(operand(words[1]), container.kind(), position);
+    if (!sequence) return false;
+    switch (op) {
+        case Opcode::IterSource:
+            write(slot_location(a), *sequence, container);
+            return true;
+        case Opcode::Length: {
+            uint32_t length = emit(TraceInstruction{TraceOp::Length, TraceRep::Int32,
+                                                    ValueKind::Int32, *sequence});
+            write(slot_location(a), length, Value::int32(static_cast<int64_t>(elements.size())));
+            return true;
+        }
+        default: {
+            const Value& index = source(words[2]);
+            if (!index.is_int32() || static_cast<uint64_t>(index.as_int()) >= elements.size()) {
+                return false;  // The interpreter reports the error
+            }
+            std::optional<uint32_t> number = as_kind(operand(words[2]), ValueKind::Int32,
+                                                     position);
+            if (!number) return false;
+            TraceInstruction element{TraceOp::Index, TraceRep::Any, std::nullopt, *sequence,
+                                     *number};
+            element.exit = exit(position, DeoptReason::Range);
+            write(slot_location(a), emit(element), elements[index.as_int()]);
+            return true;
+        }
+    }
+}
+
+// GetProp on an object, guarded by the object's shape.
+bool Recorder::property(uint32_t position, const uint32_t* words) {
+    const Value& object = source(words[1]);
+    if (!object.is(ValueKind::Object)) return false;
+    Object* instance = as_object(object);
+    const Property* found = instance->shape->find(chunk_.names[words[2]]);
+    if (!found) return false;
+    TraceInstruction load{TraceOp::Property, TraceRep::Any, std::nullopt, operand(words[1]),
+                          found->slot};
+    load.shape = instance->shape;
+    load.exit = exit(position, DeoptReason::Shape);
+    uint32_t value = emit(load);
+    objects_[value] = instance;
+    write(slot_location(decode_operand(words[0])), value, instance->slots()[found->slot]);
+    return true;
+}
+
+// Nothing in a trace changes an object, so a property of an object that
+// enters the loop and stays there (or of such a property) reads the same
+// value every iteration: it is read once, before the first, and the trace
+// depends on the object keeping its shape.
+void Recorder::hoist_invariants() {
+    std::set<uint32_t> carried;
+    for (const TraceCarry& carry : trace_.carries) carried.insert(carry.entry);
+    for (auto& [value, object] : objects_) {
+        TraceInstruction& load = trace_.instructions[value];
+        const TraceInstruction& owner = at(load.x);
+        bool entry = owner.op == TraceOp::Slot || owner.op == TraceOp::Global ||
+                     owner.op == TraceOp::Self;
+        bool invariant = owner.op == TraceOp::Property ? owner.invariant
+                                                       : entry && !carried.count(load.x);
+        if (!invariant) continue;
+        load.invariant = true;
+        trace_.watched.push_back(object);
+    }
+}
+
+// The loop got back to its header: note what the iteration leaves for the
+// next one. Fails if a value entering the loop changes its kind.
+bool Recorder::close() {
+    for (Location location : written_) {
+        uint32_t value = values_[location];
+        auto entry = entries_.find(location);
+        if (entry != entries_.end() && entry->second == value) continue;
+        trace_.writes.push_back({is_global(location), location_index(location), value});
+        if (entry == entries_.end()) continue;
+        const TraceInstruction& in = at(entry->second);
+        const TraceInstruction& out = at(value);
+        bool check = false;
+        if (in.kind && out.kind != in.kind) {
+            if (out.kind) return false;
+            check = true;
+        }
+        trace_.carries.push_back({entry->second, value, check});
+    }
+    hoist_invariants();
+    return true;
+}
+
+bool Recorder::run(uint32_t& resume) {
+    const std::vector<uint32_t>& code = chunk_.code;
+    uint32_t position = trace_.header;
+    for (size_t length = 0; length < kMaxTraceLength; ++length) {
+        resume = position;
+        // A superinstruction only stands for its first part; the others follow in place.
+        Opcode op = superinstruction_parts(decode_op(code[position])).front();
+        const uint32_t* words = &code[position];
+        uint32_t a = decode_operand(words[0]);
+        uint32_t next = position + static_cast<uint32_t>(instruction_length(op));
+        switch (generic_opcode(op)) {
+            case Opcode::Move:
+                write(slot_location(a), operand(words[1]), source(words[1]));
+                break;
+            case Opcode::LoadSelf:
+                write(slot_location(a), self(), context_.self);
+                break;
+            case Opcode::LoadGlobal:
+                write(slot_location(a), read(global_location(words[1])),
+                      context_.globals[words[1]]);
+                break;
+            case Opcode::StoreGlobal:
+                write(global_location(a), operand(words[1]), source(words[1]));
+                break;
+            case Opcode::Not:
+            case Opcode::Truthy:
+                truthiness(op, a, words[1]);
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Mod:
+                if (!arithmetic(op, position, a, words[1], words[2])) return false;
+                break;
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+                if (!compare(op, position, a, words[1], words[2])) return false;
+                break;
+            case Opcode::Cast:
+            case Opcode::Coerce:
+                if (!convert(position, a, words[1], chunk_.types[words[2]])) return false;
+                break;
+            case Opcode::Index:
+            case Opcode::Length:
+            case Opcode::IterSource:
+                if (!sequence(op, position, words)) return false;
+                break;
+            case Opcode::GetProp:
+                if (!property(position, words)) return false;
+                break;
+            case Opcode::Jump:
+                if (a == trace_.header) {
+                    resume = a;
+                    return close();
+                }
+                if (a < position) return false;  // An inner loop
+                next = a;
+                break;
+            case Opcode::JumpIfFalse:
+            case Opcode::JumpIfTrue: {
+                uint32_t value = operand(words[1]);
+                bool truthy = source(words[1]).truthy();
+                bool taken = truthy == (op == Opcode::JumpIfTrue);
+                uint32_t target = taken ? a : next;
+                if (target <= position) return false;
+                if (!known_truthiness(value)) {
+                    TraceInstruction guard{TraceOp::Guard, TraceRep::Bool, std::nullopt, value};
+                    guard.cond = truthy;
+                    guard.exit = exit(taken ? next : a, std::nullopt);
+                    emit(guard);
+                }
+                next = target;
+                break;
+            }
+            default:
+                return false;
+        }
+        position = next;
+    }
+    resume = position;
+    return false;
+}
+
+bool uses_operands(TraceOp op) {
+    return op != TraceOp::Slot && op != TraceOp::Global && op != TraceOp::Self &&
+           op != TraceOp::Const;
+}
+
+bool uses_second_operand(TraceOp op) {
+    switch (op) {
+        case TraceOp::AddI32:
+        case TraceOp::SubI32:
+        case TraceOp::MulI32:
+        case TraceOp::DivI32:
+        case TraceOp::ModI32:
+        case TraceOp::AddF64:
+        case TraceOp::SubF64:
+        case TraceOp::MulF64:
+        case TraceOp::DivF64:
+        case TraceOp::CompareI32:
+        case TraceOp::CompareF64:
+        case TraceOp::Index:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Instructions that can leave the trace, which dead code elimination keeps.
+bool can_exit(TraceOp op) {
+    switch (op) {
+        case TraceOp::AddI32:
+        case TraceOp::SubI32:
+        case TraceOp::MulI32:
+        case TraceOp::DivI32:
+        case TraceOp::ModI32:
+        case TraceOp::Unbox:
+        case TraceOp::Index:
+        case TraceOp::Property:
+        case TraceOp::Guard:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_entry(TraceOp op) {
+    return op == TraceOp::Slot || op == TraceOp::Global || op == TraceOp::Self;
+}
+
+}  // anonymous namespace
+
+bool record_trace(const Chunk& chunk, uint32_t header, Value* slots, JitContext& context,
+                  Trace& trace, uint32_t& resume) {
+    trace.header = header;
+    return Recorder(chunk, slots, context, trace).run(resume);
+}
+
+void eliminate_dead_code(Trace& trace) {
+    std::vector<TraceInstruction>& instructions = trace.instructions;
+    std::vector<uint32_t> work;
+    auto use = [&](uint32_t value) {
+        if (instructions[value].live) return;
+        instructions[value].live = true;
+        work.push_back(value);
+    };
+    for (TraceInstruction& instruction : instructions) instruction.live = false;
+    for (uint32_t i = 0; i < instructions.size(); ++i) {
+        if (can_exit(instructions[i].op)) use(i);
+    }
+    for (const TraceExit& exit : trace.exits) {
+        for (const TraceWrite& write : exit.writes) use(write.value);
+    }
+    for (const TraceWrite& write : trace.writes) use(write.value);
+    while (!work.empty()) {
+        const TraceInstruction& instruction = instructions[work.back()];
+        work.pop_back();
+        if (!uses_operands(instruction.op)) continue;
+        use(instruction.x);
+        if (uses_second_operand(instruction.op)) use(instruction.y);
+    }
+}
+
+#if TOOI_JIT_AVAILABLE
+
+namespace {
+
+// ----------------------------------------------------------------------------
+// Trace compiler
+//
+// Trace code keeps the frame's slots in rbx, the globals in r12, the
+// JitContext in r13, and the int32 tag and the bits of nil in r14 and r15
+// as the templates do; rbp counts the iterations completed. Every trace
+// value has a cell in the stack frame holding it in its rep; constants are
+// immediates instead. The loop entries are loaded, checked and unboxed once,
+// before the loop, and the invariant instructions run there too. At the end
+// of an iteration every written location is stored back, boxed, and the
+// carried values move into the cells of the entries they replace. An exit
+// that deoptimizes stores its DeoptReason in JitContext::deopt.
+// ----------------------------------------------------------------------------
+
+const uint64_t kNilBits = Value::nil().bits();
+const uint64_t kInt32Bits = Value::int32(0).bits();
+const uint64_t kNaNBits =
+    Value::number(ValueKind::Float64, std::numeric_limits<double>::quiet_NaN()).bits();
+
+// Called from trace code, with the System V calling convention.
+uint32_t trace_has_kind(Value value, uint32_t kind) {
+    return value.is(static_cast<ValueKind>(kind));
+}
+uint32_t trace_index(Value sequence, int64_t index, Value* element) {
+    const std::vector<Value>& elements = as_array(sequence)->elements();
+    if (static_cast<uint64_t>(index) >= elements.size()) return 0;
+    *element = elements[index];
+    return 1;
+}
+int64_t trace_length(Value sequence) {
+    return static_cast<int64_t>(as_array(sequence)->elements().size());
+}
+uint32_t trace_property(Value object, const Shape* shape, uint32_t slot, Value* property) {
+    if (!object.is(ValueKind::Object) || as_object(object)->shape != shape) return 0;
+    *property = as_object(object)->slots()[slot];
+    return 1;
+}
+
+class TraceCompiler {
+public:
+    explicit TraceCompiler(const Trace& trace)
+        : trace_(trace), cells_(trace.instructions.size(), -1), exits_(trace.exits.size()) {}
+
+    std::vector<uint8_t> compile();
+
+private:
+    const Trace& trace_;
+    Assembler as_;
+    std::vector<int32_t> cells_;  ///< Stack offset per instruction; -1 for constants
+    std::vector<Label> exits_;
+    Label leave_;
+    Label entry_failed_;  ///< An entry has another kind than when recorded
+    Label shape_failed_;  ///< An invariant Property found another shape
+    Label end_failed_;    ///< A carried value has another kind than its entry
+
+    const TraceInstruction& at(uint32_t value) const { return trace_.instructions[value]; }
+
+    void load(Reg dst, uint32_t value);
+    void box(uint32_t value);
+    void convert(uint32_t value, TraceRep rep);
+    void check_kind(int32_t cell, ValueKind kind, Label& failed);
+    void write_back(const std::vector<TraceWrite>& writes);
+    void leave_at(uint32_t position, std::optional<DeoptReason> reason = std::nullopt) {
+        if (reason) {
+            as_.store_byte(r13, offsetof(JitContext, deopt), static_cast<uint8_t>(*reason));
+        }
+        as_.mov32(rax, position);
+        as_.jmp(leave_);
+    }
+
+    void entry(uint32_t value);
+    void instruction(uint32_t value);
+    void int32_arithmetic(const TraceInstruction& instruction, int32_t cell);
+    void float64_compare(const TraceInstruction& instruction);
+};
+
+// Loads a value, in its rep, into a general register.
+void TraceCompiler::load(Reg dst, uint32_t value) {
+    const TraceInstruction& instruction = at(value);
+    if (instruction.op != TraceOp::Const) {
+        as_.load(dst, rsp, cells_[value]);
+        return;
+    }
+    const Value& constant = instruction.constant;
+    switch (instruction.rep) {
+        case TraceRep::Int32:
+            as_.mov(dst, static_cast<uint64_t>(constant.as_int()));
+            break;
+        case TraceRep::Bool:
+            as_.mov(dst, uint64_t{constant.as_bool()});
+            break;
+        default:
+            as_.mov(dst, constant.bits());
+            break;
+    }
+}
+
+// Boxes a value into rax.
+void TraceCompiler::box(uint32_t value) {
+    const TraceInstruction& instruction = at(value);
+    if (instruction.op == TraceOp::Const) {
+        as_.mov(rax, instruction.constant.bits());
+        return;
+    }
+    load(rax, value);
+    switch (instruction.rep) {
+        case TraceRep::Int32:
+            as_.shl64(rax, 16);
+            as_.shr64(rax, 16);
+            as_.alu64(kOr, rax, r14);
+            break;
+        case TraceRep::Float64: {
+            Label done;
+            as_.movq_to_xmm(0, rax);
+            as_.ucomisd(0, 0);  // Only a NaN is unordered with itself
+            as_.jump_if(kNoParity, done);
+            as_.mov(rax, kNaNBits);
+            as_.bind(done);
+            break;
+        }
+        case TraceRep::Bool:
+            as_.alu64(kAdd, rax, r15);
+            as_.add64(rax, 1);
+            break;
+        case TraceRep::Any:
+            break;
+    }
+}
+
+// Loads a value converted to `rep` into rax. A value of another rep than
+// its entry's is either boxed into an Any entry, or an Any whose kind was
+// just checked.
+void TraceCompiler::convert(uint32_t value, TraceRep rep) {
+    if (rep == TraceRep::Any) {
+        box(value);
+        return;
+    }
+    load(rax, value);
+    if (at(value).rep == TraceRep::Any && rep == TraceRep::Int32) as_.movsxd(rax, rax);
+}
+
+// Jumps to `failed` unless the Value in a cell has the kind.
+void TraceCompiler::check_kind(int32_t cell, ValueKind kind, Label& failed) {
+    as_.load(rax, rsp, cell);
+    switch (kind) {
+        case ValueKind::Int32:
+            as_.mov(rdx, rax);
+            as_.shr64(rdx, 48);
+            as_.cmp32(rdx, static_cast<uint32_t>(kInt32Bits >> 48));
+            as_.jump_if(kNotEqual, failed);
+            break;
+        case ValueKind::Float64:
+            as_.mov(rdx, rax);
+            as_.shr64(rdx, 51);
+            as_.cmp32(rdx, static_cast<uint32_t>(kNilBits >> 51));
+            as_.jump_if(kEqual, failed);
+            break;
+        default:
+            as_.mov(rdi, rax);
+            as_.mov32(rsi, static_cast<uint32_t>(kind));
+            as_.mov(rax, reinterpret_cast<uint64_t>(&trace_has_kind));
+            as_.call(rax);
+            as_.alu32(kTest, rax, rax);
+            as_.jump_if(kEqual, failed);
+            break;
+    }
+}
+
+void TraceCompiler::write_back(const std::vector<TraceWrite>& writes) {
+    for (const TraceWrite& write : writes) {
+        box(write.value);
+        as_.store(write.global ? r12 : rbx, static_cast<int32_t>(write.index * sizeof(Value)),
+                  rax);
+    }
+}
+
+// Loads, checks and unboxes a value entering the loop.
+void TraceCompiler::entry(uint32_t value) {
+    const TraceInstruction& instruction = at(value);
+    int32_t cell = cells_[value];
+    int32_t offset = static_cast<int32_t>(instruction.x * sizeof(Value));
+    switch (instruction.op) {
+        case TraceOp::Slot:
+            as_.load(rax, rbx, offset);
+            break;
+        case TraceOp::Global:
+            as_.load(rax, r12, offset);
+            break;
+        default:
+            as_.load(rax, r13, offsetof(JitContext, self));
+            break;
+    }
+    as_.store(rsp, cell, rax);
+    if (!instruction.kind) return;
+    check_kind(cell, *instruction.kind, entry_failed_);
+    if (instruction.rep == TraceRep::Int32) {
+        as_.load_int32(rax, rsp, cell);
+        as_.store(rsp, cell, rax);
+    }
+}
+
+void TraceCompiler::instruction(uint32_t value) {
+    const TraceInstruction& instruction = at(value);
+    int32_t cell = cells_[value];
+    switch (instruction.op) {
+        case TraceOp::AddI32:
+        case TraceOp::SubI32:
+        case TraceOp::MulI32:
+        case TraceOp::DivI32:
+        case TraceOp::ModI32:
+            int32_arithmetic(instruction, cell);
+            return;
+        case TraceOp::AddF64:
+        case TraceOp::SubF64:
+        case TraceOp::MulF64:
+        case TraceOp::DivF64: {
+            static constexpr Sse kOps[] = {kAddsd, kSubsd, kMulsd, kDivsd};
+            load(rax, instruction.x);
+            load(rcx, instruction.y);
+            as_.movq_to_xmm(0, rax);
+            as_.movq_to_xmm(1, rcx);
+            as_.sse(kOps[static_cast<int>(instruction.op) - static_cast<int>(TraceOp::AddF64)], 0,
+                    1);
+            as_.movq_from_xmm(rax, 0);
+            break;
+        }
+        case TraceOp::CompareI32:
+            load(rax, instruction.x);
+            load(rcx, instruction.y);
+            as_.alu32(kCmp, rax, rcx);
+            as_.set(static_cast<Cond>(instruction.cond), rax);
+            break;
+        case TraceOp::CompareF64:
+            float64_compare(instruction);
+            break;
+        case TraceOp::Not:
+        case TraceOp::Truthy:
+            load(rax, instruction.x);
+            if (at(instruction.x).rep == TraceRep::Bool) {
+                as_.xor32(rax, 1);  // Only Not reaches here with a bool
+            } else {
+                as_.alu64(kSub, rax, r15);  // nil and false are the two lowest boxed values
+                as_.cmp64(rax, 1);
+                as_.set(instruction.op == TraceOp::Not ? kBelowEqual : kAbove, rax);
+            }
+            break;
+        case TraceOp::Int32ToFloat64:
+            load(rax, instruction.x);
+            as_.cvtsi2sd(0, rax);
+            as_.movq_from_xmm(rax, 0);
+            break;
+        case TraceOp::Unbox:
+            load(rax, instruction.x);
+            as_.store(rsp, cell, rax);
+            check_kind(cell, *instruction.kind, exits_[instruction.exit]);
+            if (instruction.rep != TraceRep::Int32) return;
+            as_.load_int32(rax, rsp, cell);
+            break;
+        case TraceOp::Index:
+            load(rdi, instruction.x);
+            load(rsi, instruction.y);
+            as_.lea(rdx, rsp, cell);
+            as_.mov(rax, reinterpret_cast<uint64_t>(&trace_index));
+            as_.call(rax);
+            as_.alu32(kTest, rax, rax);
+            as_.jump_if(kEqual, exits_[instruction.exit]);
+            return;
+        case TraceOp::Property:
+            load(rdi, instruction.x);
+            as_.mov(rsi, reinterpret_cast<uint64_t>(instruction.shape));
+            as_.mov32(rdx, instruction.y);
+            as_.lea(rcx, rsp, cell);
+            as_.mov(rax, reinterpret_cast<uint64_t>(&trace_property));
+            as_.call(rax);
+            as_.alu32(kTest, rax, rax);
+            as_.jump_if(kEqual, instruction.invariant ? shape_failed_ : exits_[instruction.exit]);
+            return;
+        case TraceOp::Length:
+            load(rdi, instruction.x);
+            as_.mov(rax, reinterpret_cast<uint64_t>(&trace_length));
+            as_.call(rax);
+            break;
+        case TraceOp::Guard: {
+            load(rax, instruction.x);
+            Cond falsy = kBelowEqual;
+            if (at(instruction.x).rep == TraceRep::Bool) {
+                as_.alu32(kTest, rax, rax);
+                falsy = kEqual;
+            } else {
+                as_.alu64(kSub, rax, r15);
+                as_.cmp64(rax, 1);
+            }
+            Cond failed = instruction.cond ? falsy : static_cast<Cond>(falsy ^ 1);
+            as_.jump_if(failed, exits_[instruction.exit]);
+            return;
+        }
+        default:
+            return;
+    }
+    as_.store(rsp, cell, rax);
+}
+
+void TraceCompiler::int32_arithmetic(const TraceInstruction& instruction, int32_t cell) {
+    Label& exit = exits_[instruction.exit];
+    load(rax, instruction.x);
+    load(rcx, instruction.y);
+    switch (instruction.op) {
+        case TraceOp::AddI32:
+            as_.alu32(kAdd, rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        case TraceOp::SubI32:
+            as_.alu32(kSub, rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        case TraceOp::MulI32:
+            as_.imul32(rax, rcx);
+            as_.jump_if(kOverflow, exit);
+            break;
+        default: {
+            Label divide;
+            as_.alu32(kTest, rcx, rcx);
+            as_.jump_if(kEqual, exit);
+            as_.cmp32(rcx, UINT32_MAX);
+            as_.jump_if(kNotEqual, divide);
+            as_.cmp32(rax, 0x80000000u);
+            as_.jump_if(kEqual, exit);
+            as_.bind(divide);
+            as_.cdq();
+            as_.idiv32(rcx);
+            if (instruction.op == TraceOp::ModI32) as_.mov(rax, rdx);
+            break;
+        }
+    }
+    as_.movsxd(rax, rax);
+    as_.store(rsp, cell, rax);
+}
+
+void TraceCompiler::float64_compare(const TraceInstruction& instruction) {
+    load(rax, instruction.x);
+    load(rcx, instruction.y);
+    as_.movq_to_xmm(0, rax);
+    as_.movq_to_xmm(1, rcx);
+    // As in the templates: unordered operands make every "above" condition false.
+    switch (instruction.cond) {
+        case kLess:
+        case kLessEqual:
+            as_.ucomisd(1, 0);
+            as_.set(instruction.cond == kLess ? kAbove : kAboveEqual, rax);
+            break;
+        case kGreater:
+        case kGreaterEqual:
+            as_.ucomisd(0, 1);
+            as_.set(instruction.cond == kGreater ? kAbove : kAboveEqual, rax);
+            break;
+        case kEqual:
+            as_.ucomisd(0, 1);
+            as_.set(kEqual, rax);
+            as_.set(kNoParity, rcx);
+            as_.alu32(kAnd, rax, rcx);
+            break;
+        default:
+            as_.ucomisd(0, 1);
+            as_.set(kNotEqual, rax);
+            as_.set(kParity, rcx);
+            as_.alu32(kOr, rax, rcx);
+            break;
+    }
+}
+
+std::vector<uint8_t> TraceCompiler::compile() {
+    const std::vector<TraceInstruction>& instructions = trace_.instructions;
+    int32_t cells = 0;
+    for (uint32_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].live && instructions[i].op != TraceOp::Const) {
+            cells_[i] = static_cast<int32_t>(cells++ * sizeof(Value));
+        }
+    }
+    std::vector<const TraceCarry*> carries;
+    for (const TraceCarry& carry : trace_.carries) {
+        if (instructions[carry.entry].live) carries.push_back(&carry);
+    }
+    int32_t scratch = static_cast<int32_t>(cells * sizeof(Value));
+    cells += static_cast<int32_t>(carries.size());
+    // Six pushes after the return address leave rsp 8 bytes off the 16-byte
+    // alignment calls need, which the frame makes up for.
+    auto frame = static_cast<uint32_t>((cells * sizeof(Value) + 8 + 15) / 16 * 16 - 8);
+
+    // Jit::loop calls the code as uint64_t (Value* slots, JitContext*).
+    for (Reg r : {rbx, rbp, r12, r13, r14, r15}) as_.push(r);
+    as_.mov(rbx, rdi);
+    as_.mov(r13, rsi);
+    as_.load(r12, r13, offsetof(JitContext, globals));
+    as_.mov(r14, kInt32Bits);
+    as_.mov(r15, kNilBits);
+    as_.mov32(rbp, 0);
+    as_.sub_rsp(frame);
+    for (uint32_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].live && is_entry(instructions[i].op)) entry(i);
+    }
+    for (uint32_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].live && instructions[i].invariant) instruction(i);
+    }
+
+    Label loop;
+    as_.bind(loop);
+    for (uint32_t i = 0; i < instructions.size(); ++i) {
+        const TraceInstruction& instruction = instructions[i];
+        if (instruction.live && !instruction.invariant && !is_entry(instruction.op)) {
+            this->instruction(i);
+        }
+    }
+    for (const TraceCarry* carry : carries) {
+        if (carry->check) check_kind(cells_[carry->value], *at(carry->entry).kind, end_failed_);
+    }
+    write_back(trace_.writes);
+    // Parallel copy: one carried value may be the entry another one replaces.
+    for (size_t i = 0; i < carries.size(); ++i) {
+        convert(carries[i]->value, at(carries[i]->entry).rep);
+        as_.store(rsp, scratch + static_cast<int32_t>(i * sizeof(Value)), rax);
+    }
+    for (size_t i = 0; i < carries.size(); ++i) {
+        as_.load(rax, rsp, scratch + static_cast<int32_t>(i * sizeof(Value)));
+        as_.store(rsp, cells_[carries[i]->entry], rax);
+    }
+    as_.add64(rbp, 1);
+    as_.jmp(loop);
+
+    as_.bind(entry_failed_);
+    leave_at(trace_.header, DeoptReason::Kind);
+    as_.bind(shape_failed_);
+    leave_at(trace_.header, DeoptReason::Shape);
+    as_.bind(end_failed_);
+    write_back(trace_.writes);
+    leave_at(trace_.header, DeoptReason::Kind);
+    for (size_t i = 0; i < exits_.size(); ++i) {
+        if (exits_[i].fixups.empty()) continue;
+        as_.bind(exits_[i]);
+        write_back(trace_.exits[i].writes);
+        leave_at(trace_.exits[i].position, trace_.exits[i].reason);
+    }
+    // The position goes in the low half of the result, the iterations in the high half.
+    as_.bind(leave_);
+    as_.shl64(rbp, 32);
+    as_.alu64(kOr, rax, rbp);
+    as_.add_rsp(frame);
+    for (Reg r : {r15, r14, r13, r12, rbp, rbx}) as_.pop(r);
+    as_.ret();
+    return std::move(as_.code);
+}
+
+}  // anonymous namespace
+
+std::vector<uint8_t> compile_trace(const Trace& trace) { return TraceCompiler(trace).compile(); }
+
+uint32_t Jit::loop(const Chunk& chunk, uint32_t header, Value* slots, JitContext& context) {
+    Loop& loop = loops_[&chunk.code[header]];
+    if (loop.blacklisted) return header;
+    if (!loop.trace) {
+        if (++loop.hotness < kLoopHotness) return header;
+        Trace trace;
+        uint32_t resume = header;
+        if (!record_trace(chunk, header, slots, context, trace, resume)) {
+            abort(loop);
+            return resume;
+        }
+        eliminate_dead_code(trace);
+        if (!cache_.install(loop.trace, loop.hotness, compile_trace(trace), {})) {
+            abort(loop);
+            return resume;
+        }
+        for (Object* object : trace.watched) dependencies_.add(*object, loop.trace);
+        loop.runs = 0;
+        loop.iterations = 0;
+        loop.misses = 0;
+        stats_.traces++;
+    }
+    cache_.touch(*loop.trace);
+    stats_.trace_entries++;
+    using Code = uint64_t (*)(Value*, JitContext*);
+    auto code = reinterpret_cast<Code>(const_cast<uint8_t*>(loop.trace->code));
+    context.deopt = kNoDeopt;
+    uint64_t result = code(slots, &context);
+    if (context.deopt != kNoDeopt) stats_.deopts.count(static_cast<DeoptReason>(context.deopt));
+    auto resume = static_cast<uint32_t>(result);
+    auto iterations = static_cast<uint32_t>(result >> 32);
+    loop.iterations += iterations;
+    if (iterations > 0) {
+        loop.misses = 0;
+    } else if (++loop.misses == kLoopHotness) {
+        // The kinds or shapes the trace was recorded with no longer hold, so
+        // that it keeps leaving before completing an iteration: record it again.
+        cache_.evict(loop.trace);
+        stats_.trace_invalidated++;
+        abort(loop);
+    }
+    if (loop.trace && ++loop.runs == kProbation && loop.iterations < kProbation * kMinIterations) {
+        // The trace leaves too early to pay for entering it; the templates run the loop.
+        cache_.evict(loop.trace);
+        loop.blacklisted = 1;
+        stats_.blacklisted++;
+    }
+    return resume;
+}
+
+#else
+
+std::vector<uint8_t> compile_trace(const Trace&) { return {}; }
+
+uint32_t Jit::loop(const Chunk&, uint32_t header, Value*, JitContext&) { return header; }
+
+#endif
+
+void Jit::abort(Loop& loop) {
+    stats_.trace_aborts++;
+    loop.hotness = 0;
+    if (++loop.aborts == kMaxAborts) {
+        loop.blacklisted = 1;
+        stats_.blacklisted++;
+    }
+}
+
+}  // namespace vm
+}  // namespace tooi
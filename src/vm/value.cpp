@@ -0,0 +1,290 @@
+/**
+ * @file value.cpp
+ * @brief Implementation of runtime value helpers: type names, display text and equality.
+ */
+#include "tooi/vm/value.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <unordered_set>
+
+#include "tooi/core/conversions.h"
+#include "tooi/vm/object.h"
+
+namespace tooi {
+namespace vm {
+
+namespace {
+
+using core::Type;
+using core::TypeKind;
+
+void append_display(const Value& value, bool quote_strings,
+                    std::unordered_set<const HeapObject*>& active, std::string& out);
+
+void append_elements(const std::vector<Value>& elements,
+                     std::unordered_set<const HeapObject*>& active, std::string& out) {
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (i > 0) out += ", ";
+        append_display(elements[i], true, active, out);
+    }
+}
+
+void append_display(const Value& value, bool quote_strings,
+                    std::unordered_set<const HeapObject*>& active, std::string& out) {
+    switch (value.kind()) {
+        case ValueKind::Nil:
+            out += "nil";
+            return;
+        case ValueKind::Bool:
+            out += value.as_bool() ? "true" : "false";
+            return;
+        case ValueKind::Int32:
+        case ValueKind::Int64:
+            core::append_int(value.as_int(), out);
+            return;
+        case ValueKind::Byte:
+        case ValueKind::UInt32:
+        case ValueKind::UInt64:
+            core::append_uint(value.as_uint(), out);
+            return;
+        case ValueKind::Float32:
+        case ValueKind::Float64:
+            core::append_float(value.as_double(), value.is(ValueKind::Float32), out);
+            return;
+        case ValueKind::String:
+            if (quote_strings) {
+                out += '"' + as_string(value)->text + '"';
+            } else {
+                out += as_string(value)->text;
+            }
+            return;
+        case ValueKind::Object: {
+            const std::string& name = as_object(value)->name;
+            out += name.empty() ? "<object>" : "<object " + name + ">";
+            return;
+        }
+        case ValueKind::Closure:
+            out += "<act>";
+            return;
+        case ValueKind::Module:
+            out += "<module " + as_module(value)->name + ">";
+            return;
+        default:
+            break;
+    }
+
+    // Collections; one that is already being printed is elided.
+    bool tuple = value.is(ValueKind::Tuple);
+    if (!active.insert(value.ref()).second) {
+        out += tuple ? "(...)" : "[...]";
+        return;
+    }
+    if (value.is(ValueKind::Assoc)) {
+        const AssocObject* assoc = as_assoc(value);
+        out += '[';
+        if (assoc->entries().empty()) out += "->";
+        for (size_t i = 0; i < assoc->entries().size(); ++i) {
+            if (i > 0) out += ", ";
+            append_display(assoc->entries()[i].first, true, active, out);
+            out += " -> ";
+            append_display(assoc->entries()[i].second, true, active, out);
+        }
+        out += ']';
+    } else {
+        out += tuple ? '(' : '[';
+        append_elements(as_array(value)->elements(), active, out);
+        out += tuple ? ')' : ']';
+    }
+    active.erase(value.ref());
+}
+
+}  // anonymous namespace
+
+const char* kind_name(ValueKind kind) {
+    switch (kind) {
+        case ValueKind::Nil:
+            return "nil";
+        case ValueKind::Bool:
+            return "bool";
+        case ValueKind::Byte:
+            return "byte";
+        case ValueKind::Int32:
+            return "int";
+        case ValueKind::Int64:
+            return "int64";
+        case ValueKind::UInt32:
+            return "uint";
+        case ValueKind::UInt64:
+            return "uint64";
+        case ValueKind::Float32:
+            return "float";
+        case ValueKind::Float64:
+            return "float64";
+        case ValueKind::String:
+            return "string";
+        case ValueKind::Array:
+            return "array";
+        case ValueKind::Tuple:
+            return "tuple";
+        case ValueKind::Assoc:
+            return "assoc";
+        case ValueKind::Object:
+            return "object";
+        case ValueKind::Closure:
+            return "act";
+        case ValueKind::Module:
+            return "module";
+    }
+    return "<unknown>";
+}
+
+core::TypeRef primitive_type(ValueKind kind) {
+    switch (kind) {
+        case ValueKind::Nil:
+            return Type::nil();
+        case ValueKind::Bool:
+            return Type::boolean();
+        case ValueKind::Byte:
+            return Type::byte();
+        case ValueKind::Int32:
+            return Type::int32();
+        case ValueKind::Int64:
+            return Type::int64();
+        case ValueKind::UInt32:
+            return Type::uint32();
+        case ValueKind::UInt64:
+            return Type::uint64();
+        case ValueKind::Float32:
+            return Type::float32();
+        case ValueKind::Float64:
+            return Type::float64();
+        case ValueKind::String:
+            return Type::string();
+        default:
+            return nullptr;
+    }
+}
+
+ValueKind kind_of(const core::TypeRef& type) {
+    switch (type->kind) {
+        case TypeKind::Bool:
+            return ValueKind::Bool;
+        case TypeKind::Byte:
+            return ValueKind::Byte;
+        case TypeKind::Int32:
+            return ValueKind::Int32;
+        case TypeKind::Int64:
+            return ValueKind::Int64;
+        case TypeKind::UInt32:
+            return ValueKind::UInt32;
+        case TypeKind::UInt64:
+            return ValueKind::UInt64;
+        case TypeKind::Float32:
+            return ValueKind::Float32;
+        case TypeKind::Float64:
+            return ValueKind::Float64;
+        case TypeKind::String:
+            return ValueKind::String;
+        case TypeKind::Array:
+            return ValueKind::Array;
+        case TypeKind::Tuple:
+            return ValueKind::Tuple;
+        case TypeKind::Assoc:
+            return ValueKind::Assoc;
+        case TypeKind::Object:
+            return ValueKind::Object;
+        case TypeKind::Module:
+            return ValueKind::Module;
+        case TypeKind::Proto:
+        case TypeKind::Nil:
+            break;
+    }
+    return ValueKind::Nil;
+}
+
+std::string display_string(const Value& value) {
+    if (value.is(ValueKind::String)) return as_string(value)->text;
+    std::string out;
+    std::unordered_set<const HeapObject*> active;
+    append_display(value, false, active, out);
+    return out;
+}
+
+bool values_equal(const Value& a, const Value& b) {
+    if (a.is_int32() && b.is_int32()) return a.bits() == b.bits();
+    ValueKind a_kind = a.kind();
+    ValueKind b_kind = b.kind();
+    if (a.bits() == b.bits() && !is_float_kind(a_kind)) return true;
+    if (is_numeric_kind(a_kind) && is_numeric_kind(b_kind)) {
+        if (is_float_kind(a_kind) || is_float_kind(b_kind)) {
+            auto as_double = [](const Value& v, ValueKind kind) {
+                if (is_float_kind(kind)) return v.as_double();
+                return is_signed_kind(kind) ? static_cast<double>(v.as_int())
+                                            : static_cast<double>(v.as_uint());
+            };
+            return as_double(a, a_kind) == as_double(b, b_kind);
+        }
+        bool a_signed = is_signed_kind(a_kind);
+        bool b_signed = is_signed_kind(b_kind);
+        if (a_signed && b_signed) return a.as_int() == b.as_int();
+        if (!a_signed && !b_signed) return a.as_uint() == b.as_uint();
+        // Signed against unsigned: a negative value equals no unsigned one.
+        int64_t signed_value = a_signed ? a.as_int() : b.as_int();
+        uint64_t unsigned_value = a_signed ? b.as_uint() : a.as_uint();
+        return signed_value >= 0 && static_cast<uint64_t>(signed_value) == unsigned_value;
+    }
+    // Different bits: only strings with the same text are still equal.
+    return a_kind == ValueKind::String && b_kind == ValueKind::String &&
+           as_string(a)->text == as_string(b)->text;
+}
+
+size_t hash_value(const Value& value) {
+    ValueKind kind = value.kind();
+    if (is_numeric_kind(kind)) {
+        // Equal numbers of different kinds must hash alike: integral values hash as integers.
+        if (is_float_kind(kind)) {
+            double number = value.as_double();
+            if (std::trunc(number) == number && std::fabs(number) < 9.2e18) {
+                return std::hash<int64_t>()(static_cast<int64_t>(number));
+            }
+            if (number == 0) return 0;
+            return std::hash<double>()(number);
+        }
+        if (is_signed_kind(kind)) return std::hash<int64_t>()(value.as_int());
+        uint64_t number = value.as_uint();
+        if (number <= static_cast<uint64_t>(INT64_MAX)) {
+            return std::hash<int64_t>()(static_cast<int64_t>(number));
+        }
+        return std::hash<uint64_t>()(number);
+    }
+    switch (kind) {
+        case ValueKind::Nil:
+            return 0;
+        case ValueKind::Bool:
+            return value.as_bool() ? 1 : 2;
+        case ValueKind::String:
+            return std::hash<std::string>()(as_string(value)->text);
+        default:
+            return std::hash<uint64_t>()(value.bits());
+    }
+}
+
+// ============================================================================
+// Value
+// ============================================================================
+
+uint64_t Value::boxed_integer() const {
+    TOOI_VALUE_CHECK(is_pointer() && !is_heap(), "boxed integer expected");
+    return static_cast<const IntegerObject*>(pointer())->bits;
+}
+
+void invalid_value(const char* message, const char* file, int line) {
+    std::fprintf(stderr, "%s:%d: invalid value: %s\n", file, line, message);
+    std::abort();
+}
+
+}  // namespace vm
+}  // namespace tooi
@@ -0,0 +1,1231 @@
+/**
+ * @file vm.cpp
+ * @brief Implementation of the bytecode interpreter loop and the builtin methods.
+ */
+#include "tooi/vm/vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "tooi/core/source_location.h"
+#include "tooi/vm/compiler.h"
+#include "tooi/vm/fast_paths.h"
+
+namespace tooi {
+namespace vm {
+
+using core::ErrorCode;
+
+namespace {
+
+// Position in a sequence of the given size, for an integer index of any kind.
+size_t element_index(const Value& index, size_t size, ValueKind container) {
+    if (!is_integer_kind(index.kind())) {
+        throw RuntimeError(ErrorCode::Runtime_InvalidIndex, kind_name(container),
+                           kind_name(index.kind()));
+    }
+    uint64_t position = is_signed_kind(index.kind()) ? static_cast<uint64_t>(index.as_int())
+                                                     : index.as_uint();
+    bool in_range = position < size;  // A negative int wraps around to a huge position
+    if (!in_range) {
+        throw RuntimeError(ErrorCode::Runtime_IndexOutOfRange, display_string(index),
+                           kind_name(container), size);
+    }
+    return static_cast<size_t>(position);
+}
+
+void check_arity(const std::string& name, int expected, int argc) {
+    if (argc > expected) {
+        throw RuntimeError(ErrorCode::Runtime_TooManyArguments, name, expected, argc);
+    }
+    if (argc < expected) {
+        throw RuntimeError(ErrorCode::Runtime_MissingArgument, name, expected, argc);
+    }
+}
+
+// Builtin methods of arrays and assocs, shared by CallMethod and the intrinsic opcodes.
+
+// The receiver of an intrinsic, which the type checker allows to be nil as well.
+template <ValueKind kind>
+auto* intrinsic_receiver(const Value& receiver, const char* method) {
+    if (!receiver.is(kind)) {
+        throw RuntimeError(ErrorCode::Runtime_UnknownMethod, kind_name(receiver.kind()), method);
+    }
+    if constexpr (kind == ValueKind::Array) {
+        return as_array(receiver);
+    } else {
+        return as_assoc(receiver);
+    }
+}
+
+Value array_pop(std::vector<Value>& elements) {
+    if (elements.empty()) throw RuntimeError(ErrorCode::Runtime_EmptyArray);
+    Value last = elements.back();
+    elements.pop_back();
+    return last;
+}
+
+void array_insert(std::vector<Value>& elements, const Value& element, const Value& index) {
+    size_t position = element_index(index, elements.size() + 1, ValueKind::Array);
+    elements.insert(elements.begin() + static_cast<std::ptrdiff_t>(position), element);
+}
+
+Value array_remove(std::vector<Value>& elements, const Value& index) {
+    size_t position = element_index(index, elements.size(), ValueKind::Array);
+    Value removed = elements[position];
+    elements.erase(elements.begin() + static_cast<std::ptrdiff_t>(position));
+    return removed;
+}
+
+Value assoc_remove(AssocObject& assoc, const Value& key) {
+    Value removed;
+    if (!assoc.remove(key, &removed)) {
+        throw RuntimeError(ErrorCode::Runtime_MissingKey, describe(key));
+    }
+    return removed;
+}
+
+// The kind both operands share, as far as a typed opcode cares; Nil if none.
+ValueKind typed_kind(const Value& x, const Value& y) {
+    if (x.is_int32() && y.is_int32()) return ValueKind::Int32;
+    if (x.is_float64() && y.is_float64()) return ValueKind::Float64;
+    if (x.is_small_int64() && y.is_small_int64()) return ValueKind::Int64;
+    if (x.is_uint32() && y.is_uint32()) return ValueKind::UInt32;
+    if (x.is_small_uint64() && y.is_small_uint64()) return ValueKind::UInt64;
+    return ValueKind::Nil;
+}
+
+// Reports an error raised outside of any instruction, so without a location.
+void report_general(core::ErrorReporter& reporter, const RuntimeError& error) {
+    const std::vector<std::string>& args = error.args;
+    switch (args.size()) {
+        case 0:
+            reporter.report_general(error.code);
+            break;
+        case 1:
+            reporter.report_general(error.code, args[0]);
+            break;
+        case 2:
+            reporter.report_general(error.code, args[0], args[1]);
+            break;
+        default:
+            reporter.report_general(error.code, args[0], args[1], args[2]);
+            break;
+    }
+}
+
+std::string object_name(const Value& value) {
+    if (value.is(ValueKind::Object) && !as_object(value)->name.empty()) {
+        return as_object(value)->name;
+    }
+    return display_string(value);
+}
+
+}  // anonymous namespace
+
+VM::VM(core::ErrorReporter& error_reporter, std::ostream& out, std::istream& in)
+    : error_reporter_(error_reporter),
+      out_(out),
+      in_(in),
+      stack_(new Value[kInitialStackSize]),
+      megamorphic_(kMegamorphicEntries) {
+    sp_ = stack_.get();
+    frames_.reserve(kMaxFrames);  // Frames are referenced by pointer while they run
+}
+
+// ============================================================================
+// Entry points
+// ============================================================================
+
+void VM::enable_jit(size_t capacity, bool tracing) {
+    jit_ = std::make_unique<Jit>(capacity, tracing);
+    jit_context_.heap_count = heap_.count_address();
+    jit_context_.heap_threshold = heap_.threshold_address();
+}
+
+void VM::use_aot(const AotProgram& program) {
+    aot_ = &program;
+    jit_context_.heap_count = heap_.count_address();
+    jit_context_.heap_threshold = heap_.threshold_address();
+}
+
+bool VM::run(std::unique_ptr<CompiledModule> module, const core::GlobalTable& globals) {
+    auto start = std::chrono::steady_clock::now();
+    global_table_ = &globals;
+    for (size_t i = globals_.size(); i < globals.size(); ++i) {
+        globals_.push_back(zero_value(globals.at(static_cast<int>(i)).type, heap_));
+    }
+    for (const auto& function : module->functions) {
+        function->feedback.assign(function->code.size(), Feedback{});
+        if (!function->code.empty()) attach_aot(*function);  // Lazy acts attach once compiled
+    }
+    modules_.push_back(std::move(module));
+    const Chunk* script = modules_.back()->script();
+
+    // The script runs like an act invoked without arguments (and without an object).
+    size_t base = static_cast<size_t>(sp_ - stack_.get());
+    Value* slots;
+    try {
+        slots = reserve_frame(sp_ + 1, script->slot_count);
+    } catch (const RuntimeError& error) {
+        report_general(error_reporter_, error);
+        return false;
+    }
+    slots[-1] = Value::nil();
+    sp_ = slots;
+    std::fill(slots, slots + script->slot_count, Value::nil());
+    frames_.push_back(Frame{script, script->code.data(), slots, Value::nil(), nullptr, slots - 1});
+    bool ok = execute(frames_.size() - 1);
+    sp_ = stack_.get() + base;
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats_.milliseconds += elapsed.count();
+    return ok;
+}
+
+bool VM::is_invocable(int global) const {
+    if (global < 0 || global >= static_cast<int>(globals_.size())) return false;
+    const Value& value = globals_[global];
+    return value.is(ValueKind::Object) && as_object(value)->act;
+}
+
+bool VM::invoke_global(int global) {
+    auto start = std::chrono::steady_clock::now();
+    size_t base = static_cast<size_t>(sp_ - stack_.get());
+    size_t depth = frames_.size();
+    bool ok = false;
+    try {
+        Value* callee = reserve_frame(sp_, 1);
+        *callee = globals_[global];
+        sp_ = callee + 1;
+        enter(callee, 0, callee);
+        ok = execute(depth);
+    } catch (const RuntimeError& error) {
+        report_general(error_reporter_, error);
+    }
+    sp_ = stack_.get() + base;
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats_.milliseconds += elapsed.count();
+    return ok;
+}
+
+void VM::print_stats(std::ostream& out) const {
+    out << "  VM: " << stats_.instructions << " instruction(s), " << stats_.invocations
+        << " invocation(s) (" << stats_.tail_calls << " tail), " << stats_.quickened << " quickened, " << stats_.dequickened
+        << " de-quickened, " << heap_.collections() << " collection(s), " << std::fixed
+        << std::setprecision(3) << stats_.milliseconds << " ms\n";
+    out.unsetf(std::ios::fixed);
+    if (jit_) {
+        const JitStats& jit = jit_->stats();
+        out << "  JIT: " << jit.compiled << " compiled, " << jit.invalidated << " invalidated, "
+            << jit.entries << " native entr(ies) (" << jit.osr_entries << " on-stack), "
+            << jit_->cache().evictions()
+            << " evicted, " << jit_->cache().used() << " byte(s) of code\n";
+        if (jit_->tracing()) {
+            out << "  Traces: " << jit.traces << " recorded, " << jit.trace_aborts
+                << " aborted, " << jit.trace_invalidated << " invalidated, " << jit.blacklisted
+                << " blacklisted, " << jit.trace_entries
+                << " entered\n";
+        }
+    }
+    if (aot_) {
+        out << "  AOT: " << stats_.aot_chunks << " chunk(s) compiled ahead of time, "
+            << stats_.aot_stale << " interpreted for changed bytecode, " << stats_.aot_entries
+            << " entr(ies)\n";
+    }
+    out << "  Deopts:";
+    for (size_t i = 0; i < kDeoptReasons; ++i) {
+        auto reason = static_cast<DeoptReason>(i);
+        uint64_t count = stats_.deopts[reason] + (jit_ ? jit_->stats().deopts[reason] : 0);
+        out << (i ? ", " : " ") << count << ' ' << deopt_reason_name(reason);
+    }
+    out << '\n';
+}
+
+void VM::print_ic_stats(std::ostream& out) const {
+    out << "  Inline caches:\n";
+    for (const auto& module : modules_) {
+        for (const auto& chunk : module->functions) {
+            for (size_t pc = 0; pc < chunk->code.size();) {
+                Opcode op = decode_op(chunk->code[pc]);
+                const std::vector<OperandKind>& kinds = operand_kinds(op);
+                auto operand = [&](OperandKind kind) {
+                    size_t i = std::find(kinds.begin(), kinds.end(), kind) - kinds.begin();
+                    return i == 0 ? decode_operand(chunk->code[pc]) : chunk->code[pc + i];
+                };
+                if (kinds.back() == OperandKind::Cache) {
+                    const InlineCache& cache = chunk->caches[operand(OperandKind::Cache)];
+                    uint64_t lookups = cache.hits + cache.misses;
+                    if (lookups > 0) {
+                        const char* state = cache.megamorphic ? "megamorphic"
+                                            : cache.count > 1 ? "polymorphic"
+                                            : cache.count == 1 ? "monomorphic"
+                                                               : "uninitialized";
+                        out << "    " << chunk->name << " line " << chunk->locations[pc].line
+                            << ": " << opcode_name(op) << " '"
+                            << chunk->names[operand(OperandKind::Name)] << "' " << state << ", "
+                            << cache.hits << " hit(s), " << cache.misses << " miss(es), "
+                            << std::fixed << std::setprecision(1)
+                            << 100.0 * static_cast<double>(cache.hits) / lookups << "%\n";
+                        out.unsetf(std::ios::fixed);
+                    }
+                }
+                pc += kinds.size();
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Interpreter loop
+// ============================================================================
+
+void VM::enter(Value* callee, int argc, Value* result, bool replace) {
+    if (!callee->is(ValueKind::Object) || !as_object(*callee)->act) {
+        throw RuntimeError(ErrorCode::Runtime_NotInvocable, object_name(*callee));
+    }
+    Closure* closure = as_object(*callee)->act;
+    const Chunk* chunk = closure->function;
+    if (chunk->code.empty()) compile_act(*chunk);
+    if (argc > chunk->param_count) {
+        throw RuntimeError(ErrorCode::Runtime_TooManyArguments, object_name(*callee),
+                           chunk->param_count, argc);
+    }
+    // Growing the stack moves the caller's result slot along with the window.
+    ptrdiff_t result_offset = result - stack_.get();
+    Value* slots = reserve_frame(callee + 1, chunk->slot_count, replace);
+    callee = slots - 1;
+    result = stack_.get() + result_offset;
+    // Missing arguments take the act's defaults. The other slots are cleared
+    // so that the collector never sees values left behind by earlier frames.
+    for (int i = argc; i < chunk->param_count; ++i) {
+        slots[i] = closure->captured[chunk->upvalue_count + i];
+    }
+    std::fill(slots + chunk->param_count, slots + chunk->slot_count, Value::nil());
+    if (replace) {
+        frames_.pop_back();
+        stats_.tail_calls++;
+    }
+    frames_.push_back(Frame{chunk, chunk->code.data(), slots, *callee, closure, result});
+    stats_.invocations++;
+}
+
+Value* VM::reserve_frame(Value* slots, size_t count, bool replace) {
+    auto top = static_cast<size_t>(slots - stack_.get()) + count;
+    size_t depth = replace ? frames_.size() - 1 : frames_.size();
+    if (top <= stack_size_ && depth < kMaxFrames) return slots;
+    if (top > kMaxStackSize || depth == kMaxFrames) {
+        throw RuntimeError(ErrorCode::Runtime_StackOverflow, kMaxFrames);
+    }
+    ptrdiff_t offset = slots - stack_.get();
+    grow_stack(top);
+    return stack_.get() + offset;
+}
+
+void VM::grow_stack(size_t size) {
+    size_t grown = stack_size_;
+    while (grown < size) grown *= 2;
+    grown = std::min(grown, kMaxStackSize);
+    // Slots above sp_ may belong to the running frame, so all of the old stack is copied.
+    auto stack = std::make_unique<Value[]>(grown);
+    std::copy(stack_.get(), stack_.get() + stack_size_, stack.get());
+    auto rebase = [&](Value* pointer) { return stack.get() + (pointer - stack_.get()); };
+    for (Frame& frame : frames_) {
+        frame.slots = rebase(frame.slots);
+        frame.result = rebase(frame.result);
+    }
+    sp_ = rebase(sp_);
+    stack_ = std::move(stack);
+    stack_size_ = grown;
+}
+
+void VM::compile_act(const Chunk& chunk) {
+    // The module owns its chunks; frames and closures only see them as const.
+    Chunk& act = *chunk.module->functions[chunk.index];
+    Compiler(heap_).compile_act(act);
+    act.feedback.assign(act.code.size(), Feedback{});
+    attach_aot(act);
+}
+
+void VM::attach_aot(Chunk& chunk) {
+    if (!aot_) return;
+    if (attach(*aot_, chunk)) {
+        stats_.aot_chunks++;
+    } else {
+        stats_.aot_stale++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Quickening
+//
+// Generic arithmetic, comparisons, Concat and GetProp report to observe()
+// which specialized form their operands would allow. After
+// kQuickenThreshold consecutive executions agree, the opcode byte is
+// rewritten in place. A specialized instruction whose operand guard fails
+// is rewritten back and stays generic from then on, so an instruction that
+// sees mixed kinds does not flip back and forth. A quickened instruction may
+// start a superinstruction with the ones after it; the compiler can only
+// fuse those whose specialized form it knew statically. De-quickening a
+// later part splits the superinstruction again.
+// ----------------------------------------------------------------------------
+
+void VM::observe(const Chunk& chunk, ptrdiff_t position, Opcode candidate) {
+    Feedback& feedback = chunk.feedback[position];
+    if (feedback.count == Feedback::kBlocked) return;
+    uint32_t& word = chunk.code[position];
+    if (candidate == decode_op(word)) {
+        feedback.count = 0;  // Nothing to specialize to
+    } else if (candidate != feedback.candidate) {
+        feedback.candidate = candidate;
+        feedback.count = 1;
+    } else if (++feedback.count == kQuickenThreshold) {
+        word = encode(candidate, decode_operand(word));
+        fuse_superinstruction(chunk.code, position);
+        if (jit_) jit_->invalidate(chunk);
+        stats_.quickened++;
+    }
+}
+
+void VM::dequicken(const Chunk& chunk, ptrdiff_t position) {
+    uint32_t& word = chunk.code[position];
+    word = encode(generic_opcode(decode_op(word)), decode_operand(word));
+    unfuse_superinstructions(chunk.code, static_cast<size_t>(position));
+    chunk.feedback[position].count = Feedback::kBlocked;
+    if (jit_) jit_->invalidate(chunk);
+    stats_.dequickened++;
+    stats_.deopts.count(DeoptReason::Kind);
+}
+
+// ----------------------------------------------------------------------------
+// Inline caches
+//
+// GetPropObject, SetProp and CallMethod sites remember the slot of their
+// property for the shapes they saw (see InlineCache), so that a hit costs a
+// pointer comparison instead of a lookup by name. Megamorphic sites share
+// one direct-mapped table keyed by shape and name.
+// ----------------------------------------------------------------------------
+
+int VM::cached_slot(InlineCache& cache, const Object* object, const std::string& name,
+                    const core::TypeRef** written_type) {
+    const Shape* shape = object->shape;
+    bool for_write = written_type != nullptr;
+    for (uint8_t i = 0; i < cache.count; ++i) {
+        if (cache.entries[i].shape == shape) {
+            cache.hits++;
+            if (for_write) *written_type = cache.entries[i].type;
+            return static_cast<int>(cache.entries[i].slot);
+        }
+    }
+    size_t hash = (reinterpret_cast<uintptr_t>(shape) >> 4) ^
+                  (reinterpret_cast<uintptr_t>(&name) >> 3);
+    MegamorphicEntry& shared = megamorphic_[hash & (kMegamorphicEntries - 1)];
+    if (cache.megamorphic && shared.shape == shape && shared.name == &name &&
+        (shared.writable || !for_write)) {
+        cache.hits++;
+        if (for_write) *written_type = shared.type;
+        return static_cast<int>(shared.slot);
+    }
+    cache.misses++;
+    const Property* property = shape->find(name);
+    if (!property || (for_write && property->is_set)) return -1;
+    const core::TypeRef* type = property->type ? &property->type : nullptr;
+    if (for_write) *written_type = type;
+    if (cache.count < InlineCache::kEntries) {
+        cache.entries[cache.count++] = InlineCache::Entry{shape, property->slot, type};
+    } else {
+        cache.megamorphic = true;
+        shared = MegamorphicEntry{shape, &name, property->slot, !property->is_set, type};
+    }
+    return static_cast<int>(property->slot);
+}
+
+// ----------------------------------------------------------------------------
+// Dispatch
+//
+// With GCC and Clang every handler jumps straight to the next one through a
+// table of label addresses (direct threading), so each handler ends in an
+// indirect branch of its own that the predictor can learn. Other compilers,
+// and builds configured with TOOI_THREADED_DISPATCH=OFF, use a switch in a
+// loop instead. A superinstruction handler runs the bodies of its parts with
+// only a TOOI_VM_FETCH() between them, so the instruction count and error
+// locations are those of the unfused code.
+// ----------------------------------------------------------------------------
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(TOOI_NO_THREADED_DISPATCH)
+#define TOOI_VM_THREADED_DISPATCH 1
+#else
+#define TOOI_VM_THREADED_DISPATCH 0
+#endif
+
+#ifdef TOOI_VM_PROFILE
+#define TOOI_VM_PROFILE_RECORD() profile_.record(decode_op(word), start)
+#else
+#define TOOI_VM_PROFILE_RECORD() (void)0
+#endif
+
+#define TOOI_VM_FETCH()       \
+    start = pc;               \
+    executed++;               \
+    word = *pc++;             \
+    TOOI_VM_PROFILE_RECORD(); \
+    a = decode_operand(word)
+
+#if TOOI_VM_THREADED_DISPATCH
+#define TOOI_VM_LABEL_ADDRESS(name, ...) &&op_##name,
+#define TOOI_VM_DISPATCH_BEGIN                             \
+    static const void* const handlers[] = {                \
+        TOOI_VM_OPCODES(TOOI_VM_LABEL_ADDRESS)             \
+        TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_LABEL_ADDRESS)}; \
+    TOOI_VM_NEXT;
+#define TOOI_VM_DISPATCH_END
+#define TOOI_VM_CASE(name) op_##name
+#define TOOI_VM_NEXT                 \
+    do {                             \
+        TOOI_VM_FETCH();             \
+        goto* handlers[word & 0xff]; \
+    } while (false)
+#else
+#define TOOI_VM_DISPATCH_BEGIN \
+    for (;;) {                 \
+        TOOI_VM_FETCH();       \
+        switch (decode_op(word)) {
+#define TOOI_VM_DISPATCH_END \
+    }                        \
+    }
+#define TOOI_VM_CASE(name) case Opcode::name
+#define TOOI_VM_NEXT break
+#endif
+
+// Continues the frame in its native code if the chunk was compiled ahead of
+// time (see aot.h), has been compiled, or just got hot enough to be (see
+// Jit). Checked where control enters a chunk or loops back: invocations,
+// returns and loop back edges.
+#define TOOI_VM_TRY_NATIVE()             \
+    if (chunk->aot) goto run_aot;        \
+    if (jit_ && (native = jit_->entry(*chunk, pc - code))) goto run_native
+#define TOOI_VM_TRY_OSR()                \
+    if (chunk->aot) goto run_aot;        \
+    if (jit_ && (native = jit_->entry(*chunk, pc - code, true))) goto run_native
+
+// Hands a loop back edge to the tracing tier, which runs the loop's trace or
+// records one, and continues wherever that stopped.
+#define TOOI_VM_TRY_TRACE()                                                                    \
+    if (jit_ && jit_->tracing()) {                                                             \
+        jit_context_.globals = globals_.data();                                                \
+        jit_context_.self = frame->self;                                                       \
+        pc = code + jit_->loop(*chunk, static_cast<uint32_t>(pc - code), slots, jit_context_); \
+    }
+
+// Handler bodies that superinstructions run back to back. Each leaves `pc`
+// at the next instruction.
+#define TOOI_VM_BODY_Move     \
+    slots[a] = source(pc[0]); \
+    pc += 1;
+#define TOOI_VM_BODY_LoadSelf slots[a] = frame->self;
+#define TOOI_VM_BODY_LoadGlobal \
+    slots[a] = globals_[pc[0]]; \
+    pc += 1;
+#define TOOI_VM_BODY_StoreGlobal \
+    globals_[a] = source(pc[0]); \
+    pc += 1;
+#define TOOI_VM_BODY_Not                                \
+    slots[a] = Value::boolean(!source(pc[0]).truthy()); \
+    pc += 1;
+#define TOOI_VM_BODY_Truthy                            \
+    slots[a] = Value::boolean(source(pc[0]).truthy()); \
+    pc += 1;
+#define TOOI_VM_BODY_Jump                    \
+    pc = code + a;                           \
+    if (pc <= start) { /* Loop back edge */ \
+        safe_point();                        \
+        TOOI_VM_TRY_TRACE();                 \
+        TOOI_VM_TRY_OSR();                   \
+    }
+#define TOOI_VM_BODY_JumpIfFalse pc = source(pc[0]).truthy() ? pc + 1 : code + a;
+#define TOOI_VM_BODY_JumpIfTrue pc = source(pc[0]).truthy() ? code + a : pc + 1;
+
+// The body of a TOOI_VM_TYPED_OPCODES handler. When `fast` declines, an
+// operand of the wrong kind de-quickens the instruction, and `slow` runs.
+#define TOOI_VM_TYPED_BODY(op, T, fast, slow)               \
+    {                                                       \
+        const Value& x = source(pc[0]);                     \
+        const Value& y = source(pc[1]);                     \
+        if (!fast<Opcode::op, T>(x, y, slots[a])) {         \
+            if (!Operand<T>::is(x) || !Operand<T>::is(y)) { \
+                dequicken(*chunk, start - code);            \
+            }                                               \
+            slots[a] = slow;                                \
+        }                                                   \
+        pc += 2;                                            \
+    }
+#define TOOI_VM_TYPED_ARITHMETIC_BODY(op, T) \
+    TOOI_VM_TYPED_BODY(op, T, typed_arithmetic, arithmetic(Opcode::op, x, y, heap_))
+#define TOOI_VM_TYPED_COMPARE_BODY(op, T) \
+    TOOI_VM_TYPED_BODY(op, T, typed_compare, Value::boolean(compare(Opcode::op, x, y)))
+#define TOOI_VM_TYPED_ARITHMETIC(op, type, T) \
+    TOOI_VM_CASE(op##type) : TOOI_VM_TYPED_ARITHMETIC_BODY(op, T) TOOI_VM_NEXT;
+#define TOOI_VM_TYPED_COMPARE(op, type, T) \
+    TOOI_VM_CASE(op##type) : TOOI_VM_TYPED_COMPARE_BODY(op, T) TOOI_VM_NEXT;
+#define TOOI_VM_TYPED_CASES(type, T)       \
+    TOOI_VM_TYPED_ARITHMETIC(Add, type, T) \
+    TOOI_VM_TYPED_ARITHMETIC(Sub, type, T) \
+    TOOI_VM_TYPED_ARITHMETIC(Mul, type, T) \
+    TOOI_VM_TYPED_ARITHMETIC(Div, type, T) \
+    TOOI_VM_TYPED_ARITHMETIC(Mod, type, T) \
+    TOOI_VM_TYPED_COMPARE(Eq, type, T)     \
+    TOOI_VM_TYPED_COMPARE(Ne, type, T)     \
+    TOOI_VM_TYPED_COMPARE(Lt, type, T)     \
+    TOOI_VM_TYPED_COMPARE(Le, type, T)     \
+    TOOI_VM_TYPED_COMPARE(Gt, type, T)     \
+    TOOI_VM_TYPED_COMPARE(Ge, type, T)
+
+bool VM::execute(size_t entry_depth) {
+    Frame* frame = &frames_.back();
+    const Chunk* chunk = frame->chunk;
+    const Value* constants = chunk->constants.data();
+    const uint32_t* code = chunk->code.data();
+    const uint32_t* pc = frame->pc;
+    Value* slots = frame->slots;
+    const uint32_t* start = pc;  // First word of the running instruction
+    const uint8_t* native = nullptr;  // Where native code resumes the frame
+    uint64_t executed = 0;
+
+    // Reloads the cached state after the frame changed.
+    auto load_frame = [&]() {
+        frame = &frames_.back();
+        chunk = frame->chunk;
+        constants = chunk->constants.data();
+        code = chunk->code.data();
+        pc = frame->pc;
+        slots = frame->slots;
+    };
+    auto safe_point = [&]() {
+        if (heap_.should_collect()) {
+            sp_ = slots + chunk->slot_count;
+            collect_garbage();
+        }
+    };
+    // Operands: A is packed into the opcode word, the others follow it.
+    auto source = [&](uint32_t operand) -> const Value& {
+        return (operand & kConstantFlag) ? constants[operand & ~kConstantFlag] : slots[operand];
+    };
+
+    uint32_t word;
+    uint32_t a;
+    try {
+        TOOI_VM_DISPATCH_BEGIN
+        // --- Values and names ---
+        TOOI_VM_CASE(Move):
+            TOOI_VM_BODY_Move
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(LoadSelf):
+            TOOI_VM_BODY_LoadSelf
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(LoadUpvalue):
+            slots[a] = frame->closure->captured[pc[0]];
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(LoadGlobal):
+            TOOI_VM_BODY_LoadGlobal
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(StoreGlobal):
+            TOOI_VM_BODY_StoreGlobal
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(LoadName):
+            slots[a] = load_name(*frame, chunk->names[pc[0]]);
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(AddModule):
+            slots[a] = builtin_module(chunk->names[pc[0]]);
+            pc += 1;
+            TOOI_VM_NEXT;
+
+        // --- Arithmetic, comparison, conversion ---
+        TOOI_VM_CASE(Add):
+        TOOI_VM_CASE(Sub):
+        TOOI_VM_CASE(Mul):
+        TOOI_VM_CASE(Div):
+        TOOI_VM_CASE(Mod): {
+            const Value& x = source(pc[0]);
+            const Value& y = source(pc[1]);
+            observe(*chunk, start - code, typed_opcode(decode_op(word), typed_kind(x, y)));
+            slots[a] = arithmetic(decode_op(word), x, y, heap_);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(Neg):
+            slots[a] = negate(source(pc[0]), heap_);
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Not):
+            TOOI_VM_BODY_Not
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Eq):
+        TOOI_VM_CASE(Ne):
+        TOOI_VM_CASE(Lt):
+        TOOI_VM_CASE(Le):
+        TOOI_VM_CASE(Gt):
+        TOOI_VM_CASE(Ge): {
+            const Value& x = source(pc[0]);
+            const Value& y = source(pc[1]);
+            observe(*chunk, start - code, typed_opcode(decode_op(word), typed_kind(x, y)));
+            slots[a] = Value::boolean(compare(decode_op(word), x, y));
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(Truthy):
+            TOOI_VM_BODY_Truthy
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Concat): {
+            const Value& x = source(pc[0]);
+            const Value& y = source(pc[1]);
+            bool strings = x.is(ValueKind::String) && y.is(ValueKind::String);
+            observe(*chunk, start - code, strings ? Opcode::ConcatStr : Opcode::Concat);
+            slots[a] = concat(x, y, heap_);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(Cast):
+            slots[a] = cast(source(pc[0]), chunk->types[pc[1]], heap_);
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Coerce):
+            slots[a] = coerce(source(pc[0]), chunk->types[pc[1]], heap_);
+            pc += 2;
+            TOOI_VM_NEXT;
+
+        // --- Typed and quickened forms ---
+        TOOI_VM_TYPED_CASES(I32, int32_t)
+        TOOI_VM_TYPED_CASES(I64, int64_t)
+        TOOI_VM_TYPED_CASES(U32, uint32_t)
+        TOOI_VM_TYPED_CASES(U64, uint64_t)
+        TOOI_VM_TYPED_CASES(F64, double)
+        TOOI_VM_CASE(ConcatStr): {
+            const Value& x = source(pc[0]);
+            const Value& y = source(pc[1]);
+            if (x.is(ValueKind::String) && y.is(ValueKind::String)) {
+                slots[a] = heap_.string(as_string(x)->text + as_string(y)->text);
+            } else {
+                dequicken(*chunk, start - code);
+                slots[a] = concat(x, y, heap_);
+            }
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(GetPropObject): {
+            const Value& object = source(pc[0]);
+            const std::string& name = chunk->names[pc[1]];
+            int slot = -1;
+            if (object.is(ValueKind::Object)) {
+                slot = cached_slot(chunk->caches[pc[2]], as_object(object), name);
+            } else {
+                dequicken(*chunk, start - code);
+            }
+            slots[a] = slot >= 0 ? as_object(object)->slots()[slot] : get_property(object, name);
+            pc += 3;
+            TOOI_VM_NEXT;
+        }
+
+        // --- Objects ---
+        TOOI_VM_CASE(NewObject):
+            slots[a] = Value::heap(heap_.object(chunk->names[pc[0]]));
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(CloneObject): {
+            const Value& original = source(pc[0]);
+            if (!original.is(ValueKind::Object)) {
+                throw RuntimeError(ErrorCode::Runtime_InvalidUnaryOperand, "new",
+                                   kind_name(original.kind()));
+            }
+            slots[a] = Value::heap(heap_.copy(*as_object(original)));
+            pc += 1;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(GetProp): {
+            const Value& object = source(pc[0]);
+            bool is_object = object.is(ValueKind::Object);
+            observe(*chunk, start - code, is_object ? Opcode::GetPropObject : Opcode::GetProp);
+            slots[a] = get_property(object, chunk->names[pc[1]]);
+            pc += 3;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(SetProp): {
+            const Value& object = source(a);
+            const std::string& name = chunk->names[pc[0]];
+            int slot = -1;
+            const core::TypeRef* type = nullptr;
+            if (object.is(ValueKind::Object)) {
+                slot = cached_slot(chunk->caches[pc[2]], as_object(object), name, &type);
+            }
+            if (slot >= 0) {
+                // The type checker cannot see the declared type behind a `proto` receiver.
+                Value value = type ? coerce(source(pc[1]), *type, heap_) : source(pc[1]);
+                as_object(object)->writable_slots()[slot] = value;
+            } else {
+                set_property(object, name, source(pc[1]));
+            }
+            pc += 3;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(DefineProp): {
+            const Value& object = source(a);
+            const std::string& name = chunk->names[pc[0]];
+            if (!object.is(ValueKind::Object)) {
+                throw RuntimeError(ErrorCode::Runtime_NotAnObject, name,
+                                   kind_name(object.kind()));
+            }
+            const core::TypeRef& type = chunk->types[pc[3]];
+            define_property(*as_object(object), name, source(pc[1]),
+                            (pc[2] & kPropertyIsSet) != 0, (pc[2] & kPropertyIsPrivate) != 0,
+                            type->is_proto() ? nullptr : type);
+            pc += 4;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(MakeAct): {
+            const Chunk* function = chunk->module->functions[pc[0]].get();
+            const Value* window = slots + pc[1];
+            Closure* closure = heap_.make<Closure>(function);
+            closure->captured.assign(
+                window, window + function->upvalue_count + function->param_count);
+            slots[a] = Value::heap(closure);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(SetAct): {
+            const Value& object = source(a);
+            if (!object.is(ValueKind::Object)) {
+                throw RuntimeError(ErrorCode::Runtime_InvalidUnaryOperand, "@",
+                                   kind_name(object.kind()));
+            }
+            as_object(object)->act = as_closure(source(pc[0]));
+            pc += 1;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(ActIs): {
+            const Value& object = source(pc[0]);
+            bool same = object.is(ValueKind::Object) &&
+                        as_object(object)->act == source(pc[1]).ref();
+            if (!same) stats_.deopts.count(DeoptReason::Act);
+            slots[a] = Value::boolean(same);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(ActIsFunction): {
+            const Value& object = source(pc[0]);
+            const Chunk* function = chunk->module->functions[pc[1]].get();
+            bool same = object.is(ValueKind::Object) && as_object(object)->act &&
+                        as_object(object)->act->function == function;
+            if (!same) stats_.deopts.count(DeoptReason::Act);
+            slots[a] = Value::boolean(same);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(Invoke): {
+            safe_point();
+            Value* window = slots + pc[0];
+            int argc = static_cast<int>(pc[1]);
+            frame->pc = pc + 2;
+            enter(window, argc, slots + a);
+            load_frame();
+            TOOI_VM_TRY_NATIVE();
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(TailInvoke): {
+            // The callee and its arguments move down to where this frame's
+            // callee sits, and the new frame returns to this frame's caller.
+            safe_point();
+            Value* window = slots + a;
+            int argc = static_cast<int>(pc[0]);
+            frame->pc = pc + 1;
+            std::copy(window, window + argc + 1, slots - 1);
+            enter(slots - 1, argc, frame->result, true);
+            load_frame();
+            TOOI_VM_TRY_NATIVE();
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(CallMethod): {
+            Value* window = slots + pc[0];
+            const std::string& name = chunk->names[pc[1]];
+            int argc = static_cast<int>(pc[2]);
+            if (!window->is(ValueKind::Object)) {
+                slots[a] = call_builtin(name, *window, window + 1, argc);
+                pc += 4;
+                TOOI_VM_NEXT;
+            }
+            const Object* receiver = as_object(*window);
+            int method = cached_slot(chunk->caches[pc[3]], receiver, name);
+            if (method < 0) {
+                throw RuntimeError(ErrorCode::Runtime_UnknownProperty,
+                                   object_name(*window), name);
+            }
+            *window = receiver->slots()[method];  // The method is invoked like an act
+            safe_point();
+            frame->pc = pc + 4;
+            enter(window, argc, slots + a);
+            load_frame();
+            TOOI_VM_TRY_NATIVE();
+            TOOI_VM_NEXT;
+        }
+
+        // --- Collections ---
+        TOOI_VM_CASE(NewArray):
+        TOOI_VM_CASE(NewTuple): {
+            ValueKind kind =
+                decode_op(word) == Opcode::NewArray ? ValueKind::Array : ValueKind::Tuple;
+            const Value* window = slots + pc[0];
+            slots[a] = heap_.array(kind, std::vector<Value>(window, window + pc[1]));
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(NewAssoc): {
+            const Value* window = slots + pc[0];
+            AssocObject* assoc = heap_.make<AssocObject>();
+            for (uint32_t i = 0; i < pc[1]; i += 2) assoc->set(window[i], window[i + 1]);
+            slots[a] = Value::heap(assoc);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(Index):
+            slots[a] = index(source(pc[0]), source(pc[1]));
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(SetIndex):
+            set_index(source(a), source(pc[0]), source(pc[1]));
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Length):
+            slots[a] = length(source(pc[0]));
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(ArrayPush):
+            intrinsic_receiver<ValueKind::Array>(source(pc[0]), "push")
+                ->writable_elements().push_back(source(pc[1]));
+            slots[a] = Value::nil();
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(ArrayPop):
+            slots[a] = array_pop(intrinsic_receiver<ValueKind::Array>(source(pc[0]), "pop")
+                                     ->writable_elements());
+            pc += 1;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(ArrayInsert):
+            array_insert(
+                intrinsic_receiver<ValueKind::Array>(source(pc[0]), "insert")->writable_elements(),
+                source(pc[1]), source(pc[2]));
+            slots[a] = Value::nil();
+            pc += 3;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(ArrayRemove):
+            slots[a] = array_remove(
+                intrinsic_receiver<ValueKind::Array>(source(pc[0]), "remove")->writable_elements(),
+                source(pc[1]));
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(AssocHas): {
+            AssocObject* assoc = intrinsic_receiver<ValueKind::Assoc>(source(pc[0]), "has");
+            slots[a] = Value::boolean(assoc->find(source(pc[1])) != nullptr);
+            pc += 2;
+            TOOI_VM_NEXT;
+        }
+        TOOI_VM_CASE(AssocRemove):
+            slots[a] = assoc_remove(
+                *intrinsic_receiver<ValueKind::Assoc>(source(pc[0]), "remove"), source(pc[1]));
+            pc += 2;
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(IterSource): {
+            const Value& sequence = source(pc[0]);
+            if (sequence.is(ValueKind::Assoc)) {
+                std::vector<Value> keys;
+                for (const auto& entry : as_assoc(sequence)->entries()) {
+                    keys.push_back(entry.first);
+                }
+                slots[a] = heap_.array(ValueKind::Array, std::move(keys));
+            } else if (sequence.is(ValueKind::Array) ||
+                       sequence.is(ValueKind::Tuple) ||
+                       sequence.is(ValueKind::String)) {
+                slots[a] = sequence;
+            } else {
+                throw RuntimeError(ErrorCode::Runtime_NotIterable,
+                                   kind_name(sequence.kind()));
+            }
+            pc += 1;
+            TOOI_VM_NEXT;
+        }
+
+        // --- Control flow ---
+        TOOI_VM_CASE(Jump):
+            TOOI_VM_BODY_Jump
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(JumpIfFalse):
+            TOOI_VM_BODY_JumpIfFalse
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(JumpIfTrue):
+            TOOI_VM_BODY_JumpIfTrue
+            TOOI_VM_NEXT;
+        TOOI_VM_CASE(Return): {
+            *frame->result = source(a);
+            frames_.pop_back();
+            if (frames_.size() == entry_depth) {
+                stats_.instructions += executed;
+                return true;
+            }
+            load_frame();
+            TOOI_VM_TRY_NATIVE();
+            TOOI_VM_NEXT;
+        }
+
+        // --- Native code ---
+        // Runs until an instruction without a template, which executes next.
+        run_native:
+            jit_context_.globals = globals_.data();
+            jit_context_.self = frame->self;
+            pc = code + jit_->run(*chunk, native, slots, constants, jit_context_);
+            TOOI_VM_NEXT;
+        run_aot:
+            jit_context_.globals = globals_.data();
+            jit_context_.self = frame->self;
+            jit_context_.caches = chunk->caches.data();
+            stats_.aot_entries++;
+            pc = code + chunk->aot(slots, constants, &jit_context_,
+                                   static_cast<uint32_t>(pc - code));
+            TOOI_VM_NEXT;
+
+        // --- Superinstructions ---
+        TOOI_VM_SUPERINSTRUCTION_HANDLERS
+        TOOI_VM_DISPATCH_END
+    } catch (const RuntimeError& error) {
+        stats_.instructions += executed;
+        report(error, *frame, start);
+        frames_.resize(entry_depth);
+        return false;
+    }
+}
+
+// ============================================================================
+// Operations
+// ============================================================================
+
+Value VM::load_name(const Frame& frame, const std::string& name) {
+    if (frame.self.is(ValueKind::Object)) {
+        if (const Value* property = as_object(frame.self)->find(name)) return *property;
+    }
+    int global = global_table_ ? global_table_->find(name) : -1;
+    if (global < 0 || global >= static_cast<int>(globals_.size())) {
+        throw RuntimeError(ErrorCode::Runtime_UndefinedName, name);
+    }
+    return globals_[global];
+}
+
+Value VM::builtin_module(const std::string& name) {
+    auto [it, inserted] = builtin_modules_.emplace(name, Value());
+    if (inserted) it->second = Value::heap(heap_.make<ModuleObject>(name));
+    return it->second;
+}
+
+Value VM::get_property(const Value& object, const std::string& name) {
+    if (object.is(ValueKind::Object)) {
+        if (const Value* property = as_object(object)->find(name)) return *property;
+        throw RuntimeError(ErrorCode::Runtime_UnknownProperty, object_name(object), name);
+    }
+    if (name == "length" && !object.is(ValueKind::Module) && object.is_heap()) {
+        return length(object);
+    }
+    throw RuntimeError(ErrorCode::Runtime_NotAnObject, name, kind_name(object.kind()));
+}
+
+void VM::set_property(const Value& object, const std::string& name, const Value& value) {
+    if (!object.is(ValueKind::Object)) {
+        throw RuntimeError(ErrorCode::Runtime_NotAnObject, name, kind_name(object.kind()));
+    }
+    Object* instance = as_object(object);
+    const Property* property = instance->shape->find(name);
+    if (!property) {
+        define_property(*instance, name, value, false, false);
+    } else if (property->is_set) {
+        throw RuntimeError(ErrorCode::Runtime_AssignToImmutable, name);
+    } else {
+        Value checked = property->type ? coerce(value, property->type, heap_) : value;
+        instance->writable_slots()[property->slot] = checked;
+    }
+}
+
+void VM::define_property(Object& object, const std::string& name, const Value& value,
+                         bool is_set, bool is_private, const core::TypeRef& type) {
+    const Shape* shape = object.shape;
+    object.define(name, value, is_set, is_private, type);
+    if (object.watched && object.shape != shape && jit_) jit_->shape_changed(object);
+}
+
+Value VM::index(const Value& container, const Value& position) {
+    switch (container.kind()) {
+        case ValueKind::Array:
+        case ValueKind::Tuple: {
+            const std::vector<Value>& elements = as_array(container)->elements();
+            return elements[element_index(position, elements.size(), container.kind())];
+        }
+        case ValueKind::String: {
+            const std::string& text = as_string(container)->text;
+            return heap_.string(std::string(1, text[element_index(position, text.size(),
+                                                                  container.kind())]));
+        }
+        case ValueKind::Assoc:
+            if (const Value* value = as_assoc(container)->find(position)) return *value;
+            throw RuntimeError(ErrorCode::Runtime_MissingKey, describe(position));
+        default:
+            throw RuntimeError(ErrorCode::Runtime_NotIndexable, kind_name(container.kind()));
+    }
+}
+
+void VM::set_index(const Value& container, const Value& position, const Value& value) {
+    switch (container.kind()) {
+        case ValueKind::Array: {
+            std::vector<Value>& elements = as_array(container)->writable_elements();
+            elements[element_index(position, elements.size(), container.kind())] = value;
+            return;
+        }
+        case ValueKind::Assoc:
+            as_assoc(container)->set(position, value);
+            return;
+        case ValueKind::Tuple:
+        case ValueKind::String:
+            throw RuntimeError(ErrorCode::Runtime_ElementNotAssignable,
+                               kind_name(container.kind()));
+        default:
+            throw RuntimeError(ErrorCode::Runtime_NotIndexable, kind_name(container.kind()));
+    }
+}
+
+Value VM::length(const Value& sequence) {
+    switch (sequence.kind()) {
+        case ValueKind::Array:
+        case ValueKind::Tuple:
+            return Value::int32(static_cast<int64_t>(as_array(sequence)->elements().size()));
+        case ValueKind::String:
+            return Value::int32(static_cast<int64_t>(as_string(sequence)->text.size()));
+        case ValueKind::Assoc:
+            return Value::int32(static_cast<int64_t>(as_assoc(sequence)->entries().size()));
+        default:
+            throw RuntimeError(ErrorCode::Runtime_NotAnObject, "length",
+                               kind_name(sequence.kind()));
+    }
+}
+
+Value VM::call_builtin(const std::string& name, const Value& receiver, const Value* args,
+                       int argc) {
+    switch (receiver.kind()) {
+        case ValueKind::Module:
+            if (as_module(receiver)->name != "io") break;
+            if (name == "print" || name == "print_line") {
+                for (int i = 0; i < argc; ++i) {
+                    if (i > 0) out_ << ' ';
+                    out_ << display_string(args[i]);
+                }
+                if (name == "print_line") out_ << '\n';
+                return Value::nil();
+            }
+            if (name == "read_line") {
+                check_arity(name, 0, argc);
+                out_.flush();
+                std::string line;
+                if (!std::getline(in_, line)) line.clear();
+                return heap_.string(std::move(line));
+            }
+            break;
+        case ValueKind::Array: {
+            std::vector<Value>& elements = as_array(receiver)->writable_elements();
+            if (name == "push") {
+                check_arity(name, 1, argc);
+                elements.push_back(args[0]);
+                return Value::nil();
+            }
+            if (name == "pop") {
+                check_arity(name, 0, argc);
+                return array_pop(elements);
+            }
+            if (name == "insert") {
+                check_arity(name, 2, argc);
+                array_insert(elements, args[0], args[1]);
+                return Value::nil();
+            }
+            if (name == "remove") {
+                check_arity(name, 1, argc);
+                return array_remove(elements, args[0]);
+            }
+            break;
+        }
+        case ValueKind::Assoc: {
+            AssocObject* assoc = as_assoc(receiver);
+            if (name == "remove") {
+                check_arity(name, 1, argc);
+                return assoc_remove(*assoc, args[0]);
+            }
+            if (name == "has") {
+                check_arity(name, 1, argc);
+                return Value::boolean(assoc->find(args[0]) != nullptr);
+            }
+            if (name == "keys") {
+                check_arity(name, 0, argc);
+                std::vector<Value> keys;
+                for (const auto& entry : assoc->entries()) keys.push_back(entry.first);
+                return heap_.array(ValueKind::Array, std::move(keys));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    throw RuntimeError(ErrorCode::Runtime_UnknownMethod, kind_name(receiver.kind()), name);
+}
+
+// ============================================================================
+// Garbage collection and diagnostics
+// ============================================================================
+
+void VM::collect_garbage() {
+    heap_.collect([this](Heap& heap) {
+        for (const Value* value = stack_.get(); value < sp_; ++value) heap.mark(*value);
+        for (const Frame& frame : frames_) {
+            heap.mark(frame.self);
+            heap.mark(frame.closure);
+        }
+        for (const Value& value : globals_) heap.mark(value);
+        for (const auto& [name, module] : builtin_modules_) heap.mark(module);
+        for (const auto& module : modules_) {
+            for (const auto& chunk : module->functions) {
+                for (const Value& constant : chunk->constants) heap.mark(constant);
+            }
+        }
+    });
+}
+
+void VM::report(const RuntimeError& error, const Frame& frame, const uint32_t* pc) {
+    const Chunk& chunk = *frame.chunk;
+    core::SourceLocation loc = chunk.locations[pc - chunk.code.data()];
+    std::string line = core::source_line(chunk.module->source, loc.line);
+    const std::vector<std::string>& args = error.args;
+    switch (args.size()) {
+        case 0:
+            error_reporter_.report_at(loc.line, loc.column, loc.length, line, error.code);
+            break;
+        case 1:
+            error_reporter_.report_at(loc.line, loc.column, loc.length, line, error.code,
+                                      args[0]);
+            break;
+        case 2:
+            error_reporter_.report_at(loc.line, loc.column, loc.length, line, error.code,
+                                      args[0], args[1]);
+            break;
+        default:
+            error_reporter_.report_at(loc.line, loc.column, loc.length, line, error.code,
+                                      args[0], args[1], args[2]);
+            break;
+    }
+}
+
+}  // namespace vm
+}  // namespace tooi
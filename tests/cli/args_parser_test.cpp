@@ -155,4 +155,85 @@ TEST_CASE("ArgsParser Default REPL Mode", "[args_parser]") {
         REQUIRE(parser.get_filename().empty());
         REQUIRE(parser.is_verbose());
     }
-} 
\ No newline at end of file
+}
+
+TEST_CASE("ArgsParser Optimization Flag", "[args_parser]") {
+    ArgsParser parser;
+
+    SECTION("Optimizations are enabled by default") {
+        const char* args[] = {"program", "test.tooi"};
+        parser.parse(2, const_cast<char**>(args));
+        REQUIRE(parser.get_options().optimize);
+    }
+
+    SECTION("--no-opt disables them") {
+        const char* args[] = {"program", "--no-opt", "test.tooi"};
+        parser.parse(3, const_cast<char**>(args));
+        REQUIRE(parser.get_mode() == RunMode::FILE);
+        REQUIRE_FALSE(parser.get_options().optimize);
+    }
+}
+
+TEST_CASE("ArgsParser IR Pass Flags", "[args_parser]") {
+    ArgsParser parser;
+
+    SECTION("Passes can be disabled by name and inspected") {
+        const char* args[] = {"program", "--disable-pass=licm,bce", "--pass-stats", "--dump-ir",
+                              "test.tooi"};
+        parser.parse(5, const_cast<char**>(args));
+        REQUIRE(parser.get_mode() == RunMode::FILE);
+        const auto& options = parser.get_options();
+        REQUIRE(options.disabled_passes == std::vector<std::string>{"licm", "bce"});
+        REQUIRE(options.pass_stats);
+        REQUIRE(options.dump_ir);
+    }
+
+    SECTION("Unknown pass names are rejected") {
+        const char* args[] = {"program", "--disable-pass=unroll", "test.tooi"};
+        parser.parse(3, const_cast<char**>(args));
+        REQUIRE(parser.get_mode() == RunMode::ERROR);
+    }
+}
+
+TEST_CASE("ArgsParser VM Flags", "[args_parser]") {
+    ArgsParser parser;
+    const char* args[] = {"program", "--vm-stats", "--ic-stats", "--dump-bytecode", "test.tooi"};
+    parser.parse(5, const_cast<char**>(args));
+    REQUIRE(parser.get_mode() == RunMode::FILE);
+    REQUIRE(parser.get_options().vm_stats);
+    REQUIRE(parser.get_options().ic_stats);
+    REQUIRE(parser.get_options().dump_bytecode);
+    REQUIRE(parser.get_options().opcode_profile.empty());
+    REQUIRE_FALSE(parser.get_options().jit);
+    REQUIRE(parser.get_options().trace);
+    REQUIRE(parser.get_options().lazy);
+
+    ArgsParser profiling;
+    const char* profile_args[] = {"program", "--opcode-profile=pairs.txt", "--jit", "--no-trace",
+                                  "--eager", "test.tooi"};
+    profiling.parse(6, const_cast<char**>(profile_args));
+    REQUIRE(profiling.get_mode() == RunMode::FILE);
+    REQUIRE(profiling.get_options().opcode_profile == "pairs.txt");
+    REQUIRE(profiling.get_options().jit);
+    REQUIRE_FALSE(profiling.get_options().trace);
+    REQUIRE_FALSE(profiling.get_options().lazy);
+}
+
+TEST_CASE("ArgsParser Emit C++", "[args_parser]") {
+    ArgsParser to_stdout;
+    const char* args[] = {"program", "--emit-cpp", "test.tooi"};
+    to_stdout.parse(3, const_cast<char**>(args));
+    REQUIRE(to_stdout.get_mode() == RunMode::FILE);
+    REQUIRE(to_stdout.get_options().emit_cpp == "-");
+
+    ArgsParser to_file;
+    const char* file_args[] = {"program", "--emit-cpp=out.cpp", "test.tooi"};
+    to_file.parse(3, const_cast<char**>(file_args));
+    REQUIRE(to_file.get_options().emit_cpp == "out.cpp");
+
+    // There is no script to translate in the REPL
+    ArgsParser without_script;
+    const char* repl_args[] = {"program", "--emit-cpp"};
+    without_script.parse(2, const_cast<char**>(repl_args));
+    REQUIRE(without_script.get_mode() == RunMode::ERROR);
+}
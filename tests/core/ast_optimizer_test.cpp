@@ -0,0 +1,127 @@
+#include "catch2.hpp"
+#include "core/recording_error_reporter.h"
+#include "tooi/core/ast.h"
+#include "tooi/core/ast_optimizer.h"
+#include "tooi/core/parser.h"
+#include "tooi/core/scanner.h"
+#include "tooi/core/type_checker.h"
+
+#include <string>
+
+using namespace tooi::core;
+
+namespace {
+
+Program optimize_source(const std::string& source, GlobalTable& globals,
+                        AstOptimizerStats* stats = nullptr) {
+    RecordingErrorReporter reporter;
+    Scanner scanner(source, reporter);
+    Parser parser(scanner.scan_tokens(), source, reporter);
+    Program program = parser.parse();
+    TypeChecker checker(globals, source, reporter);
+    REQUIRE(checker.check(program));
+    AstOptimizer optimizer(globals);
+    optimizer.optimize(program);
+    if (stats) *stats = optimizer.stats();
+    return program;
+}
+
+const Expr& value_at(const Program& program, size_t index) {
+    return *static_cast<const BindStmt&>(*program.statements[index]).value;
+}
+
+const LiteralValue& literal_at(const Program& program, size_t index) {
+    const Expr& value = value_at(program, index);
+    REQUIRE(value.kind == ExprKind::Literal);
+    return static_cast<const LiteralExpr&>(value).value;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("AstOptimizer Constant Folding", "[optimizer]") {
+    GlobalTable globals;
+
+    SECTION("Arithmetic, comparison and logic") {
+        Program program = optimize_source(
+            "let a -> 2 + 3 * 4; let b -> 7 / 2; let c -> 1.5 * 2; let d -> 3 < 4 and not false;"
+            "let e -> 10 % 4 == 2;",
+            globals);
+        REQUIRE(std::get<int64_t>(literal_at(program, 0)) == 14);
+        REQUIRE(std::get<int64_t>(literal_at(program, 1)) == 3);
+        REQUIRE(std::get<double>(literal_at(program, 2)) == 3.0);
+        REQUIRE(std::get<bool>(literal_at(program, 3)) == true);
+        REQUIRE(std::get<bool>(literal_at(program, 4)) == true);
+    }
+
+    SECTION("String concatenation and conversions") {
+        Program program = optimize_source(
+            "let s -> \"n=\" + 42 + \"/\" + true; let i -> \"42\" as int + 1; let t -> 3.75 as int;"
+            "let f -> 7 as string;",
+            globals);
+        REQUIRE(std::get<std::string>(literal_at(program, 0)) == "n=42/true");
+        REQUIRE(std::get<int64_t>(literal_at(program, 1)) == 43);
+        REQUIRE(std::get<int64_t>(literal_at(program, 2)) == 3);
+        REQUIRE(std::get<std::string>(literal_at(program, 3)) == "7");
+    }
+
+    SECTION("Overflow, division by zero and bad conversions are left to the runtime") {
+        Program program = optimize_source(
+            "let a -> 2147483647 + 1; let b -> 1 / 0; let c -> \"x\" as int; let d -> 300 as byte;",
+            globals);
+        for (size_t i = 0; i < 4; ++i) {
+            REQUIRE(value_at(program, i).kind != ExprKind::Literal);
+        }
+    }
+
+    SECTION("Typed constants fold at their declared width") {
+        Program program = optimize_source("let a : int64 -> 2147483647; let b -> a;"
+                                          "set c : int64 -> 2147483647; let d -> c + 1;",
+                                          globals);
+        REQUIRE(value_at(program, 1).kind == ExprKind::Identifier);  // `let` is not propagated
+        REQUIRE(std::get<int64_t>(literal_at(program, 3)) == 2147483648LL);
+        REQUIRE(value_at(program, 3).type->kind == TypeKind::Int64);
+    }
+}
+
+TEST_CASE("AstOptimizer Constant Propagation", "[optimizer]") {
+    GlobalTable globals;
+    AstOptimizerStats stats;
+    Program program = optimize_source(
+        "set limit -> 10; let x -> limit * 2;"
+        "let o => { } @ { set k -> 3; be k + limit; };"
+        "let y -> 0; if (y > 0) { set cond -> 1; }",
+        globals, &stats);
+    REQUIRE(std::get<int64_t>(literal_at(program, 1)) == 20);
+    REQUIRE(globals.at(globals.find("limit")).constant.has_value());
+    // Conditionally executed bindings are not constants.
+    REQUIRE_FALSE(globals.at(globals.find("cond")).constant.has_value());
+
+    const auto& object = static_cast<const ObjectExpr&>(value_at(program, 2));
+    const auto& be = static_cast<const BeStmt&>(*object.act->body[1]);
+    REQUIRE(be.value->kind == ExprKind::Literal);
+    REQUIRE(std::get<int64_t>(static_cast<const LiteralExpr&>(*be.value).value) == 13);
+    REQUIRE(stats.propagated_constants == 3);
+
+    // Constant globals remain available to later REPL submissions.
+    Program next = optimize_source("let z -> limit - 1;", globals);
+    REQUIRE(std::get<int64_t>(literal_at(next, 0)) == 9);
+}
+
+TEST_CASE("AstOptimizer Dead Branch Elimination", "[optimizer]") {
+    GlobalTable globals;
+    AstOptimizerStats stats;
+    Program program = optimize_source(
+        "add io; set debug -> false;"
+        "if (debug) { io.@print_line(\"debug\"); }"
+        "if (not debug) { io.@print_line(\"release\"); } else { io.@print_line(\"never\"); }"
+        "while (debug) { }"
+        "let f => { } @ { be 1; io.@print_line(\"unreachable\"); };",
+        globals, &stats);
+    REQUIRE(program.statements.size() == 4);  // add, set, the surviving branch, f
+    REQUIRE(program.statements[2]->kind == StmtKind::Block);
+    REQUIRE(stats.removed_branches == 3);
+    REQUIRE(stats.removed_statements == 1);
+
+    const auto& object = static_cast<const ObjectExpr&>(value_at(program, 3));
+    REQUIRE(object.act->body.size() == 1);
+}
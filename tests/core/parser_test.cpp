@@ -0,0 +1,167 @@
+#include "catch2.hpp"
+#include "core/recording_error_reporter.h"
+#include "tooi/core/ast.h"
+#include "tooi/core/parser.h"
+#include "tooi/core/scanner.h"
+
+#include <string>
+
+using namespace tooi::core;
+
+namespace {
+
+Program parse_source(const std::string& source, RecordingErrorReporter& reporter,
+                     bool defer_acts = false) {
+    Scanner scanner(source, reporter);
+    Parser parser(scanner.scan_tokens(), source, reporter, defer_acts);
+    return parser.parse();
+}
+
+ActDecl& act_at(Program& program, size_t index) {
+    return *static_cast<ObjectExpr&>(*static_cast<BindStmt&>(*program.statements[index]).value)
+                .act;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Parser Binding Statements", "[parser]") {
+    RecordingErrorReporter reporter;
+
+    SECTION("Assignment with annotation") {
+        Program program = parse_source("let x : int -> 1 + 2 * 3;", reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        REQUIRE(program.statements.size() == 1);
+        auto& bind = static_cast<BindStmt&>(*program.statements[0]);
+        REQUIRE(bind.op == BindOp::Assign);
+        REQUIRE_FALSE(bind.is_set);
+        REQUIRE(bind.annotation.has_value());
+        REQUIRE(bind.annotation->type->kind == TypeKind::Int32);
+        // Multiplication binds tighter than addition.
+        REQUIRE(bind.value->kind == ExprKind::Binary);
+        auto& sum = static_cast<BinaryExpr&>(*bind.value);
+        REQUIRE(sum.op == TokenType::PLUS);
+        REQUIRE(sum.right->kind == ExprKind::Binary);
+    }
+
+    SECTION("Compound binding") {
+        Program program = parse_source("let x * 2;", reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        auto& bind = static_cast<BindStmt&>(*program.statements[0]);
+        REQUIRE(bind.op == BindOp::Compound);
+        REQUIRE(bind.compound_op == TokenType::ASTERISK);
+    }
+
+    SECTION("Object definition with mode and act") {
+        Program program = parse_source(
+            "set adder => { param a : int -> 0; param b : int -> 0; \"bias\" -> 1; }"
+            " @ { be a + b; };",
+            reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        auto& bind = static_cast<BindStmt&>(*program.statements[0]);
+        REQUIRE(bind.is_set);
+        REQUIRE(bind.op == BindOp::Define);
+        auto& object = static_cast<ObjectExpr&>(*bind.value);
+        REQUIRE(object.mode.size() == 3);
+        REQUIRE(object.mode[0].kind == ModeEntry::Kind::Param);
+        REQUIRE(object.mode[2].kind == ModeEntry::Kind::Property);
+        REQUIRE(object.mode[2].name == "bias");
+        REQUIRE(object.act != nullptr);
+        REQUIRE(object.act->body.size() == 1);
+    }
+
+    SECTION("Append and act bindings") {
+        Program program = parse_source("let o >> { \"y\" -> 2; }; let o @ { be 1; };", reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        REQUIRE(static_cast<BindStmt&>(*program.statements[0]).op == BindOp::Append);
+        REQUIRE(static_cast<BindStmt&>(*program.statements[1]).op == BindOp::Act);
+    }
+}
+
+TEST_CASE("Parser Expressions", "[parser]") {
+    RecordingErrorReporter reporter;
+
+    SECTION("Negative number literals are folded") {
+        Program program = parse_source("let x -> -2147483648;", reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        auto& bind = static_cast<BindStmt&>(*program.statements[0]);
+        REQUIRE(bind.value->kind == ExprKind::Literal);
+        auto& literal = static_cast<LiteralExpr&>(*bind.value);
+        REQUIRE(std::get<int64_t>(literal.value) == -2147483648LL);
+    }
+
+    SECTION("Invocations, properties and indexing") {
+        Program program = parse_source("io.@print_line(items[0].name, @f(1));", reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        auto& stmt = static_cast<ExpressionStmt&>(*program.statements[0]);
+        REQUIRE(stmt.expr->kind == ExprKind::Invoke);
+        auto& invoke = static_cast<InvokeExpr&>(*stmt.expr);
+        REQUIRE(invoke.name == "print_line");
+        REQUIRE(invoke.args.size() == 2);
+        REQUIRE(invoke.args[0]->kind == ExprKind::Property);
+        REQUIRE(invoke.args[1]->kind == ExprKind::Invoke);
+        REQUIRE(static_cast<InvokeExpr&>(*invoke.args[1]).receiver == nullptr);
+    }
+
+    SECTION("Collection literals and casts") {
+        Program program = parse_source(
+            "let a -> [1, 2]; let m -> [\"k\" -> 1]; let t -> (1, \"x\"); let f -> a[0] as float;",
+            reporter);
+        REQUIRE_FALSE(reporter.had_error());
+        REQUIRE(static_cast<BindStmt&>(*program.statements[0]).value->kind == ExprKind::Array);
+        REQUIRE(static_cast<BindStmt&>(*program.statements[1]).value->kind == ExprKind::Assoc);
+        REQUIRE(static_cast<BindStmt&>(*program.statements[2]).value->kind == ExprKind::Tuple);
+        REQUIRE(static_cast<BindStmt&>(*program.statements[3]).value->kind == ExprKind::Cast);
+    }
+}
+
+TEST_CASE("Parser Control Flow", "[parser]") {
+    RecordingErrorReporter reporter;
+    Program program = parse_source(
+        "while (x < 10) { if (x == 5) { done; } else { skip; } }"
+        "for (item in items) { let n + 1; }",
+        reporter);
+    REQUIRE_FALSE(reporter.had_error());
+    REQUIRE(program.statements.size() == 2);
+    REQUIRE(program.statements[0]->kind == StmtKind::While);
+    REQUIRE(program.statements[1]->kind == StmtKind::For);
+    REQUIRE(static_cast<ForStmt&>(*program.statements[1]).variable == "item");
+}
+
+TEST_CASE("Parser Error Recovery", "[parser]") {
+    RecordingErrorReporter reporter;
+    Program program = parse_source("let -> 1; let ok -> 2; let x -> (1 + ; let y -> 3;", reporter);
+    REQUIRE(reporter.had_error());
+    REQUIRE(reporter.messages.size() == 2);
+    // The well-formed statements are still parsed.
+    REQUIRE(program.statements.size() == 2);
+}
+
+TEST_CASE("Parser Deferred Act Bodies", "[parser]") {
+    RecordingErrorReporter reporter;
+    std::string source =
+        "let f => { param a -> 1; } @ { let g => {} @ { be a; }; be @g() + (1 + ; };"
+        "let p : pure @ { be 1; };"
+        "let o => {} @ { let o >> { \"x\" -> 1; }; };"
+        "let q @ { let o @ { }; };";
+    Program program = parse_source(source, reporter, true);
+    // The error in the body of `f` is only found once it is parsed.
+    REQUIRE_FALSE(reporter.had_error());
+    REQUIRE(program.statements.size() == 4);
+
+    ActDecl& f = act_at(program, 0);
+    REQUIRE(f.deferred);
+    REQUIRE(f.body.empty());
+    REQUIRE(f.deferred->tokens.back().type == TokenType::END_OF_FILE);
+    // Pure acts and bodies that change other objects are parsed right away.
+    REQUIRE_FALSE(act_at(program, 1).deferred);
+    REQUIRE_FALSE(act_at(program, 2).deferred);
+    REQUIRE(act_at(program, 2).body.size() == 1);
+    REQUIRE_FALSE(act_at(program, 3).deferred);
+
+    REQUIRE_FALSE(Parser::parse_deferred(f, source, reporter));
+    REQUIRE(reporter.messages.size() == 1);
+    REQUIRE(f.body.size() == 1);  // `let g`, then recovery skips the broken statement
+    // Acts nested in a deferred body are parsed with it.
+    auto& g = static_cast<BindStmt&>(*f.body[0]);
+    REQUIRE_FALSE(static_cast<ObjectExpr&>(*g.value).act->deferred);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tooi/core/error_reporter.h"
+
+/**
+ * @brief ErrorReporter for tests: records messages instead of printing them.
+ */
+class RecordingErrorReporter : public tooi::core::ErrorReporter {
+public:
+    void print_error(int line, int column, int length, const std::string& source_line,
+                     const std::string& message) override {
+        messages.push_back(message);
+    }
+
+    /// True if any recorded message contains the given text.
+    bool saw(const std::string& text) const {
+        for (const auto& message : messages) {
+            if (message.find(text) != std::string::npos) return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string> messages;
+};
@@ -0,0 +1,285 @@
+#include "catch2.hpp"
+#include "core/recording_error_reporter.h"
+#include "tooi/core/ast.h"
+#include "tooi/core/parser.h"
+#include "tooi/core/scanner.h"
+#include "tooi/core/type_checker.h"
+
+#include <string>
+
+using namespace tooi::core;
+
+namespace {
+
+struct Checked {
+    Program program;
+    bool ok = false;
+};
+
+Checked check_source(const std::string& source, GlobalTable& globals,
+                     RecordingErrorReporter& reporter, bool defer_acts = false) {
+    Scanner scanner(source, reporter);
+    Parser parser(scanner.scan_tokens(), source, reporter, defer_acts);
+    Checked result;
+    result.program = parser.parse();
+    REQUIRE_FALSE(reporter.had_error());  // Tests feed syntactically valid code
+    TypeChecker checker(globals, source, reporter);
+    result.ok = checker.check(result.program);
+    return result;
+}
+
+const BindStmt& bind_at(const Checked& checked, size_t index) {
+    return static_cast<const BindStmt&>(*checked.program.statements[index]);
+}
+
+}  // anonymous namespace
+
+TEST_CASE("TypeChecker Inference", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+
+    SECTION("Literals and arithmetic") {
+        Checked checked = check_source(
+            "let a -> 1; let b -> 2.5; let c -> a + b; let d -> a < 3; let e -> \"n\" + a;"
+            "let big -> 5000000000;",
+            globals, reporter);
+        REQUIRE(checked.ok);
+        REQUIRE(bind_at(checked, 0).binding_type->kind == TypeKind::Int32);
+        REQUIRE(bind_at(checked, 1).binding_type->kind == TypeKind::Float64);
+        REQUIRE(bind_at(checked, 2).binding_type->kind == TypeKind::Float64);
+        REQUIRE(bind_at(checked, 3).binding_type->kind == TypeKind::Bool);
+        REQUIRE(bind_at(checked, 4).binding_type->kind == TypeKind::String);
+        REQUIRE(bind_at(checked, 5).binding_type->kind == TypeKind::Int64);
+
+        // `a` is widened explicitly so both operands of `+` are float.
+        auto& sum = static_cast<const BinaryExpr&>(*bind_at(checked, 2).value);
+        REQUIRE(sum.left->kind == ExprKind::Cast);
+        REQUIRE(static_cast<const CastExpr&>(*sum.left).cast_kind == CastKind::Widen);
+        REQUIRE(sum.right->type->kind == TypeKind::Float64);
+    }
+
+    SECTION("Literals adapt to annotated types") {
+        Checked checked = check_source(
+            "let a : byte -> 200; let b : uint64 -> 1; let c : float -> 1; let d : [int64] -> [1];"
+            "let e : int64 -> 1; let f -> e + 1;",
+            globals, reporter);
+        REQUIRE(checked.ok);
+        REQUIRE(bind_at(checked, 0).value->type->kind == TypeKind::Byte);
+        REQUIRE(bind_at(checked, 1).value->type->kind == TypeKind::UInt64);
+        REQUIRE(bind_at(checked, 2).value->type->kind == TypeKind::Float32);
+        REQUIRE(bind_at(checked, 3).value->type->element()->kind == TypeKind::Int64);
+        // The literal takes the type of the other operand instead of widening it.
+        auto& sum = static_cast<const BinaryExpr&>(*bind_at(checked, 5).value);
+        REQUIRE(sum.right->kind == ExprKind::Literal);
+        REQUIRE(sum.right->type->kind == TypeKind::Int64);
+        REQUIRE(bind_at(checked, 5).binding_type->kind == TypeKind::Int64);
+    }
+
+    SECTION("Compound bindings are desugared") {
+        Checked checked = check_source("let n -> 1; let n + 2;", globals, reporter);
+        REQUIRE(checked.ok);
+        const BindStmt& bind = bind_at(checked, 1);
+        REQUIRE(bind.op == BindOp::Assign);
+        REQUIRE_FALSE(bind.declares);
+        REQUIRE(bind.value->kind == ExprKind::Binary);
+        REQUIRE(bind.value->type->kind == TypeKind::Int32);
+    }
+}
+
+TEST_CASE("TypeChecker Name Resolution", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+
+    Checked checked = check_source(
+        "let g -> 1;"
+        "let o => { param a : int -> 0; \"p\" -> 2; } @ {"
+        "  let local -> a + p + g;"
+        "  let inner @ { let local -> local + 1; be local; };"
+        "  be local;"
+        "};",
+        globals, reporter);
+    REQUIRE(checked.ok);
+
+    auto& object = static_cast<const ObjectExpr&>(*bind_at(checked, 1).value);
+    const ActDecl& act = *object.act;
+    REQUIRE(act.param_count == 1);
+    REQUIRE(act.locals.size() == 3);  // a, local, inner
+    REQUIRE(act.locals[0].name == "a");
+
+    auto& local_bind = static_cast<const BindStmt&>(*act.body[0]);
+    auto& outer = static_cast<const BinaryExpr&>(*local_bind.value);
+    auto& inner_sum = static_cast<const BinaryExpr&>(*outer.left);
+    auto& a = static_cast<const IdentifierExpr&>(*inner_sum.left);
+    auto& p = static_cast<const IdentifierExpr&>(*inner_sum.right);
+    auto& g = static_cast<const IdentifierExpr&>(*outer.right);
+    REQUIRE(a.resolution.kind == BindingKind::Local);
+    REQUIRE(a.resolution.slot == 0);
+    REQUIRE(p.resolution.kind == BindingKind::Property);
+    REQUIRE(g.resolution.kind == BindingKind::Global);
+
+    // `inner` captures `local` from the enclosing act by value.
+    auto& inner_bind = static_cast<const BindStmt&>(*act.body[1]);
+    const ActDecl& inner = *static_cast<const ObjectExpr&>(*inner_bind.value).act;
+    REQUIRE(inner.upvalues.size() == 1);
+    REQUIRE(inner.upvalues[0].from_local);
+    REQUIRE(inner.upvalues[0].index == 1);
+    // Rebinding a captured name makes a local copy instead of writing the capture.
+    auto& rebind = static_cast<const BindStmt&>(*inner.body[0]);
+    REQUIRE(rebind.declares);
+    REQUIRE(static_cast<const IdentifierExpr&>(*rebind.target).resolution.kind ==
+            BindingKind::Local);
+}
+
+TEST_CASE("TypeChecker Errors", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+
+    SECTION("Type mismatch") {
+        REQUIRE_FALSE(check_source("let x : int -> \"text\";", globals, reporter).ok);
+        REQUIRE(reporter.saw("Cannot bind a value of type 'string' to 'x' of type 'int'"));
+    }
+
+    SECTION("Immutable bindings") {
+        REQUIRE_FALSE(check_source("set x -> 1; let x -> 2;", globals, reporter).ok);
+        REQUIRE(reporter.saw("immutable"));
+    }
+
+    SECTION("Mutable collections only bind to exactly their element types") {
+        REQUIRE(check_source("let c : [proto] -> [1, \"s\"]; let d : [proto] -> c;"
+                             "let e : [int] -> [1, 2];",
+                             globals, reporter)
+                    .ok);
+        REQUIRE_FALSE(check_source("let a : [int] -> [1, 2]; let b : [proto] -> a;", globals,
+                                   reporter)
+                          .ok);
+        REQUIRE(reporter.saw("Cannot bind a value of type '[int]' to 'b' of type '[proto]'"));
+    }
+
+    SECTION("Literal out of range") {
+        REQUIRE_FALSE(check_source("let b : byte -> 256;", globals, reporter).ok);
+        REQUIRE(reporter.saw("does not fit in 'byte'"));
+    }
+
+    SECTION("Undefined names and bad operands") {
+        REQUIRE_FALSE(check_source("let y -> missing; let z -> true + 1;", globals, reporter).ok);
+        REQUIRE(reporter.messages.size() == 2);
+        REQUIRE(reporter.saw("missing"));
+        REQUIRE(reporter.saw("'+' cannot be applied to 'bool' and 'int'"));
+    }
+
+    SECTION("Conditions must be bool") {
+        REQUIRE_FALSE(check_source("let n -> 1; while (n) { }", globals, reporter).ok);
+        REQUIRE(reporter.saw("Expected 'bool'"));
+    }
+
+    SECTION("Too many arguments") {
+        REQUIRE_FALSE(check_source("let f => { param a -> 0; } @ { be a; }; @f(1, 2);", globals,
+                                   reporter)
+                          .ok);
+        REQUIRE(reporter.saw("'f' takes 1 argument(s) but 2 were given"));
+    }
+
+    SECTION("Private members are only visible through self") {
+        REQUIRE_FALSE(check_source("let o => { let secret : private -> 1; }; let s -> o.secret;",
+                                   globals, reporter)
+                          .ok);
+        REQUIRE(reporter.saw("secret"));
+    }
+
+    SECTION("Loop control outside of loops") {
+        REQUIRE_FALSE(check_source("done;", globals, reporter).ok);
+    }
+}
+
+TEST_CASE("TypeChecker Pure Acts", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+
+    SECTION("Pure acts may recurse and build their own collections") {
+        REQUIRE(check_source("let fib : pure => { param n : int -> 0; } @ {"
+                             "  if (n < 2) { be n; }"
+                             "  let parts -> [];"
+                             "  parts.@push(@fib(n - 1));"
+                             "  let parts[0] -> parts[0] + @fib(n - 2);"
+                             "  be parts[0];"
+                             "};",
+                             globals, reporter)
+                    .ok);
+    }
+
+    SECTION("Side effects are rejected") {
+        REQUIRE_FALSE(check_source("add io; let total -> 0; let log @ { be 1; };"
+                                   "let f : pure => { param xs -> []; } @ {"
+                                   "  io.@print(1);"
+                                   "  let total -> 1;"
+                                   "  xs.@push(1);"
+                                   "  let copy -> [];"
+                                   "  let copy -> xs;"
+                                   "  let copy[0] -> 2;"
+                                   "  be @log();"
+                                   "};",
+                                   globals, reporter)
+                          .ok);
+        REQUIRE(reporter.messages.size() == 5);
+        REQUIRE(reporter.saw("Pure act 'f' cannot call 'io.print'"));
+        REQUIRE(reporter.saw("Pure act 'f' cannot modify 'total'"));
+        REQUIRE(reporter.saw("Pure act 'f' cannot modify 'xs'"));
+        REQUIRE(reporter.saw("Pure act 'f' cannot modify 'copy'"));  // May alias `xs`
+        REQUIRE(reporter.saw("cannot invoke 'log'"));
+    }
+}
+
+TEST_CASE("TypeChecker Globals Persist Across Runs", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+    REQUIRE(check_source("let counter -> 1;", globals, reporter).ok);
+    REQUIRE(globals.find("counter") == 0);
+
+    Checked second = check_source("let counter + 1;", globals, reporter);
+    REQUIRE(second.ok);
+    REQUIRE_FALSE(bind_at(second, 0).declares);
+    REQUIRE(globals.size() == 1);
+}
+
+TEST_CASE("TypeChecker Deferred Act Bodies", "[type_checker]") {
+    RecordingErrorReporter reporter;
+    GlobalTable globals;
+    std::string source =
+        "let g -> 1; let k -> 2;"
+        "let o => { param a : int -> 0; \"p\" -> 2; } @ { be a + p + g + k + later; };"
+        "let o >> { \"q\" -> 3; };"
+        "let later -> 3; let g : string -> \"s\";"
+        "let bad @ { let z : int -> \"s\"; };";
+    Checked checked = check_source(source, globals, reporter, true);
+    REQUIRE(checked.ok);  // Bodies are checked on their first invocation
+
+    auto& object = static_cast<ObjectExpr&>(*bind_at(checked, 2).value);
+    ActDecl& act = *object.act;
+    REQUIRE(act.param_count == 1);
+    REQUIRE(Parser::parse_deferred(act, source, reporter));
+    TypeChecker checker(globals, source, reporter);
+    REQUIRE(checker.check_deferred(act));
+    REQUIRE(act.locals.size() == 1);
+
+    // Names resolve as they would have where the act is defined: `k` is a
+    // global, while `later` and the redeclared `g` are not declared yet.
+    std::vector<const IdentifierExpr*> names;
+    const Expr* sum = static_cast<const BeStmt&>(*act.body[0]).value.get();
+    while (sum->kind == ExprKind::Binary) {
+        auto& binary = static_cast<const BinaryExpr&>(*sum);
+        names.insert(names.begin(), static_cast<const IdentifierExpr*>(binary.right.get()));
+        sum = binary.left.get();
+    }
+    names.insert(names.begin(), static_cast<const IdentifierExpr*>(sum));
+    REQUIRE(names.size() == 5);
+    REQUIRE(names[0]->resolution.kind == BindingKind::Local);
+    REQUIRE(names[1]->resolution.kind == BindingKind::Property);
+    REQUIRE(names[2]->resolution.kind == BindingKind::Dynamic);
+    REQUIRE(names[3]->resolution.kind == BindingKind::Global);
+    REQUIRE(names[4]->resolution.kind == BindingKind::Dynamic);
+
+    auto& bad = static_cast<ObjectExpr&>(*bind_at(checked, 6).value);
+    REQUIRE(Parser::parse_deferred(*bad.act, source, reporter));
+    REQUIRE_FALSE(checker.check_deferred(*bad.act));
+    REQUIRE(reporter.saw("Cannot bind a value of type 'string' to 'z' of type 'int'"));
+}
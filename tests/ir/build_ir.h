@@ -0,0 +1,47 @@
+#pragma once
+
+#include "catch2.hpp"
+#include "core/recording_error_reporter.h"
+#include "tooi/core/parser.h"
+#include "tooi/core/scanner.h"
+#include "tooi/core/type_checker.h"
+#include "tooi/ir/builder.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * @brief Scans, parses, checks and lowers a source snippet to IR.
+ *
+ * The program is kept alive alongside the module, since functions refer to
+ * their act declarations.
+ */
+struct BuiltIr {
+    tooi::core::GlobalTable globals;
+    tooi::core::Program program;
+    std::unique_ptr<tooi::ir::Module> module;
+};
+
+inline std::unique_ptr<BuiltIr> build_ir(const std::string& source) {
+    auto result = std::make_unique<BuiltIr>();
+    RecordingErrorReporter reporter;
+    tooi::core::Scanner scanner(source, reporter);
+    tooi::core::Parser parser(scanner.scan_tokens(), source, reporter);
+    result->program = parser.parse();
+    tooi::core::TypeChecker checker(result->globals, source, reporter);
+    REQUIRE(checker.check(result->program));
+    tooi::ir::Builder builder(result->globals);
+    result->module = builder.build(result->program);
+    return result;
+}
+
+/// Number of instructions with the given opcode in a function.
+inline int count_ops(const tooi::ir::Function& function, tooi::ir::Opcode op) {
+    int count = 0;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == op) count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,117 @@
+#include "catch2.hpp"
+#include "ir/build_ir.h"
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/ir.h"
+
+#include <sstream>
+
+using namespace tooi::ir;
+
+namespace {
+
+// Checks the structural invariants every function must satisfy.
+void verify(const Function& function) {
+    for (const auto& block : function.blocks) {
+        REQUIRE(block->terminator() != nullptr);
+        for (const BasicBlock* successor : block->successors()) {
+            REQUIRE(successor->predecessor_index(block.get()) >= 0);
+        }
+        for (const auto& instruction : block->instructions) {
+            REQUIRE(instruction->block == block.get());
+            if (instruction->op == Opcode::Phi) {
+                REQUIRE(instruction->operands.size() == block->predecessors.size());
+            }
+            for (const Instruction* operand : instruction->operands) {
+                REQUIRE(operand->block != nullptr);
+            }
+        }
+    }
+}
+
+const Instruction* find_op(const Function& function, Opcode op) {
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == op) return instruction.get();
+        }
+    }
+    return nullptr;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("IR Builder SSA Construction", "[ir]") {
+    SECTION("Straight-line code needs no phis and writes globals through") {
+        auto ir = build_ir("let a -> 1; let b -> a + 2; let a -> b * a;");
+        const Function& script = *ir->module->script();
+        verify(script);
+        REQUIRE(script.blocks.size() == 1);
+        REQUIRE(count_ops(script, Opcode::Phi) == 0);
+        REQUIRE(count_ops(script, Opcode::StoreGlobal) == 3);
+        REQUIRE(count_ops(script, Opcode::LoadGlobal) == 0);  // Reads use the SSA values
+    }
+
+    SECTION("Loop-carried variables get a phi in the loop header") {
+        auto ir = build_ir("let i -> 0; let sum -> 0;"
+                           "while (i < 10) { let sum -> sum + i; let i -> i + 1; }");
+        const Function& script = *ir->module->script();
+        verify(script);
+        REQUIRE(count_ops(script, Opcode::Phi) == 2);
+        DominatorTree dominators(script);
+        auto loops = find_loops(dominators);
+        REQUIRE(loops.size() == 1);
+        REQUIRE(loops[0]->preheader != nullptr);
+        REQUIRE(loops[0]->header->instructions.front()->op == Opcode::Phi);
+    }
+
+    SECTION("Short-circuit operators merge their operands with a phi") {
+        auto ir = build_ir("let a -> true; let b -> false; let c -> a and b;");
+        const Function& script = *ir->module->script();
+        verify(script);
+        REQUIRE(count_ops(script, Opcode::Phi) == 1);
+        REQUIRE(count_ops(script, Opcode::Branch) == 1);
+    }
+
+    SECTION("Globals are reloaded after calls that may rebind them") {
+        auto ir = build_ir("let n -> 0; let f @ { let n -> n + 1; }; @f(); let m -> n;");
+        const Function& script = *ir->module->script();
+        verify(script);
+        const Instruction* load = find_op(script, Opcode::LoadGlobal);
+        REQUIRE(load != nullptr);
+        REQUIRE(load->index == 0);
+        const BasicBlock* block = load->block;
+        REQUIRE(block->instructions[block->position_of(load) - 1]->op == Opcode::Invoke);
+    }
+}
+
+TEST_CASE("IR Builder Acts", "[ir]") {
+    auto ir = build_ir("let make => { param start : int -> 5; } @ {"
+                       "  let base -> start * 2;"
+                       "  let get @ { be base; };"
+                       "  be @get();"
+                       "};");
+    const Module& module = *ir->module;
+    REQUIRE(module.functions.size() == 3);
+    for (const auto& function : module.functions) verify(*function);
+
+    const Function& make = *module.functions[1];
+    REQUIRE(make.name == "make");
+    REQUIRE(make.param_count == 1);
+    REQUIRE(make.entry()->instructions.front()->op == Opcode::Param);
+
+    // The script passes the param default, `make` passes the captured local.
+    const Instruction* outer_closure = find_op(*module.script(), Opcode::MakeAct);
+    REQUIRE(outer_closure->index == 1);
+    REQUIRE(outer_closure->operands.size() == 1);
+    REQUIRE(std::get<int64_t>(outer_closure->operands[0]->constant) == 5);
+
+    const Function& get = *module.functions[2];
+    REQUIRE(get.upvalue_count == 1);
+    REQUIRE(count_ops(get, Opcode::Upvalue) == 1);
+    const Instruction* inner_closure = find_op(make, Opcode::MakeAct);
+    REQUIRE(inner_closure->operands.size() == 1);
+    REQUIRE(inner_closure->operands[0]->op == Opcode::Mul);
+
+    std::ostringstream out;
+    print_module(module, out);
+    REQUIRE(out.str().find("function 2 get (params 0, upvalues 1)") != std::string::npos);
+}
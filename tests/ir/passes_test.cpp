@@ -0,0 +1,291 @@
+#include "catch2.hpp"
+#include "ir/build_ir.h"
+#include "tooi/ir/analysis.h"
+#include "tooi/ir/pass_manager.h"
+#include "tooi/ir/passes.h"
+
+#include <sstream>
+
+using namespace tooi::ir;
+
+namespace {
+
+// Element accesses of a function that still need a bounds check.
+int checked_accesses(const Function& function) {
+    int count = 0;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block->instructions) {
+            if ((instruction->op == Opcode::Index || instruction->op == Opcode::SetIndex) &&
+                instruction->bounds_check) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+bool is_in_loop(const Function& function, const Instruction* instruction) {
+    DominatorTree dominators(function);
+    for (const auto& loop : find_loops(dominators)) {
+        if (loop->contains(instruction->block)) return true;
+    }
+    return false;
+}
+
+const Instruction* find_op(const Function& function, Opcode op) {
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == op) return instruction.get();
+        }
+    }
+    return nullptr;
+}
+
+// True if every phi has one operand per predecessor of its block.
+bool has_consistent_phis(const Function& function) {
+    for (const auto& block : function.blocks) {
+        for (const BasicBlock* successor : block->successors()) {
+            if (successor->predecessor_index(block.get()) < 0) return false;
+        }
+        for (const auto& instruction : block->instructions) {
+            if (instruction->op == Opcode::Phi &&
+                instruction->operands.size() != block->predecessors.size()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("IR Compile-Time Evaluation", "[ir]") {
+    const std::string fib = "let fib : pure => { param n : int -> 0; } @ {"
+                            "  if (n < 2) { be n; }"
+                            "  be @fib(n - 1) + @fib(n - 2);"
+                            "};";
+
+    SECTION("Pure acts with constant arguments become constants") {
+        auto ir = build_ir(fib + "let a -> @fib(10); let b -> @fib(6) + 1;");
+        Function& script = *ir->module->script();
+        REQUIRE(evaluate_pure_calls(script) == 3);  // Two invocations and the addition
+        REQUIRE(count_ops(script, Opcode::Invoke) == 0);
+        bool found = false;
+        for (const auto& instruction : script.entry()->instructions) {
+            if (instruction->op == Opcode::StoreGlobal && instruction->name == "b") {
+                REQUIRE(std::get<int64_t>(instruction->operands[0]->constant) == 9);
+                found = true;
+            }
+        }
+        REQUIRE(found);
+    }
+
+    SECTION("Calls that cannot be decided at compile time are kept") {
+        const std::string sources[] = {
+            fib + "let a -> @fib(40);",  // Exceeds the step budget
+            "let spin : pure @ { let i -> 0; while (true) { let i -> i + 1; } }; @spin();",
+            "let plain => { param n -> 0; } @ { be n; }; let a -> @plain(1);",  // Not pure
+            fib + "let a -> @fib(io.@read_line() as int);",  // Argument not constant
+        };
+        for (const std::string& source : sources) {
+            auto ir = build_ir("add io;" + source);
+            REQUIRE(evaluate_pure_calls(*ir->module->script()) == 0);
+        }
+    }
+
+    SECTION("Calls after a call that may replace the act are not evaluated") {
+        auto ir = build_ir(fib + "let swap @ { let fib @ { be 0; }; }; @swap(); let a -> @fib(3);");
+        Function& script = *ir->module->script();
+        REQUIRE(evaluate_pure_calls(script) == 0);
+    }
+}
+
+TEST_CASE("IR Inlining", "[ir]") {
+    const std::string square = "add io; let sq => { param n : int -> 0; } @ { be n * n; };";
+
+    SECTION("An act defined right before the call is spliced in without a check") {
+        auto ir = build_ir(square + "let a -> @sq(io.@read_line() as int);");
+        Function& script = *ir->module->script();
+        InlineStats stats;
+        REQUIRE(inline_small_acts(script, &stats) == 1);
+        REQUIRE(count_ops(script, Opcode::Invoke) == 0);
+        REQUIRE(count_ops(script, Opcode::ActIs) == 0);
+        REQUIRE(count_ops(script, Opcode::Mul) == 1);
+        REQUIRE(stats.guarded == 0);
+        REQUIRE(stats.instructions ==
+                static_cast<int>(ir->module->functions[1]->instruction_count()));
+        REQUIRE(has_consistent_phis(script));
+    }
+
+    SECTION("Calls the act may have been replaced before are guarded") {
+        auto ir = build_ir(square + "let swap @ { let sq @ { be 0; }; };"
+                                    "@swap(); let a -> @sq(2);"
+                                    "let i -> 0; while (i < 3) { let i -> i + @sq(i); }");
+        Function& script = *ir->module->script();
+        InlineStats stats;
+        REQUIRE(inline_small_acts(script, &stats) == 3);
+        REQUIRE(stats.guarded == 2);
+        REQUIRE(count_ops(script, Opcode::ActIs) == 2);
+        REQUIRE(count_ops(script, Opcode::Invoke) == 2);  // The fallbacks
+        REQUIRE(has_consistent_phis(script));
+    }
+
+    SECTION("Self-recursive and large acts are not inlined") {
+        std::string large = "let big @ { let x -> 1;";
+        for (int i = 0; i < 10; ++i) large += "let x -> x * 3 + 1;";
+        large += "be x; };";
+        const std::string sources[] = {
+            "let fib => { param n : int -> 0; } @ {"
+            "  if (n < 2) { be n; }"
+            "  be @fib(n - 1) + @fib(n - 2);"
+            "};"
+            "let a -> @fib(7);",
+            large + "@big();",
+        };
+        for (const std::string& source : sources) {
+            auto ir = build_ir(source);
+            for (const auto& function : ir->module->functions) {
+                REQUIRE(inline_small_acts(*function) == 0);
+            }
+        }
+    }
+
+    SECTION("Calls in loops may inline larger acts") {
+        std::string medium = "let f @ { let x -> 1;";
+        for (int i = 0; i < 8; ++i) medium += "let x -> x * 3 + 1;";
+        medium += "be x; };";
+        auto ir = build_ir(medium + "@f(); let i -> 0; while (i < 3) { @f(); let i -> i + 1; }");
+        REQUIRE(ir->module->functions[1]->instruction_count() > kInlineSizeLimit);
+        REQUIRE(inline_small_acts(*ir->module->script()) == 1);
+        REQUIRE(count_ops(*ir->module->script(), Opcode::Invoke) == 2);
+    }
+}
+
+TEST_CASE("IR Common Subexpression Elimination", "[ir]") {
+    SECTION("Identical pure expressions are computed once") {
+        auto ir = build_ir("let x -> 3; let y -> 4; let a -> x * y + y * x;");
+        Function& script = *ir->module->script();
+        REQUIRE(count_ops(script, Opcode::Mul) == 2);
+        REQUIRE(eliminate_common_subexpressions(script) > 0);
+        REQUIRE(count_ops(script, Opcode::Mul) == 1);  // Commutative operands match
+    }
+
+    SECTION("Memory reads are not merged across calls") {
+        auto ir = build_ir("add io; let a -> [1, 2];"
+                           "let b -> a[0] + a[0]; a.@push(3); let c -> a[0];");
+        Function& script = *ir->module->script();
+        eliminate_common_subexpressions(script);
+        REQUIRE(count_ops(script, Opcode::Index) == 2);
+    }
+}
+
+TEST_CASE("IR Loop-Invariant Code Motion", "[ir]") {
+    SECTION("Invariant non-trapping arithmetic and length leave the loop") {
+        auto ir = build_ir("let xs -> [1, 2, 3]; let k -> 1.5; let i -> 0; let s -> 0.0;"
+                           "while (i < xs.length) { let s -> s + k * k; let i -> i + 1; }");
+        Function& script = *ir->module->script();
+        REQUIRE(hoist_loop_invariants(script) > 0);
+        REQUIRE_FALSE(is_in_loop(script, find_op(script, Opcode::Mul)));
+        REQUIRE_FALSE(is_in_loop(script, find_op(script, Opcode::Length)));
+    }
+
+    SECTION("Length stays in a loop that may resize the array") {
+        auto ir = build_ir("let xs -> [1]; let i -> 0;"
+                           "while (i < xs.length) { xs.@push(i); let i -> i + 1; }");
+        Function& script = *ir->module->script();
+        hoist_loop_invariants(script);
+        REQUIRE(is_in_loop(script, find_op(script, Opcode::Length)));
+    }
+
+    SECTION("Possibly trapping code is not speculated out of the loop body") {
+        auto ir = build_ir("let a -> 1; let b -> 0; let i -> 0;"
+                           "while (i < 3) { if (b != 0) { let i -> i + a / b; } let i -> i + 1; }");
+        Function& script = *ir->module->script();
+        hoist_loop_invariants(script);
+        REQUIRE(is_in_loop(script, find_op(script, Opcode::Div)));
+    }
+}
+
+TEST_CASE("IR Bounds Check Elimination", "[ir]") {
+    SECTION("for-in loops index without checks") {
+        auto ir = build_ir("let xs -> [1, 2, 3]; let s -> 0; for (x in xs) { let s -> s + x; }");
+        Function& script = *ir->module->script();
+        REQUIRE(checked_accesses(script) == 1);
+        REQUIRE(eliminate_bounds_checks(script) == 1);
+        REQUIRE(checked_accesses(script) == 0);
+    }
+
+    SECTION("Counted while loops guarded by length") {
+        auto ir = build_ir("let xs -> [1, 2, 3]; let i -> 0;"
+                           "while (i < xs.length) { let xs[i] -> xs[i] * 2; let i -> i + 1; }");
+        Function& script = *ir->module->script();
+        REQUIRE(eliminate_bounds_checks(script) == 2);
+    }
+
+    SECTION("Accesses that are not proven in range keep their checks") {
+        auto ir = build_ir("let xs -> [1, 2, 3]; let i -> 0; let s -> 0;"
+                           "while (i < xs.length) {"
+                           "  let s -> s + xs[i - 1] + xs[i + 1];"
+                           "  let i -> i + 1;"
+                           "}"
+                           "let j -> 0;"
+                           "while (j < xs.length) {"
+                           "  xs.@pop();"
+                           "  let s -> s + xs[j];"
+                           "  let j -> j + 1;"
+                           "}");
+        Function& script = *ir->module->script();
+        REQUIRE(eliminate_bounds_checks(script) == 0);
+    }
+}
+
+TEST_CASE("IR Dead Code Elimination", "[ir]") {
+    auto ir = build_ir("let i -> 0; let unused -> 0;"
+                       "while (i < 5) { let i -> i + 1; done; let unused -> i * 2; }");
+    Function& script = *ir->module->script();
+    size_t blocks = script.blocks.size();
+    REQUIRE(eliminate_dead_code(script) > 0);
+    REQUIRE(script.blocks.size() < blocks);
+    REQUIRE(count_ops(script, Opcode::Mul) == 0);
+}
+
+TEST_CASE("IR Pass Manager", "[ir]") {
+    auto ir = build_ir("let xs -> [1, 2]; let s -> 0; for (x in xs) { let s -> s + x * x; }");
+    PassManager passes;
+    REQUIRE(passes.disable("bce"));
+    REQUIRE_FALSE(passes.disable("no-such-pass"));
+    passes.run(*ir->module);
+
+    // Disabled passes leave their work undone and are reported as such.
+    REQUIRE(checked_accesses(*ir->module->script()) == 1);
+    const auto& stats = passes.stats();
+    REQUIRE(stats.size() == PassManager::pass_names().size());
+    REQUIRE(stats[4].name == "bce");
+    REQUIRE_FALSE(stats[4].enabled);
+    REQUIRE(stats[3].changes > 0);  // licm hoisted the length
+
+    std::ostringstream out;
+    passes.print_stats(out);
+    REQUIRE(out.str().find("bce    disabled") != std::string::npos);
+}
+
+TEST_CASE("IR Pass Manager Deferring Acts", "[ir]") {
+    std::string source =
+        "let sum => { param n : int -> 0; } @ { let s : int -> 0;"
+        "  for (x in [1, 2, n]) { let s -> s + x * x; } be s; };"
+        "let twice => { param n : int -> 0; } @ { be @sum(n) * 2; }; let y -> @twice(3);";
+    auto eager = build_ir(source);
+    PassManager().run(*eager->module);
+
+    // The function-local passes left out for acts give the same IR when run later.
+    auto deferred = build_ir(source);
+    PassManager passes;
+    passes.run(*deferred->module, true);
+    for (const auto& function : deferred->module->functions) {
+        if (function.get() != deferred->module->script()) passes.finish(*function);
+    }
+    std::ostringstream expected, actual;
+    print_module(*eager->module, expected);
+    print_module(*deferred->module, actual);
+    REQUIRE(actual.str() == expected.str());
+}
@@ -0,0 +1,60 @@
+#include "catch2.hpp"
+#include "tooi/vm/heap.h"
+
+using namespace tooi::vm;
+
+TEST_CASE("Objects defined alike share a shape", "[vm]") {
+    Heap heap;
+    Object* a = heap.object("a");
+    Object* b = heap.object("b");
+    REQUIRE(a->shape == heap.empty_shape());
+    for (Object* object : {a, b}) {
+        object->define("x", Value::int32(1), false, false);
+        object->define("y", Value::int32(2), true, false);
+    }
+    REQUIRE(a->shape == b->shape);
+    REQUIRE(a->shape->slot_count == 2);
+    REQUIRE(a->find("y")->as_int() == 2);
+    REQUIRE(a->find("z") == nullptr);
+
+    // Replacing a value keeps the shape; new flags or another order do not.
+    Shape* shape = a->shape;
+    a->define("x", Value::int32(5), false, false);
+    REQUIRE(a->shape == shape);
+    REQUIRE(a->find("x")->as_int() == 5);
+    b->define("x", Value::int32(5), true, false);
+    REQUIRE(b->shape != shape);
+    REQUIRE(b->shape->slot_count == 2);
+    REQUIRE(b->shape->find("x")->is_set);
+
+    Object* c = heap.object("c");
+    c->define("y", Value::int32(2), true, false);
+    c->define("x", Value::int32(1), false, false);
+    REQUIRE(c->shape != shape);
+    REQUIRE(heap.empty_shape()->transitions.size() == 2);
+}
+
+TEST_CASE("Copies share their slots until one of them writes", "[vm]") {
+    Heap heap;
+    Object* original = heap.object("original");
+    original->define("x", Value::int32(1), false, false);
+    original->define("y", Value::int32(2), false, false);
+    Object* copy = heap.object("copy");
+    copy->shape = original->shape;
+    copy->share_slots(*original);
+    REQUIRE(copy->slots().data() == original->slots().data());
+
+    // Writing to either side copies the slots of only that side.
+    copy->writable_slots()[0] = Value::int32(10);
+    REQUIRE(copy->slots().data() != original->slots().data());
+    REQUIRE(original->find("x")->as_int() == 1);
+    REQUIRE(copy->find("x")->as_int() == 10);
+
+    Object* other = heap.object("other");
+    other->shape = original->shape;
+    other->share_slots(*original);
+    original->define("z", Value::int32(3), false, false);
+    REQUIRE(original->find("z")->as_int() == 3);
+    REQUIRE(other->slots().size() == 2);
+    REQUIRE(other->find("y")->as_int() == 2);
+}
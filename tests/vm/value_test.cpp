@@ -0,0 +1,57 @@
+#include "catch2.hpp"
+#include "tooi/vm/heap.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace tooi::vm;
+
+TEST_CASE("Value boxes scalars into one word", "[vm]") {
+    Heap heap;
+    REQUIRE(sizeof(Value) == 8);
+    REQUIRE(Value().is_nil());
+    REQUIRE(Value::boolean(false).is_bool());
+    REQUIRE_FALSE(Value::boolean(false).truthy());
+    REQUIRE(Value::boolean(true).as_bool());
+
+    Value negative = Value::int32(-7);
+    REQUIRE(negative.is_int32());
+    REQUIRE(negative.as_int() == -7);
+    REQUIRE(Value::unsigned_int(ValueKind::Byte, 255, heap).as_uint() == 255);
+    REQUIRE(Value::unsigned_int(ValueKind::UInt32, 4000000000u, heap).kind() ==
+            ValueKind::UInt32);
+
+    Value half = Value::number(ValueKind::Float64, 0.5);
+    REQUIRE(half.is_float64());
+    REQUIRE(half.as_double() == 0.5);
+    REQUIRE(Value::number(ValueKind::Float32, 0.1).as_double() == static_cast<float>(0.1));
+    REQUIRE(heap.object_count() == 0);
+}
+
+TEST_CASE("Value canonicalizes NaN so no double aliases a box", "[vm]") {
+    Value nan = Value::number(ValueKind::Float64, -std::numeric_limits<double>::quiet_NaN());
+    REQUIRE(nan.kind() == ValueKind::Float64);
+    REQUIRE(std::isnan(nan.as_double()));
+    REQUIRE_FALSE(values_equal(nan, nan));
+    REQUIRE(Value::number(ValueKind::Float64, -INFINITY).as_double() == -INFINITY);
+}
+
+TEST_CASE("Value keeps 64-bit integers beyond the payload on the heap", "[vm]") {
+    Heap heap;
+    Value small = Value::signed_int(ValueKind::Int64, -(int64_t{1} << 47), heap);
+    REQUIRE(heap.object_count() == 0);
+    REQUIRE(small.as_int() == -(int64_t{1} << 47));
+
+    Value wide = Value::signed_int(ValueKind::Int64, INT64_MIN, heap);
+    REQUIRE(heap.object_count() == 1);
+    REQUIRE(wide.kind() == ValueKind::Int64);
+    REQUIRE(wide.is_pointer());
+    REQUIRE_FALSE(wide.is_heap());
+    REQUIRE(wide.as_int() == INT64_MIN);
+
+    Value max = Value::unsigned_int(ValueKind::UInt64, UINT64_MAX, heap);
+    REQUIRE(max.as_uint() == UINT64_MAX);
+    REQUIRE(values_equal(max, Value::unsigned_int(ValueKind::UInt64, UINT64_MAX, heap)));
+    REQUIRE(hash_value(max) ==
+            hash_value(Value::unsigned_int(ValueKind::UInt64, UINT64_MAX, heap)));
+}
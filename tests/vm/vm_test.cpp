@@ -0,0 +1,660 @@
+#include "catch2.hpp"
+#include "ir/build_ir.h"
+#include "tooi/ir/pass_manager.h"
+#include "tooi/vm/compiler.h"
+#include "tooi/vm/vm.h"
+
+#include <sstream>
+
+using namespace tooi::vm;
+
+namespace {
+
+struct RunResult {
+    bool ok;
+    std::string output;
+    RecordingErrorReporter reporter;
+};
+
+// Runs a snippet through the whole pipeline and captures what it prints.
+std::unique_ptr<RunResult> run_source(const std::string& source, bool optimize = true,
+                                      const std::string& input = "") {
+    auto built = build_ir(source);
+    if (optimize) tooi::ir::PassManager().run(*built->module);
+    auto result = std::make_unique<RunResult>();
+    std::ostringstream out;
+    std::istringstream in(input);
+    VM vm(result->reporter, out, in);
+    Compiler compiler(vm.heap());
+    result->ok = vm.run(compiler.compile(*built->module, source), built->globals);
+    result->output = out.str();
+    return result;
+}
+
+std::string output_of(const std::string& source) {
+    auto result = run_source(source);
+    REQUIRE(result->ok);
+    auto unoptimized = run_source(source, false);
+    REQUIRE(unoptimized->ok);
+    REQUIRE(unoptimized->output == result->output);
+    return result->output;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("VM evaluates arithmetic and strings", "[vm]") {
+    REQUIRE(output_of("add io; let x : int -> 10;"
+                      "io.@print_line(x * 3 + 1, x / 3, x % 3, -x, 7.5 / 2);") ==
+            "31 3 1 -10 3.75\n");
+    REQUIRE(output_of("add io; let s -> \"a\" + \"b\" + 1; io.@print(s, 2 < 3, 1 == 1.0);") ==
+            "ab1 true true");
+    REQUIRE(output_of("add io; io.@print_line(42 as string, \"42\" as int + 1, 3.9 as int);") ==
+            "42 43 3\n");
+    // int64 values beyond 48 bits are boxed on the heap.
+    REQUIRE(output_of("add io; let big : int64 -> 140737488355327; let n -> big + 1;"
+                      "io.@print(n, n * 1000, -(n * 1000) == 0 - n * 1000);") ==
+            "140737488355328 140737488355328000 true");
+}
+
+TEST_CASE("VM converts between numbers and text", "[vm]") {
+    // Floats print as the shortest text that reads back as the same value.
+    REQUIRE(output_of("add io; let third : float -> 1.0f / 3.0f; let x -> 0.1 + 0.2;"
+                      "io.@print(x as string, third, 2.5 * 4, x as string as float64 == x);") ==
+            "0.30000000000000004 0.33333334 10 true");
+    REQUIRE(output_of("add io; io.@print(\" 42\" as int, \"+7\" as int, \"-2.5\" as float64,"
+                      "\"4294967295\" as uint, -3.7 as int);") ==
+            "42 7 -2.5 4294967295 -3");
+    for (const char* text : {"4x", "", "-1", "+-1", "4294967296"}) {
+        auto result = run_source(std::string("let s -> \"") + text + "\"; let n -> s as uint;");
+        REQUIRE_FALSE(result->ok);
+        REQUIRE(result->reporter.saw("Cannot convert"));
+    }
+}
+
+TEST_CASE("VM keeps float constants with distinct bits apart", "[vm]") {
+    // Folded NaN and -0.0 must not be merged with other constants by value.
+    REQUIRE(output_of("add io; io.@print(2.5, 0.0 / 0.0, \"nan\" as float64, 100000.0);") ==
+            "2.5 nan nan 1e+05");
+    REQUIRE(output_of("add io; let a : float64 -> 0.0; let b : float64 -> -0.0;"
+                      "io.@print(a, b, 1.0 / b);") == "0 -0 -inf");
+}
+
+TEST_CASE("VM specializes integer arithmetic by width", "[vm]") {
+    std::string source = "add io; let a : uint64 -> 100; let b : uint64 -> 7;"
+                         "io.@print(a / b, a % b, a - b * 14, a > b, a == b);";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+    RecordingErrorReporter reporter;
+    VM vm(reporter);
+    std::ostringstream code;
+    print_compiled_module(*Compiler(vm.heap()).compile(*built->module, source), code);
+    REQUIRE(code.str().find("DivU64") != std::string::npos);
+    REQUIRE(output_of(source) == "14 2 2 true false");
+
+    // Results beyond the 48-bit payload and mixed kinds take the generic path.
+    REQUIRE(output_of("add io; let f => { param n : int64 -> 0; } @ { be n * n; };"
+                      "io.@print(@f(100000000), @f(3) < @f(100000000));") ==
+            "10000000000000000 true");
+    auto overflow = run_source("let zero : uint -> 0; let f => { param n : uint -> 0; } @ {"
+                               "be n - 1; }; @f(zero);");
+    REQUIRE_FALSE(overflow->ok);
+    REQUIRE(overflow->reporter.saw("Integer overflow"));
+    auto zero = run_source("let f => { param n : int64 -> 0; } @ { be 7 % n; }; @f(0);");
+    REQUIRE_FALSE(zero->ok);
+    REQUIRE(zero->reporter.saw("division by zero"));
+}
+
+TEST_CASE("VM quickens generic instructions and de-quickens on a guard failure", "[vm]") {
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    // Without optimization `f` stays an act whose `+` only sees proto operands.
+    std::string source =
+        "add io; let f => { param a : proto -> 0; param b : proto -> 0; } @ { be a + b; };"
+        "let o => { let p : int -> 1; }; let g => { param x : proto -> nil; } @ { be x.p; };"
+        "let i : int -> 0; let s : proto -> 0;"
+        "while (i < 20) { let s -> @f(s, i) + @g(o); let i -> i + 1; }"
+        "io.@print(s, @f(\"x\", \"y\"), @f(1.5, 2));";
+    auto built = build_ir(source);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "210 xy 3.5");
+    REQUIRE(vm.stats().quickened >= 2);   // AddI32 in f, GetPropObject in g
+    REQUIRE(vm.stats().dequickened == 1);  // f("x", "y")
+}
+
+TEST_CASE("VM fuses instruction sequences into superinstructions", "[vm]") {
+    // Whichever sequences the build generated from the profile, each is found in place.
+    std::vector<Opcode> superinstructions = {
+#define TOOI_VM_TEST_SUPERINSTRUCTION(name, ...) Opcode::name,
+        TOOI_VM_SUPERINSTRUCTIONS(TOOI_VM_TEST_SUPERINSTRUCTION)
+#undef TOOI_VM_TEST_SUPERINSTRUCTION
+    };
+    for (Opcode fused : superinstructions) {
+        const std::vector<Opcode>& parts = superinstruction_parts(fused);
+        std::vector<uint32_t> code;
+        for (Opcode part : parts) {
+            code.push_back(encode(part, 1));
+            code.resize(code.size() + instruction_length(part) - 1);
+        }
+        fuse_superinstruction(code, 0);
+        REQUIRE(superinstruction_parts(decode_op(code[0])).size() == parts.size());
+        REQUIRE(decode_operand(code[0]) == 1);
+        REQUIRE(instruction_length(fused) == instruction_length(parts.front()));
+        REQUIRE(generic_opcode(fused) == generic_opcode(parts.front()));
+
+        // Changing the form of a later part splits the superinstruction before it.
+        size_t position = 0;
+        for (size_t i = 1; i < parts.size(); ++i) {
+            position += instruction_length(parts[i - 1]);
+            if (generic_opcode(parts[i]) == parts[i]) continue;
+            std::vector<uint32_t> split = code;
+            split[position] = encode(generic_opcode(parts[i]), 1);
+            unfuse_superinstructions(split, position);
+            REQUIRE(superinstruction_parts(decode_op(split[0])).size() <= i);
+            REQUIRE(superinstruction_parts(decode_op(split[0])).front() == parts.front());
+        }
+    }
+
+    // A quickened instruction fused with the ones after it still de-quickens.
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    std::string source = "add io; let s : proto -> 0; let i : int -> 0;"
+                         "while (i < 20) { if (i == 15) { let s -> \"n\"; }"
+                         "  let s -> s + i; let i -> i + 1; }"
+                         "io.@print(s);";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "n1516171819");
+    REQUIRE(vm.stats().dequickened == 1);
+
+    // `+` quickens after `%`, so AddI32 may be fused with the ModI32 after it,
+    // whose guard then fails for every call from the 62nd on.
+    std::string later = "add io; let f => { param a : proto -> 0; param b : proto -> 0;"
+                        "  param u : proto -> 0; param v : proto -> 1; } @ {"
+                        "  let p -> a + b; let q -> u % v; be [p, q]; };"
+                        "let i : int -> 0; let s : proto -> 0;"
+                        "while (i < 2000) { let a : proto -> i; if (i < 40) { let a -> 0.5; }"
+                        "  let v : proto -> 7; if (i > 60) { let v -> 7.5; }"
+                        "  let s -> @f(a, 1, i, v); let i -> i + 1; }"
+                        "io.@print(s);";
+    auto unoptimized = build_ir(later);
+    VM second(reporter, out);
+    Compiler second_compiler(second.heap());
+    REQUIRE(second.run(second_compiler.compile(*unoptimized->module, later),
+                       unoptimized->globals));
+    REQUIRE(second.stats().dequickened == 1);
+}
+
+TEST_CASE("VM runs loops and branches", "[vm]") {
+    REQUIRE(output_of("add io; let i : int -> 0; let total : int -> 0;"
+                      "while (i < 10) { let total -> total + i; let i -> i + 1; }"
+                      "if (total > 40 and not (total == 0)) { io.@print(total); }"
+                      "else { io.@print(0); }") == "45");
+    REQUIRE(output_of("add io; for (v in [1, 2, 3]) { io.@print(v); }"
+                      "for (k in [\"a\" -> 1, \"b\" -> 2]) { io.@print(k); }") == "123ab");
+}
+
+TEST_CASE("VM invokes acts with params, defaults and state", "[vm]") {
+    REQUIRE(output_of("add io; let plus => { param a : int -> 1; param b : int -> 2; }"
+                      "@ { be a + b; }; io.@print(@plus(), @plus(10), @plus(10, 20));") ==
+            "3 12 30");
+    REQUIRE(output_of("add io; let fib => { param n : int -> 0; } @ {"
+                      "  if (n < 2) { be n; } be @fib(n - 1) + @fib(n - 2); };"
+                      "io.@print(@fib(15));") == "610");
+    REQUIRE(output_of("add io; let counter => { let count : int -> 0; } @ {"
+                      "  let count + 1; io.@print_line(\"Count: \" + count); };"
+                      "@counter; @counter; let copy -> new counter; @copy; @counter;") ==
+            "Count: 1\nCount: 2\nCount: 3\nCount: 3\n");
+}
+
+TEST_CASE("VM resolves phis as parallel copies", "[vm]") {
+    // The swap makes the edge copies cyclic; `n` is computed into the phi slot of `i`.
+    REQUIRE(output_of("add io; let a : int -> 1; let b : int -> 2; let i : int -> 0;"
+                      "while (i < 3) { let t -> a; let a -> b; let b -> t; let n -> i + 1;"
+                      "  io.@print(i, a, b, \"\"); let i -> n; }"
+                      "io.@print(a, b);") == "0 2 1 1 1 2 2 2 1 2 1");
+    REQUIRE(output_of("add io; let f => { param n : int -> 0; } @ {"
+                      "  let x : int -> 0; let y : int -> 1; let k : int -> 0;"
+                      "  while (k < n) { let z -> x + y; let x -> y; let y -> z;"
+                      "    let k -> k + 1; }"
+                      "  be x; }; io.@print(@f(30), [@f(5), @f(6)]);") == "832040 [5, 8]");
+}
+
+TEST_CASE("VM copies loop-invariant variables inside a loop", "[vm]") {
+    // The phi of `a` in the loop header is trivial; `b` was defined as it before its removal.
+    REQUIRE(output_of("add io; let f => { param n : int -> 3; } @ {"
+                      "  let a : int -> 7; let b : int -> 0; let k : int -> 0;"
+                      "  while (k < n) { let b -> a; let k -> k + 1; } be b; };"
+                      "io.@print(@f());") == "7");
+    REQUIRE(output_of("add io; let a : int -> 7; let b : int -> 0; let k : int -> 0;"
+                      "while (k < 3) { let b -> a; let k -> k + 1; }"
+                      "let g => {} @ { while (k < 6) { let b -> a; let k -> k + 1; } be b; };"
+                      "io.@print(b, @g(), b);") == "7 7 7");
+}
+
+TEST_CASE("VM copies and extends objects", "[vm]") {
+    REQUIRE(output_of("add io; let p => { let x : int -> 1; let y : int -> 2; };"
+                      "let q -> new p; let q >> { let z : int -> 3; };"
+                      "let p >> { let z : int -> 4; }; let q.x -> 10;"
+                      "io.@print(p.x, p.y, p.z, q.x, q.y, q.z);") ==
+            "1 2 4 10 2 3");
+    // Arrays and assoc arrays in properties are copied too, whichever side modifies them.
+    REQUIRE(output_of("add io; let p => { let items : [int] -> [1, 2];"
+                      "let names : [string -> int] -> [\"a\" -> 1]; };"
+                      "let q -> new p; let r -> new p; q.items.@push(3); p.items.@pop();"
+                      "let n -> q.names; let n[\"b\"] -> 2; r.names.@remove(\"a\");"
+                      "io.@print(p.items, q.items, r.items, p.names, q.names, r.names);") ==
+            "[1] [1, 2, 3] [1, 2] [\"a\" -> 1] [\"a\" -> 1, \"b\" -> 2] [->]");
+}
+
+TEST_CASE("VM checks writes through proto receivers against property types", "[vm]") {
+    // Widening still applies; the loop makes the last writes hit the site's cache.
+    REQUIRE(output_of("add io; let o => { let n : int -> 1; let x : float64 -> 0.0; };"
+                      "let p : proto -> o; let i : int -> 0;"
+                      "while (i < 5) { let p.n -> i; let p.x -> i; let i -> i + 1; }"
+                      "io.@print(o.n, o.x + 0.5);") == "4 4.5");
+    for (const char* value : {"\"str\"", "2.5"}) {
+        auto result = run_source(std::string("let o => { let n : int -> 1; };") +
+                                 "let p : proto -> o; let i : int -> 0;"
+                                 "while (i < 5) { let p.n -> i; let i -> i + 1; }"
+                                 "let p.n -> " + value + ";");
+        REQUIRE_FALSE(result->ok);
+        REQUIRE(result->reporter.saw("Expected a value of type 'int'"));
+    }
+}
+
+TEST_CASE("VM caches property lookups per site and shape", "[vm]") {
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    // Once inlined, one `o.x` site sees six shapes and the other two.
+    std::string source =
+        "add io; let a => { let x : int -> 1; }; let b => { let y : int -> 0; let x : int -> 2; };"
+        "let c => { let z : int -> 0; let x : int -> 3; };"
+        "let d => { let w : int -> 0; let x : int -> 4; };"
+        "let e => { let v : int -> 0; let x : int -> 5; };"
+        "let f => { let u : int -> 0; let x : int -> 6; };"
+        "let get => { param o : proto -> nil; } @ { be o.x; };"
+        "let objects : [proto] -> [a, b, c, d, e, f]; let total : proto -> 0; let i : int -> 0;"
+        "while (i < 60) { let total -> total + @get(objects[i % 6]) + @get(objects[i % 2]);"
+        "  let i -> i + 1; }"
+        "let a.x -> 10; io.@print(total, @get(a));";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "300 10");
+    std::ostringstream stats;
+    vm.print_ic_stats(stats);
+    REQUIRE(stats.str().find("'x' megamorphic") != std::string::npos);
+    REQUIRE(stats.str().find("'x' polymorphic") != std::string::npos);
+    REQUIRE(stats.str().find("SetProp 'x' monomorphic, 0 hit(s), 1 miss(es)") != std::string::npos);
+
+    // A cached slot is never used to assign a `set` property.
+    auto immutable = run_source("let p => { set x : int -> 1; }; let q : proto -> p;"
+                                "let i : int -> 0; while (i < 3) { let q.x -> i; let i -> i + 1; }");
+    REQUIRE_FALSE(immutable->ok);
+    REQUIRE(immutable->reporter.saw("Cannot rebind property 'x'"));
+}
+
+TEST_CASE("VM supports arrays, tuples and assoc arrays", "[vm]") {
+    REQUIRE(output_of("add io; let arr : [int] -> [1, 2, 3]; arr.@push(4); arr.@insert(9, 0);"
+                      "let n -> arr.length; let last -> arr.@pop(); let first -> arr.@remove(0);"
+                      "io.@print(n, last, first, arr);") == "5 4 9 [1, 2, 3]");
+    REQUIRE(output_of("add io; let t -> (1, \"two\", 3.5); io.@print(t, t[1]);") ==
+            "(1, \"two\", 3.5) two");
+    REQUIRE(output_of("add io; let m : [string -> int] -> [\"a\" -> 1, \"b\" -> 2];"
+                      "let m[\"c\"] -> 3; let gone -> m.@remove(\"a\");"
+                      "io.@print(m, m[\"b\"], gone, m.@has(\"a\"), m.@keys());") ==
+            "[\"b\" -> 2, \"c\" -> 3] 2 1 false [\"b\", \"c\"]");
+}
+
+TEST_CASE("VM runs builtin collection methods inline", "[vm]") {
+    std::string source =
+        "add io; let arr : [int] -> [1]; let m : [string -> int] -> [\"a\" -> 1];"
+        "let i : int -> 0; while (i < 100) { arr.@push(i); let i -> i + 1; }"
+        "arr.@insert(7, 1); let x -> arr.@remove(2) + arr.@pop();"
+        "io.@print(x, arr.length, m.@has(\"a\"), m.@remove(\"a\"), m.@keys());";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+    RecordingErrorReporter reporter;
+    VM vm(reporter);
+    std::ostringstream code;
+    print_compiled_module(*Compiler(vm.heap()).compile(*built->module, source), code);
+    for (const char* op : {"ArrayPush", "ArrayInsert", "ArrayRemove", "ArrayPop", "AssocHas",
+                           "AssocRemove"}) {
+        REQUIRE(code.str().find(op) != std::string::npos);
+    }
+    // Only io's methods and assoc keys, which has no opcode, remain calls.
+    REQUIRE(code.str().find("'keys'") != std::string::npos);
+    REQUIRE(code.str().find("'push'") == std::string::npos);
+    REQUIRE(output_of(source) == "99 100 true 1 []");
+
+    // The receiver's kind is still checked: nil is a value of every array type.
+    auto empty = run_source("let arr : [int] -> nil; arr.@push(1);");
+    REQUIRE_FALSE(empty->ok);
+    REQUIRE(empty->reporter.saw("Values of type 'nil' have no method 'push'"));
+}
+
+TEST_CASE("VM reads input through io", "[vm]") {
+    auto result = run_source("add io; let line -> io.@read_line(); io.@print(line + \"!\");",
+                             true, "hello\n");
+    REQUIRE(result->ok);
+    REQUIRE(result->output == "hello!");
+}
+
+TEST_CASE("VM reports runtime errors with their location", "[vm]") {
+    auto overflow = run_source("add io; let a : int -> 2147483647; io.@print(1); let b -> a + 1;"
+                               "io.@print(2);");
+    REQUIRE_FALSE(overflow->ok);
+    REQUIRE(overflow->output == "1");
+    REQUIRE(overflow->reporter.saw("Integer overflow"));
+
+    auto zero = run_source("let a : int -> 0; let b -> 1 / a;");
+    REQUIRE_FALSE(zero->ok);
+    REQUIRE(zero->reporter.saw("division by zero"));
+
+    auto range = run_source("let arr -> [1, 2]; let f => { param i : int -> 0; } @ {"
+                            "be arr[i]; }; let x -> @f(5);");
+    REQUIRE_FALSE(range->ok);
+    REQUIRE(range->reporter.saw("Index 5 is out of range (array of length 2)"));
+
+    // Not a tail call, so every invocation keeps its frame
+    auto recursion =
+        run_source("let r => { param n : int -> 0; } @ { be 1 + @r(n + 1); }; @r(0);");
+    REQUIRE_FALSE(recursion->ok);
+    REQUIRE(recursion->reporter.saw("Stack overflow"));
+}
+
+TEST_CASE("VM grows its stack for deep recursion", "[vm]") {
+    // 5000 frames take several times the initial stack, which moves as it grows.
+    REQUIRE(output_of("add io; let sum => { param n : int -> 0; } @ {"
+                      "  if (n == 0) { be 0; } let s -> [n]; be s[0] + @sum(n - 1); };"
+                      "let total -> @sum(5000); io.@print(total, @sum(10));") ==
+            "12502500 55");
+}
+
+TEST_CASE("VM runs tail calls in constant stack space", "[vm]") {
+    // Both recurse far deeper than kMaxFrames.
+    std::string source =
+        "add io; let loop => { param n : int -> 0; param acc : int -> 0; } @ {"
+        "  if (n == 0) { be acc; } be @loop(n - 1, acc + n % 7); };"
+        "let even => { param n : int -> 0; } @ { if (n == 0) { be true; } be @odd(n - 1); };"
+        "let odd => { param n : int -> 0; } @ { if (n == 0) { be false; } be @even(n - 1); };"
+        "io.@print(@loop(100000, 0), @even(50001));";
+    REQUIRE(output_of(source) == "300000 false");
+
+    auto built = build_ir(source);
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(vm.stats().tail_calls == 150001);
+}
+
+TEST_CASE("VM makes tail calls at the frame limit", "[vm]") {
+    // The script's frame and @down(0) to @down(depth) fill all kMaxFrames
+    // frames; the innermost tail call replaces a frame rather than adding one.
+    auto source = [](size_t depth) {
+        return "add io; let leaf => { param n : int -> 0; } @ { be n; };"
+               "let down => { param n : int -> 0; } @ {"
+               "  if (n == 0) { be @leaf(7); } be 1 + @down(n - 1); };"
+               "io.@print(@down(" +
+               std::to_string(depth) + "));";
+    };
+    REQUIRE(output_of(source(VM::kMaxFrames - 2)) == std::to_string(VM::kMaxFrames + 5));
+
+    auto deeper = run_source(source(VM::kMaxFrames - 1));
+    REQUIRE_FALSE(deeper->ok);
+    REQUIRE(deeper->reporter.saw("Stack overflow"));
+}
+
+TEST_CASE("VM collects garbage while keeping reachable values", "[vm]") {
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    std::string source =
+        "add io; let keep : [[int]] -> []; let i : int -> 0;"
+        "while (i < 200000) { let tmp -> [i, i + 1];"
+        "  if (i % 1000 == 0) { keep.@push(tmp); } let i -> i + 1; }"
+        "io.@print(keep.length, keep[199]);";
+    auto built = build_ir(source);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "200 [199000, 199001]");
+    REQUIRE(vm.heap().collections() > 0);
+    REQUIRE(vm.stats().instructions > 200000);
+}
+
+TEST_CASE("VM runs hot chunks as native code", "[vm]") {
+    if (!Jit::kAvailable) return;
+    // `f` gets hot and quickened, then de-quickens on a float; `g` loops with int
+    // division and float comparisons; the script's own loop overflows at the end.
+    std::string source =
+        "add io; let f => { param a : proto -> 0; param b : proto -> 0; } @ { be a + b; };"
+        "let g => { param n : int -> 0; } @ { let k : int -> 0; let t : int -> 0;"
+        "  let x : float64 -> 0.5; while (k < n) { let t -> t + k / 3 - k % 7;"
+        "    if (x < 100.0 and not (x == 50.5)) { let x -> x * 1.5; } let k -> k + 1; }"
+        "  be t; };"
+        "let keep : [int] -> []; let s : proto -> 0; let i : int -> 0;"
+        "while (i < 300) { let s -> @f(s, i); keep.@push(@g(i)); let i -> i + 1; }"
+        "io.@print_line(s, @f(1.5, 2), keep[299]);"
+        "let big : int -> 2147483000; while (true) { let big -> big + 1; }";
+    auto built = build_ir(source);  // Unoptimized, so that `f` and `g` are not inlined
+    for (size_t capacity : {CodeCache::kDefaultCapacity, size_t{0}}) {
+        RecordingErrorReporter reporter;
+        std::ostringstream out;
+        VM vm(reporter, out);
+        vm.enable_jit(capacity);
+        Compiler compiler(vm.heap());
+        REQUIRE_FALSE(vm.run(compiler.compile(*built->module, source), built->globals));
+        REQUIRE(reporter.saw("Integer overflow"));
+        REQUIRE(out.str() == "44850 3.5 13859\n");
+        const JitStats& stats = vm.jit()->stats();
+        if (capacity > 0) {
+            REQUIRE(stats.compiled >= 3);
+            REQUIRE(stats.invalidated >= 1);
+            REQUIRE(stats.entries > 300);
+        } else {
+            REQUIRE(stats.compiled == 0);  // Nothing fits; everything is interpreted
+        }
+    }
+
+    // With room for one chunk at a time, the hot chunks evict each other.
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    vm.enable_jit(4096);
+    std::string loops = "add io; let a => { param n : int -> 0; } @ { be n + 1; };"
+                        "let b => { param n : int -> 0; } @ { be n * 2; };"
+                        "let i : int -> 0; let s : int -> 0;"
+                        "while (i < 1000) { let s -> (@a(s) + @b(i)) % 997; let i -> i + 1; }"
+                        "io.@print(s);";
+    auto looping = build_ir(loops);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*looping->module, loops), looping->globals));
+    REQUIRE(out.str() == "9");
+    REQUIRE(vm.jit()->cache().evictions() > 0);
+    REQUIRE(vm.jit()->cache().used() <= 4096);
+}
+
+TEST_CASE("VM traces hot loops", "[vm]") {
+    if (!Jit::kAvailable) return;
+    // The first loop's branch flips late and leaves its trace through a guard;
+    // the second one's flips every iteration, so its trace is dropped.
+    std::string source =
+        "add io; let p => { let w : int -> 3; }; let xs : [int] -> [1, 2, 3, 4];"
+        "let i : int -> 0; let s : int -> 0; let f : float64 -> 0.0;"
+        "while (i < 5000) { let s -> (s + xs[i % 4] * p.w) % 100003; let f -> f + 0.5;"
+        "  if (i > 4000) { let s -> s + 1; } let i -> i + 1; }"
+        "let j : int -> 0; let odd : int -> 0;"
+        "while (j < 5000) { if (j % 2 == 1) { let odd -> odd + 1; } let j -> j + 1; }"
+        "io.@print_line(s, f, odd);";
+    auto built = build_ir(source);
+    for (bool tracing : {true, false}) {
+        RecordingErrorReporter reporter;
+        std::ostringstream out;
+        VM vm(reporter, out);
+        vm.enable_jit(CodeCache::kDefaultCapacity, tracing);
+        Compiler compiler(vm.heap());
+        REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+        REQUIRE(out.str() == "38499 2500 2500\n");
+        const JitStats& stats = vm.jit()->stats();
+        if (tracing) {
+            REQUIRE(stats.traces >= 2);
+            REQUIRE(stats.blacklisted == 1);
+            REQUIRE(stats.trace_entries > 0);
+        } else {
+            REQUIRE(stats.traces == 0);
+        }
+    }
+}
+
+TEST_CASE("VM moves a long loop into native code while it runs", "[vm]") {
+    if (!Jit::kAvailable) return;
+    // `main` is invoked once; halfway through its loop `p` changes shape,
+    // which breaks the assumption the loop's first trace was recorded with.
+    std::string source =
+        "add io; let a => { let x : int -> 1; }; let b => { let y : int -> 0; let x : int -> 2; };"
+        "set main @ { let p : proto -> a; let i : int -> 0; let s : int -> 0;"
+        "  while (i < 4000) { if (i == 2000) { let p -> b; } let s -> s + p.x; let i -> i + 1; }"
+        "  io.@print_line(s); };";
+    auto built = build_ir(source);
+    for (bool tracing : {true, false}) {
+        RecordingErrorReporter reporter;
+        std::ostringstream out;
+        VM vm(reporter, out);
+        vm.enable_jit(CodeCache::kDefaultCapacity, tracing);
+        Compiler compiler(vm.heap());
+        REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+        REQUIRE(vm.invoke_global(built->globals.find("main")));
+        REQUIRE(out.str() == "6000\n");
+        const JitStats& stats = vm.jit()->stats();
+        REQUIRE(stats.compiled == 1);
+        REQUIRE(stats.osr_entries > 0);
+        if (tracing) {
+            REQUIRE(stats.traces == 2);
+            REQUIRE(stats.trace_invalidated == 1);
+        }
+    }
+}
+
+TEST_CASE("VM deoptimizes code whose assumptions stop holding", "[vm]") {
+    // `a` is inlined behind a check of its act, which fails once it is replaced;
+    // the second loop's trace reads `q.x` once and is dropped when `q` changes shape.
+    std::string source =
+        "add io; let a => { let x : int -> 1; } @ { be x; }; let q => { let x : int -> 5; };"
+        "let i : int -> 0; let s : int -> 0;"
+        "while (i < 3000) { if (i == 1000) { let a @ { be x * 10; }; } let s -> s + @a();"
+        "  let i -> i + 1; }"
+        "let t : int -> 0; let j : int -> 0;"
+        "while (j < 3000) { if (j == 1500) { let q >> { let z : int -> 1; }; }"
+        "  let t -> t + q.x; let j -> j + 1; }"
+        "io.@print_line(s, t);";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    vm.enable_jit();
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "21000 15000\n");
+    REQUIRE(vm.stats().deopts[DeoptReason::Act] == 2000);
+    if (!Jit::kAvailable) return;
+    const JitStats& stats = vm.jit()->stats();
+    REQUIRE(stats.trace_invalidated == 1);
+    REQUIRE(stats.deopts[DeoptReason::Shape] == 0);  // Dropped before it could fail
+}
+
+TEST_CASE("VM runs chunks in the C++ generated for them", "[vm]") {
+    std::string source = "add io; let f => { param n : int -> 0; } @ { be n * 2 + 1; };"
+                         "let i : int -> 0; let s : int -> 0;"
+                         "while (i < 100) { let s -> s + @f(i); let i -> i + 1; }"
+                         "io.@print(s, 2.5 < 3.5);";
+    auto built = build_ir(source);
+    tooi::ir::PassManager().run(*built->module);
+
+    // One function per chunk, entered by position, with int and float64 arithmetic inline.
+    RecordingErrorReporter emit_reporter;
+    VM emitter(emit_reporter);
+    std::unique_ptr<CompiledModule> module =
+        Compiler(emitter.heap()).compile(*built->module, source);
+    std::ostringstream cpp;
+    emit_cpp(*module, source, {}, cpp);
+    REQUIRE(cpp.str().find("uint32_t chunk_0(") != std::string::npos);
+    REQUIRE(cpp.str().find("uint32_t chunk_1(") != std::string::npos);
+    REQUIRE(cpp.str().find("typed_arithmetic<Opcode::Add, int32_t>") != std::string::npos);
+    REQUIRE(cpp.str().find("case 0: goto at_0;") != std::string::npos);
+    REQUIRE(cpp.str().find("tooi::cli::run_compiled(kProgram, argc, argv)") != std::string::npos);
+
+    // A function that hands every instruction back leaves the interpreter to
+    // run the script; one generated from other bytecode is not attached.
+    AotFunction hand_back = [](Value*, const Value*, JitContext*, uint32_t position) {
+        return position;
+    };
+    std::vector<AotFunction> functions(module->functions.size(), hand_back);
+    std::vector<uint64_t> fingerprints;
+    for (const auto& chunk : module->functions) fingerprints.push_back(fingerprint(*chunk));
+    fingerprints.back() ^= 1;
+    AotProgram program{source.c_str(), true, "", functions.data(), fingerprints.data(),
+                       functions.size()};
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    vm.use_aot(program);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    REQUIRE(out.str() == "10000 true");
+    REQUIRE(vm.stats().aot_chunks == functions.size() - 1);
+    REQUIRE(vm.stats().aot_stale == 1);
+    REQUIRE(vm.stats().aot_entries > 0);
+}
+
+TEST_CASE("VM compiles acts on their first invocation", "[vm]") {
+    std::string source =
+        "add io; let fib => { param n : int -> 0; } @ {"
+        "  if (n < 2) { be n; } be @fib(n - 1) + @fib(n - 2); };"
+        "let unused => { param n : int -> 0; } @ { be @fib(n) - 1; };"
+        "io.@print(@fib(15));";
+    auto built = build_ir(source);
+    auto passes = std::make_shared<tooi::ir::PassManager>();
+    passes->run(*built->module, true);
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    Compiler compiler(vm.heap());
+    auto compiled = compiler.compile_lazily(std::move(built->module), source,
+                                            [passes](tooi::ir::Function& act) {
+                                                passes->finish(act);
+                                            });
+    const CompiledModule& module = *compiled;
+    REQUIRE_FALSE(module.functions.front()->code.empty());
+    for (size_t i = 1; i < module.functions.size(); ++i) {
+        REQUIRE(module.functions[i]->code.empty());
+    }
+    REQUIRE(vm.run(std::move(compiled), built->globals));
+    REQUIRE(out.str() == output_of(source));
+    for (const auto& chunk : module.functions) {
+        REQUIRE(chunk->code.empty() == (chunk->name == "unused"));
+    }
+}
+
+TEST_CASE("VM invokes an entry point act", "[vm]") {
+    RecordingErrorReporter reporter;
+    std::ostringstream out;
+    VM vm(reporter, out);
+    std::string source = "add io; set main @ { io.@print_line(\"Hello, Tooi!\"); };";
+    auto built = build_ir(source);
+    Compiler compiler(vm.heap());
+    REQUIRE(vm.run(compiler.compile(*built->module, source), built->globals));
+    int main = built->globals.find("main");
+    REQUIRE(vm.is_invocable(main));
+    REQUIRE(vm.invoke_global(main));
+    REQUIRE(out.str() == "Hello, Tooi!\n");
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Generates the VM's superinstructions from an opcode profile.
+
+Picks the N opcode pairs and triples of the profile written by
+tools/opcode_profile.py that save the most dispatches and whose handlers can
+run back to back, and writes superinstructions.inc: the list the Opcode enum
+and the opcode tables are built from (TOOI_VM_SUPERINSTRUCTIONS) and the
+fused handlers the VM's dispatch loop includes
+(TOOI_VM_SUPERINSTRUCTION_HANDLERS). CMake runs it at build time.
+"""
+
+import argparse
+import re
+
+# Opcodes whose handler bodies vm.cpp defines as TOOI_VM_BODY_<name>.
+STRAIGHT = {"Move", "LoadSelf", "LoadGlobal", "StoreGlobal", "Not", "Truthy"}
+# Jumps end a superinstruction, since the next instruction need not follow them.
+BRANCHES = {"Jump", "JumpIfFalse", "JumpIfTrue"}
+TYPED = re.compile(r"^(Add|Sub|Mul|Div|Mod|Eq|Ne|Lt|Le|Gt|Ge)(I32|I64|U32|U64|F64)$")
+CTYPES = {"I32": "int32_t", "I64": "int64_t", "U32": "uint32_t", "U64": "uint64_t",
+          "F64": "double"}
+ARITHMETIC = {"Add", "Sub", "Mul", "Div", "Mod"}
+
+
+def body(opcode):
+    """The statements that execute one part of a fused handler."""
+    typed = TYPED.match(opcode)
+    if typed:
+        op, family = typed.groups()
+        macro = "ARITHMETIC" if op in ARITHMETIC else "COMPARE"
+        return f"TOOI_VM_TYPED_{macro}_BODY({op}, {CTYPES[family]})"
+    return f"TOOI_VM_BODY_{opcode}"
+
+
+def fusible(opcodes):
+    def straight(opcode):
+        return opcode in STRAIGHT or TYPED.match(opcode) is not None
+
+    return (all(straight(opcode) for opcode in opcodes[:-1]) and
+            (straight(opcodes[-1]) or opcodes[-1] in BRANCHES))
+
+
+def read_profile(path):
+    sequences = []
+    with open(path) as profile:
+        for line in profile:
+            if line.startswith("#") or not line.strip():
+                continue
+            kind, count, *opcodes = line.split()
+            if kind in ("pair", "triple") and fusible(opcodes):
+                # Each fused instruction after the first saves one dispatch.
+                sequences.append((int(count) * (len(opcodes) - 1), opcodes))
+    sequences.sort(key=lambda s: (-s[0], s[1]))
+    return [opcodes for _, opcodes in sequences]
+
+
+def define(name, lines):
+    """A multi-line #define with aligned continuations."""
+    lines = [f"#define {name}"] + lines
+    if len(lines) == 1:
+        return lines[0] + "\n"
+    width = max(len(line) for line in lines) + 1
+    return "\n".join(line.ljust(width) + "\\" for line in lines[:-1]) + "\n" + lines[-1] + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--profile", required=True, help="benchmarks/opcode_profile.txt")
+    parser.add_argument("--top", type=int, default=16, help="superinstructions to generate")
+    parser.add_argument("--out", required=True, help="superinstructions.inc to write")
+    args = parser.parse_args()
+
+    chosen = read_profile(args.profile)[:args.top]
+    entries = []
+    handlers = []
+    for opcodes in chosen:
+        name = "_".join(opcodes)
+        entries.append(f"    X({name}, {', '.join(opcodes)})")
+        handlers.append(f"    TOOI_VM_CASE({name}) : {{")
+        for i, opcode in enumerate(opcodes):
+            if i > 0:
+                handlers.append("        TOOI_VM_FETCH();")
+            handlers.append(f"        {body(opcode)}")
+        handlers.append("        TOOI_VM_NEXT;")
+        handlers.append("    }")
+
+    with open(args.out, "w") as out:
+        out.write("// Generated by tools/gen_superinstructions.py; do not edit.\n")
+        out.write("#pragma once\n\n")
+        out.write(define("TOOI_VM_SUPERINSTRUCTIONS(X)", entries) + "\n")
+        out.write(define("TOOI_VM_SUPERINSTRUCTION_HANDLERS", handlers))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Records opcode pair and triple frequencies over the benchmark corpus.
+
+Runs every script with a tooi built with -DTOOI_VM_PROFILE=ON, which writes
+the instruction sequences it executed to --opcode-profile, and sums them into
+one profile. tools/gen_superinstructions.py turns that profile into the
+superinstructions of the next build.
+
+    cmake -S . -B build-profile -DTOOI_VM_PROFILE=ON
+    cmake --build build-profile
+    tools/opcode_profile.py --tooi build-profile/tooi \\
+        --out benchmarks/opcode_profile.txt benchmarks/*.tooi
+"""
+
+import argparse
+import collections
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def run_script(tooi, script):
+    """Returns the (kind, opcodes) -> count profile of one script."""
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "profile.txt")
+        result = subprocess.run([tooi, "--opcode-profile=" + path, script],
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+        if result.returncode != 0 or not os.path.exists(path):
+            sys.exit(f"{script}: profiling failed\n{result.stderr}")
+        counts = collections.Counter()
+        with open(path) as profile:
+            for line in profile:
+                kind, count, *opcodes = line.split()
+                counts[(kind, tuple(opcodes))] += int(count)
+        return counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--tooi", required=True, help="tooi built with TOOI_VM_PROFILE=ON")
+    parser.add_argument("--out", required=True, help="profile to write")
+    parser.add_argument("scripts", nargs="+", help="benchmark scripts")
+    args = parser.parse_args()
+
+    total = collections.Counter()
+    for script in args.scripts:
+        total.update(run_script(args.tooi, script))
+
+    with open(args.out, "w") as out:
+        out.write("# Opcode sequences executed by fall-through, summed over:\n")
+        for script in args.scripts:
+            out.write(f"#   {os.path.basename(script)}\n")
+        out.write("# Regenerate with tools/opcode_profile.py (see its header).\n")
+        for kind in ("pair", "triple"):
+            sequences = [(count, opcodes) for (k, opcodes), count in total.items() if k == kind]
+            for count, opcodes in sorted(sequences, key=lambda s: (-s[0], s[1])):
+                out.write(f"{kind} {count} {' '.join(opcodes)}\n")
+
+
+if __name__ == "__main__":
+    main()